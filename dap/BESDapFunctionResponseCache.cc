@@ -28,17 +28,19 @@
 //#define DODS_DEBUG
 
 #include <cstdio>
+#include <cstring>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <stdint.h>
+#include <zlib.h>
 
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
-
-#ifdef HAVE_TR1_FUNCTIONAL
-#include <tr1/functional>
-#endif
+#include <vector>
+#include <set>
+#include <memory>
 
 #include <DDS.h>
 #include <ConstraintEvaluator.h>
@@ -60,6 +62,8 @@
 #include "CacheTypeFactory.h"
 #include "CacheMarshaller.h"
 #include "CacheUnMarshaller.h"
+#include "CacheFileMap.h"
+#include "CacheKey.h"
 
 #include "BESDapFunctionResponseCache.h"
 #include "BESDapResponseBuilder.h"
@@ -72,12 +76,6 @@
 
 #define DEBUG_KEY "response_cache"
 
-#ifdef HAVE_TR1_FUNCTIONAL
-#define HASH_OBJ std::tr1::hash
-#else
-#define HASH_OBJ std::hash
-#endif
-
 using namespace std;
 using namespace libdap;
 
@@ -91,6 +89,22 @@ const unsigned int default_cache_size = 20; // 20 GB
 const string default_cache_prefix = "rc";
 const string default_cache_dir = ""; // I'm making the default empty so that no key == no caching. jhrg 9.26.16
 
+// The values of the function result's variables are stored one top-level
+// variable per block, each block a zlib stream. The blocks are followed by a
+// table of their offsets and sizes and a trailer that holds the table's
+// location. The last two characters of the trailer's magic are the version
+// of the block format; in version 01 a block was not compressed if that did
+// not make it smaller.
+struct cached_block {
+    uint64_t offset;    // from the start of the data, just after DATA_MARK
+    uint64_t size;      // as stored
+    uint64_t length;    // uncompressed
+};
+
+const char block_table_magic[8] = { 'B', 'E', 'S', 'F', 'R', 'C', '0', '2' };
+const unsigned int block_table_version_offset = 6;
+const unsigned int block_trailer_size = 2 * sizeof(uint64_t) + sizeof(block_table_magic);
+
 const string BESDapFunctionResponseCache::PATH_KEY = "DAP.FunctionResponseCache.path";
 const string BESDapFunctionResponseCache::PREFIX_KEY = "DAP.FunctionResponseCache.prefix";
 const string BESDapFunctionResponseCache::SIZE_KEY = "DAP.FunctionResponseCache.size";
@@ -262,9 +276,227 @@ bool BESDapFunctionResponseCache::is_valid(const string &cache_file_name, const
     return true;
 }
 
+/**
+ * A streambuf that compresses the values written to it with zlib's deflate()
+ * and writes the result to the cache file in fixed-size chunks. A variable's
+ * values are never held in memory whole, only a chunk of them.
+ */
+class BlockWriter: public streambuf {
+private:
+    static const size_t chunk_size = 64 * 1024;
+
+    ostream &d_out;
+    z_stream d_zs;
+    vector<char> d_in;      // values waiting to be compressed
+    vector<char> d_zbuf;    // compressed values waiting to be written
+    uint64_t d_length;      // uncompressed
+    uint64_t d_size;        // compressed
+
+    void deflate_chunk(int flush)
+    {
+        d_zs.next_in = reinterpret_cast<Bytef*>(pbase());
+        d_zs.avail_in = pptr() - pbase();
+        d_length += d_zs.avail_in;
+
+        do {
+            d_zs.next_out = reinterpret_cast<Bytef*>(&d_zbuf[0]);
+            d_zs.avail_out = d_zbuf.size();
+            if (deflate(&d_zs, flush) == Z_STREAM_ERROR)
+                throw BESInternalError("Could not compress a block for the function response cache.", __FILE__, __LINE__);
+
+            size_t n = d_zbuf.size() - d_zs.avail_out;
+            d_out.write(&d_zbuf[0], n);
+            d_size += n;
+        } while (d_zs.avail_out == 0);
+
+        setp(&d_in[0], &d_in[0] + d_in.size());
+    }
+
+protected:
+    virtual int_type overflow(int_type c)
+    {
+        deflate_chunk(Z_NO_FLUSH);
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+public:
+    BlockWriter(ostream &out) :
+        d_out(out), d_in(chunk_size), d_zbuf(chunk_size), d_length(0), d_size(0)
+    {
+        memset(&d_zs, 0, sizeof(d_zs));
+        if (deflateInit(&d_zs, Z_BEST_SPEED) != Z_OK)
+            throw BESInternalError("Could not initialize zlib for the function response cache.", __FILE__, __LINE__);
+
+        setp(&d_in[0], &d_in[0] + d_in.size());
+    }
+
+    virtual ~BlockWriter()
+    {
+        deflateEnd(&d_zs);
+    }
+
+    /**
+     * Compress and write the values still held and end the block.
+     *
+     * @param blocks Value-result parameter; the block is added to these
+     * @param pos Value-result parameter; the offset of the block in the data
+     */
+    void finish(vector<cached_block> &blocks, uint64_t &pos)
+    {
+        deflate_chunk(Z_FINISH);
+
+        cached_block block;
+        block.offset = pos;
+        block.size = d_size;
+        block.length = d_length;
+        blocks.push_back(block);
+
+        pos += d_size;
+    }
+};
+
+static void write_block_table(ostream &out, const vector<cached_block> &blocks, uint64_t pos)
+{
+    uint64_t count = blocks.size();
+    if (count) out.write(reinterpret_cast<const char*>(&blocks[0]), count * sizeof(cached_block));
+
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(&pos), sizeof(pos));
+    out.write(block_table_magic, sizeof(block_table_magic));
+}
+
+/**
+ * Read the block table from a cache file. Cache files written before the
+ * values were stored in blocks have no table. A file that has a trailer but
+ * whose table cannot be used is an error; its data must not be read as if
+ * there were no table.
+ *
+ * @param in The cache file
+ * @param data_start The position just after DATA_MARK
+ * @param blocks Value-result parameter; the table
+ * @return False if the file has no block table
+ * @exception BESInternalError if the table is from a different version of
+ * the block format or is inconsistent with the file.
+ */
+static bool read_block_table(istream &in, streampos data_start, vector<cached_block> &blocks)
+{
+    in.seekg(0, ios::end);
+    streamoff data_size = in.tellg() - data_start;
+    if (!in || data_size < block_trailer_size) return false;
+
+    uint64_t count;
+    uint64_t table_offset;
+    char magic[sizeof(block_table_magic)];
+    in.seekg(data_start + streamoff(data_size - block_trailer_size));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    in.read(reinterpret_cast<char*>(&table_offset), sizeof(table_offset));
+    in.read(magic, sizeof(magic));
+    if (!in || memcmp(magic, block_table_magic, block_table_version_offset) != 0) return false;
+
+    if (memcmp(magic, block_table_magic, sizeof(magic)) != 0)
+        throw BESInternalError("A function response cache file uses an unknown block format.", __FILE__, __LINE__);
+
+    if (count > (uint64_t) data_size / sizeof(cached_block)
+        || table_offset + count * sizeof(cached_block) + block_trailer_size != (uint64_t) data_size)
+        throw BESInternalError("The block table of a function response cache file is damaged.", __FILE__, __LINE__);
+
+    blocks.resize(count);
+    in.seekg(data_start + streamoff(table_offset));
+    if (count) in.read(reinterpret_cast<char*>(&blocks[0]), count * sizeof(cached_block));
+    if (!in)
+        throw BESInternalError("Could not read the block table of a function response cache file.", __FILE__, __LINE__);
+
+    return true;
+}
+
+/**
+ * Get a block's values from the mapped cache file, uncompressing them.
+ *
+ * @param map The mapped cache file
+ * @param data_start The offset of the position just after DATA_MARK
+ * @param block The block
+ * @param data Value-result parameter; the block's values
+ * @return The memory that holds the values
+ */
+static shared_ptr<CacheFileMap> get_block(shared_ptr<CacheFileMap> map, streampos data_start,
+    const cached_block &block, const char *&data)
+{
+    uint64_t start = (uint64_t) data_start + block.offset;
+    if (start + block.size > map->size())
+        throw BESInternalError("A block in the function response cache is past the end of the file.", __FILE__, __LINE__);
+
+    data = map->data() + start;
+    if (block.length == 0) return map;
+
+    shared_ptr<CacheFileMap> values(new CacheFileMap(block.length));
+    uLongf length = block.length;
+    if (uncompress(reinterpret_cast<Bytef*>(values->buffer()), &length, reinterpret_cast<const Bytef*>(data),
+        block.size) != Z_OK || length != block.length)
+        throw BESInternalError("Could not uncompress a block from the function response cache.", __FILE__, __LINE__);
+
+    data = values->data();
+    return values;
+}
+
+/**
+ * Find the top-level variables a projection needs. This does not parse the
+ * projection (that would set constraints on the variables); it only looks
+ * at the names at the start of each clause.
+ *
+ * @param dds The function result
+ * @param projection The part of the CE that follows the function call(s)
+ * @param names Value-result parameter; the names of the variables
+ * @return False if all of the variables should be loaded; the projection
+ * is empty, includes a selection or uses a name that is not a top-level
+ * variable.
+ */
+static bool get_projected_vars(DDS *dds, const string &projection, set<string> &names)
+{
+    if (projection.empty() || projection.find('&') != string::npos) return false;
+
+    string::size_type start = 0;
+    while (true) {
+        string::size_type comma = projection.find(',', start);
+        string clause = projection.substr(start, comma == string::npos ? string::npos : comma - start);
+        string name = clause.substr(0, clause.find_first_of(".["));
+
+        string::size_type first = name.find_first_not_of(" ");
+        if (first == string::npos) return false;
+        name = name.substr(first, name.find_last_not_of(" ") - first + 1);
+
+        bool found = false;
+        for (DDS::Vars_iter i = dds->var_begin(), e = dds->var_end(); i != e && !found; ++i)
+            found = (*i)->name() == name;
+        if (!found) return false;
+
+        names.insert(name);
+
+        if (comma == string::npos) break;
+        start = comma + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Return the resource ID for the response to a constraint on a dataset.
+ *
+ * The ID holds the dataset's name and version (so a changed dataset is not
+ * answered from the cache) and the constraint in canonical form (so the
+ * same function calls, written differently, share one cached response).
+ *
+ * @param dds The DDS of the dataset
+ * @param constraint The function part of the CE
+ * @return The resource ID
+ * @see make_cache_key()
+ */
 string BESDapFunctionResponseCache::get_resource_id(DDS *dds, const string &constraint)
 {
-    return dds->filename() + "#" + constraint;
+    return make_cache_key(dds->filename(), constraint);
 }
 
 bool BESDapFunctionResponseCache::can_be_cached(DDS *dds, const string &constraint)
@@ -284,13 +516,8 @@ bool BESDapFunctionResponseCache::can_be_cached(DDS *dds, const string &constrai
  */
 string BESDapFunctionResponseCache::get_hash_basename(const string &resource_id)
 {
-    // Get a hash function for strings
-    HASH_OBJ<string> str_hash;
-    size_t hashValue = str_hash(resource_id);
-    stringstream hashed_id;
-    hashed_id << hashValue;
     string cache_file_name = get_cache_directory();
-    cache_file_name.append("/").append(get_cache_file_prefix()).append(hashed_id.str());
+    cache_file_name.append("/").append(get_cache_file_prefix()).append(hash_cache_key(resource_id));
 
     return cache_file_name;
 }
@@ -313,31 +540,22 @@ string BESDapFunctionResponseCache::get_hash_basename(const string &resource_id)
  *
  * @param dds
  * @param constraint
- * @param eval
+ * @param projection The rest of the CE. If given, only the variables it
+ * names are read from a cached result; the others are not marked as read.
  * @return
  */
 DDS *
-BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constraint)
+BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constraint, const string &projection)
 {
     // Build the response_id. Since the response content is a function of both the dataset AND the constraint,
     // glue them together to get a unique id for the response.
-    string resourceId = dds->filename() + "#" + constraint;
+    string resourceId = get_resource_id(dds, constraint);
 
     BESDEBUG(DEBUG_KEY, __FUNCTION__ << " resourceId: '" << resourceId << "'" << endl);
 
-    // Get a hash function for strings
-    HASH_OBJ<string> str_hash;
-
-    // Use the hash function to hash the resourceId.
-    size_t hashValue = str_hash(resourceId);
-    stringstream hashed_id;
-    hashed_id << hashValue;
-
-    BESDEBUG(DEBUG_KEY,  __FUNCTION__ << " hashed_id: '" << hashed_id.str() << "'" << endl);
-
     // Use the parent class's get_cache_file_name() method and its associated machinery to get the file system path for the cache file.
     // We store it in a variable called basename because the value is later extended as part of the collision avoidance code.
-    string cache_file_name = BESFileLockingCache::get_cache_file_name(hashed_id.str(), false);
+    string cache_file_name = BESFileLockingCache::get_cache_file_name(hash_cache_key(resourceId), false);
 
     BESDEBUG(DEBUG_KEY,  __FUNCTION__ << " cache_file_name: '" << cache_file_name << "'" << endl);
 
@@ -345,7 +563,7 @@ BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constr
     // cache_file_name is updated to be the correct name for write_dataset_
     // to_cache().
     DDS *ret_dds = 0;
-    if ((ret_dds = load_from_cache(resourceId, cache_file_name))) {
+    if ((ret_dds = load_from_cache(resourceId, cache_file_name, projection))) {
         BESDEBUG(DEBUG_KEY, __FUNCTION__ << " Data loaded from cache file: " << cache_file_name << endl);
         ret_dds->filename(dds->filename());
     }
@@ -354,7 +572,7 @@ BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constr
     }
     // get_read_lock() returns immediately if the file does not exist,
     // but blocks waiting to get a shared lock if the file does exist.
-    else if ((ret_dds = load_from_cache(resourceId, cache_file_name))) {
+    else if ((ret_dds = load_from_cache(resourceId, cache_file_name, projection))) {
         BESDEBUG(DEBUG_KEY,  __FUNCTION__ << " Data loaded from cache file (2nd try): " << cache_file_name << endl);
         ret_dds->filename(dds->filename());
     }
@@ -377,11 +595,13 @@ BESDapFunctionResponseCache::get_or_cache_dataset(DDS *dds, const string &constr
  * function call part of the CE that built the cached response.
  * @param cache_file_name Value-result parameter: The basename of a cache
  * file that _may_ contain the correct response.
+ * @param projection Only read the variables this projection needs
  * @return A pointer to a newly allocated DDS that contains data if the cache file
  * held the correct response, null otherwise.
  */
 DDS *
-BESDapFunctionResponseCache::load_from_cache(const string &resource_id, string &cache_file_name)
+BESDapFunctionResponseCache::load_from_cache(const string &resource_id, string &cache_file_name,
+    const string &projection)
 {
     BESDEBUG(DEBUG_KEY, __FUNCTION__ << " resource_id: " << resource_id << endl);
 
@@ -431,7 +651,13 @@ BESDapFunctionResponseCache::load_from_cache(const string &resource_id, string &
                 BESDEBUG(DEBUG_KEY, "BESDapFunctionResponseCache::load_from_cache() - Cache Hit!" << endl);
 
                 // non-null value value for cached_dds will exit the loop
-                cached_dds = read_cached_data(cache_file_istream);
+                try {
+                    cached_dds = read_cached_data(cache_file_istream, cfname.str(), projection);
+                }
+                catch (...) {
+                    unlock_and_close(cfname.str());
+                    throw;
+                }
             }
 
             unlock_and_close(cfname.str());
@@ -446,9 +672,21 @@ BESDapFunctionResponseCache::load_from_cache(const string &resource_id, string &
 /**
  * Read data from cache. Allocates a new DDS using the given factory.
  *
+ * The values are read from the cache file mapped into memory. Sequences of
+ * scalars keep a reference to that memory and read their rows from it when
+ * they are serialized (see CachedSequence).
+ *
+ * Only the variables named by the projection are read; the rest are left
+ * with read_p() false. If the projection is empty, or cannot be matched to
+ * the top-level variables, all of the variables are read.
+ *
+ * @param cached_data The cache file, positioned after the resource id
+ * @param cache_file_name The cache file's name
+ * @param projection The rest of the CE
  */
 DDS *
-BESDapFunctionResponseCache::read_cached_data(istream &cached_data)
+BESDapFunctionResponseCache::read_cached_data(istream &cached_data, const string &cache_file_name,
+    const string &projection)
 {
     // Build a CachedSequence; all other types are as BaseTypeFactory builds
     CacheTypeFactory factory;
@@ -469,16 +707,50 @@ BESDapFunctionResponseCache::read_cached_data(istream &cached_data)
         throw BESInternalError(e.get_error_message(), __FILE__, __LINE__);
     }
 
-    CacheUnMarshaller um(cached_data);
+    streampos data_start = cached_data.tellg();
 
-    for (DDS::Vars_iter i = fdds->var_begin(), e = fdds->var_end(); i != e; ++i) {
-        (*i)->deserialize(um, fdds);
+    shared_ptr<CacheFileMap> map(new CacheFileMap(cache_file_name));
+    if ((uint64_t) data_start > map->size())
+        throw BESInternalError("The function response cache file '" + cache_file_name + "' is truncated.", __FILE__, __LINE__);
+
+    set<string> projected;
+    bool only_projected = get_projected_vars(fdds, projection, projected);
+
+    vector<cached_block> blocks;
+    if (read_block_table(cached_data, data_start, blocks)) {
+        if (blocks.size() != (vector<cached_block>::size_type) (fdds->var_end() - fdds->var_begin()))
+            throw BESInternalError("The block table of the function response cache file '" + cache_file_name
+                + "' does not match its variables.", __FILE__, __LINE__);
+
+        vector<cached_block>::const_iterator block = blocks.begin();
+        for (DDS::Vars_iter i = fdds->var_begin(), e = fdds->var_end(); i != e; ++i, ++block) {
+            if (only_projected && projected.find((*i)->name()) == projected.end()) {
+                BESDEBUG(DEBUG_KEY, __FUNCTION__ << " - Not reading " << (*i)->name() << endl);
+                (*i)->set_read_p(false);
+                continue;
+            }
+
+            const char *data;
+            shared_ptr<CacheFileMap> values = get_block(map, data_start, *block, data);
+
+            CacheUnMarshaller um(values, data, block->length);
+            (*i)->deserialize(um, fdds);
+            (*i)->set_read_p(true);
+        }
     }
+    else {
+        // A cache file without blocks; the values follow DATA_MARK
+        CacheUnMarshaller um(map, map->data() + data_start, map->size() - data_start);
 
-    // mark everything as read. And 'to send.' That is, make sure that when a response
-    // is retrieved from the cache, all of the variables are marked as 'to be sent.'
+        for (DDS::Vars_iter i = fdds->var_begin(), e = fdds->var_end(); i != e; ++i) {
+            (*i)->deserialize(um, fdds);
+            (*i)->set_read_p(true);
+        }
+    }
+
+    // Make sure that when a response is retrieved from the cache, all of the
+    // variables are marked as 'to be sent.'
     for (DDS::Vars_iter i = fdds->var_begin(), e = fdds->var_end(); i != e; ++i) {
-        (*i)->set_read_p(true);
         (*i)->set_send_p(true);
 
         // For Sequences, deserialize() will update the 'current row number,' which
@@ -548,17 +820,30 @@ BESDapFunctionResponseCache::write_dataset_to_cache(DDS *dds, const string &reso
             // Define the scope of the StreamMarshaller because for some types it will use
             // a child thread to send data and it's dtor will wait for that thread to complete.
             // We want that before we close the output stream (cache_file_stream) jhrg 5/6/16
-            {
-                ConstraintEvaluator new_ce;
-                CacheMarshaller m(cache_file_ostream);
-
-                for (DDS::Vars_iter i = fdds->var_begin(); i != fdds->var_end(); i++) {
-                    if ((*i)->send_p()) {
+            //
+            // Each variable is written to its own block so that it can be read
+            // without reading the others.
+            ConstraintEvaluator new_ce;
+            vector<cached_block> blocks;
+            uint64_t pos = 0;
+
+            for (DDS::Vars_iter i = fdds->var_begin(); i != fdds->var_end(); i++) {
+                if ((*i)->send_p()) {
+                    BlockWriter block(cache_file_ostream);
+                    ostream block_ostream(&block);
+                    {
+                        CacheMarshaller m(block_ostream);
                         (*i)->serialize(new_ce, *fdds, m, false);
                     }
+                    block.finish(blocks, pos);
                 }
             }
 
+            write_block_table(cache_file_ostream, blocks, pos);
+            cache_file_ostream.flush();
+            if (!cache_file_ostream)
+                throw BESInternalError("Could not write the cached response to '" + cache_file_name + "'.", __FILE__, __LINE__);
+
             // Change the exclusive locks on the new file to a shared lock. This keeps
             // other processes from purging the new file and ensures that the reading
             // process can use it.
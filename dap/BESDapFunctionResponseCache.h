@@ -66,6 +66,12 @@ class BaseTypeFactory;
  * each cache entry contains the resource id as its first line so that the correct
  * entry can be identified.
  *
+ * @note The values of each top-level variable are stored as a separate block,
+ * compressed using zlib as they are written, and the blocks are followed by a
+ * table of their offsets.
+ * When a response is read from the cache, only the variables named in the
+ * projection part of the CE are read.
+ *
  * @author ndp, jhrg
  */
 
@@ -95,12 +101,14 @@ private:
     std::string get_resource_id(libdap::DDS *dds, const std::string &constraint);
     std::string get_hash_basename(const std::string &resource_id);
 
-    libdap::DDS *read_cached_data(istream &cached_data);
+    libdap::DDS *read_cached_data(istream &cached_data, const std::string &cache_file_name,
+        const std::string &projection = "");
 
     libdap::DDS *write_dataset_to_cache(libdap::DDS *dds, const string &resourceId, const string &constraint,
         const string &cache_file_name);
 
-    libdap::DDS *load_from_cache(const string &resource_id, string &cache_file_name);
+    libdap::DDS *load_from_cache(const string &resource_id, string &cache_file_name,
+        const std::string &projection = "");
 
     friend class FunctionResponseCacheTest;
     friend class StoredResultTest;
@@ -139,7 +147,8 @@ public:
 
     // If the DDS is in the cache and valid, return it otherwise, build the dds, cache it and return it.
     // TODO cache_dataset() was too confusing, but get_or_... is not that great either
-    virtual libdap::DDS *get_or_cache_dataset(libdap::DDS *dds, const std::string &constraint);
+    virtual libdap::DDS *get_or_cache_dataset(libdap::DDS *dds, const std::string &constraint,
+        const std::string &projection = "");
 
     virtual bool can_be_cached(libdap::DDS *dds, const std::string &constraint);
 
@@ -75,6 +75,7 @@ using std::endl;
 #include "DapFunctionUtils.h"
 #include "ServerFunctionsList.h"
 #include "ShowPathInfoResponseHandler.h"
+#include "ShowStoredResultResponseHandler.h"
 
 
 void BESDapModule::initialize(const string &modname)
@@ -119,6 +120,9 @@ void BESDapModule::initialize(const string &modname)
     BESDEBUG("dap", "    adding " << SHOW_PATH_INFO_RESPONSE << " response handler" << endl ) ;
     BESResponseHandlerList::TheList()->add_handler( SHOW_PATH_INFO_RESPONSE, ShowPathInfoResponseHandler::ShowPathInfoResponseBuilder ) ;
 
+    BESDEBUG("dap", "    adding " << SHOW_STORED_RESULT_RESPONSE << " response handler" << endl ) ;
+    BESResponseHandlerList::TheList()->add_handler( SHOW_STORED_RESULT_RESPONSE, ShowStoredResultResponseHandler::ShowStoredResultResponseBuilder ) ;
+
 	BESDEBUG("dap", "    adding dap debug context" << endl);
 	BESDebug::Register("dap");
 
@@ -0,0 +1,249 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <string>
+
+#include <BaseType.h>
+#include <D4Group.h>
+
+#include "BESDataHandlerInterface.h"
+#include "BESContainer.h"
+#include "BESRequestHandler.h"
+#include "BESRequestHandlerList.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+
+#include "BESDapReadAhead.h"
+
+using namespace std;
+using namespace libdap;
+
+static const string READ_AHEAD_KEY = "DAP.ReadAhead";
+
+/// Can this variable be read on a worker thread?
+static bool can_read_ahead(BaseType *var)
+{
+    switch (var->type()) {
+    case dods_array_c:
+        return var->var() && var->var()->is_simple_type();
+    case dods_grid_c:
+        return true;
+    default:
+        return var->is_simple_type();
+    }
+}
+
+/**
+ * @brief Start reading the first variables
+ *
+ * @param vars The variables, in the order they will be used. Variables
+ * that cannot be read ahead are ignored.
+ * @param window Read at most this many variables ahead; zero turns
+ * read-ahead off. See get_read_ahead().
+ */
+BESDapReadAhead::BESDapReadAhead(const vector<BaseType*> &vars, unsigned int window) :
+    d_window(window), d_next(0), d_current(0), d_stop(false)
+{
+    pthread_mutex_init(&d_mutex, 0);
+    pthread_cond_init(&d_cond, 0);
+
+    if (d_window == 0) return;
+
+    for (vector<BaseType*>::const_iterator i = vars.begin(), e = vars.end(); i != e; ++i) {
+        if (can_read_ahead(*i) && !(*i)->read_p()) d_vars.push_back(*i);
+    }
+
+    // One variable is read by the caller; only read ahead if there are more
+    if (d_vars.size() < 2) return;
+
+    d_state.resize(d_vars.size(), waiting);
+
+    unsigned int threads = d_window < d_vars.size() ? d_window : d_vars.size();
+    BESDEBUG("dap", "BESDapReadAhead - Reading " << d_vars.size() << " variables using " << threads << " threads" << endl);
+
+    for (unsigned int i = 0; i < threads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, 0, reader, this) != 0) break;
+        d_threads.push_back(thread);
+    }
+}
+
+/**
+ * Stop the worker threads. Reads that have started are finished first.
+ */
+BESDapReadAhead::~BESDapReadAhead()
+{
+    pthread_mutex_lock(&d_mutex);
+    d_stop = true;
+    pthread_cond_broadcast(&d_cond);
+    pthread_mutex_unlock(&d_mutex);
+
+    for (vector<pthread_t>::iterator i = d_threads.begin(), e = d_threads.end(); i != e; ++i)
+        pthread_join(*i, 0);
+
+    pthread_cond_destroy(&d_cond);
+    pthread_mutex_destroy(&d_mutex);
+}
+
+/**
+ * @brief How many variables of this request's data response can be read ahead?
+ *
+ * @param dhi The request; its current container is the dataset
+ * @return The number of variables set by DAP.ReadAhead, or zero if the
+ * container's handler does not support concurrent reads.
+ */
+unsigned int BESDapReadAhead::get_read_ahead(BESDataHandlerInterface &dhi)
+{
+    int read_ahead = TheBESKeys::TheKeys()->read_int_key(READ_AHEAD_KEY, 0);
+    if (read_ahead <= 0 || !dhi.container) return 0;
+
+    BESRequestHandler *handler = BESRequestHandlerList::TheList()->find_handler(dhi.container->get_container_type());
+    if (!handler || !handler->supports_concurrent_reads()) {
+        BESDEBUG("dap", "BESDapReadAhead - The '" << dhi.container->get_container_type()
+            << "' handler does not support concurrent reads; not reading ahead" << endl);
+        return 0;
+    }
+
+    return read_ahead;
+}
+
+void *BESDapReadAhead::reader(void *arg)
+{
+    static_cast<BESDapReadAhead*>(arg)->read_vars();
+    return 0;
+}
+
+/**
+ * The worker threads run this. Each takes the next variable that is
+ * within d_window of the caller's variable and reads it.
+ */
+void BESDapReadAhead::read_vars()
+{
+    pthread_mutex_lock(&d_mutex);
+    while (true) {
+        while (!d_stop && d_next < d_vars.size() && d_next > d_current + d_window)
+            pthread_cond_wait(&d_cond, &d_mutex);
+
+        if (d_stop || d_next >= d_vars.size()) break;
+
+        unsigned int n = d_next++;
+        if (d_state[n] != waiting) continue;    // the caller got to it first
+        d_state[n] = reading;
+
+        pthread_mutex_unlock(&d_mutex);
+
+        BaseType *var = d_vars[n];
+        try {
+            var->read();
+        }
+        catch (...) {
+            // Let the caller read it again and report the error
+            var->set_read_p(false);
+        }
+
+        pthread_mutex_lock(&d_mutex);
+        d_state[n] = done;
+        pthread_cond_broadcast(&d_cond);
+    }
+    pthread_mutex_unlock(&d_mutex);
+}
+
+/**
+ * @brief Wait until a variable can be used by the caller
+ *
+ * Call this for each variable, in order, before it is serialized. If the
+ * variable is being read, this waits for the read to finish; if it has not
+ * been started, it is left for the caller to read. Either way, reads of the
+ * variables that follow it are started.
+ *
+ * @param var The variable
+ */
+void BESDapReadAhead::wait(BaseType *var)
+{
+    if (d_threads.empty()) return;
+
+    pthread_mutex_lock(&d_mutex);
+
+    unsigned int n = d_current;
+    while (n < d_vars.size() && d_vars[n] != var)
+        ++n;
+
+    if (n < d_vars.size()) {
+        d_current = n;
+        pthread_cond_broadcast(&d_cond);
+
+        while (d_state[n] == reading)
+            pthread_cond_wait(&d_cond, &d_mutex);
+
+        d_state[n] = done;
+    }
+
+    pthread_mutex_unlock(&d_mutex);
+}
+
+/**
+ * @brief Start reading the projected variables of a DAP4 response
+ *
+ * @param out Write the response here
+ * @param root The root group of the response
+ * @param window Read at most this many variables ahead; see
+ * BESDapReadAhead::get_read_ahead().
+ */
+BESDapReadAheadMarshaller::BESDapReadAheadMarshaller(ostream &out, D4Group *root, unsigned int window) :
+    D4StreamMarshaller(out), d_next(0), d_read_ahead(0)
+{
+    if (window == 0) return;
+
+    projected_vars(root, d_vars);
+    d_read_ahead = new BESDapReadAhead(d_vars, window);
+}
+
+BESDapReadAheadMarshaller::~BESDapReadAheadMarshaller()
+{
+    delete d_read_ahead;
+}
+
+/// Add the projected variables of 'group' in the order D4Group::serialize() sends them
+void BESDapReadAheadMarshaller::projected_vars(D4Group *group, vector<BaseType*> &vars)
+{
+    for (D4Group::groupsIter g = group->grp_begin(), e = group->grp_end(); g != e; ++g)
+        projected_vars(*g, vars);
+
+    for (Constructor::Vars_iter i = group->var_begin(), e = group->var_end(); i != e; ++i) {
+        if ((*i)->send_p()) vars.push_back(*i);
+    }
+}
+
+/**
+ * Wait for the next variable, which is about to be sent, and then reset
+ * the checksum.
+ */
+void BESDapReadAheadMarshaller::reset_checksum()
+{
+    if (d_read_ahead && d_next < d_vars.size()) d_read_ahead->wait(d_vars[d_next++]);
+
+    D4StreamMarshaller::reset_checksum();
+}
@@ -0,0 +1,116 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _bes_dap_read_ahead_h
+#define _bes_dap_read_ahead_h
+
+#include <pthread.h>
+
+#include <vector>
+
+#include <D4StreamMarshaller.h>
+
+namespace libdap {
+class BaseType;
+class D4Group;
+}
+
+class BESDataHandlerInterface;
+
+/**
+ * @brief Read variables on worker threads ahead of their use
+ *
+ * While one variable of a data response is serialized (or interned), the
+ * read() methods of the next N variables run on N worker threads. The
+ * variables are still used in their original order and at most N variables
+ * are read ahead, so the response and its memory use are the same as when
+ * the variables are read one at a time.
+ *
+ * N is set with DAP.ReadAhead; zero (the default) turns read-ahead off.
+ * Read-ahead is only used for the datasets of handlers that support
+ * concurrent reads (see BESRequestHandler::supports_concurrent_reads()).
+ *
+ * Only Arrays of simple types, Grids and simple types are read ahead. A
+ * variable whose read() fails on a worker thread is read again, by the
+ * caller, so that the error is reported as usual.
+ */
+class BESDapReadAhead {
+private:
+    enum state { waiting, reading, done };
+
+    std::vector<libdap::BaseType*> d_vars;  // in the order they are used
+    std::vector<state> d_state;
+
+    unsigned int d_window;  // read at most this many variables ahead
+    unsigned int d_next;    // the next variable to read
+    unsigned int d_current; // the variable the caller is using
+    bool d_stop;
+
+    pthread_mutex_t d_mutex;
+    pthread_cond_t d_cond;
+    std::vector<pthread_t> d_threads;
+
+    static void *reader(void *arg);
+    void read_vars();
+
+    BESDapReadAhead(const BESDapReadAhead &);
+    BESDapReadAhead &operator=(const BESDapReadAhead &);
+
+public:
+    BESDapReadAhead(const std::vector<libdap::BaseType*> &vars, unsigned int window);
+    virtual ~BESDapReadAhead();
+
+    static unsigned int get_read_ahead(BESDataHandlerInterface &dhi);
+
+    void wait(libdap::BaseType *var);
+};
+
+/**
+ * @brief Read the variables of a DAP4 data response ahead
+ *
+ * D4Group::serialize() calls reset_checksum() before it sends each
+ * projected variable at the top level of a group, visiting the child groups
+ * before the group's own variables. This marshaller waits for the variable
+ * that is about to be sent in reset_checksum(), so the response can be sent
+ * using D4Group::serialize().
+ */
+class BESDapReadAheadMarshaller: public libdap::D4StreamMarshaller {
+private:
+    std::vector<libdap::BaseType*> d_vars;  // in the order they are sent
+    unsigned int d_next;
+    BESDapReadAhead *d_read_ahead;
+
+    static void projected_vars(libdap::D4Group *group, std::vector<libdap::BaseType*> &vars);
+
+    BESDapReadAheadMarshaller(const BESDapReadAheadMarshaller &);
+    BESDapReadAheadMarshaller &operator=(const BESDapReadAheadMarshaller &);
+
+public:
+    BESDapReadAheadMarshaller(std::ostream &out, libdap::D4Group *root, unsigned int window);
+    virtual ~BESDapReadAheadMarshaller();
+
+    virtual void reset_checksum();
+};
+
+#endif // _bes_dap_read_ahead_h
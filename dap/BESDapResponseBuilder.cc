@@ -49,13 +49,13 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <vector>
 
 #include <cstring>
 #include <ctime>
 
 //#define DODS_DEBUG
 #define CLEAR_LOCAL_DATA
-#undef USE_LOCAL_TIMEOUT_SCHEME
 
 #include <DAS.h>
 #include <DDS.h>
@@ -82,19 +82,15 @@
 #include <mime_util.h>	// for last_modified_time() and rfc_822_date()
 #include <escaping.h>
 #include <util.h>
-#if USE_LOCAL_TIMEOUT_SCHEME
-#ifndef WIN32
-#include <SignalHandler.h>
-#include <EventHandler.h>
-#include <AlarmHandler.h>
-#endif
-#endif
 
 #include "TheBESKeys.h"
 #include "BESDapResponseBuilder.h"
 #include "BESContextManager.h"
 #include "BESDapFunctionResponseCache.h"
+#include "BESDapReadAhead.h"
+#include "BESDeadline.h"
 #include "BESStoredDapResultCache.h"
+#include "BESStoredResultJobs.h"
 
 #include "BESResponseObject.h"
 #include "BESDDSResponse.h"
@@ -137,12 +133,6 @@ void BESDapResponseBuilder::initialize()
 
 BESDapResponseBuilder::~BESDapResponseBuilder()
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // If an alarm was registered, delete it. The register code in SignalHandler
-    // always deletes the old alarm handler object, so only the one returned by
-    // remove_handler needs to be deleted at this point.
-    delete dynamic_cast<AlarmHandler*>(SignalHandler::instance()->remove_handler(SIGALRM));
-#endif
 }
 
 /** Return the entire DAP2 constraint expression in a string.  This
@@ -271,7 +261,6 @@ void BESDapResponseBuilder::set_dataset_name(const string ds)
 /** Set the server's timeout value. A value of zero (the default) means no
  timeout.
 
- @see To establish a timeout, call establish_timeout(ostream &)
  @param t Server timeout in seconds. Default is zero (no timeout). */
 void BESDapResponseBuilder::set_timeout(int t)
 {
@@ -285,93 +274,70 @@ int BESDapResponseBuilder::get_timeout() const
 }
 
 /**
- * Turn on the alarm. The code will timeout after d_timeout
- * seconds unless timeout_off() is called first.
+ * Does nothing; requests are timed by BESDeadline.
  *
  * @deprecated
  */
 void
 BESDapResponseBuilder::timeout_on() const
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-#ifndef WIN32
-    alarm(d_timeout);
-#endif
-#endif
 }
 
 /**
- * Turn off the timeout.
+ * Does nothing; requests are timed by BESDeadline.
  *
  * @deprecated
  */
 void
 BESDapResponseBuilder::timeout_off()
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-#ifndef WIN32
-    alarm(0);
-#endif
-#endif
 }
 
 /**
- * If the value of the BES Key BES.CancelTimeoutOnSend is true, cancel the
- * timeout. The intent of this is to stop the timeout counter once the
- * BES starts sending data back since, the network link used by a remote
- * client may be low-bandwidth and data providers might want to ensure those
- * users get their data (and don't submit second, third, ..., requests when/if
- * the first one fails). The timeout is initiated in the BES framework when it
- * first processes the request.
+ * Does nothing; requests are timed by BESDeadline.
  *
- * @note The BES timeout is set/controlled in bes/dispatch/BESInterface
- * in the 'int BESInterface::execute_request(const string &from)' method.
- *
- * @see BESInterface::execute_request(const string &from)
+ * @deprecated
  */
-void BESDapResponseBuilder::conditional_timeout_cancel()
+void BESDapResponseBuilder::register_timeout() const
 {
-    if (d_cancel_timeout_on_send)
-        alarm(0);
 }
 
 /**
- * Configure a signal handler for the SIGALRM. The signal handler
- * will throw a DAP Error object if the alarm signal is triggered.
+ * Does nothing; requests are timed by BESDeadline.
  *
  * @deprecated
- *
- * @return void
  */
-void BESDapResponseBuilder::register_timeout() const
+void BESDapResponseBuilder::establish_timeout(ostream &) const
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-#ifndef WIN32
-    SignalHandler *sh = SignalHandler::instance();
-    EventHandler *old_eh = sh->register_handler(SIGALRM, new AlarmHandler());
-    delete old_eh;
-#endif
-#endif
 }
 
-
-/** Use values of this instance to establish a timeout alarm for the server.
- * If the timeout value is zero, do nothing.
+/**
+ * Does nothing; requests are timed by BESDeadline.
  *
  * @deprecated
  */
-void BESDapResponseBuilder::establish_timeout(ostream &) const
+void BESDapResponseBuilder::remove_timeout() const
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-#ifndef WIN32
-    if (d_timeout > 0) {
-        SignalHandler *sh = SignalHandler::instance();
-        EventHandler *old_eh = sh->register_handler(SIGALRM, new AlarmHandler());
-        delete old_eh;
-        alarm(d_timeout);
-    }
-#endif
-#endif
+}
+
+/**
+ * If the value of the BES Key BES.CancelTimeoutOnSend is true, cancel the
+ * timeout. The intent of this is to stop the timeout counter once the
+ * BES starts sending data back since, the network link used by a remote
+ * client may be low-bandwidth and data providers might want to ensure those
+ * users get their data (and don't submit second, third, ..., requests when/if
+ * the first one fails). The timeout is initiated in the BES framework when it
+ * first processes the request.
+ *
+ * @note The BES timeout is set/controlled in bes/dispatch/BESInterface
+ * in the 'int BESInterface::execute_request(const string &from)' method.
+ *
+ * @see BESInterface::execute_request(const string &from)
+ */
+void BESDapResponseBuilder::conditional_timeout_cancel()
+{
+    if (d_cancel_timeout_on_send)
+        BESDeadline::TheDeadline()->cancel();
 }
 
 /**
@@ -525,11 +491,6 @@ void BESDapResponseBuilder::send_das(ostream &out, DAS &das, bool with_mime_head
 void BESDapResponseBuilder::send_das(ostream &out, DDS **dds, ConstraintEvaluator &eval, bool constrained,
     bool with_mime_headers)
 {
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // Set up the alarm.
-    establish_timeout(out);
-    dds.set_timeout(d_timeout);
-#endif
     if (!constrained) {
         if (with_mime_headers) set_mime_text(out, dods_das, x_plain, last_modified_time(d_dataset), "2.0");
 
@@ -616,12 +577,6 @@ void BESDapResponseBuilder::send_dds(ostream &out, DDS **dds, ConstraintEvaluato
         return;
     }
 
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // Set up the alarm.
-    establish_timeout(out);
-    dds.set_timeout(d_timeout);
-#endif
-
     // Split constraint into two halves
     split_ce(eval);
 
@@ -805,9 +760,18 @@ void BESDapResponseBuilder::serialize_dap2_data_dds(ostream &out, DDS **dds, Con
     // is set. Otherwise it does nothing.
     conditional_timeout_cancel();
 
+    vector<BaseType*> projected;
+    for (DDS::Vars_iter i = (*dds)->var_begin(); i != (*dds)->var_end(); i++) {
+        if ((*i)->send_p()) projected.push_back(*i);
+    }
+
+    // When read-ahead is on, the next variables are read while this one is sent
+    BESDapReadAhead read_ahead(projected, d_read_ahead);
+
     // Send all variables in the current projection (send_p())
     for (DDS::Vars_iter i = (*dds)->var_begin(); i != (*dds)->var_end(); i++) {
         if ((*i)->send_p()) {
+            read_ahead.wait(*i);
             (*i)->serialize(eval, **dds, m, ce_eval);
 #ifdef CLEAR_LOCAL_DATA
             (*i)->clear_local_data();
@@ -871,29 +835,6 @@ void BESDapResponseBuilder::serialize_dap2_data_ddx(ostream &out, DDS **dds, Con
 }
 #endif
 
-/** Send the data in the DDS object back to the client program. The data is
- encoded using a Marshaller, and enclosed in a MIME document which is all sent
- to \c data_stream.
-
- @note This is the DAP2 data response.
-
- @brief Transmit data.
- @param dds A DDS object containing the data to be sent.
- @param eval A reference to the ConstraintEvaluator to use.
- @param data_stream Write the response to this stream.
- @param anc_location A directory to search for ancillary files (in
- addition to the CWD).  This is used in a call to
- get_data_last_modified_time().
- @param with_mime_headers If true, include the MIME headers in the response.
- Defaults to true.
- @return void */
-void BESDapResponseBuilder::remove_timeout() const
-{
-#if USE_LOCAL_TIMEOUT_SCHEME
-    alarm(0);
-#endif
-}
-
 /**
  * @brief Process a DDS (i.e., apply a constraint) for a non-DAP transmitter.
  *
@@ -938,7 +879,7 @@ BESDapResponseBuilder::process_dap2_dds(BESResponseObject *obj, BESDataHandlerIn
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
         if (responseCache && responseCache->can_be_cached(dds, get_btp_func_ce())) {
-            fdds = responseCache->get_or_cache_dataset(dds, get_btp_func_ce());
+            fdds = responseCache->get_or_cache_dataset(dds, get_btp_func_ce(), get_ce());
         }
         else {
             func_eval.parse_constraint(get_btp_func_ce(), *dds);
@@ -1018,7 +959,7 @@ BESDapResponseBuilder::intern_dap2_data(BESResponseObject *obj, BESDataHandlerIn
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
         if (responseCache && responseCache->can_be_cached(dds, get_btp_func_ce())) {
-            fdds = responseCache->get_or_cache_dataset(dds, get_btp_func_ce());
+            fdds = responseCache->get_or_cache_dataset(dds, get_btp_func_ce(), get_ce());
         }
         else {
             func_eval.parse_constraint(get_btp_func_ce(), *dds);
@@ -1055,10 +996,18 @@ BESDapResponseBuilder::intern_dap2_data(BESResponseObject *obj, BESDataHandlerIn
 
     throw_if_dap2_response_too_big(dds);
 
+    vector<BaseType*> projected;
+    for (DDS::Vars_iter i = dds->var_begin(), e = dds->var_end(); i != e; ++i) {
+        if ((*i)->send_p()) projected.push_back(*i);
+    }
+
+    BESDapReadAhead read_ahead(projected, BESDapReadAhead::get_read_ahead(dhi));
+
     // Iterate through the variables in the DataDDS and read
     // in the data if the variable has the send flag set.
     for (DDS::Vars_iter i = dds->var_begin(), e = dds->var_end(); i != e; ++i) {
         if ((*i)->send_p()) {
+            read_ahead.wait(*i);
             (*i)->intern_data(eval, *dds);
         }
     }
@@ -1086,12 +1035,6 @@ void BESDapResponseBuilder::send_dap2_data(ostream &data_stream, DDS **dds, Cons
 {
     BESDEBUG("dap", "BESDapResponseBuilder::send_dap2_data() - BEGIN"<< endl);
 
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // Set up the alarm.
-    establish_timeout(data_stream);
-    dds.set_timeout(d_timeout);
-#endif
-
     // Split constraint into two halves
     split_ce(eval);
 
@@ -1107,7 +1050,7 @@ void BESDapResponseBuilder::send_dap2_data(ostream &data_stream, DDS **dds, Cons
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
         if (response_cache && response_cache->can_be_cached(*dds, get_btp_func_ce())) {
-            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce());
+            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce(), get_ce());
         }
         else {
             func_eval.parse_constraint(get_btp_func_ce(), **dds);
@@ -1175,12 +1118,6 @@ void BESDapResponseBuilder::send_dap2_data(BESDataHandlerInterface &dhi, DDS **d
     BESDEBUG("dap", "BESDapResponseBuilder::send_dap2_data() - BEGIN"<< endl);
 
     ostream & data_stream = dhi.get_output_stream();
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // Set up the alarm.
-    establish_timeout(data_stream);
-    dds.set_timeout(d_timeout);
-#endif
-
     // Split constraint into two halves
     split_ce(eval);
 
@@ -1209,7 +1146,7 @@ void BESDapResponseBuilder::send_dap2_data(BESDataHandlerInterface &dhi, DDS **d
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
         if (response_cache && response_cache->can_be_cached(*dds, get_btp_func_ce())) {
-            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce());
+            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce(), get_ce());
         }
         else {
             func_eval.parse_constraint(get_btp_func_ce(), **dds);
@@ -1295,12 +1232,6 @@ void BESDapResponseBuilder::send_ddx(ostream &out, DDS **dds, ConstraintEvaluato
         return;
     }
 
-#if USE_LOCAL_TIMEOUT_SCHEME
-    // Set up the alarm.
-    establish_timeout(out);
-    dds.set_timeout(d_timeout);
-#endif
-
     // Split constraint into two halves
     split_ce(eval);
 
@@ -1313,7 +1244,7 @@ void BESDapResponseBuilder::send_ddx(ostream &out, DDS **dds, ConstraintEvaluato
         ConstraintEvaluator func_eval;
         DDS *fdds = 0; // nulll_ptr
         if (response_cache && response_cache->can_be_cached(*dds, get_btp_func_ce())) {
-            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce());
+            fdds = response_cache->get_or_cache_dataset(*dds, get_btp_func_ce(), get_ce());
         }
         else {
             func_eval.parse_constraint(get_btp_func_ce(), **dds);
@@ -1462,7 +1393,8 @@ void BESDapResponseBuilder::serialize_dap4_data(std::ostream &out, libdap::DMR &
     cos << xml.get_doc() << CRLF << flush;
 
     // Write the data, chunked with checksums
-    D4StreamMarshaller m(cos);
+    // When read-ahead is on, the next variables are read while each one is sent
+    BESDapReadAheadMarshaller m(cos, dmr.root(), d_read_ahead);
     dmr.root()->serialize(m, dmr, !d_dap4ce.empty());
 #ifdef CLEAR_LOCAL_DATA
     dmr.root()->clear_local_data();
@@ -1531,7 +1463,25 @@ bool BESDapResponseBuilder::store_dap4_result(ostream &out, libdap::DMR &dmr)
             BESDEBUG("dap", "BESDapResponseBuilder::store_dap4_result() - serviceUrl="<< serviceUrl << endl);
 
             string storedResultId = "";
-            storedResultId = resultCache->store_dap4_result(dmr, get_ce(), this);
+            if (BESStoredResultJobs::is_enabled()) {
+                // The result is built by a worker process; tell the client
+                // where it will be as soon as the job is queued.
+                if (!BESStoredResultJobs::submit_dap4_job(resultCache, dmr, get_ce(), this, storedResultId)) {
+                    string msg = "The Stored Result request cannot be serviced. ";
+                    msg += "Too many stored results are being built; try again later.";
+
+                    BESDEBUG("dap", "[WARNING] " << msg << endl);
+                    d4au.writeD4AsyncResponseRejected(xmlWrtr, UNAVAILABLE, msg, stylesheet_ref);
+                    out << xmlWrtr.get_doc();
+                    out << flush;
+                    BESDEBUG("dap", "BESDapResponseBuilder::store_dap4_result() - Sent AsyncRequestRejected" << endl);
+
+                    return true;
+                }
+            }
+            else {
+                storedResultId = resultCache->store_dap4_result(dmr, get_ce(), this);
+            }
 
             BESDEBUG("dap",
                 "BESDapResponseBuilder::store_dap4_result() - storedResultId='"<< storedResultId << "'" << endl);
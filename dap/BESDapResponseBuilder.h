@@ -79,6 +79,9 @@ protected:
 	 */
 	std::string d_store_result;
 
+	/// Read this many variables ahead while a data response is sent; see BESDapReadAhead
+	unsigned int d_read_ahead;
+
 	void initialize();
 
 #ifdef DAP2_STORED_RESULTS
@@ -94,7 +97,8 @@ public:
 	 version information. */
 	BESDapResponseBuilder(): d_dataset(""), d_dap2ce(""), d_dap4ce(""), d_dap4function(""),
 	    d_btp_func_ce(""), d_timeout(0), d_default_protocol(DAP_PROTOCOL_VERSION),
-	    d_cancel_timeout_on_send(false), d_async_accepted(""), d_store_result("")
+	    d_cancel_timeout_on_send(false), d_async_accepted(""), d_store_result(""),
+	    d_read_ahead(0)
 	{
 		initialize();
 	}
@@ -113,6 +117,15 @@ public:
 	virtual std::string get_store_result() const;
 	virtual void set_store_result(std::string _sr);
 
+	virtual unsigned int get_read_ahead() const
+	{
+		return d_read_ahead;
+	}
+	virtual void set_read_ahead(unsigned int read_ahead)
+	{
+		d_read_ahead = read_ahead;
+	}
+
 	virtual std::string get_async_accepted() const;
 	virtual void set_async_accepted(std::string _aa);
 
@@ -130,6 +143,9 @@ public:
 
     /** @name DDS_timeout
      *  Old deprecated BESDapResponseBuilder timeout code. Do not use.
+     *  Requests are timed by BESDeadline; register_timeout(), timeout_on(),
+     *  timeout_off(), establish_timeout() and remove_timeout() do nothing
+     *  and are kept only for handlers built against older versions.
      *  @deprecated
      */
     ///@{
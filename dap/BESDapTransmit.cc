@@ -55,6 +55,7 @@
 #include "BESDebug.h"
 
 #include "BESDapResponseBuilder.h"
+#include "BESDapReadAhead.h"
 
 using namespace libdap;
 using namespace std;
@@ -204,6 +205,7 @@ private:
 
         rb.set_async_accepted(dhi.data[ASYNC]);
         rb.set_store_result(dhi.data[STORE_RESULT]);
+        rb.set_read_ahead(BESDapReadAhead::get_read_ahead(dhi));
 
         BESDEBUG("dap", "dhi.data[POST_CONSTRAINT]: " << dhi.data[POST_CONSTRAINT] << endl);
         //rb.send_dap2_data(dhi.get_output_stream(), &dds, ce, print_mime);
@@ -299,6 +301,7 @@ private:
 
         rb.set_async_accepted(dhi.data[ASYNC]);
         rb.set_store_result(dhi.data[STORE_RESULT]);
+        rb.set_read_ahead(BESDapReadAhead::get_read_ahead(dhi));
 
         rb.send_dap4_data(dhi.get_output_stream(), *dmr, get_print_mime());
     }
@@ -29,9 +29,6 @@
 #include <sys/stat.h>
 
 #include <iostream>
-#ifdef HAVE_TR1_FUNCTIONAL
-#include <tr1/functional>
-#endif
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -69,18 +66,13 @@
 
 #include "BESStoredDapResultCache.h"
 #include "BESDapResponseBuilder.h"
+#include "CacheKey.h"
 #include "BESInternalError.h"
 
 #include "BESUtil.h"
 #include "TheBESKeys.h"
 #include "BESDebug.h"
 
-#ifdef HAVE_TR1_FUNCTIONAL
-#define HASH_OBJ std::tr1::hash
-#else
-#define HASH_OBJ std::hash
-#endif
-
 #define CRLF "\r\n"
 #define BES_DATA_ROOT "BES.Data.RootDirectory"
 #define BES_CATALOG_ROOT "BES.Catalog.catalog.RootDirectory"
@@ -688,16 +680,16 @@ string BESStoredDapResultCache::store_dap2_result(DDS &dds, const string &constr
  * name can be used both to store a result for later retrieval or to access
  * a previously-stored result.
  *
+ * The name is a 128-bit hash of the dataset, its version and the CE in
+ * canonical form (see make_cache_key()), so requests that differ only in
+ * how the CE is written share one stored result, and a result made before
+ * the dataset changed is never returned for it.
  */
 string BESStoredDapResultCache::get_stored_result_local_id(const string &dataset, const string &ce,
     libdap::DAPVersion version)
 {
     BESDEBUG("cache", "get_stored_result_local_id() - BEGIN. dataset: " << dataset << ", ce: " << ce << endl);
-    std::ostringstream ostr;
-    HASH_OBJ<std::string> str_hash;
-    string name = dataset + "#" + ce;
-    ostr << str_hash(name);
-    string hashed_name = ostr.str();
+    string hashed_name = hash_cache_key(make_cache_key(dataset, ce, version == DAP_4_0 ? ';' : ','));
     BESDEBUG("cache", "get_stored_result_local_id() - hashed_name: " << hashed_name << endl);
 
     string suffix = "";
@@ -820,3 +812,33 @@ string BESStoredDapResultCache::store_dap4_result(DMR &dmr, const string &constr
 
 }
 
+
+/**
+ * @brief The id of the stored result for a DMR and constraint
+ *
+ * This is the value store_dap4_result() returns, so the id can be given to
+ * the client before the result is built.
+ */
+string BESStoredDapResultCache::get_dap4_result_id(DMR &dmr, const string &constraint)
+{
+    return get_stored_result_local_id(dmr.filename(), constraint, DAP_4_0);
+}
+
+/**
+ * @param local_id The id of a stored result
+ * @return The pathname of the stored result's file
+ */
+string BESStoredDapResultCache::get_result_file_name(const string &local_id)
+{
+    return get_cache_file_name(local_id, /*mangle*/false);
+}
+
+/**
+ * @param local_id The id of a stored result
+ * @param dataset The dataset the result was built from
+ * @return True if the result has been stored and is newer than the dataset
+ */
+bool BESStoredDapResultCache::is_stored(const string &local_id, const string &dataset)
+{
+    return is_valid(get_result_file_name(local_id), dataset);
+}
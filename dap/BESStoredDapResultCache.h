@@ -114,6 +114,11 @@ public:
 
     // Store the passed DMR to disk as a serialized DAP4 object.
     virtual string store_dap4_result(libdap::DMR &dmr, const string &constraint, BESDapResponseBuilder *rb);
+
+    // The id store_dap4_result() will return, without storing anything.
+    string get_dap4_result_id(libdap::DMR &dmr, const string &constraint);
+    string get_result_file_name(const string &local_id);
+    bool is_stored(const string &local_id, const string &dataset);
 };
 
 #endif // _bes_store_result_cache_h
@@ -0,0 +1,480 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <exception>
+
+#include <DMR.h>
+#include <Error.h>
+
+#include "BESStoredResultJobs.h"
+#include "BESStoredDapResultCache.h"
+#include "BESDapResponseBuilder.h"
+#include "BESInternalError.h"
+#include "BESForbiddenError.h"
+#include "BESIndent.h"
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+#include "BESDebug.h"
+#include "BESLog.h"
+
+using namespace std;
+using namespace libdap;
+
+const string BESStoredResultJobs::MAX_JOBS_KEY = "DAP.StoredResultsCache.maxJobs";
+const string BESStoredResultJobs::MAX_QUEUED_KEY = "DAP.StoredResultsCache.maxQueuedJobs";
+
+// The status records and worker slot files are kept in this subdirectory
+// of the stored results directory. The cache only counts (and purges) the
+// files in that directory whose names start with its prefix, so the records
+// must not be kept next to the results.
+static const string JOBS_SUBDIR = ".jobs";
+static const string STATUS_SUFFIX = ".status";
+static const string SLOT_FILE_PREFIX = "slot_";
+
+static const unsigned int DEFAULT_MAX_JOBS = 2;
+static const unsigned int DEFAULT_MAX_QUEUED = 16;
+
+// A job that has been queued, but whose worker has not yet written its pid,
+// is counted as live for this many seconds.
+static const time_t STARTUP_GRACE = 10;
+
+string BESStoredResultJob::state_name(State state)
+{
+    switch (state) {
+    case queued:
+        return "queued";
+    case running:
+        return "running";
+    case complete:
+        return "complete";
+    case failed:
+        return "failed";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief Read a status record
+ *
+ * @param status_file The record's pathname
+ * @return False if the record does not exist or cannot be read
+ */
+bool BESStoredResultJob::read(const string &status_file)
+{
+    ifstream in(status_file.c_str());
+    if (!in) return false;
+
+    bool found_state = false;
+    string line;
+    while (getline(in, line)) {
+        string::size_type eq = line.find('=');
+        if (eq == string::npos) continue;
+
+        string key = line.substr(0, eq);
+        string value = line.substr(eq + 1);
+
+        if (key == "id")
+            d_id = value;
+        else if (key == "state") {
+            found_state = true;
+            if (value == "queued")
+                d_state = queued;
+            else if (value == "running")
+                d_state = running;
+            else if (value == "complete")
+                d_state = complete;
+            else
+                d_state = failed;
+        }
+        else if (key == "pid")
+            d_pid = atol(value.c_str());
+        else if (key == "submitted")
+            d_submitted = atol(value.c_str());
+        else if (key == "started")
+            d_started = atol(value.c_str());
+        else if (key == "finished")
+            d_finished = atol(value.c_str());
+        else if (key == "bytes")
+            d_bytes = strtoull(value.c_str(), 0, 10);
+        else if (key == "message")
+            d_message = value;
+    }
+
+    return found_state;
+}
+
+/**
+ * @brief Write a status record
+ *
+ * The record is written to a temporary file that is then renamed, so that
+ * readers never see a partial record.
+ *
+ * @param status_file The record's pathname
+ */
+void BESStoredResultJob::write(const string &status_file) const
+{
+    ostringstream tmp_name;
+    tmp_name << status_file << ".tmp." << getpid();
+
+    ofstream out(tmp_name.str().c_str());
+    if (!out)
+        throw BESInternalError("Could not write the stored result status file '" + tmp_name.str() + "'.", __FILE__,
+            __LINE__);
+
+    // A message may not span lines
+    string message = d_message;
+    for (string::size_type i = 0; i < message.length(); ++i)
+        if (message[i] == '\n') message[i] = ' ';
+
+    out << "id=" << d_id << endl;
+    out << "state=" << state_name(d_state) << endl;
+    out << "pid=" << d_pid << endl;
+    out << "submitted=" << d_submitted << endl;
+    out << "started=" << d_started << endl;
+    out << "finished=" << d_finished << endl;
+    out << "bytes=" << d_bytes << endl;
+    out << "message=" << message << endl;
+    out.close();
+
+    if (out.fail() || rename(tmp_name.str().c_str(), status_file.c_str()) != 0) {
+        (void) unlink(tmp_name.str().c_str());
+        throw BESInternalError("Could not write the stored result status file '" + status_file + "'.", __FILE__,
+            __LINE__);
+    }
+}
+
+void BESStoredResultJob::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "BESStoredResultJob::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    strm << BESIndent::LMarg << "id: " << d_id << endl;
+    strm << BESIndent::LMarg << "state: " << state_name(d_state) << endl;
+    strm << BESIndent::LMarg << "pid: " << d_pid << endl;
+    strm << BESIndent::LMarg << "bytes: " << d_bytes << endl;
+    if (!d_message.empty()) strm << BESIndent::LMarg << "message: " << d_message << endl;
+    BESIndent::UnIndent();
+}
+
+// The directory part of a pathname
+static string dir_name(const string &path)
+{
+    string::size_type slash = path.find_last_of('/');
+    return slash == string::npos ? "." : path.substr(0, slash);
+}
+
+unsigned int BESStoredResultJobs::get_max_jobs()
+{
+    int max_jobs = TheBESKeys::TheKeys()->read_int_key(MAX_JOBS_KEY, DEFAULT_MAX_JOBS);
+    return max_jobs < 0 ? 0 : max_jobs;
+}
+
+unsigned int BESStoredResultJobs::get_max_queued()
+{
+    int max_queued = TheBESKeys::TheKeys()->read_int_key(MAX_QUEUED_KEY, DEFAULT_MAX_QUEUED);
+    return max_queued < 0 ? 0 : max_queued;
+}
+
+/**
+ * @param cache The stored result cache
+ * @return The directory that holds the status records and worker slot files
+ */
+string BESStoredResultJobs::get_jobs_dir(BESStoredDapResultCache *cache)
+{
+    return BESUtil::assemblePath(cache->get_cache_directory(), JOBS_SUBDIR);
+}
+
+/**
+ * @param cache The stored result cache
+ * @param id The stored result's id
+ * @return The pathname of the stored result's status record
+ */
+string BESStoredResultJobs::get_status_file_name(BESStoredDapResultCache *cache, const string &id)
+{
+    string result_file = cache->get_result_file_name(id);
+    string::size_type slash = result_file.find_last_of('/');
+    string name = slash == string::npos ? result_file : result_file.substr(slash + 1);
+
+    return BESUtil::assemblePath(get_jobs_dir(cache), name + STATUS_SUFFIX);
+}
+
+/**
+ * @brief Is a job queued or running?
+ *
+ * A job whose record says it is queued or running, but whose worker process
+ * no longer exists, has failed.
+ */
+bool BESStoredResultJobs::is_live(const BESStoredResultJob &job)
+{
+    if (job.d_state != BESStoredResultJob::queued && job.d_state != BESStoredResultJob::running) return false;
+
+    if (job.d_pid == 0) return time(0) - job.d_submitted < STARTUP_GRACE;
+
+    return kill(job.d_pid, 0) == 0 || errno == EPERM;
+}
+
+/**
+ * @brief The number of jobs queued or running
+ *
+ * @param dir The directory that holds the status records
+ */
+unsigned int BESStoredResultJobs::count_active(const string &dir)
+{
+    DIR *dp = opendir(dir.c_str());
+    if (!dp) return 0;
+
+    unsigned int active = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != 0) {
+        string name = entry->d_name;
+        if (name.length() <= STATUS_SUFFIX.length()
+            || name.compare(name.length() - STATUS_SUFFIX.length(), string::npos, STATUS_SUFFIX) != 0) continue;
+
+        BESStoredResultJob job;
+        if (job.read(BESUtil::assemblePath(dir, name)) && is_live(job)) ++active;
+    }
+
+    closedir(dp);
+
+    return active;
+}
+
+/**
+ * @brief Wait for a worker slot
+ *
+ * @param dir The directory that holds the slot files
+ * @return The open, locked, slot file; the lock is released when the
+ * worker exits.
+ */
+int BESStoredResultJobs::acquire_slot(const string &dir)
+{
+    unsigned int slots = get_max_jobs();
+
+    while (true) {
+        for (unsigned int i = 0; i < slots; ++i) {
+            ostringstream name;
+            name << SLOT_FILE_PREFIX << i;
+            string slot_file = BESUtil::assemblePath(dir, name.str());
+
+            int fd = open(slot_file.c_str(), O_RDWR | O_CREAT, 0666);
+            if (fd == -1)
+                throw BESInternalError("Could not open the worker slot file '" + slot_file + "': " + strerror(errno),
+                    __FILE__, __LINE__);
+
+            struct flock lock;
+            lock.l_type = F_WRLCK;
+            lock.l_whence = SEEK_SET;
+            lock.l_start = 0;
+            lock.l_len = 0;
+            if (fcntl(fd, F_SETLK, &lock) != -1) return fd;
+
+            close(fd);
+        }
+
+        sleep(1);
+    }
+}
+
+/**
+ * @brief Build a stored result; called in the worker process
+ */
+void BESStoredResultJobs::run_dap4_job(BESStoredDapResultCache *cache, DMR &dmr, const string &constraint,
+    BESDapResponseBuilder *rb, BESStoredResultJob &job, const string &status_file)
+{
+    try {
+        job.d_pid = getpid();
+        job.write(status_file);
+
+        (void) acquire_slot(dir_name(status_file));
+
+        job.d_state = BESStoredResultJob::running;
+        job.d_started = time(0);
+        job.write(status_file);
+
+        cache->store_dap4_result(dmr, constraint, rb);
+
+        struct stat sb;
+        if (stat(cache->get_result_file_name(job.d_id).c_str(), &sb) == 0) job.d_bytes = sb.st_size;
+        job.d_state = BESStoredResultJob::complete;
+    }
+    catch (BESError &e) {
+        job.d_state = BESStoredResultJob::failed;
+        job.d_message = e.get_message();
+    }
+    catch (libdap::Error &e) {
+        job.d_state = BESStoredResultJob::failed;
+        job.d_message = e.get_error_message();
+    }
+    catch (std::exception &e) {
+        job.d_state = BESStoredResultJob::failed;
+        job.d_message = e.what();
+    }
+    catch (...) {
+        job.d_state = BESStoredResultJob::failed;
+        job.d_message = "Unknown error.";
+    }
+
+    if (job.d_state == BESStoredResultJob::failed)
+        LOG("Could not build the stored result '" << job.d_id << "': " << job.d_message << endl);
+
+    job.d_pid = 0;
+    job.d_finished = time(0);
+    try {
+        job.write(status_file);
+    }
+    catch (BESError &e) {
+        LOG(e.get_message() << endl);
+    }
+}
+
+/**
+ * @brief Queue a job to build the stored DAP4 result for a DMR
+ *
+ * If the result is already stored, or is being built, no new job is queued.
+ *
+ * @param cache The stored result cache
+ * @param dmr The DMR to serialize; the worker has its own copy
+ * @param constraint The constraint used to build the DMR
+ * @param rb The response builder used to serialize the DMR
+ * @param id Value-result parameter; the stored result's id
+ * @return False if the job could not be queued because the queue is full
+ */
+bool BESStoredResultJobs::submit_dap4_job(BESStoredDapResultCache *cache, DMR &dmr, const string &constraint,
+    BESDapResponseBuilder *rb, string &id)
+{
+    id = cache->get_dap4_result_id(dmr, constraint);
+    string status_file = get_status_file_name(cache, id);
+
+    BESStoredResultJob job;
+    if (job.read(status_file) && is_live(job)) {
+        BESDEBUG("dap", "BESStoredResultJobs::submit_dap4_job() - Job for '" << id << "' is already " << BESStoredResultJob::state_name(job.d_state) << endl);
+        return true;
+    }
+
+    if (cache->is_stored(id, dmr.filename())) {
+        BESDEBUG("dap", "BESStoredResultJobs::submit_dap4_job() - Result '" << id << "' is already stored" << endl);
+        return true;
+    }
+
+    string dir = get_jobs_dir(cache);
+    if (mkdir(dir.c_str(), 0775) != 0 && errno != EEXIST)
+        throw BESInternalError("Could not make the stored result jobs directory '" + dir + "': " + strerror(errno),
+            __FILE__, __LINE__);
+
+    if (count_active(dir) >= get_max_jobs() + get_max_queued()) {
+        BESDEBUG("dap", "BESStoredResultJobs::submit_dap4_job() - Queue is full; rejecting '" << id << "'" << endl);
+        return false;
+    }
+
+    job = BESStoredResultJob();
+    job.d_id = id;
+    job.d_state = BESStoredResultJob::queued;
+    job.d_submitted = time(0);
+    job.write(status_file);
+
+    int status = BESUtil::fork_background_process();
+    if (status == 0) {
+        run_dap4_job(cache, dmr, constraint, rb, job, status_file);
+        _exit(0);
+    }
+
+    if (status == -1) {
+        LOG("Could not start a worker for the stored result '" << id << "'" << endl);
+        (void) unlink(status_file.c_str());
+        return false;
+    }
+
+    BESDEBUG("dap", "BESStoredResultJobs::submit_dap4_job() - Queued '" << id << "'" << endl);
+    return true;
+}
+
+/**
+ * @brief Get the status of a stored result
+ *
+ * Results stored without a job (e.g., when DAP.StoredResultsCache.maxJobs
+ * is zero) have no status record and are reported as complete.
+ *
+ * @param cache The stored result cache
+ * @param id The stored result's id
+ * @param job Value-result parameter; the job's status
+ * @return False if there is no such stored result
+ */
+bool BESStoredResultJobs::get_job(BESStoredDapResultCache *cache, const string &id, BESStoredResultJob &job)
+{
+    if (id.find("..") != string::npos)
+        throw BESForbiddenError("The stored result id '" + id + "' is not valid.", __FILE__, __LINE__);
+
+    string result_file = cache->get_result_file_name(id);
+
+    struct stat sb;
+    bool stored = stat(result_file.c_str(), &sb) == 0;
+
+    if (!job.read(get_status_file_name(cache, id))) {
+        if (!stored) return false;
+
+        job.d_id = id;
+        job.d_state = BESStoredResultJob::complete;
+        job.d_finished = sb.st_mtime;
+        job.d_bytes = sb.st_size;
+        return true;
+    }
+
+    switch (job.d_state) {
+    case BESStoredResultJob::queued:
+    case BESStoredResultJob::running:
+        if (!is_live(job)) {
+            job.d_state = BESStoredResultJob::failed;
+            job.d_message = "The worker building this result exited before it finished.";
+        }
+        else if (stored) {
+            job.d_bytes = sb.st_size;
+        }
+        break;
+
+    case BESStoredResultJob::complete:
+        // The result has been purged from the cache
+        if (!stored) return false;
+        break;
+
+    default:
+        break;
+    }
+
+    return true;
+}
@@ -0,0 +1,137 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _bes_stored_result_jobs_h
+#define _bes_stored_result_jobs_h
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+#include <ostream>
+
+#include "BESObj.h"
+
+namespace libdap {
+class DMR;
+}
+
+class BESStoredDapResultCache;
+class BESDapResponseBuilder;
+
+/**
+ * @brief The status record of a stored result job
+ *
+ * The record is a small text file of 'key=value' lines held in the '.jobs'
+ * subdirectory of the stored results directory (its name is the result's
+ * name with '.status' appended).
+ * It is replaced, never edited in place, so a reader always sees a complete
+ * record.
+ */
+class BESStoredResultJob: public BESObj {
+public:
+    enum State {
+        queued, running, complete, failed
+    };
+
+    std::string d_id;               // The stored result's id
+    State d_state;
+    pid_t d_pid;                    // The worker process; 0 once it has finished
+    time_t d_submitted;
+    time_t d_started;
+    time_t d_finished;
+    unsigned long long d_bytes;     // Bytes written so far
+    std::string d_message;          // Why the job failed
+
+    BESStoredResultJob() :
+        d_state(queued), d_pid(0), d_submitted(0), d_started(0), d_finished(0), d_bytes(0)
+    {
+    }
+
+    virtual ~BESStoredResultJob()
+    {
+    }
+
+    static std::string state_name(State state);
+
+    bool read(const std::string &status_file);
+    void write(const std::string &status_file) const;
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+/**
+ * @brief Build stored DAP4 results in background worker processes
+ *
+ * A store_result request is answered as soon as its job is queued. The job
+ * runs in a process forked (twice, so the listener never has to reap it)
+ * from the listener that took the request; it waits for one of a fixed
+ * number of worker slots, each an fcntl(2) lock on a file in the jobs
+ * directory, and then writes the result using
+ * BESStoredDapResultCache::store_dap4_result(). The job's progress is kept
+ * in its status record (see BESStoredResultJob) and is returned by the
+ * showStoredResult command.
+ *
+ * Configure the jobs using:
+ *
+ * DAP.StoredResultsCache.maxJobs = the number of results built at the same
+ * time (default 2). If zero, results are built before the request is
+ * answered.
+ * DAP.StoredResultsCache.maxQueuedJobs = the number of jobs that may wait
+ * for a worker slot (default 16). Requests made when the queue is full are
+ * rejected.
+ */
+class BESStoredResultJobs {
+private:
+    static unsigned int get_max_jobs();
+    static unsigned int get_max_queued();
+
+    static std::string get_jobs_dir(BESStoredDapResultCache *cache);
+    static std::string get_status_file_name(BESStoredDapResultCache *cache, const std::string &id);
+
+    static unsigned int count_active(const std::string &dir);
+    static int acquire_slot(const std::string &dir);
+    static void run_dap4_job(BESStoredDapResultCache *cache, libdap::DMR &dmr, const std::string &constraint,
+        BESDapResponseBuilder *rb, BESStoredResultJob &job, const std::string &status_file);
+
+    friend class StoredResultJobsTest;
+
+public:
+    static const std::string MAX_JOBS_KEY;
+    static const std::string MAX_QUEUED_KEY;
+
+    static bool is_enabled()
+    {
+        return get_max_jobs() > 0;
+    }
+
+    static bool is_live(const BESStoredResultJob &job);
+
+    static bool submit_dap4_job(BESStoredDapResultCache *cache, libdap::DMR &dmr, const std::string &constraint,
+        BESDapResponseBuilder *rb, std::string &id);
+
+    static bool get_job(BESStoredDapResultCache *cache, const std::string &id, BESStoredResultJob &job);
+};
+
+#endif // _bes_stored_result_jobs_h
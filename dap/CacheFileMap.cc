@@ -0,0 +1,109 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "BESInternalError.h"
+#include "CacheFileMap.h"
+
+using namespace std;
+
+// namespace bes {
+
+/**
+ * @brief Map a cache file into memory
+ *
+ * The mapping is not affected by the file being closed, unlocked or
+ * removed from the cache.
+ *
+ * @param file_name The cache file
+ */
+CacheFileMap::CacheFileMap(const string &file_name) :
+    d_data(0), d_size(0), d_mapped(true)
+{
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw BESInternalError("Could not open the cache file '" + file_name + "': " + strerror(errno), __FILE__,
+            __LINE__);
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        int err = errno;
+        close(fd);
+        throw BESInternalError("Could not stat the cache file '" + file_name + "': " + strerror(err), __FILE__,
+            __LINE__);
+    }
+
+    d_size = sb.st_size;
+    if (d_size > 0) {
+        void *data = mmap(0, d_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw BESInternalError("Could not map the cache file '" + file_name + "': " + strerror(err), __FILE__,
+                __LINE__);
+        }
+
+        d_data = static_cast<char*>(data);
+        (void) madvise(data, d_size, MADV_SEQUENTIAL);
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief Make a buffer for values that are not held in a cache file as-is
+ * @param size The size of the buffer in bytes
+ */
+CacheFileMap::CacheFileMap(size_t size) :
+    d_data(0), d_size(size), d_mapped(false)
+{
+    if (d_size > 0) {
+        d_data = static_cast<char*>(malloc(d_size));
+        if (!d_data) throw BESInternalError("Could not allocate memory for cached values.", __FILE__, __LINE__);
+    }
+}
+
+CacheFileMap::~CacheFileMap()
+{
+    if (d_mapped) {
+        if (d_data) munmap(d_data, d_size);
+    }
+    else {
+        free(d_data);
+    }
+}
+
+// } // namespace bes
@@ -0,0 +1,76 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#ifndef cache_file_map_h
+#define cache_file_map_h 1
+
+#include <cstddef>
+#include <string>
+
+// namespace bes {
+
+/**
+ * @brief Read-only memory that holds cached values
+ *
+ * Either a cache file mapped into memory or, for values that were
+ * compressed in the file, a buffer that holds the uncompressed values.
+ * Objects that read their values lazily (see CachedSequence) keep a
+ * reference to one of these so the memory outlives the cache file's lock.
+ */
+class CacheFileMap {
+private:
+    char *d_data;
+    size_t d_size;
+    bool d_mapped;
+
+    CacheFileMap();
+    CacheFileMap(const CacheFileMap &);
+    CacheFileMap &operator=(const CacheFileMap &);
+
+public:
+    CacheFileMap(const std::string &file_name);
+    CacheFileMap(size_t size);
+    virtual ~CacheFileMap();
+
+    const char *data() const
+    {
+        return d_data;
+    }
+
+    /// Fill a buffer made with CacheFileMap(size_t) using this.
+    char *buffer()
+    {
+        return d_mapped ? 0 : d_data;
+    }
+
+    size_t size() const
+    {
+        return d_size;
+    }
+};
+
+// } // namespace bes
+
+#endif // cache_file_map_h
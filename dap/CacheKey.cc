@@ -0,0 +1,357 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+
+#include <cctype>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "CacheKey.h"
+
+using namespace std;
+
+// namespace bes {
+
+/**
+ * Rewrite the indices of one hyperslab (the text between '[' and ']') in
+ * its shortest form: 'start:1:stop' becomes 'start:stop' and a lone index
+ * 'n' becomes 'n:n'. Anything that is not made of digits and colons is
+ * returned unchanged.
+ */
+static string canonical_hyperslab(const string &slab)
+{
+    if (slab.empty() || slab.find_first_not_of("0123456789:") != string::npos) return slab;
+
+    vector<string> parts;
+    string::size_type start = 0;
+    while (true) {
+        string::size_type colon = slab.find(':', start);
+        parts.push_back(slab.substr(start, colon == string::npos ? string::npos : colon - start));
+        if (colon == string::npos) break;
+        start = colon + 1;
+    }
+
+    if (parts.size() == 1) return parts[0] + ":" + parts[0];
+    if (parts.size() == 3 && parts[1] == "1") return parts[0] + ":" + parts[2];
+
+    return slab;
+}
+
+/**
+ * Remove the white space that is not inside a quoted string and put each
+ * hyperslab in its canonical form.
+ */
+static string strip_constraint(const string &ce)
+{
+    string out;
+    out.reserve(ce.size());
+
+    bool quoted = false;
+    for (string::size_type i = 0; i < ce.size(); ++i) {
+        char c = ce[i];
+        if (quoted) {
+            out += c;
+            if (c == '\\' && i + 1 < ce.size())
+                out += ce[++i];
+            else if (c == '"')
+                quoted = false;
+        }
+        else if (c == '"') {
+            out += c;
+            quoted = true;
+        }
+        else if (c == '[') {
+            string::size_type close = ce.find(']', i);
+            if (close == string::npos) {
+                out += ce.substr(i);
+                break;
+            }
+            string slab;
+            for (string::size_type j = i + 1; j < close; ++j)
+                if (!isspace(ce[j])) slab += ce[j];
+            out.append("[").append(canonical_hyperslab(slab)).append("]");
+            i = close;
+        }
+        else if (!isspace(c)) {
+            out += c;
+        }
+    }
+
+    return out;
+}
+
+/**
+ * Split a constraint at each 'separator' that is not inside a quoted
+ * string, a function's argument list, a hyperslab or a DAP4 filter.
+ */
+static vector<string> split_constraint(const string &ce, char separator)
+{
+    vector<string> clauses;
+    string clause;
+    int depth = 0;
+    bool quoted = false;
+    for (string::size_type i = 0; i < ce.size(); ++i) {
+        char c = ce[i];
+        if (quoted) {
+            if (c == '\\' && i + 1 < ce.size()) {
+                clause += c;
+                c = ce[++i];
+            }
+            else if (c == '"')
+                quoted = false;
+        }
+        else if (c == '"') {
+            quoted = true;
+        }
+        else if (c == '(' || c == '[' || c == '{') {
+            ++depth;
+        }
+        else if ((c == ')' || c == ']' || c == '}') && depth > 0) {
+            --depth;
+        }
+        else if (c == separator && depth == 0) {
+            clauses.push_back(clause);
+            clause.clear();
+            continue;
+        }
+        clause += c;
+    }
+    clauses.push_back(clause);
+
+    return clauses;
+}
+
+static string join_clauses(const vector<string> &clauses, char separator)
+{
+    string out;
+    for (vector<string>::const_iterator i = clauses.begin(), e = clauses.end(); i != e; ++i) {
+        if (i != clauses.begin()) out += separator;
+        out += *i;
+    }
+    return out;
+}
+
+static void sort_clauses(vector<string> &clauses)
+{
+    sort(clauses.begin(), clauses.end());
+    clauses.erase(unique(clauses.begin(), clauses.end()), clauses.end());
+}
+
+/**
+ * Can the projected variables be sorted? Not if a variable is projected
+ * more than once with different hyperslabs, since the order of those
+ * clauses is part of the response (e.g., 'a[5:8],a[0:3]').
+ */
+static bool can_sort_projection(const vector<string> &vars)
+{
+    map<string, string> clauses;
+    for (vector<string>::const_iterator i = vars.begin(), e = vars.end(); i != e; ++i) {
+        string name = i->substr(0, i->find_first_of("[{"));
+        map<string, string>::iterator c = clauses.find(name);
+        if (c == clauses.end())
+            clauses[name] = *i;
+        else if (c->second != *i)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief The canonical form of a constraint expression
+ *
+ * White space outside of quoted strings is removed, hyperslabs are
+ * rewritten in their shortest form and the projected variables are sorted
+ * with duplicates removed. The variables are only sorted when the
+ * projection contains no function calls, since the order of a function's
+ * results is part of the response, and when no variable is projected twice
+ * with different hyperslabs. DAP2 selection clauses (those that follow an
+ * '&') are sorted as well.
+ *
+ * @param ce The constraint expression
+ * @param separator The character that separates the projected variables;
+ * ',' for DAP2 and ';' for DAP4.
+ * @return The constraint in canonical form
+ */
+string canonical_constraint(const string &ce, char separator)
+{
+    vector<string> clauses = split_constraint(strip_constraint(ce), '&');
+
+    vector<string> vars = split_constraint(clauses[0], separator);
+    bool has_function = false;
+    for (vector<string>::iterator i = vars.begin(), e = vars.end(); i != e && !has_function; ++i)
+        has_function = i->find('(') != string::npos;
+    if (!has_function) {
+        vars.erase(remove(vars.begin(), vars.end(), string("")), vars.end());
+        if (can_sort_projection(vars)) sort_clauses(vars);
+    }
+
+    vector<string> selections(clauses.begin() + 1, clauses.end());
+    sort_clauses(selections);
+
+    string canonical = join_clauses(vars, separator);
+    for (vector<string>::iterator i = selections.begin(), e = selections.end(); i != e; ++i)
+        canonical.append("&").append(*i);
+
+    return canonical;
+}
+
+/**
+ * @brief The version of a dataset, as its modification time and size
+ *
+ * @param dataset The dataset's pathname
+ * @return 'mtime:size', or the empty string if the dataset is not a file
+ * (e.g., it is a URL).
+ */
+string dataset_version(const string &dataset)
+{
+    struct stat buf;
+    if (stat(dataset.c_str(), &buf) != 0) return "";
+
+    ostringstream oss;
+    oss << buf.st_mtime << ":" << buf.st_size;
+    return oss.str();
+}
+
+/**
+ * @brief The key for the response to a constraint on a dataset
+ *
+ * @param dataset The dataset's pathname
+ * @param ce The constraint expression
+ * @param separator See canonical_constraint()
+ * @return The dataset, its version and the canonical constraint, separated
+ * by '#' characters.
+ */
+string make_cache_key(const string &dataset, const string &ce, char separator)
+{
+    return dataset + "#" + dataset_version(dataset) + "#" + canonical_constraint(ce, separator);
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t get_uint64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/**
+ * MurmurHash3 (x64, 128-bit), by Austin Appleby, who placed it in the
+ * public domain. The bytes are read as little-endian words on every host
+ * so that a key always hashes to the same value.
+ */
+static void murmur3_128(const unsigned char *data, size_t len, uint64_t &h1, uint64_t &h2)
+{
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    h1 = 0;
+    h2 = 0;
+
+    size_t nblocks = len / 16;
+    for (size_t i = 0; i < nblocks; ++i) {
+        uint64_t k1 = get_uint64(data + i * 16);
+        uint64_t k2 = get_uint64(data + i * 16 + 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const unsigned char *tail = data + nblocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (len & 15) {
+    case 15: k2 ^= uint64_t(tail[14]) << 48; // fall through
+    case 14: k2 ^= uint64_t(tail[13]) << 40; // fall through
+    case 13: k2 ^= uint64_t(tail[12]) << 32; // fall through
+    case 12: k2 ^= uint64_t(tail[11]) << 24; // fall through
+    case 11: k2 ^= uint64_t(tail[10]) << 16; // fall through
+    case 10: k2 ^= uint64_t(tail[9]) << 8; // fall through
+    case 9:  k2 ^= uint64_t(tail[8]);
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2; // fall through
+    case 8:  k1 ^= uint64_t(tail[7]) << 56; // fall through
+    case 7:  k1 ^= uint64_t(tail[6]) << 48; // fall through
+    case 6:  k1 ^= uint64_t(tail[5]) << 40; // fall through
+    case 5:  k1 ^= uint64_t(tail[4]) << 32; // fall through
+    case 4:  k1 ^= uint64_t(tail[3]) << 24; // fall through
+    case 3:  k1 ^= uint64_t(tail[2]) << 16; // fall through
+    case 2:  k1 ^= uint64_t(tail[1]) << 8; // fall through
+    case 1:  k1 ^= uint64_t(tail[0]);
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+}
+
+/**
+ * @brief Hash a key to 128 bits
+ *
+ * @param key The key, usually from make_cache_key()
+ * @return The hash as 32 hexadecimal digits
+ */
+string hash_cache_key(const string &key)
+{
+    uint64_t h1, h2;
+    murmur3_128(reinterpret_cast<const unsigned char *>(key.data()), key.size(), h1, h2);
+
+    ostringstream oss;
+    oss << hex << setfill('0') << setw(16) << h1 << setw(16) << h2;
+    return oss.str();
+}
+
+// } // namespace bes
@@ -0,0 +1,43 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of Hyrax, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef cache_key_h
+#define cache_key_h 1
+
+#include <string>
+
+/** @brief Build the keys used to name cached and stored DAP responses
+ *
+ * Two requests that differ only in how their constraints are written (white
+ * space, the order of the projected variables or selection clauses, a
+ * stride of one in a hyperslab) get the same key, and a key changes when the
+ * dataset it names is modified. Keys are hashed to 128 bits, so the names
+ * made from them are short and collisions are not a practical concern.
+ */
+std::string canonical_constraint(const std::string &ce, char separator = ',');
+std::string dataset_version(const std::string &dataset);
+std::string make_cache_key(const std::string &dataset, const std::string &ce, char separator = ',');
+std::string hash_cache_key(const std::string &key);
+
+#endif // cache_key_h
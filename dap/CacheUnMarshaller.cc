@@ -24,6 +24,8 @@
 
 #include "config.h"
 
+#include <cstring>
+
 #include <InternalErr.h>
 
 #include "BESIndent.h"
@@ -34,47 +36,78 @@ using namespace std;
 
 // namespace bes {
 
+void CacheUnMarshaller::read(char *val, size_t bytes)
+{
+    if (d_in) {
+        d_in->read(val, bytes);
+        return;
+    }
+
+    memcpy(val, get_pointer(bytes), bytes);
+}
+
+/**
+ * @brief Get the next bytes without copying them
+ *
+ * Only values read from memory can be returned this way.
+ *
+ * @param bytes The number of bytes
+ * @return A pointer to the bytes; it is valid as long as the CacheFileMap
+ * is.
+ */
+const char *CacheUnMarshaller::get_pointer(size_t bytes)
+{
+    if (d_in) throw InternalErr(__FILE__, __LINE__, "CacheUnMarshaller::get_pointer() needs values in memory.");
+
+    if (bytes > (size_t) (d_end - d_pos))
+        throw InternalErr(__FILE__, __LINE__, "Read past the end of the cached values.");
+
+    const char *pos = d_pos;
+    d_pos += bytes;
+    return pos;
+}
+
 void CacheUnMarshaller::get_byte(dods_byte &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_int16(dods_int16 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_int32(dods_int32 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_float32(dods_float32 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_float64(dods_float64 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_uint16(dods_uint16 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_uint32(dods_uint32 &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 void CacheUnMarshaller::get_str(string &val)
 {
     size_t len;
-    d_in.read(reinterpret_cast<char*>(&len), sizeof(size_t));
+    read(reinterpret_cast<char*>(&len), sizeof(size_t));
     val.resize(len);
-    d_in.read(&val[0], len);
+    if (len) read(&val[0], len);
 }
 
 void CacheUnMarshaller::get_url(string &val)
@@ -92,13 +125,13 @@ void CacheUnMarshaller::get_url(string &val)
  */
 void CacheUnMarshaller::get_opaque(char *val, unsigned int bytes)
 {
-    d_in.read(val, bytes);
+    read(val, bytes);
     //throw InternalErr(__FILE__, __LINE__, "CacheUnMarshaller::get_opaque() not implemented");
 }
 
 void CacheUnMarshaller::get_int(int &val)
 {
-    d_in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    read(reinterpret_cast<char*>(&val), sizeof(val));
 }
 
 /**
@@ -109,12 +142,12 @@ void CacheUnMarshaller::get_int(int &val)
  */
 void CacheUnMarshaller::get_vector(char **val, unsigned int &bytes, Vector &)
 {
-    d_in.read(*val, bytes);
+    read(*val, bytes);
 }
 
 void CacheUnMarshaller::get_vector(char **val, unsigned int &num, int width, Vector &)
 {
-    d_in.read(*val, num * width);
+    read(*val, num * width);
 }
 
 void CacheUnMarshaller::dump(ostream &strm) const
@@ -27,9 +27,12 @@
 
 #include <cassert>
 #include <istream>
+#include <memory>
 
 #include <UnMarshaller.h>   // from libdap
 
+#include "CacheFileMap.h"
+
 // namespace bes {
 
 /**
@@ -39,21 +42,43 @@
  *  the XDR-based Marshaller/UnMarshaller code, this does not translate
  *  the data to network byte order (and thus does not make a copy of
  *  the data or allocate temporary memory).
+ *
+ *  The values can be read from a stream or from memory (a cache file
+ *  mapped into memory; see CacheFileMap). When reading from memory,
+ *  get_pointer() returns values without copying them and get_map() can be
+ *  used to keep the memory after this object is gone.
  */
 class CacheUnMarshaller: public libdap::UnMarshaller {
 private:
-    std::istream &d_in;
+    std::istream *d_in;
+
+    std::shared_ptr<CacheFileMap> d_map;
+    const char *d_start;
+    const char *d_pos;
+    const char *d_end;
 
     CacheUnMarshaller();
     CacheUnMarshaller(const CacheUnMarshaller &um);
     CacheUnMarshaller & operator=(const CacheUnMarshaller &);
 
+    void read(char *val, size_t bytes);
+
 public:
-    CacheUnMarshaller(std::istream &in) : UnMarshaller(), d_in(in) {
+    CacheUnMarshaller(std::istream &in) : UnMarshaller(), d_in(&in), d_start(0), d_pos(0), d_end(0) {
         assert(sizeof(std::streamsize) >= sizeof(int64_t));
         // This will cause exceptions to be thrown on i/o errors. The exception
         // will be ostream::failure
-        d_in.exceptions(std::istream::failbit | std::istream::badbit);
+        d_in->exceptions(std::istream::failbit | std::istream::badbit);
+    }
+
+    /**
+     * Read values from memory
+     * @param map The memory that holds data
+     * @param data The first value
+     * @param size The number of bytes that can be read
+     */
+    CacheUnMarshaller(std::shared_ptr<CacheFileMap> map, const char *data, size_t size) :
+        UnMarshaller(), d_in(0), d_map(map), d_start(data), d_pos(data), d_end(data + size) {
     }
 
     virtual ~CacheUnMarshaller() { }
@@ -78,6 +103,15 @@ public:
     virtual void get_vector(char **val, unsigned int &num, libdap::Vector &);
     virtual void get_vector(char **val, unsigned int &num, int width, libdap::Vector &);
 
+    bool is_mapped() const { return d_in == 0; }
+
+    std::shared_ptr<CacheFileMap> get_map() const { return d_map; }
+
+    /// The number of bytes read from memory
+    size_t get_position() const { return d_pos - d_start; }
+
+    const char *get_pointer(size_t bytes);
+
     virtual void dump(ostream &strm) const;
 };
 
@@ -27,6 +27,7 @@
 //#define DODS_DEBUG
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <cassert>
@@ -45,17 +46,150 @@
 #include <DDS.h>
 #include <ConstraintEvaluator.h>
 #include <Marshaller.h>
-//#include <UnMarshaller.h>
+#include <UnMarshaller.h>
+#include <Error.h>
 #include <debug.h>
 
 #include "BESIndent.h"
 #include "CachedSequence.h"
+#include "CacheUnMarshaller.h"
 
 using namespace std;
 using namespace libdap;
 
 // namespace bes {
 
+// The row markers written by Sequence::serialize()
+static const unsigned char start_of_instance = 0x5A;
+static const unsigned char end_of_sequence = 0xA5;
+
+// Skip over one value of a scalar
+static void skip_value(CacheUnMarshaller &um, Type type)
+{
+    switch (type) {
+    case dods_byte_c:
+        um.get_pointer(sizeof(dods_byte));
+        break;
+    case dods_int16_c:
+    case dods_uint16_c:
+        um.get_pointer(sizeof(dods_int16));
+        break;
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_float32_c:
+        um.get_pointer(sizeof(dods_int32));
+        break;
+    case dods_float64_c:
+        um.get_pointer(sizeof(dods_float64));
+        break;
+    case dods_str_c:
+    case dods_url_c: {
+        size_t len;
+        memcpy(&len, um.get_pointer(sizeof(size_t)), sizeof(size_t));
+        um.get_pointer(len);
+        break;
+    }
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Expected a scalar when skipping values.");
+    }
+}
+
+// Read one value of a scalar into the variable
+static void load_value(CacheUnMarshaller &um, BaseType *var)
+{
+    switch (var->type()) {
+    case dods_byte_c: {
+        dods_byte val;
+        um.get_byte(val);
+        static_cast<Byte*>(var)->set_value(val);
+        break;
+    }
+    case dods_int16_c: {
+        dods_int16 val;
+        um.get_int16(val);
+        static_cast<Int16*>(var)->set_value(val);
+        break;
+    }
+    case dods_int32_c: {
+        dods_int32 val;
+        um.get_int32(val);
+        static_cast<Int32*>(var)->set_value(val);
+        break;
+    }
+    case dods_uint16_c: {
+        dods_uint16 val;
+        um.get_uint16(val);
+        static_cast<UInt16*>(var)->set_value(val);
+        break;
+    }
+    case dods_uint32_c: {
+        dods_uint32 val;
+        um.get_uint32(val);
+        static_cast<UInt32*>(var)->set_value(val);
+        break;
+    }
+    case dods_float32_c: {
+        dods_float32 val;
+        um.get_float32(val);
+        static_cast<Float32*>(var)->set_value(val);
+        break;
+    }
+    case dods_float64_c: {
+        dods_float64 val;
+        um.get_float64(val);
+        static_cast<Float64*>(var)->set_value(val);
+        break;
+    }
+    case dods_str_c: {
+        string val;
+        um.get_str(val);
+        static_cast<Str*>(var)->set_value(val);
+        break;
+    }
+    case dods_url_c: {
+        string val;
+        um.get_url(val);
+        static_cast<Url*>(var)->set_value(val);
+        break;
+    }
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Expected a scalar when loading values.");
+    }
+}
+
+/**
+ * Are all of the Sequence's fields scalars that skip_value() and
+ * load_value() know about?
+ */
+bool CachedSequence::has_scalar_fields()
+{
+    if (d_vars.empty()) return false;
+
+    for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+        switch ((*i)->type()) {
+        case dods_byte_c:
+        case dods_int16_c:
+        case dods_int32_c:
+        case dods_uint16_c:
+        case dods_uint32_c:
+        case dods_float32_c:
+        case dods_float64_c:
+        case dods_str_c:
+        case dods_url_c:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CachedSequence::start_rows()
+{
+    d_row_reader.reset(new CacheUnMarshaller(d_map, d_rows, d_rows_size));
+}
+
 void CachedSequence::load_prototypes_with_values(BaseTypeRow &btr, bool safe)
 {
     // For each of the prototype variables in the Sequence, load it
@@ -139,10 +273,67 @@ void CachedSequence::load_prototypes_with_values(BaseTypeRow &btr, bool safe)
  * @param ce_eval If True, evaluate any CE, otherwise do not.
  */
 
+/**
+ * @brief Deserialize a Sequence, or find its rows in memory
+ *
+ * When the values are being read from memory (a cache file mapped using
+ * CacheFileMap) and all of the fields are scalars, the rows are not loaded
+ * into the Sequence's values. Instead this records where they are and
+ * read_row() reads them, one at a time, when the Sequence is serialized.
+ * Otherwise the parent class' method is used.
+ */
+bool CachedSequence::deserialize(UnMarshaller &um, DDS *dds, bool reuse)
+{
+    CacheUnMarshaller *cum = dynamic_cast<CacheUnMarshaller*>(&um);
+    if (!cum || !cum->is_mapped() || !has_scalar_fields()) return Sequence::deserialize(um, dds, reuse);
+
+    d_map = cum->get_map();
+    d_rows = cum->get_pointer(0);
+    size_t start = cum->get_position();
+
+    // Find the end of the rows
+    while (true) {
+        unsigned char marker = *cum->get_pointer(1);
+        if (marker == end_of_sequence) break;
+        if (marker != start_of_instance)
+            throw Error(internal_error, "I could not read the expected Sequence data stream marker!");
+
+        for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+            skip_value(*cum, (*i)->type());
+    }
+
+    d_rows_size = cum->get_position() - start;
+    d_row_reader.reset();
+
+    return false;
+}
+
 bool CachedSequence::read_row(int row, DDS &dds, ConstraintEvaluator &eval, bool ce_eval)
 {
     DBGN(cerr << __PRETTY_FUNCTION__ << " name: " << name() << ", row number " << row << ", current row " << get_row_number() << endl);
 
+    if (d_rows) {
+        // The rows are read from memory; see deserialize()
+        if (!d_row_reader) start_rows();
+
+        while (row > get_row_number()) {
+            if (d_row_reader->get_position() == d_rows_size) return false;
+
+            unsigned char marker = *d_row_reader->get_pointer(1);
+            if (marker == end_of_sequence) return false;
+
+            for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+                load_value(*d_row_reader, *i);
+
+            if (!ce_eval || eval.eval_selection(dds, dataset())) {
+                increment_row_number(1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     // get_row_number() returns the current row number for the sequence. This
     // means the number of the current row that satisfies the selection constraint.
     // Thus, if 20 rows have been res (d_value_index == 19 then) but only 5
@@ -200,6 +391,7 @@ bool CachedSequence::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &
 {
     // Reset the index to the parent's value field's index
     d_value_index = 0;
+    if (d_rows) start_rows();
 
     return Sequence::serialize(eval, dds, m, ce_eval);
 }
@@ -216,6 +408,7 @@ bool CachedSequence::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &
 void CachedSequence::intern_data(ConstraintEvaluator &eval, DDS &dds)
 {
     d_value_index = 0;
+    if (d_rows) start_rows();
 
     Sequence::intern_data(eval, dds);
 }
@@ -25,23 +25,42 @@
 #ifndef _cached_sequence_h
 #define _cached_sequence_h 1
 
+#include <memory>
+
 #include <Sequence.h>
 
 namespace libdap {
 class ConstraintEvaluator;
 class DDS;
 class Marshaller;
+class UnMarshaller;
 }
 
+class CacheFileMap;
+class CacheUnMarshaller;
+
 // namespace bes {
 
 /** @brief Specialization of Sequence for cached responses
  *
  * Assumes that the data are loaded into the Sequence using set_value()
+ * or, when a Sequence of scalars is deserialized from a cache file mapped
+ * into memory, that its rows are read from that memory one at a time by
+ * read_row(). In the latter case the Sequence's values (e.g., value_ref())
+ * are not loaded; use serialize() or intern_data() to read them.
  */
 class CachedSequence: public libdap::Sequence
 {
 private:
+    // Rows that are read from memory; see deserialize()
+    std::shared_ptr<CacheFileMap> d_map;
+    const char *d_rows;
+    size_t d_rows_size;
+    std::shared_ptr<CacheUnMarshaller> d_row_reader;
+
+    bool has_scalar_fields();
+    void start_rows();
+
 protected:
     unsigned int d_value_index;
 
@@ -56,7 +75,7 @@ public:
         created.
 
         @brief The Sequence constructor. */
-    CachedSequence(const string &n) : Sequence(n), d_value_index(0) { }
+    CachedSequence(const string &n) : Sequence(n), d_rows(0), d_rows_size(0), d_value_index(0) { }
 
     /** The Sequence server-side constructor requires the name of the variable
         to be created and the dataset name from which this variable is being
@@ -68,10 +87,11 @@ public:
         variable is being created.
 
         @brief The Sequence server-side constructor. */
-    CachedSequence(const string &n, const string &d) : Sequence(n, d), d_value_index(0) { }
+    CachedSequence(const string &n, const string &d) : Sequence(n, d), d_rows(0), d_rows_size(0), d_value_index(0) { }
 
     /** @brief The Sequence copy constructor. */
-    CachedSequence(const CachedSequence &rhs) : Sequence(rhs), d_value_index(0) { }
+    CachedSequence(const CachedSequence &rhs) : Sequence(rhs), d_map(rhs.d_map), d_rows(rhs.d_rows),
+        d_rows_size(rhs.d_rows_size), d_value_index(0) { }
 
     virtual ~CachedSequence() { }
 
@@ -83,9 +103,16 @@ public:
 
         static_cast<Sequence &>(*this) = rhs; // run Sequence=
 
+        d_map = rhs.d_map;
+        d_rows = rhs.d_rows;
+        d_rows_size = rhs.d_rows_size;
+        d_row_reader.reset();
+
         return *this;
     }
 
+    virtual bool deserialize(libdap::UnMarshaller &um, libdap::DDS *dds, bool reuse = false);
+
     virtual bool read_row(int row, libdap::DDS &dds, libdap::ConstraintEvaluator &eval, bool ce_eval);
 
     virtual void intern_data(libdap::ConstraintEvaluator &eval, libdap::DDS &dds);
@@ -0,0 +1,156 @@
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+#include <sstream>
+
+#include "ShowStoredResultResponseHandler.h"
+#include "BESStoredDapResultCache.h"
+#include "BESStoredResultJobs.h"
+
+#include "BESDebug.h"
+#include "BESInfoList.h"
+#include "BESInfo.h"
+#include "BESDataNames.h"
+#include "BESInternalError.h"
+#include "BESNotFoundError.h"
+#include "BESStopWatch.h"
+
+using std::endl;
+using std::map;
+using std::string;
+using std::ostream;
+using std::ostringstream;
+
+#define SHOW_STORED_RESULT_RESPONSE_STR "showStoredResult"
+#define STORED_RESULT_ID "storedResultId"
+
+#define STORED_RESULT "StoredResult"
+#define ID "id"
+#define STATE "state"
+#define BYTES "bytes"
+#define SUBMITTED "submitted"
+#define STARTED "started"
+#define FINISHED "finished"
+#define MESSAGE "message"
+
+static string time_str(time_t t)
+{
+    ostringstream oss;
+    oss << t;
+    return oss.str();
+}
+
+ShowStoredResultResponseHandler::ShowStoredResultResponseHandler(const string &name) :
+    BESResponseHandler(name)
+{
+}
+
+ShowStoredResultResponseHandler::~ShowStoredResultResponseHandler()
+{
+}
+
+/** @brief executes the command 'show storedResult for &lt;id&gt;;'
+ *
+ * The response object BESInfo is created to store the information.
+ *
+ * @param dhi structure that holds request and response information
+ * @see BESDataHandlerInterface
+ * @see BESInfo
+ */
+void ShowStoredResultResponseHandler::execute(BESDataHandlerInterface &dhi)
+{
+    BESStopWatch sw;
+    if (BESISDEBUG(TIMING_LOG)) sw.start("ShowStoredResultResponseHandler::execute", dhi.data[REQUEST_ID]);
+
+    string id = dhi.data[STORED_RESULT_ID];
+    BESDEBUG("dap", "ShowStoredResultResponseHandler::execute() - id: " << id << endl);
+
+    BESStoredDapResultCache *cache = BESStoredDapResultCache::get_instance();
+    if (!cache)
+        throw BESInternalError("The stored result cache is not configured.", __FILE__, __LINE__);
+
+    BESStoredResultJob job;
+    if (!BESStoredResultJobs::get_job(cache, id, job))
+        throw BESNotFoundError("There is no stored result '" + id + "'.", __FILE__, __LINE__);
+
+    BESInfo *info = BESInfoList::TheList()->build_info();
+    d_response_object = info;
+
+    info->begin_response(SHOW_STORED_RESULT_RESPONSE_STR, dhi);
+
+    map<string, string> attrs;
+    attrs[ID] = id;
+    info->begin_tag(STORED_RESULT, &attrs);
+
+    info->add_tag(STATE, BESStoredResultJob::state_name(job.d_state));
+
+    ostringstream bytes;
+    bytes << job.d_bytes;
+    info->add_tag(BYTES, bytes.str());
+
+    if (job.d_submitted) info->add_tag(SUBMITTED, time_str(job.d_submitted));
+    if (job.d_started) info->add_tag(STARTED, time_str(job.d_started));
+    if (job.d_finished) info->add_tag(FINISHED, time_str(job.d_finished));
+    if (!job.d_message.empty()) info->add_tag(MESSAGE, job.d_message);
+
+    info->end_tag(STORED_RESULT);
+
+    info->end_response();
+}
+
+/** @brief transmit the response object built by the execute command
+ * using the specified transmitter object
+ *
+ * @param transmitter object that knows how to transmit specific basic types
+ * @param dhi structure that holds the request and response information
+ * @see BESInfo
+ * @see BESTransmitter
+ * @see BESDataHandlerInterface
+ */
+void ShowStoredResultResponseHandler::transmit(BESTransmitter *transmitter, BESDataHandlerInterface &dhi)
+{
+    if (d_response_object) {
+        BESInfo *info = dynamic_cast<BESInfo *>(d_response_object);
+        if (!info) throw BESInternalError("cast error", __FILE__, __LINE__);
+        info->transmit(transmitter, dhi);
+    }
+}
+
+/** @brief dumps information about this object
+ *
+ * Displays the pointer value of this instance
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void ShowStoredResultResponseHandler::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "ShowStoredResultResponseHandler::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    BESResponseHandler::dump(strm);
+    BESIndent::UnIndent();
+}
+
+BESResponseHandler *
+ShowStoredResultResponseHandler::ShowStoredResultResponseBuilder(const string &name)
+{
+    return new ShowStoredResultResponseHandler(name);
+}
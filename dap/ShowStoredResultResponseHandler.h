@@ -0,0 +1,55 @@
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+#ifndef I_ShowStoredResultResponseHandler_h
+#define I_ShowStoredResultResponseHandler_h 1
+
+#include <string>
+#include <ostream>
+
+#include "BESResponseHandler.h"
+
+#define SHOW_STORED_RESULT_RESPONSE "show.storedResult"
+
+/** @brief response handler that returns the status of a stored result
+ *
+ * The response holds the state of the job building the result (queued,
+ * running, complete or failed), the number of bytes written so far, the
+ * times the job was submitted, started and finished, and, if the job
+ * failed, why.
+ *
+ * @see BESStoredResultJobs
+ */
+class ShowStoredResultResponseHandler: public BESResponseHandler {
+public:
+    ShowStoredResultResponseHandler(const std::string &name);
+    virtual ~ShowStoredResultResponseHandler(void);
+
+    virtual void execute(BESDataHandlerInterface &dhi);
+    virtual void transmit(BESTransmitter *transmitter, BESDataHandlerInterface &dhi);
+
+    virtual void dump(std::ostream &strm) const;
+
+    static BESResponseHandler *ShowStoredResultResponseBuilder(const std::string &name);
+};
+
+#endif // I_ShowStoredResultResponseHandler_h
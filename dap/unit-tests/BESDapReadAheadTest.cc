@@ -0,0 +1,296 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include <Int32.h>
+#include <Error.h>
+#include <util.h>
+#include <debug.h>
+
+#include "BESDebug.h"
+#include "BESDapReadAhead.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+/**
+ * A variable that records when and where it is read. Its read() sleeps, so
+ * the worker threads run ahead of the caller, and may throw.
+ */
+class ReadAheadVar: public Int32 {
+public:
+    static pthread_mutex_t s_mutex;
+    static vector<unsigned int> s_reads;    // the variables read, in the order they were started
+
+    unsigned int d_index;
+    bool d_throw;
+    unsigned int d_reads;
+    pthread_t d_reader;
+
+    ReadAheadVar(unsigned int index) :
+        Int32(string("v") + long_to_string(index)), d_index(index), d_throw(false), d_reads(0), d_reader(pthread_self())
+    {
+    }
+
+    virtual bool read()
+    {
+        if (read_p()) return true;
+
+        pthread_mutex_lock(&s_mutex);
+        s_reads.push_back(d_index);
+        ++d_reads;
+        d_reader = pthread_self();
+        pthread_mutex_unlock(&s_mutex);
+
+        usleep(10000);
+        if (d_throw) throw Error("Could not read " + name());
+
+        set_read_p(true);
+        return true;
+    }
+
+    /// @return The largest index of the variables whose reads have started
+    static unsigned int max_read()
+    {
+        pthread_mutex_lock(&s_mutex);
+        unsigned int max = 0;
+        for (vector<unsigned int>::iterator i = s_reads.begin(), e = s_reads.end(); i != e; ++i)
+            if (*i > max) max = *i;
+        pthread_mutex_unlock(&s_mutex);
+        return max;
+    }
+
+    static unsigned int reads()
+    {
+        pthread_mutex_lock(&s_mutex);
+        unsigned int n = s_reads.size();
+        pthread_mutex_unlock(&s_mutex);
+        return n;
+    }
+};
+
+pthread_mutex_t ReadAheadVar::s_mutex = PTHREAD_MUTEX_INITIALIZER;
+vector<unsigned int> ReadAheadVar::s_reads;
+
+class BESDapReadAheadTest: public TestFixture {
+private:
+    vector<BaseType*> d_vars;
+
+    ReadAheadVar *var(unsigned int i) { return static_cast<ReadAheadVar*>(d_vars[i]); }
+
+public:
+    BESDapReadAheadTest()
+    {
+    }
+
+    ~BESDapReadAheadTest()
+    {
+    }
+
+    void setUp()
+    {
+        ReadAheadVar::s_reads.clear();
+        for (unsigned int i = 0; i < 10; ++i)
+            d_vars.push_back(new ReadAheadVar(i));
+    }
+
+    void tearDown()
+    {
+        for (vector<BaseType*>::iterator i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+            delete *i;
+        d_vars.clear();
+    }
+
+    // With no window, the variables are all read by the caller
+    void no_read_ahead_test()
+    {
+        BESDapReadAhead read_ahead(d_vars, 0);
+        for (unsigned int i = 0; i < d_vars.size(); ++i) {
+            read_ahead.wait(var(i));
+            CPPUNIT_ASSERT(!var(i)->read_p());
+            var(i)->read();
+        }
+
+        CPPUNIT_ASSERT(ReadAheadVar::reads() == d_vars.size());
+        for (unsigned int i = 0; i < d_vars.size(); ++i)
+            CPPUNIT_ASSERT(pthread_equal(var(i)->d_reader, pthread_self()));
+    }
+
+    // The variables are used in order, each is read once and at most
+    // 'window' variables are read ahead of the one being used.
+    void ordering_test()
+    {
+        const unsigned int window = 3;
+        {
+            BESDapReadAhead read_ahead(d_vars, window);
+            for (unsigned int i = 0; i < d_vars.size(); ++i) {
+                read_ahead.wait(var(i));
+                CPPUNIT_ASSERT(ReadAheadVar::max_read() <= i + window);
+
+                // This is what serialize() does
+                var(i)->read();
+                CPPUNIT_ASSERT(var(i)->read_p());
+                DBG(cerr << "Used " << var(i)->name() << ", reads started: " << ReadAheadVar::reads() << endl);
+            }
+        }
+
+        CPPUNIT_ASSERT(ReadAheadVar::reads() == d_vars.size());
+
+        unsigned int read_by_workers = 0;
+        for (unsigned int i = 0; i < d_vars.size(); ++i) {
+            CPPUNIT_ASSERT(var(i)->d_reads == 1);
+            if (!pthread_equal(var(i)->d_reader, pthread_self())) ++read_by_workers;
+        }
+
+        DBG(cerr << "Read by worker threads: " << read_by_workers << endl);
+        CPPUNIT_ASSERT(read_by_workers > 0);
+    }
+
+    // A variable whose read throws on a worker thread is left for the caller
+    // to read again, so the caller sees the error.
+    void exception_test()
+    {
+        var(2)->d_throw = true;
+
+        BESDapReadAhead read_ahead(d_vars, 4);
+
+        // Let the worker threads read the first variables
+        usleep(50000);
+        CPPUNIT_ASSERT(var(2)->d_reads == 1);
+        CPPUNIT_ASSERT(!pthread_equal(var(2)->d_reader, pthread_self()));
+
+        read_ahead.wait(var(0));
+        var(0)->read();
+        read_ahead.wait(var(1));
+        var(1)->read();
+
+        read_ahead.wait(var(2));
+        CPPUNIT_ASSERT(!var(2)->read_p());
+        CPPUNIT_ASSERT_THROW(var(2)->read(), Error);
+
+        // The others are still read
+        for (unsigned int i = 3; i < d_vars.size(); ++i) {
+            read_ahead.wait(var(i));
+            var(i)->read();
+            CPPUNIT_ASSERT(var(i)->read_p());
+        }
+    }
+
+    // If the caller stops (e.g., serialize() throws), the destructor waits
+    // for the reads that have started and no others are started.
+    void early_stop_test()
+    {
+        const unsigned int window = 2;
+        {
+            BESDapReadAhead read_ahead(d_vars, window);
+            read_ahead.wait(var(0));
+            var(0)->read();
+        }
+
+        unsigned int reads = ReadAheadVar::reads();
+        DBG(cerr << "Reads started: " << reads << endl);
+        CPPUNIT_ASSERT(reads <= window + 1);
+        CPPUNIT_ASSERT(ReadAheadVar::max_read() <= window);
+
+        // Nothing is read once the destructor returns
+        usleep(50000);
+        CPPUNIT_ASSERT(ReadAheadVar::reads() == reads);
+        CPPUNIT_ASSERT(!var(d_vars.size() - 1)->read_p());
+    }
+
+    CPPUNIT_TEST_SUITE( BESDapReadAheadTest );
+
+    CPPUNIT_TEST(no_read_ahead_test);
+    CPPUNIT_TEST(ordering_test);
+    CPPUNIT_TEST(exception_test);
+    CPPUNIT_TEST(early_stop_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BESDapReadAheadTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,dap");
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: BESDapReadAheadTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = BESDapReadAheadTest::suite()->getTests();
+            unsigned int prefix_len = BESDapReadAheadTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BESDapReadAheadTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <string>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include "CacheKey.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+
+class CacheKeyTest: public TestFixture {
+private:
+    // Check the canonical form of a constraint
+    void check(const string &ce, const string &expected, char separator = ',')
+    {
+        string canonical = canonical_constraint(ce, separator);
+        DBG(cerr << "'" << ce << "' -> '" << canonical << "'" << endl);
+        CPPUNIT_ASSERT_EQUAL(expected, canonical);
+    }
+
+public:
+    CacheKeyTest()
+    {
+    }
+
+    ~CacheKeyTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void white_space_test()
+    {
+        check("", "");
+        check(" a , b ", "a,b");
+        check("a [ 0 : 3 ]", "a[0:3]");
+    }
+
+    void hyperslab_test()
+    {
+        check("a[3]", "a[3:3]");
+        check("a[0:1:9]", "a[0:9]");
+        check("a[0:9]", "a[0:9]");
+        check("a[0:2:9]", "a[0:2:9]");
+        check("a[0:1:9][4]", "a[0:9][4:4]");
+        check("a[ 0 : 1 : 9 ]", "a[0:9]");
+
+        // Not made of digits and colons
+        check("a[i]", "a[i]");
+    }
+
+    void projection_test()
+    {
+        check("c,a,b", "a,b,c");
+        check("b,a,b", "a,b");
+        check("a[0:3],b,a[0:3]", "a[0:3],b");
+        check("b,,a", "a,b");
+
+        // The order of the hyperslabs of one variable is kept
+        check("a[5:8],a[0:3]", "a[5:8],a[0:3]");
+        check("b,a[5:8],a[0:3]", "b,a[5:8],a[0:3]");
+
+        // And so is the order of function results
+        check("b,f(a)", "b,f(a)");
+        check("g(b),f(a)", "g(b),f(a)");
+    }
+
+    void selection_test()
+    {
+        check("b,a&y>1&x<2", "a,b&x<2&y>1");
+        check("a&x<2&x<2", "a&x<2");
+        check("&y>1&x<2", "&x<2&y>1");
+
+        // The projection is sorted separately from the selection
+        check("b&a>1,a", "b&a>1,a");
+    }
+
+    void quoted_string_test()
+    {
+        // Separators and white space inside quotes are part of the string
+        check("a&s=\"x, y&z\"", "a&s=\"x, y&z\"");
+        check("b,a&s=\"p,q\"&r=1", "a,b&r=1&s=\"p,q\"");
+        check("f(\"b,a\")", "f(\"b,a\")");
+        check("a&s=\"a \\\" b,c\"&r=1", "a&r=1&s=\"a \\\" b,c\"");
+    }
+
+    void dap4_separator_test()
+    {
+        check("b;a", "a;b", ';');
+        check("b[0:1:3];a", "a;b[0:3]", ';');
+        check("a[5:8];a[0:3]", "a[5:8];a[0:3]", ';');
+
+        // A ',' does not separate DAP4 variables...
+        check("b,a", "b,a", ';');
+
+        // ...and a ';' does not separate DAP2 variables
+        check("b;a", "b;a");
+
+        // Nor is a DAP4 filter split
+        check("b;a{x<1;y>2}", "a{x<1;y>2};b", ';');
+    }
+
+    void cache_key_test()
+    {
+        // Not a file, so there is no version
+        CPPUNIT_ASSERT_EQUAL(string("/no/such/file##a,b"), make_cache_key("/no/such/file", "b, a"));
+
+        string dataset = string(TEST_SRC_DIR) + "/input-files/test.05.ddx";
+        string version = dataset_version(dataset);
+        DBG(cerr << "version: " << version << endl);
+        CPPUNIT_ASSERT(!version.empty());
+        CPPUNIT_ASSERT_EQUAL(dataset + "#" + version + "#a;b", make_cache_key(dataset, "b;a", ';'));
+
+        CPPUNIT_ASSERT_EQUAL(make_cache_key(dataset, "a[0:1:3],b"), make_cache_key(dataset, "b, a[0:3]"));
+    }
+
+    void hash_test()
+    {
+        CPPUNIT_ASSERT_EQUAL(string("cbd8a7b341bd9b025b1e906a48ae1d19"), hash_cache_key("hello"));
+        CPPUNIT_ASSERT_EQUAL(string("00000000000000000000000000000000"), hash_cache_key(""));
+
+        // Longer than one 16-byte block, with a tail of every length
+        string key;
+        for (unsigned int i = 0; i < 33; ++i) {
+            string hash = hash_cache_key(key);
+            CPPUNIT_ASSERT(hash.size() == 32);
+            CPPUNIT_ASSERT(hash != hash_cache_key(key + "x"));
+            key += 'a' + i % 26;
+        }
+    }
+
+    CPPUNIT_TEST_SUITE( CacheKeyTest );
+
+    CPPUNIT_TEST(white_space_test);
+    CPPUNIT_TEST(hyperslab_test);
+    CPPUNIT_TEST(projection_test);
+    CPPUNIT_TEST(selection_test);
+    CPPUNIT_TEST(quoted_string_test);
+    CPPUNIT_TEST(dap4_separator_test);
+    CPPUNIT_TEST(cache_key_test);
+    CPPUNIT_TEST(hash_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CacheKeyTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: CacheKeyTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = CacheKeyTest::suite()->getTests();
+            unsigned int prefix_len = CacheKeyTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = CacheKeyTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -38,13 +38,23 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+
 #include <Array.h>
 #include <Byte.h>
+#include <Int32.h>
+#include <Str.h>
+#include <Sequence.h>
 #include <ServerFunctionsList.h>
 #include <ConstraintEvaluator.h>
 #include <DAS.h>
 #include <DDS.h>
 #include <DDXParserSAX2.h>
+#include <XDRStreamMarshaller.h>
+#include <XDRStreamUnMarshaller.h>
 
 #include <GetOpt.h>
 #include <GNURegex.h>
@@ -54,6 +64,7 @@
 #include <test/TestTypeFactory.h>
 
 #include "BESDapFunctionResponseCache.h"
+#include "CachedSequence.h"
 #include "BESError.h"
 #include "TheBESKeys.h"
 #include "BESDebug.h"
@@ -146,6 +157,7 @@ public:
         dp(&ttf), test_dds(0), d_cache(string(TEST_BUILD_DIR) + c_cache_name), cache(0)
     {
         libdap::ServerFunctionsList::TheList()->add_function(new TestFunction());
+        libdap::ServerFunctionsList::TheList()->add_function(new TestSequenceFunction());
     }
 
     ~FunctionResponseCacheTest()
@@ -368,6 +380,344 @@ public:
         DBG(cerr << "cache_and_read_a_response() - END" << endl);
     }
 
+    // Cache a response with two variables and read it back, using a
+    // projection that needs only one of them. The other should not be read.
+    void cache_and_read_a_projection()
+    {
+        DBG(cerr << "cache_and_read_a_projection() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+        try {
+            const string constraint = "test(\"a\"),test(\"b\")";
+
+            DDS *result = cache->get_or_cache_dataset(test_dds, constraint);
+            CPPUNIT_ASSERT(result);
+            int var_count = result->var_end() - result->var_begin();
+            CPPUNIT_ASSERT(var_count == 2);
+            delete result;
+
+            string resource_id = cache->get_resource_id(test_dds, constraint);
+            string cache_file_name = cache->get_hash_basename(resource_id);
+
+            DDS *result2 = cache->load_from_cache(resource_id, cache_file_name, "b");
+            CPPUNIT_ASSERT(result2);
+            CPPUNIT_ASSERT(!result2->var("a")->read_p());
+            CPPUNIT_ASSERT(result2->var("b")->read_p());
+
+            ostringstream oss;
+            result2->var("b")->print_val(oss, "", false /*print declaration */);
+            DBG(cerr << "Value " << oss.str() << endl);
+            CPPUNIT_ASSERT(oss.str().compare("{{0, 1, 2},{3, 4, 5},{6, 7, 8}}") == 0);
+            delete result2;
+
+            // A projection that does not name a top-level variable reads them all
+            cache_file_name = cache->get_hash_basename(resource_id);
+            DDS *result3 = cache->load_from_cache(resource_id, cache_file_name, "c");
+            CPPUNIT_ASSERT(result3);
+            CPPUNIT_ASSERT(result3->var("a")->read_p());
+            CPPUNIT_ASSERT(result3->var("b")->read_p());
+            delete result3;
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+
+        DBG(cerr << "cache_and_read_a_projection() - END" << endl);
+    }
+
+    // Serialize the variables of 'dds' that the constraint projects
+    string serialize(DDS &dds, const string &constraint)
+    {
+        ConstraintEvaluator ce;
+        if (constraint.empty())
+            dds.mark_all(true);
+        else
+            ce.parse_constraint(constraint, dds);
+
+        ostringstream oss;
+        XDRStreamMarshaller m(oss);
+        for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i) {
+            if ((*i)->send_p()) (*i)->serialize(ce, dds, m, true);
+        }
+
+        return oss.str();
+    }
+
+    // Deserialize the response made by serialize() for the Sequence made by
+    // seq() and check that it holds the rows in 'rows'
+    void check_seq_rows(const string &response, const vector<int> &rows)
+    {
+        Sequence seq("s");
+        seq.add_var_nocopy(new Int32("i"));
+        seq.add_var_nocopy(new Str("s"));
+
+        DDS dds(&ttf);
+        istringstream iss(response);
+        XDRStreamUnMarshaller um(iss);
+        seq.deserialize(um, &dds);
+
+        SequenceValues &values = seq.value_ref();
+        DBG(cerr << "rows: " << values.size() << endl);
+        CPPUNIT_ASSERT(values.size() == rows.size());
+
+        for (unsigned int r = 0; r < rows.size(); ++r) {
+            BaseTypeRow &row = *values[r];
+            CPPUNIT_ASSERT(row.size() == 2);
+
+            int i = static_cast<Int32*>(row[0])->value();
+            string s = static_cast<Str*>(row[1])->value();
+            DBG(cerr << "row " << r << ": " << i << ", '" << s << "'" << endl);
+
+            CPPUNIT_ASSERT(i == rows[r]);
+            CPPUNIT_ASSERT(s == (i == 0 ? "" : "row " + long_to_string(i)));
+        }
+    }
+
+    // Cache a Sequence of scalars and read it back. Its rows are read from
+    // the mapped cache file each time it is serialized.
+    void cache_and_read_a_sequence()
+    {
+        DBG(cerr << "cache_and_read_a_sequence() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+        try {
+            const string constraint = "seq(\"s\",\"5\")";
+
+            DDS *result = cache->get_or_cache_dataset(test_dds, constraint);
+            CPPUNIT_ASSERT(result);
+            delete result;
+
+            string resource_id = cache->get_resource_id(test_dds, constraint);
+            string cache_file_name = cache->get_hash_basename(resource_id);
+
+            DDS *result2 = cache->load_from_cache(resource_id, cache_file_name);
+            CPPUNIT_ASSERT(result2);
+            CPPUNIT_ASSERT(dynamic_cast<CachedSequence*>(result2->var("s")));
+
+            vector<int> all_rows;
+            for (int i = 0; i < 5; ++i)
+                all_rows.push_back(i);
+
+            string response = serialize(*result2, "");
+            check_seq_rows(response, all_rows);
+
+            // Serializing again starts at the first row
+            CPPUNIT_ASSERT(serialize(*result2, "") == response);
+
+            vector<int> selected_rows;
+            selected_rows.push_back(3);
+            selected_rows.push_back(4);
+            check_seq_rows(serialize(*result2, "s&s.i>2"), selected_rows);
+
+            // And without the selection again
+            check_seq_rows(serialize(*result2, ""), all_rows);
+            delete result2;
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+
+        DBG(cerr << "cache_and_read_a_sequence() - END" << endl);
+    }
+
+    // Read the last entry of a cache file's block table, just before the
+    // trailer (the block count, the table's offset and the magic), and find
+    // where the values start.
+    void read_last_block(const string &file_name, uint64_t block[3], uint64_t &data_start)
+    {
+        ifstream in(file_name.c_str(), ios::binary);
+        in.seekg(0, ios::end);
+        uint64_t file_size = in.tellg();
+
+        uint64_t trailer[2];
+        in.seekg(file_size - (3 * sizeof(uint64_t) + 2 * sizeof(uint64_t) + 8));
+        in.read(reinterpret_cast<char*>(block), 3 * sizeof(uint64_t));
+        in.read(reinterpret_cast<char*>(trailer), sizeof(trailer));
+        CPPUNIT_ASSERT(in);
+
+        // The table is 'trailer[0]' entries at 'trailer[1]' from the start of the values
+        data_start = file_size - (2 * sizeof(uint64_t) + 8) - trailer[0] * 3 * sizeof(uint64_t) - trailer[1];
+        DBG(cerr << "block offset: " << block[0] << ", size: " << block[1] << ", length: " << block[2]
+            << ", data start: " << data_start << endl);
+    }
+
+    // The Sequence's block is big enough to be compressed; it is read back
+    // through a buffer that holds the uncompressed values.
+    void cache_and_read_a_compressed_block()
+    {
+        DBG(cerr << "cache_and_read_a_compressed_block() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+        try {
+            const string constraint = "seq(\"s\",\"200\")";
+
+            DDS *result = cache->get_or_cache_dataset(test_dds, constraint);
+            CPPUNIT_ASSERT(result);
+            delete result;
+
+            string resource_id = cache->get_resource_id(test_dds, constraint);
+            string cache_file_name = cache->get_hash_basename(resource_id);
+
+            uint64_t block[3];
+            uint64_t data_start;
+            read_last_block(cache_file_name + "_0", block, data_start);
+            CPPUNIT_ASSERT(block[1] < block[2]);
+
+            DDS *result2 = cache->load_from_cache(resource_id, cache_file_name);
+            CPPUNIT_ASSERT(result2);
+
+            vector<int> all_rows;
+            for (int i = 0; i < 200; ++i)
+                all_rows.push_back(i);
+
+            check_seq_rows(serialize(*result2, ""), all_rows);
+            delete result2;
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+
+        DBG(cerr << "cache_and_read_a_compressed_block() - END" << endl);
+    }
+
+    // @return True if loading the cached response throws
+    bool load_throws(const string &resource_id)
+    {
+        string cache_file_name = cache->get_hash_basename(resource_id);
+        try {
+            delete cache->load_from_cache(resource_id, cache_file_name);
+        }
+        catch (Error &e) {
+            DBG(cerr << "Caught: " << e.get_error_message() << endl);
+            return true;
+        }
+        catch (BESError &e) {
+            DBG(cerr << "Caught: " << e.get_message() << endl);
+            return true;
+        }
+
+        return false;
+    }
+
+    // A truncated cache file is an error, not a crash or a short response
+    void read_a_truncated_file()
+    {
+        DBG(cerr << "read_a_truncated_file() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+
+        const string constraint = "seq(\"s\",\"200\")";
+        DDS *result = cache->get_or_cache_dataset(test_dds, constraint);
+        CPPUNIT_ASSERT(result);
+        delete result;
+
+        string resource_id = cache->get_resource_id(test_dds, constraint);
+        string file_name = cache->get_hash_basename(resource_id) + "_0";
+
+        uint64_t block[3];
+        uint64_t data_start;
+        read_last_block(file_name, block, data_start);
+
+        // Without the end of its trailer the file looks like one without a
+        // block table and the compressed block is read as if it held the values
+        struct stat sb;
+        CPPUNIT_ASSERT(stat(file_name.c_str(), &sb) == 0);
+        CPPUNIT_ASSERT(truncate(file_name.c_str(), sb.st_size - 1) == 0);
+        CPPUNIT_ASSERT(load_throws(resource_id));
+
+        // Without the end of the block
+        CPPUNIT_ASSERT(truncate(file_name.c_str(), data_start + block[0] + block[1] / 2) == 0);
+        CPPUNIT_ASSERT(load_throws(resource_id));
+
+        // Without the end of the response's DDX
+        CPPUNIT_ASSERT(truncate(file_name.c_str(), data_start / 2) == 0);
+        CPPUNIT_ASSERT(load_throws(resource_id));
+
+        DBG(cerr << "read_a_truncated_file() - END" << endl);
+    }
+
+    // Overwrite the count and table offset of a cache file's block trailer
+    void write_trailer(const string &file_name, uint64_t count, uint64_t table_offset, const char *magic)
+    {
+        fstream io(file_name.c_str(), ios::binary | ios::in | ios::out);
+        io.seekg(0, ios::end);
+        uint64_t file_size = io.tellg();
+
+        io.seekp(file_size - (2 * sizeof(uint64_t) + 8));
+        io.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        io.write(reinterpret_cast<const char*>(&table_offset), sizeof(table_offset));
+        io.write(magic, 8);
+        CPPUNIT_ASSERT(io);
+    }
+
+    // A file with a block trailer whose table cannot be used must not be
+    // read as if it had no table
+    void read_a_mismatched_block_table()
+    {
+        DBG(cerr << "read_a_mismatched_block_table() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+
+        const string constraint = "seq(\"s\",\"200\")";
+        DDS *result = cache->get_or_cache_dataset(test_dds, constraint);
+        CPPUNIT_ASSERT(result);
+        delete result;
+
+        string resource_id = cache->get_resource_id(test_dds, constraint);
+        string file_name = cache->get_hash_basename(resource_id) + "_0";
+
+        uint64_t block[3];
+        uint64_t data_start;
+        read_last_block(file_name, block, data_start);
+        uint64_t table_offset = block[0] + block[1];
+
+        // A valid trailer for an empty table; the DDX has one variable
+        write_trailer(file_name, 0, table_offset + 3 * sizeof(uint64_t), "BESFRC02");
+        CPPUNIT_ASSERT(load_throws(resource_id));
+
+        // A table written by an older version of the block format
+        write_trailer(file_name, 1, table_offset, "BESFRC01");
+        CPPUNIT_ASSERT(load_throws(resource_id));
+
+        // The unchanged trailer can still be read
+        write_trailer(file_name, 1, table_offset, "BESFRC02");
+        CPPUNIT_ASSERT(!load_throws(resource_id));
+
+        DBG(cerr << "read_a_mismatched_block_table() - END" << endl);
+    }
+
+    // The same function calls, written differently, share one cached response
+    void equivalent_constraints()
+    {
+        DBG(cerr << "equivalent_constraints() - BEGIN" << endl);
+
+        cache = BESDapFunctionResponseCache::get_instance(d_cache, d_mds_prefix, 1000);
+        try {
+            DDS *result = cache->get_or_cache_dataset(test_dds, "test(\"a\"),test(\"b\")");
+            CPPUNIT_ASSERT(result);
+            delete result;
+
+            const string constraint = " test( \"a\" ) , test(\"b\") ";
+            CPPUNIT_ASSERT(cache->get_resource_id(test_dds, constraint)
+                == cache->get_resource_id(test_dds, "test(\"a\"),test(\"b\")"));
+
+            string resource_id = cache->get_resource_id(test_dds, constraint);
+            string cache_file_name = cache->get_hash_basename(resource_id);
+            DDS *result2 = cache->load_from_cache(resource_id, cache_file_name);
+            CPPUNIT_ASSERT(result2);
+            delete result2;
+
+            // The order of function calls is part of the response
+            CPPUNIT_ASSERT(cache->get_resource_id(test_dds, "test(\"b\"),test(\"a\")")
+                != cache->get_resource_id(test_dds, constraint));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+
+        DBG(cerr << "equivalent_constraints() - END" << endl);
+    }
+
 CPPUNIT_TEST_SUITE( FunctionResponseCacheTest );
 
     CPPUNIT_TEST(ctor_test_1);
@@ -375,6 +725,12 @@ CPPUNIT_TEST_SUITE( FunctionResponseCacheTest );
     CPPUNIT_TEST(cache_a_response);
     CPPUNIT_TEST(cache_and_read_a_response);
     CPPUNIT_TEST(cache_and_read_a_response2);
+    CPPUNIT_TEST(cache_and_read_a_projection);
+    CPPUNIT_TEST(equivalent_constraints);
+    CPPUNIT_TEST(cache_and_read_a_sequence);
+    CPPUNIT_TEST(cache_and_read_a_compressed_block);
+    CPPUNIT_TEST(read_a_truncated_file);
+    CPPUNIT_TEST(read_a_mismatched_block_table);
 
     CPPUNIT_TEST_SUITE_END()
     ;
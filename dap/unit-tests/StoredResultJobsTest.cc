@@ -0,0 +1,426 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include <DMR.h>
+#include <D4BaseTypeFactory.h>
+#include <debug.h>
+
+#include "TheBESKeys.h"
+#include "BESStoredDapResultCache.h"
+#include "BESStoredResultJobs.h"
+#include "BESForbiddenError.h"
+#include "BESUtil.h"
+#include "BESDebug.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static const string c_stored_result_subdir = "stored_result_jobs";
+
+class StoredResultJobsTest: public TestFixture {
+private:
+    string d_data_root_dir;
+    string d_jobs_dir;
+    BESStoredDapResultCache *d_cache;
+
+    D4BaseTypeFactory d_factory;
+    DMR *d_dmr;
+
+    // The pid of a process that has exited
+    static pid_t dead_pid()
+    {
+        pid_t pid = fork();
+        if (pid == 0) _exit(0);
+
+        int status;
+        waitpid(pid, &status, 0);
+        return pid;
+    }
+
+    // Write a status record for a job queued or running in this process
+    void write_live_job(const string &name)
+    {
+        BESStoredResultJob job;
+        job.d_id = name;
+        job.d_state = BESStoredResultJob::running;
+        job.d_pid = getpid();
+        job.d_submitted = time(0);
+        job.write(BESUtil::assemblePath(d_jobs_dir, name + ".status"));
+    }
+
+    void write_result(const string &id, const string &contents)
+    {
+        string result_file = d_cache->get_result_file_name(id);
+        mkdir(result_file.substr(0, result_file.find_last_of('/')).c_str(), 0775);
+
+        ofstream out(result_file.c_str());
+        out << contents;
+    }
+
+    void clean_dir(const string &dir)
+    {
+        string cmd = "rm -rf " + dir;
+        if (system(cmd.c_str()) != 0) cerr << "Could not clean " << dir << endl;
+    }
+
+public:
+    StoredResultJobsTest() :
+        d_data_root_dir(TEST_BUILD_DIR), d_cache(0), d_dmr(0)
+    {
+    }
+
+    ~StoredResultJobsTest()
+    {
+    }
+
+    void setUp()
+    {
+        TheBESKeys::ConfigFile = (string) TEST_SRC_DIR + "/input-files/test.keys"; // empty file
+        TheBESKeys::TheKeys()->set_key(BESStoredResultJobs::MAX_JOBS_KEY, "1");
+        TheBESKeys::TheKeys()->set_key(BESStoredResultJobs::MAX_QUEUED_KEY, "1");
+
+        string cache_dir = BESUtil::assemblePath(d_data_root_dir, c_stored_result_subdir);
+        clean_dir(cache_dir);
+        mkdir(cache_dir.c_str(), 0775);
+
+        d_cache = BESStoredDapResultCache::get_instance(d_data_root_dir, c_stored_result_subdir, "result_", 1000);
+        CPPUNIT_ASSERT(d_cache);
+
+        d_jobs_dir = BESStoredResultJobs::get_jobs_dir(d_cache);
+        mkdir(d_jobs_dir.c_str(), 0775);
+
+        d_dmr = new DMR(&d_factory, "jobs_test");
+        d_dmr->set_filename((string) TEST_SRC_DIR + "/input-files/test_01.dmr");
+    }
+
+    void tearDown()
+    {
+        delete d_dmr;
+        d_dmr = 0;
+
+        clean_dir(BESUtil::assemblePath(d_data_root_dir, c_stored_result_subdir));
+    }
+
+    void read_write_test()
+    {
+        BESStoredResultJob job;
+        job.d_id = "some/result.dap";
+        job.d_state = BESStoredResultJob::failed;
+        job.d_pid = 1234;
+        job.d_submitted = 100;
+        job.d_started = 200;
+        job.d_finished = 300;
+        job.d_bytes = 12345678901ULL;
+        job.d_message = "Could not read:\nthe file";
+
+        string status_file = BESUtil::assemblePath(d_jobs_dir, "rw.status");
+        job.write(status_file);
+
+        BESStoredResultJob read;
+        CPPUNIT_ASSERT(read.read(status_file));
+        DBG(read.dump(cerr));
+
+        CPPUNIT_ASSERT(read.d_id == job.d_id);
+        CPPUNIT_ASSERT(read.d_state == BESStoredResultJob::failed);
+        CPPUNIT_ASSERT(read.d_pid == 1234);
+        CPPUNIT_ASSERT(read.d_submitted == 100);
+        CPPUNIT_ASSERT(read.d_started == 200);
+        CPPUNIT_ASSERT(read.d_finished == 300);
+        CPPUNIT_ASSERT(read.d_bytes == 12345678901ULL);
+        // A message may not span lines
+        CPPUNIT_ASSERT(read.d_message == "Could not read: the file");
+
+        // The temporary file is renamed
+        struct stat sb;
+        ostringstream tmp_name;
+        tmp_name << status_file << ".tmp." << getpid();
+        CPPUNIT_ASSERT(stat(tmp_name.str().c_str(), &sb) != 0);
+
+        BESStoredResultJob missing;
+        CPPUNIT_ASSERT(!missing.read(BESUtil::assemblePath(d_jobs_dir, "missing.status")));
+    }
+
+    // The status records are not in the cache directory, so the cache does
+    // not count or purge them.
+    void status_file_name_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+        string status_file = BESStoredResultJobs::get_status_file_name(d_cache, id);
+        DBG(cerr << "status file: " << status_file << endl);
+
+        CPPUNIT_ASSERT(status_file.find(d_jobs_dir + "/") == 0);
+        CPPUNIT_ASSERT(status_file.find("/", d_jobs_dir.length() + 1) == string::npos);
+        CPPUNIT_ASSERT(status_file.substr(status_file.length() - 7) == ".status");
+    }
+
+    void is_live_test()
+    {
+        BESStoredResultJob job;
+        job.d_state = BESStoredResultJob::running;
+        job.d_pid = getpid();
+        CPPUNIT_ASSERT(BESStoredResultJobs::is_live(job));
+
+        job.d_pid = dead_pid();
+        CPPUNIT_ASSERT(!BESStoredResultJobs::is_live(job));
+
+        // Queued, but the worker has not written its pid yet
+        job.d_state = BESStoredResultJob::queued;
+        job.d_pid = 0;
+        job.d_submitted = time(0);
+        CPPUNIT_ASSERT(BESStoredResultJobs::is_live(job));
+
+        job.d_submitted = time(0) - 3600;
+        CPPUNIT_ASSERT(!BESStoredResultJobs::is_live(job));
+
+        job.d_state = BESStoredResultJob::complete;
+        job.d_pid = getpid();
+        CPPUNIT_ASSERT(!BESStoredResultJobs::is_live(job));
+    }
+
+    void count_active_test()
+    {
+        CPPUNIT_ASSERT(BESStoredResultJobs::count_active(d_jobs_dir) == 0);
+
+        write_live_job("a");
+        write_live_job("b");
+
+        BESStoredResultJob dead;
+        dead.d_state = BESStoredResultJob::running;
+        dead.d_pid = dead_pid();
+        dead.write(BESUtil::assemblePath(d_jobs_dir, "c.status"));
+
+        BESStoredResultJob done;
+        done.d_state = BESStoredResultJob::complete;
+        done.write(BESUtil::assemblePath(d_jobs_dir, "d.status"));
+
+        // Not a status record
+        ofstream other(BESUtil::assemblePath(d_jobs_dir, "slot_0").c_str());
+        other.close();
+
+        CPPUNIT_ASSERT(BESStoredResultJobs::count_active(d_jobs_dir) == 2);
+
+        CPPUNIT_ASSERT(BESStoredResultJobs::count_active(BESUtil::assemblePath(d_jobs_dir, "no_such_dir")) == 0);
+    }
+
+    // With maxJobs and maxQueuedJobs both one, two live jobs fill the queue
+    void queue_full_test()
+    {
+        write_live_job("a");
+        write_live_job("b");
+
+        string id;
+        CPPUNIT_ASSERT(!BESStoredResultJobs::submit_dap4_job(d_cache, *d_dmr, "", 0, id));
+        DBG(cerr << "rejected id: " << id << endl);
+        CPPUNIT_ASSERT(!id.empty());
+
+        // No record is written for the rejected job
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(!job.read(BESStoredResultJobs::get_status_file_name(d_cache, id)));
+    }
+
+    // A job for the same result that is already live is not queued again,
+    // even when the queue is full
+    void already_queued_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+
+        BESStoredResultJob job;
+        job.d_id = id;
+        job.d_state = BESStoredResultJob::running;
+        job.d_pid = getpid();
+        job.write(BESStoredResultJobs::get_status_file_name(d_cache, id));
+        write_live_job("b");
+
+        string submitted_id;
+        CPPUNIT_ASSERT(BESStoredResultJobs::submit_dap4_job(d_cache, *d_dmr, "", 0, submitted_id));
+        CPPUNIT_ASSERT(submitted_id == id);
+    }
+
+    void get_job_missing_test()
+    {
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(!BESStoredResultJobs::get_job(d_cache, d_cache->get_dap4_result_id(*d_dmr, ""), job));
+
+        CPPUNIT_ASSERT_THROW(BESStoredResultJobs::get_job(d_cache, "../result_x.dap", job), BESForbiddenError);
+    }
+
+    // A result stored without a job has no record and is complete
+    void get_job_no_record_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+        write_result(id, "12345");
+
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(BESStoredResultJobs::get_job(d_cache, id, job));
+        CPPUNIT_ASSERT(job.d_state == BESStoredResultJob::complete);
+        CPPUNIT_ASSERT(job.d_bytes == 5);
+    }
+
+    // A running job whose worker has exited has failed
+    void get_job_stale_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+
+        BESStoredResultJob stale;
+        stale.d_id = id;
+        stale.d_state = BESStoredResultJob::running;
+        stale.d_pid = dead_pid();
+        stale.write(BESStoredResultJobs::get_status_file_name(d_cache, id));
+
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(BESStoredResultJobs::get_job(d_cache, id, job));
+        DBG(job.dump(cerr));
+        CPPUNIT_ASSERT(job.d_state == BESStoredResultJob::failed);
+        CPPUNIT_ASSERT(!job.d_message.empty());
+    }
+
+    void get_job_running_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+
+        BESStoredResultJob running;
+        running.d_id = id;
+        running.d_state = BESStoredResultJob::running;
+        running.d_pid = getpid();
+        running.write(BESStoredResultJobs::get_status_file_name(d_cache, id));
+        write_result(id, "123");
+
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(BESStoredResultJobs::get_job(d_cache, id, job));
+        CPPUNIT_ASSERT(job.d_state == BESStoredResultJob::running);
+        CPPUNIT_ASSERT(job.d_bytes == 3);   // written so far
+    }
+
+    void get_job_complete_test()
+    {
+        string id = d_cache->get_dap4_result_id(*d_dmr, "");
+
+        BESStoredResultJob complete;
+        complete.d_id = id;
+        complete.d_state = BESStoredResultJob::complete;
+        complete.d_bytes = 5;
+        complete.write(BESStoredResultJobs::get_status_file_name(d_cache, id));
+        write_result(id, "12345");
+
+        BESStoredResultJob job;
+        CPPUNIT_ASSERT(BESStoredResultJobs::get_job(d_cache, id, job));
+        CPPUNIT_ASSERT(job.d_state == BESStoredResultJob::complete);
+        CPPUNIT_ASSERT(job.d_bytes == 5);
+
+        // Once the result is purged from the cache, it is gone
+        unlink(d_cache->get_result_file_name(id).c_str());
+        BESStoredResultJob purged;
+        CPPUNIT_ASSERT(!BESStoredResultJobs::get_job(d_cache, id, purged));
+    }
+
+    CPPUNIT_TEST_SUITE( StoredResultJobsTest );
+
+    CPPUNIT_TEST(read_write_test);
+    CPPUNIT_TEST(status_file_name_test);
+    CPPUNIT_TEST(is_live_test);
+    CPPUNIT_TEST(count_active_test);
+    CPPUNIT_TEST(queue_full_test);
+    CPPUNIT_TEST(already_queued_test);
+    CPPUNIT_TEST(get_job_missing_test);
+    CPPUNIT_TEST(get_job_no_record_test);
+    CPPUNIT_TEST(get_job_stale_test);
+    CPPUNIT_TEST(get_job_running_test);
+    CPPUNIT_TEST(get_job_complete_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StoredResultJobsTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,dap,cache");
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: StoredResultJobsTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = StoredResultJobsTest::suite()->getTests();
+            unsigned int prefix_len = StoredResultJobsTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = StoredResultJobsTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -2,14 +2,20 @@
 #ifndef DAP_UNIT_TESTS_TESTFUNCTION_H_
 #define DAP_UNIT_TESTS_TESTFUNCTION_H_
 
+#include <cstdlib>
+
 #include <Array.h>
 #include <Byte.h>
+#include <Int32.h>
+#include <Str.h>
 #include <ServerFunctionsList.h>
 
 #include <DAS.h>
 #include <DDS.h>
 #include <util.h>
 
+#include "CachedSequence.h"
+
 //#define KEY "response_cache"
 
 class TestFunction: public libdap::ServerFunction
@@ -84,4 +90,67 @@ const libdap::Type TestFunction::requested_type = libdap::dods_byte_c;
 const int TestFunction::num_dim = 2;
 const int TestFunction::dim_sz = 3;
 
+/**
+ * A server function that returns a Sequence of scalars, so the
+ * CachedSequence code that reads rows from the cache file can be tested.
+ * seq(name, rows) returns 'rows' rows of an Int32 'i' (0, 1, ...) and a
+ * Str 's' ("" for row zero, "row <i>" for the others). Both arguments are
+ * strings, e.g., seq("s","5").
+ */
+class TestSequenceFunction: public libdap::ServerFunction
+{
+private:
+    static void function_dap2_seq(int argc, libdap::BaseType *argv[], libdap::DDS &, libdap::BaseType **btpp)
+    {
+        if (argc != 2) {
+            throw libdap::Error(malformed_expr, "seq(name, rows) requires two arguments.");
+        }
+
+        std::string name = libdap::extract_string_argument(argv[0]);
+        int rows = atoi(libdap::extract_string_argument(argv[1]).c_str());
+
+        CachedSequence *dest = new CachedSequence(name);
+        dest->add_var_nocopy(new libdap::Int32("i"));
+        dest->add_var_nocopy(new libdap::Str("s"));
+
+        libdap::SequenceValues values;
+        for (int i = 0; i < rows; ++i) {
+            libdap::BaseTypeRow *row = new libdap::BaseTypeRow;
+
+            libdap::Int32 *i_var = new libdap::Int32("i");
+            i_var->set_value(i);
+            row->push_back(i_var);
+
+            libdap::Str *s_var = new libdap::Str("s");
+            s_var->set_value(i == 0 ? "" : "row " + libdap::long_to_string(i));
+            row->push_back(s_var);
+
+            values.push_back(row);
+        }
+
+        dest->set_value(values);
+
+        dest->set_send_p(true);
+        dest->set_read_p(true);
+
+        *btpp = dest;
+    }
+
+public:
+    TestSequenceFunction()
+    {
+        setName("seq");
+        setDescriptionString("The seq() function returns a new Sequence.");
+        setUsageString("seq(name, rows)");
+        setRole("http://services.opendap.org/dap4/server-side-function/");
+        setDocUrl("http://docs.opendap.org/index.php/Server_Side_Processing_Functions");
+        setFunction(TestSequenceFunction::function_dap2_seq);
+        setVersion("1.0");
+    }
+
+    virtual ~TestSequenceFunction()
+    {
+    }
+};
+
 #endif /* DAP_UNIT_TESTS_TESTFUNCTION_H_ */
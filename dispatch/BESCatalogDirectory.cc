@@ -47,6 +47,7 @@
 
 #include "BESUtil.h"
 #include "BESCatalogDirectory.h"
+#include "BESCatalogIndex.h"
 #include "BESCatalogUtils.h"
 #include "BESCatalogEntry.h"
 
@@ -83,15 +84,17 @@ using namespace std;
  * @see BESCatalogUtils
  */
 BESCatalogDirectory::BESCatalogDirectory(const string &name) :
-    BESCatalog(name)
+    BESCatalog(name), d_index(0)
 {
 #if 0
     get_catalog_utils() = BESCatalogUtils::Utils(name);
 #endif
+    d_index = BESCatalogIndex::make_index(this);
 }
 
 BESCatalogDirectory::~BESCatalogDirectory()
 {
+    delete d_index;
 }
 
 /**
@@ -376,6 +379,9 @@ CatalogItem *BESCatalogDirectory::make_item(string path_prefix, string item) con
  * the CatalogNode returned _is_ a leaf. See the CatalogNode class and note that
  * it has dual nature - it can be a node in a hierarchy _or_ it can be a leaf.
  *
+ * @note If the catalog has an index (see BESCatalogIndex), the node is
+ * read from the index when it can be.
+ *
  * @param path The pathname for the node; must start with a slash (/)
  * @return A CatalogNode instance or null if there is no such path in the
  * current catalog.
@@ -386,6 +392,30 @@ CatalogItem *BESCatalogDirectory::make_item(string path_prefix, string item) con
  */
 CatalogNode *
 BESCatalogDirectory::get_node(const string &path) const
+{
+    if (path[0] != '/')
+        throw BESInternalError("The path sent to BESCatalogDirectory::get_node() must start with a slash (/)", __FILE__, __LINE__);
+
+    if (d_index) {
+        CatalogNode *node = d_index->get_node(path);
+        if (node) return node;
+    }
+
+    return scan_node(path);
+}
+
+/**
+ * @brief Get a CatalogNode for the given path by reading the file system
+ *
+ * This is get_node() without the catalog index; it is also used to build
+ * the index.
+ *
+ * @param path The pathname for the node; must start with a slash (/)
+ * @return A CatalogNode instance
+ * @see get_node()
+ */
+CatalogNode *
+BESCatalogDirectory::scan_node(const string &path) const
 {
     if (path[0] != '/')
         throw BESInternalError("The path sent to BESCatalogDirectory::get_node() must start with a slash (/)", __FILE__, __LINE__);
@@ -670,6 +700,7 @@ void BESCatalogDirectory::dump(ostream &strm) const
     BESIndent::Indent();
     get_catalog_utils()->dump(strm);
     BESIndent::UnIndent();
+    if (d_index) d_index->dump(strm);
     BESIndent::UnIndent();
 }
 
@@ -41,6 +41,7 @@
 #include "CatalogItem.h"
 
 class BESCatalogEntry;
+class BESCatalogIndex;
 
 namespace bes {
     class CatalogNode;
@@ -51,6 +52,8 @@ namespace bes {
  */
 class BESCatalogDirectory: public BESCatalog {
 private:
+    BESCatalogIndex *d_index;
+
     bes::CatalogItem *make_item(std::string item, std::string fullpath) const;
     bes::CatalogItem *make_item(std::string item) const;
 
@@ -64,6 +67,7 @@ public:
     virtual std::string get_root() const;
 
     virtual bes::CatalogNode *get_node(const std::string &path) const;
+    bes::CatalogNode *scan_node(const std::string &path) const;
 
     virtual void get_site_map(const std::string &prefix, const std::string &node_suffix, const std::string &leaf_suffix, std::ostream &out,
         const std::string &path = "/") const;
@@ -0,0 +1,602 @@
+// BESCatalogIndex.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <algorithm>
+
+#include "BESCatalogIndex.h"
+#include "BESCatalogDirectory.h"
+#include "BESCatalogUtils.h"
+#include "CatalogNode.h"
+#include "CatalogItem.h"
+
+#include "TheBESKeys.h"
+#include "BESUtil.h"
+#include "BESInternalError.h"
+#include "BESIndent.h"
+#include "BESLog.h"
+#include "BESDebug.h"
+
+using namespace bes;
+using namespace std;
+
+#define MODULE "bes"
+#define PROLOG "BESCatalogIndex::" << __func__ << "() - "
+
+// The index file starts with this, the number of directories, the offset of
+// the table of directory record offsets and the time the build started.
+static const char INDEX_MAGIC[8] = { 'B', 'E', 'S', 'C', 'I', 'X', '0', '1' };
+static const size_t HEADER_SIZE = sizeof(INDEX_MAGIC) + 3 * sizeof(uint64_t);
+
+// A directory record is its length (not counting the length itself), the
+// directory's path, mtime and lmt, the number of nodes and leaves and then
+// the items (nodes first). Each item is a name, size, lmt and is_data flag.
+
+static void put_u8(string &buf, uint8_t v)
+{
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static void put_u32(string &buf, uint32_t v)
+{
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static void put_u64(string &buf, uint64_t v)
+{
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static void put_str(string &buf, const string &s)
+{
+    put_u32(buf, s.length());
+    buf.append(s);
+}
+
+/**
+ * Read the values in a directory record, making sure they do not run past
+ * the end of the record.
+ */
+class record_reader {
+private:
+    const char *d_pos;
+    const char *d_end;
+
+    void check(size_t n) const
+    {
+        if ((size_t) (d_end - d_pos) < n)
+            throw BESInternalError("The catalog index is corrupt.", __FILE__, __LINE__);
+    }
+
+    template<typename T> T get()
+    {
+        check(sizeof(T));
+        T v;
+        memcpy(&v, d_pos, sizeof(T));
+        d_pos += sizeof(T);
+        return v;
+    }
+
+public:
+    /// Read the record at 'record'; 'end' is the end of the mapped index
+    record_reader(const char *record, const char *end) : d_pos(record), d_end(end)
+    {
+        uint64_t length = get<uint64_t>();
+        check(length);
+        d_end = d_pos + length;
+    }
+
+    uint8_t get_u8() { return get<uint8_t>(); }
+    uint32_t get_u32() { return get<uint32_t>(); }
+    uint64_t get_u64() { return get<uint64_t>(); }
+
+    string get_str()
+    {
+        uint32_t length = get_u32();
+        check(length);
+        string s(d_pos, length);
+        d_pos += length;
+        return s;
+    }
+
+    /// Get a string without copying it
+    void get_str(const char *&s, uint32_t &length)
+    {
+        length = get_u32();
+        check(length);
+        s = d_pos;
+        d_pos += length;
+    }
+};
+
+/**
+ * The values at the start of a directory record
+ */
+struct record_header {
+    string path;
+    time_t mtime;
+    string lmt;
+    uint32_t nodes;
+    uint32_t leaves;
+
+    record_header(record_reader &r)
+    {
+        path = r.get_str();
+        mtime = r.get_u64();
+        lmt = r.get_str();
+        nodes = r.get_u32();
+        leaves = r.get_u32();
+    }
+};
+
+/**
+ * Encode the directory record for a CatalogNode.
+ */
+static void encode_record(const string &path, time_t mtime, CatalogNode *node, string &record)
+{
+    string body;
+    put_str(body, path);
+    put_u64(body, mtime);
+    put_str(body, node->get_lmt());
+    put_u32(body, node->get_node_count());
+    put_u32(body, node->get_leaf_count());
+
+    for (CatalogNode::item_citer i = node->nodes_begin(), e = node->nodes_end(); i != e; ++i) {
+        put_str(body, (*i)->get_name());
+        put_u64(body, (*i)->get_size());
+        put_str(body, (*i)->get_lmt());
+        put_u8(body, (*i)->is_data());
+    }
+
+    for (CatalogNode::item_citer i = node->leaves_begin(), e = node->leaves_end(); i != e; ++i) {
+        put_str(body, (*i)->get_name());
+        put_u64(body, (*i)->get_size());
+        put_str(body, (*i)->get_lmt());
+        put_u8(body, (*i)->is_data());
+    }
+
+    record.clear();
+    put_u64(record, body.length());
+    record.append(body);
+}
+
+/// @return The path with any trailing slashes removed; "/" for the top node
+static string canonical_path(const string &path)
+{
+    string::size_type last = path.find_last_not_of('/');
+    if (last == string::npos) return "/";
+    return path.substr(0, last + 1);
+}
+
+/**
+ * @brief Make a catalog index
+ *
+ * @param catalog The catalog to index
+ * @param index_file The pathname of the index
+ * @param refresh The number of seconds between rebuilds of the index; if
+ * zero or less the index is only built when it does not exist.
+ */
+BESCatalogIndex::BESCatalogIndex(const BESCatalogDirectory *catalog, const string &index_file, long refresh) :
+    d_catalog(catalog), d_index_file(index_file), d_refresh(refresh), d_last_rebuild(0), d_map(0), d_map_size(0),
+    d_map_ino(0), d_map_mtime(0), d_dir_count(0), d_table(0)
+{
+}
+
+BESCatalogIndex::~BESCatalogIndex()
+{
+    close_index();
+}
+
+/**
+ * @brief Make the index for a catalog, if it is configured
+ *
+ * @param catalog The catalog
+ * @return The index or null if BES.Catalog.<name>.Index is not set
+ */
+BESCatalogIndex *BESCatalogIndex::make_index(const BESCatalogDirectory *catalog)
+{
+    string key = "BES.Catalog." + catalog->get_catalog_name() + ".Index";
+    bool found = false;
+    string index_file;
+    TheBESKeys::TheKeys()->get_value(key, index_file, found);
+    if (!found || index_file.empty()) return 0;
+
+    key = "BES.Catalog." + catalog->get_catalog_name() + ".IndexRefresh";
+    long refresh = TheBESKeys::TheKeys()->read_int_key(key, 600);
+
+    BESDEBUG(MODULE, PROLOG << "Catalog '" << catalog->get_catalog_name() << "' index: " << index_file << endl);
+
+    return new BESCatalogIndex(catalog, index_file, refresh);
+}
+
+void BESCatalogIndex::close_index()
+{
+    if (d_map) munmap(d_map, d_map_size);
+
+    d_map = 0;
+    d_map_size = 0;
+    d_dir_count = 0;
+    d_table = 0;
+}
+
+/**
+ * @brief Map the index file, if it has changed since it was last mapped
+ *
+ * @return True if the index is mapped.
+ */
+bool BESCatalogIndex::open_index()
+{
+    struct stat sb;
+    if (stat(d_index_file.c_str(), &sb) != 0) {
+        close_index();
+        return false;
+    }
+
+    if (d_map && sb.st_ino == d_map_ino && sb.st_mtime == d_map_mtime) return true;
+
+    close_index();
+
+    int fd = open(d_index_file.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+
+    void *map = 0;
+    if (sb.st_size >= (off_t) HEADER_SIZE) map = mmap(0, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (!map || map == MAP_FAILED) return false;
+
+    d_map = static_cast<char *>(map);
+    d_map_size = sb.st_size;
+    d_map_ino = sb.st_ino;
+    d_map_mtime = sb.st_mtime;
+
+    uint64_t dir_count, table_offset;
+    memcpy(&dir_count, d_map + sizeof(INDEX_MAGIC), sizeof(uint64_t));
+    memcpy(&table_offset, d_map + sizeof(INDEX_MAGIC) + sizeof(uint64_t), sizeof(uint64_t));
+
+    if (memcmp(d_map, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || table_offset > d_map_size
+        || (d_map_size - table_offset) / sizeof(uint64_t) != dir_count) {
+        LOG("The catalog index '" << d_index_file << "' is corrupt; it will not be used." << endl);
+        close_index();
+        return false;
+    }
+
+    d_dir_count = dir_count;
+    d_table = d_map + table_offset;
+
+    BESDEBUG(MODULE, PROLOG << "Mapped " << d_index_file << ", " << d_dir_count << " directories." << endl);
+    return true;
+}
+
+/**
+ * @brief Find the record for a directory using a binary search
+ *
+ * @param path The directory, in the form returned by canonical_path()
+ * @return The record or null if the directory is not in the index
+ */
+const char *BESCatalogIndex::find_record(const string &path) const
+{
+    const char *end = d_map + d_map_size;
+    unsigned long long low = 0, high = d_dir_count;
+    while (low < high) {
+        unsigned long long mid = low + (high - low) / 2;
+        uint64_t offset;
+        memcpy(&offset, d_table + mid * sizeof(uint64_t), sizeof(uint64_t));
+        if (offset >= d_map_size) throw BESInternalError("The catalog index is corrupt.", __FILE__, __LINE__);
+
+        record_reader r(d_map + offset, end);
+        const char *s;
+        uint32_t length;
+        r.get_str(s, length);
+
+        int cmp = path.compare(0, string::npos, s, length);
+        if (cmp == 0)
+            return d_map + offset;
+        else if (cmp < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Get a CatalogNode from the index
+ *
+ * If the index does not exist, or is older than the refresh interval, this
+ * starts a rebuild in the background.
+ *
+ * @param path The path of a node or leaf in the catalog; starts with a slash
+ * @return The CatalogNode or null if the index does not hold the path.
+ */
+CatalogNode *BESCatalogIndex::get_node(const string &path)
+{
+    bool mapped = open_index();
+    if (!mapped || (d_refresh > 0 && time(0) - d_map_mtime > d_refresh)) rebuild_in_background();
+    if (!mapped) return 0;
+
+    const char *end = d_map + d_map_size;
+    string dir_path = canonical_path(path);
+
+    const char *record = find_record(dir_path);
+    if (record) {
+        record_reader r(record, end);
+        record_header h(r);
+
+        auto_ptr<CatalogNode> node(new CatalogNode(path));
+        node->set_catalog_name(d_catalog->get_catalog_name());
+        node->set_lmt(h.lmt);
+
+        for (uint32_t i = 0; i < h.nodes + h.leaves; ++i) {
+            string name = r.get_str();
+            uint64_t size = r.get_u64();
+            string lmt = r.get_str();
+            bool is_data = r.get_u8();
+            if (i < h.nodes)
+                node->add_node(new CatalogItem(name, size, lmt, CatalogItem::node));
+            else
+                node->add_leaf(new CatalogItem(name, size, lmt, is_data, CatalogItem::leaf));
+        }
+
+        BESDEBUG(MODULE, PROLOG << "Found " << dir_path << " in the index." << endl);
+        return node.release();
+    }
+
+    // Is it a leaf? Look in its directory.
+    string::size_type slash = dir_path.rfind('/');
+    if (slash == string::npos || slash == dir_path.length() - 1) return 0;
+
+    record = find_record(slash == 0 ? "/" : dir_path.substr(0, slash));
+    if (!record) return 0;
+
+    string leaf_name = dir_path.substr(slash + 1);
+    record_reader r(record, end);
+    record_header h(r);
+    for (uint32_t i = 0; i < h.nodes + h.leaves; ++i) {
+        string name = r.get_str();
+        uint64_t size = r.get_u64();
+        string lmt = r.get_str();
+        bool is_data = r.get_u8();
+        if (i >= h.nodes && name == leaf_name) {
+            CatalogNode *node = new CatalogNode(path);
+            node->set_leaf(new CatalogItem(path, size, lmt, is_data, CatalogItem::leaf));
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write a new index file
+ *
+ * Walk the catalog's directories and write a new index to a temporary file
+ * that then replaces the index. Directories that have not been modified
+ * since the current index was built are copied from it.
+ */
+void BESCatalogIndex::write_index()
+{
+    const char *old_end = d_map + d_map_size;
+    time_t old_build_time = 0;
+    if (d_map) {
+        uint64_t t;
+        memcpy(&t, d_map + sizeof(INDEX_MAGIC) + 2 * sizeof(uint64_t), sizeof(uint64_t));
+        old_build_time = t;
+    }
+
+    time_t build_time = time(0);
+    string root = d_catalog->get_catalog_utils()->get_root_dir();
+
+    vector<char> tmp_name(d_index_file.begin(), d_index_file.end());
+    const string suffix = "_XXXXXX";
+    tmp_name.insert(tmp_name.end(), suffix.begin(), suffix.end());
+    tmp_name.push_back('\0');
+    int fd = mkstemp(&tmp_name[0]);
+    if (fd == -1)
+        throw BESInternalError("Could not make a temporary file for the catalog index: " + string(strerror(errno)),
+            __FILE__, __LINE__);
+
+    FILE *fp = fdopen(fd, "w");
+    try {
+        if (!fp) throw BESInternalError("Could not open the catalog index: " + string(strerror(errno)), __FILE__, __LINE__);
+        fd = -1;    // closed by fclose()
+
+        string buf(HEADER_SIZE, '\0');
+        fwrite(buf.data(), 1, buf.length(), fp);
+        uint64_t offset = HEADER_SIZE;
+
+        vector<pair<string, uint64_t> > table;
+        set<pair<dev_t, ino_t> > visited;       // symbolic links can make loops
+        unsigned long reused = 0;
+
+        vector<string> paths(1, "/");
+        while (!paths.empty()) {
+            string path = paths.back();
+            paths.pop_back();
+
+            struct stat sb;
+            string fullpath = BESUtil::assemblePath(root, path);
+            if (stat(fullpath.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) continue;
+            if (!visited.insert(make_pair(sb.st_dev, sb.st_ino)).second) continue;
+
+            string record;
+            vector<string> children;
+
+            // A directory not modified since before the old index was built is copied.
+            const char *old_record = d_map ? find_record(path) : 0;
+            if (old_record) {
+                record_reader r(old_record, old_end);
+                record_header h(r);
+                if (h.mtime == sb.st_mtime && sb.st_mtime < old_build_time) {
+                    for (uint32_t i = 0; i < h.nodes; ++i) {
+                        children.push_back(r.get_str());
+                        r.get_u64();
+                        r.get_str();
+                        r.get_u8();
+                    }
+                    uint64_t length;
+                    memcpy(&length, old_record, sizeof(uint64_t));
+                    record.assign(old_record, sizeof(uint64_t) + length);
+                    ++reused;
+                }
+            }
+
+            if (record.empty()) {
+                try {
+                    auto_ptr<CatalogNode> node(d_catalog->scan_node(path));
+                    encode_record(path, sb.st_mtime, node.get(), record);
+                    for (CatalogNode::item_citer i = node->nodes_begin(), e = node->nodes_end(); i != e; ++i)
+                        children.push_back((*i)->get_name());
+                }
+                catch (BESError &e) {
+                    // Excluded or unreadable; get_node() will report it.
+                    BESDEBUG(MODULE, PROLOG << "Skipping " << path << ": " << e.get_message() << endl);
+                    continue;
+                }
+            }
+
+            if (fwrite(record.data(), 1, record.length(), fp) != record.length())
+                throw BESInternalError("Could not write the catalog index: " + string(strerror(errno)), __FILE__,
+                    __LINE__);
+            table.push_back(make_pair(path, offset));
+            offset += record.length();
+
+            // Visit the children in order
+            for (vector<string>::reverse_iterator i = children.rbegin(), e = children.rend(); i != e; ++i)
+                paths.push_back(path == "/" ? "/" + *i : path + "/" + *i);
+        }
+
+        sort(table.begin(), table.end());
+        buf.clear();
+        for (vector<pair<string, uint64_t> >::iterator i = table.begin(), e = table.end(); i != e; ++i)
+            put_u64(buf, i->second);
+
+        string header(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        put_u64(header, table.size());
+        put_u64(header, offset);
+        put_u64(header, build_time);
+
+        if (fwrite(buf.data(), 1, buf.length(), fp) != buf.length() || fseek(fp, 0, SEEK_SET) != 0
+            || fwrite(header.data(), 1, header.length(), fp) != header.length() || fclose(fp) != 0) {
+            fp = 0;
+            throw BESInternalError("Could not write the catalog index: " + string(strerror(errno)), __FILE__, __LINE__);
+        }
+        fp = 0;
+
+        if (rename(&tmp_name[0], d_index_file.c_str()) != 0)
+            throw BESInternalError("Could not replace the catalog index: " + string(strerror(errno)), __FILE__,
+                __LINE__);
+
+        BESDEBUG(MODULE, PROLOG << "Wrote " << d_index_file << ", " << table.size() << " directories (" << reused
+            << " unchanged)." << endl);
+    }
+    catch (...) {
+        if (fp) fclose(fp);
+        if (fd != -1) close(fd);
+        unlink(&tmp_name[0]);
+        throw;
+    }
+}
+
+/**
+ * @brief Build, or rebuild, the index
+ *
+ * This reads every directory that has changed since the index was last
+ * built and replaces the index file. It does not lock the index; see
+ * rebuild_in_background().
+ */
+void BESCatalogIndex::build()
+{
+    open_index();
+    write_index();
+    open_index();
+}
+
+/**
+ * Rebuild the index in a background process (see
+ * BESUtil::fork_background_process()). An exclusive lock on '<index>.lock'
+ * keeps more than one process from doing the rebuild. Each BES process
+ * starts at most one rebuild per refresh interval.
+ */
+void BESCatalogIndex::rebuild_in_background()
+{
+    time_t now = time(0);
+    if (d_last_rebuild && now - d_last_rebuild < (d_refresh > 0 ? d_refresh : 60)) return;
+    d_last_rebuild = now;
+
+    if (BESUtil::fork_background_process() == 0) {
+        try {
+            int fd = open((d_index_file + ".lock").c_str(), O_RDWR | O_CREAT, 0666);
+            struct flock lock;
+            lock.l_type = F_WRLCK;
+            lock.l_whence = SEEK_SET;
+            lock.l_start = 0;
+            lock.l_len = 0;
+            if (fd != -1 && fcntl(fd, F_SETLK, &lock) != -1) {
+                // Another process may have just finished a rebuild
+                struct stat sb;
+                if (stat(d_index_file.c_str(), &sb) != 0
+                    || (d_refresh > 0 && time(0) - sb.st_mtime > d_refresh)) build();
+            }
+        }
+        catch (BESError &e) {
+            LOG("Could not build the catalog index '" << d_index_file << "': " << e.get_message() << endl);
+        }
+        catch (...) {
+            // The index will be rebuilt by a later request.
+        }
+        _exit(0);
+    }
+}
+
+/** @brief dumps information about this object
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void BESCatalogIndex::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "BESCatalogIndex::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    strm << BESIndent::LMarg << "index file: " << d_index_file << endl;
+    strm << BESIndent::LMarg << "refresh: " << d_refresh << endl;
+    strm << BESIndent::LMarg << "directories: " << d_dir_count << endl;
+    BESIndent::UnIndent();
+}
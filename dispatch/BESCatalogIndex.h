@@ -0,0 +1,107 @@
+// BESCatalogIndex.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_BESCatalogIndex_h
+#define I_BESCatalogIndex_h 1
+
+#include <sys/types.h>
+
+#include <string>
+#include <ostream>
+
+#include "BESObj.h"
+
+class BESCatalogDirectory;
+
+namespace bes {
+    class CatalogNode;
+}
+
+/**
+ * @brief A persistent index of the nodes in a BESCatalogDirectory
+ *
+ * The index holds the CatalogNode for every directory in the catalog, after
+ * the catalog's Include, Exclude and TypeMatch regular expressions have
+ * been applied. It is a single file, sorted by path, that each BES process
+ * maps into memory; a node is found with a binary search and built without
+ * touching the catalog's directories.
+ *
+ * The index is made (and remade) by a background process. Each rebuild is
+ * incremental: a directory whose modification time has not changed since
+ * the last build is copied from the old index without being read again.
+ * Because of this, a file that is changed in place (rather than replaced)
+ * shows its old size and time until its directory is modified.
+ *
+ * Configure the index using:
+ *
+ * BES.Catalog.<name>.Index = the pathname of the index file. If this is not
+ * set the catalog is not indexed.
+ * BES.Catalog.<name>.IndexRefresh = the number of seconds between rebuilds
+ * (default 600). If zero or less, the index is only built when it does not
+ * exist.
+ *
+ * Requests that cannot be answered from the index (e.g., for a directory
+ * added since it was built) are passed back to the catalog.
+ */
+class BESCatalogIndex: public BESObj {
+private:
+    const BESCatalogDirectory *d_catalog;
+
+    std::string d_index_file;
+    long d_refresh;                 // seconds between rebuilds
+    time_t d_last_rebuild;          // when this process last started a rebuild
+
+    // The mapped index file
+    char *d_map;
+    size_t d_map_size;
+    ino_t d_map_ino;
+    time_t d_map_mtime;
+    unsigned long long d_dir_count;
+    const char *d_table;            // d_dir_count offsets, sorted by path
+
+    bool open_index();
+    void close_index();
+
+    const char *find_record(const std::string &path) const;
+
+    void write_index();
+    void rebuild_in_background();
+
+    BESCatalogIndex(const BESCatalogIndex &);
+    BESCatalogIndex &operator=(const BESCatalogIndex &);
+
+public:
+    BESCatalogIndex(const BESCatalogDirectory *catalog, const std::string &index_file, long refresh);
+    virtual ~BESCatalogIndex();
+
+    static BESCatalogIndex *make_index(const BESCatalogDirectory *catalog);
+
+    bes::CatalogNode *get_node(const std::string &path);
+
+    void build();
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif // I_BESCatalogIndex_h
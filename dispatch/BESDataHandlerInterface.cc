@@ -105,6 +105,7 @@ void BESDataHandlerInterface::clone(const BESDataHandlerInterface &copy_from)
     	data = copy_from.data;
 
 	error_info = copy_from.error_info;
+	deadline = copy_from.deadline;
 }
 
 BESDataHandlerInterface::BESDataHandlerInterface(const BESDataHandlerInterface &from)
@@ -45,6 +45,7 @@ class BESInfo;
 #include "BESObj.h"
 #include "BESContainer.h"
 #include "BESInternalError.h"
+#include "BESDeadline.h"
 #include "BESResponseHandler.h"
 
 /** @brief Structure storing information used by the BES to handle the request
@@ -93,8 +94,13 @@ public:
      */
     BESInfo *error_info;
 
+    /** @brief the time by which the request must be finished
+     */
+    BESDeadline *deadline;
+
     BESDataHandlerInterface() :
-			output_stream(0), response_handler(0), container(0), executed(false), error_info(0)
+			output_stream(0), response_handler(0), container(0), executed(false), error_info(0),
+			deadline(BESDeadline::TheDeadline())
 	{
 	}
 
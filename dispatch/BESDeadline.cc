@@ -0,0 +1,142 @@
+// BESDeadline.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <sstream>
+
+#include "BESDeadline.h"
+#include "BESTimeoutError.h"
+#include "BESIndent.h"
+
+using namespace std;
+
+static void now(struct timespec &ts)
+{
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+}
+
+/**
+ * @brief Start the deadline
+ *
+ * If there is a backstop, the alarm is set for that many seconds after
+ * the deadline.
+ *
+ * @param seconds The request must finish this many seconds from now. If
+ * zero, there is no deadline.
+ */
+void BESDeadline::start(unsigned int seconds)
+{
+    d_timeout = seconds;
+    d_set = seconds > 0;
+    if (d_set) {
+        now(d_expires);
+        d_expires.tv_sec += seconds;
+    }
+
+    if (d_set && d_backstop > 0) {
+        alarm(seconds + d_backstop);
+        d_alarm = true;
+    }
+    else if (d_alarm) {
+        alarm(0);
+        d_alarm = false;
+    }
+}
+
+/**
+ * @brief Remove the deadline and its alarm
+ */
+void BESDeadline::cancel()
+{
+    d_set = false;
+    d_timeout = 0;
+
+    if (d_alarm) {
+        alarm(0);
+        d_alarm = false;
+    }
+}
+
+/// @return True if there is a deadline and it has passed
+bool BESDeadline::expired() const
+{
+    if (!d_set) return false;
+
+    struct timespec ts;
+    now(ts);
+    return ts.tv_sec > d_expires.tv_sec || (ts.tv_sec == d_expires.tv_sec && ts.tv_nsec >= d_expires.tv_nsec);
+}
+
+/**
+ * @return The number of milliseconds left before the deadline, zero if it
+ * has passed, or -1 if there is no deadline.
+ */
+long BESDeadline::remaining_ms() const
+{
+    if (!d_set) return -1;
+
+    struct timespec ts;
+    now(ts);
+    long ms = (d_expires.tv_sec - ts.tv_sec) * 1000 + (d_expires.tv_nsec - ts.tv_nsec) / 1000000;
+    return ms > 0 ? ms : 0;
+}
+
+/**
+ * @brief Throw BESTimeoutError if the deadline has passed
+ *
+ * @param file The caller's file (__FILE__)
+ * @param line The caller's line (__LINE__)
+ */
+void BESDeadline::check(const string &file, unsigned int line) const
+{
+    if (expired()) {
+        ostringstream oss;
+        oss << "BES listener timeout after " << d_timeout << " seconds.";
+        throw BESTimeoutError(oss.str(), file, line);
+    }
+}
+
+/**
+ * @return The deadline of the request this process is working on
+ */
+BESDeadline *BESDeadline::TheDeadline()
+{
+    static BESDeadline deadline;
+    return &deadline;
+}
+
+void BESDeadline::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "BESDeadline::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    strm << BESIndent::LMarg << "timeout: " << d_timeout << endl;
+    strm << BESIndent::LMarg << "backstop: " << d_backstop << endl;
+    strm << BESIndent::LMarg << "remaining (ms): " << remaining_ms() << endl;
+    BESIndent::UnIndent();
+}
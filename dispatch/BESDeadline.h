@@ -0,0 +1,112 @@
+// BESDeadline.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_BESDeadline_h
+#define I_BESDeadline_h 1
+
+#include <time.h>
+
+#include <string>
+#include <ostream>
+
+#include "BESObj.h"
+
+/**
+ * @brief The time by which the current request must be finished
+ *
+ * BESInterface starts the deadline when it begins to execute a request,
+ * using BES.TimeOutInSeconds or the 'bes_timeout' context, and cancels it
+ * when the request is done (or when transmission starts, if
+ * BES.CancelTimeoutOnSend is true). Nothing interrupts the work when the
+ * deadline passes; instead code that can run for a long time calls check()
+ * as it goes, which throws BESTimeoutError once the deadline has passed,
+ * and code that waits on other servers uses remaining_ms() to limit how
+ * long it waits.
+ *
+ * Code that is stuck (e.g., in a library call that never returns) cannot
+ * check the deadline, so when a backstop is set, start() also sets an
+ * alarm for that many seconds after the deadline. BESInterface catches
+ * SIGALRM and ends the process, as the BES did before it had a deadline.
+ *
+ * The deadline is carried in the BESDataHandlerInterface. Code that does
+ * not have the DHI (e.g., a libdap read() method) can use TheDeadline(),
+ * which is the deadline for the request the process is working on.
+ */
+class BESDeadline: public BESObj {
+private:
+    bool d_set;
+    unsigned int d_timeout;     // seconds
+    struct timespec d_expires;  // CLOCK_MONOTONIC
+
+    unsigned int d_backstop;    // seconds after the deadline; zero means no alarm
+    bool d_alarm;
+
+public:
+    BESDeadline() : d_set(false), d_timeout(0), d_backstop(0), d_alarm(false)
+    {
+        d_expires.tv_sec = 0;
+        d_expires.tv_nsec = 0;
+    }
+    virtual ~BESDeadline()
+    {
+    }
+
+    void start(unsigned int seconds);
+    void cancel();
+
+    /// @return True if there is a deadline
+    bool is_set() const
+    {
+        return d_set;
+    }
+
+    /// @return The timeout, in seconds, used to start the deadline
+    unsigned int get_timeout() const
+    {
+        return d_timeout;
+    }
+
+    /// @return The number of seconds after the deadline that the alarm is set for
+    unsigned int get_backstop() const
+    {
+        return d_backstop;
+    }
+
+    /// @brief Set an alarm this many seconds after each deadline; zero (the default) means none
+    void set_backstop(unsigned int seconds)
+    {
+        d_backstop = seconds;
+    }
+
+    bool expired() const;
+    long remaining_ms() const;
+
+    void check(const std::string &file, unsigned int line) const;
+
+    static BESDeadline *TheDeadline();
+
+    virtual void dump(std::ostream &strm) const;
+};
+
+#endif // I_BESDeadline_h
@@ -0,0 +1,449 @@
+// BESHttpCacheRevalidator.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include "BESHttpCacheRevalidator.h"
+#include "BESFileLockingCache.h"
+#include "BESInternalError.h"
+#include "TheBESKeys.h"
+#include "BESUtil.h"
+#include "BESDebug.h"
+
+using namespace std;
+
+#define CACHE "cache"
+
+#define prolog std::string("BESHttpCacheRevalidator::").append(__func__).append("() - ")
+
+// The headers files and the temporary files used to get new copies of
+// resources are kept in this subdirectory of the cache directory. The cache
+// counts (and purges) the files in its directory whose names start with its
+// prefix, so these must not be kept next to the resources.
+const string BESHttpCacheRevalidator::HEADERS_DIR = ".headers";
+
+/**
+ * @brief Make a revalidator for a cached resource
+ *
+ * @param cache The cache that holds the resource
+ * @param cache_file The name of the (read-locked) cache file
+ * @param url The URL of the resource
+ * @param key_prefix The prefix of the MaxAge and StaleWhileRevalidate keys,
+ * e.g., 'Gateway.Cache'
+ */
+BESHttpCacheRevalidator::BESHttpCacheRevalidator(BESFileLockingCache *cache, const string &cache_file,
+    const string &url, const string &key_prefix) :
+    d_cache(cache), d_cache_file(cache_file), d_url(url)
+{
+    d_max_age = TheBESKeys::TheKeys()->read_int_key(key_prefix + ".MaxAge", -1);
+    d_stale_while_revalidate = TheBESKeys::TheKeys()->read_int_key(key_prefix + ".StaleWhileRevalidate", 0);
+    if (d_stale_while_revalidate < 0) d_stale_while_revalidate = 0;
+}
+
+/**
+ * Get the value of a header from a vector of 'name: value' header lines.
+ *
+ * @param hdrs The headers
+ * @param name The (lower case) header name; matched without regard to case
+ * @return The value, without leading or trailing white space, or the empty
+ * string if the header is not present.
+ */
+string BESHttpCacheRevalidator::get_header(const vector<string> &hdrs, const string &name)
+{
+    for (vector<string>::const_iterator i = hdrs.begin(), e = hdrs.end(); i != e; ++i) {
+        string::size_type colon = i->find(':');
+        if (colon != string::npos && BESUtil::lowercase(i->substr(0, colon)) == name) {
+            string value = i->substr(colon + 1);
+            BESUtil::removeLeadingAndTrailingBlanks(value);
+            return value;
+        }
+    }
+
+    return "";
+}
+
+/**
+ * Replace (or add) the headers in 'hdrs' with those in 'updates'.
+ */
+void BESHttpCacheRevalidator::merge_headers(vector<string> &hdrs, const vector<string> &updates)
+{
+    for (vector<string>::const_iterator u = updates.begin(), ue = updates.end(); u != ue; ++u) {
+        string name = BESUtil::lowercase(u->substr(0, u->find(':')));
+        vector<string>::iterator h = hdrs.begin();
+        while (h != hdrs.end() && BESUtil::lowercase(h->substr(0, h->find(':'))) != name)
+            ++h;
+        if (h != hdrs.end())
+            *h = *u;
+        else
+            hdrs.push_back(*u);
+    }
+}
+
+/**
+ * Get the value of a Cache-Control directive that takes a number of seconds,
+ * e.g., 'max-age=3600'.
+ *
+ * @return The number of seconds or -1 if the directive is not present.
+ */
+long BESHttpCacheRevalidator::cache_control_seconds(const string &cache_control, const string &directive)
+{
+    string cc = BESUtil::lowercase(cache_control);
+    string::size_type pos = cc.find(directive + "=");
+    while (pos != string::npos) {
+        if (pos == 0 || cc[pos - 1] == ' ' || cc[pos - 1] == ',')
+            return atol(cc.c_str() + pos + directive.length() + 1);
+        pos = cc.find(directive + "=", pos + 1);
+    }
+
+    return -1;
+}
+
+/**
+ * @brief The freshness lifetime of a cached resource
+ *
+ * @param hdrs The cached response headers of the resource
+ * @param max_age The configured MaxAge
+ * @return The lifetime in seconds or -1 if the resource never becomes stale,
+ * which is the case when max_age is < 0, regardless of the headers.
+ */
+long BESHttpCacheRevalidator::freshness_lifetime(const vector<string> &hdrs, long max_age)
+{
+    if (max_age < 0) return -1;
+
+    string cache_control = get_header(hdrs, "cache-control");
+    if (BESUtil::lowercase(cache_control).find("no-cache") != string::npos) return 0;
+
+    long origin_max_age = cache_control_seconds(cache_control, "max-age");
+    return origin_max_age < 0 ? max_age : origin_max_age;
+}
+
+/**
+ * @brief Is a cached resource fresh, or must it be revalidated?
+ *
+ * @param hdrs The cached response headers of the resource
+ * @param age The time since the resource was retrieved or last revalidated
+ * @param max_age The configured MaxAge; < 0 means the resource is always fresh
+ * @param max_stale The configured StaleWhileRevalidate, used when the
+ * headers don't have a stale-while-revalidate directive
+ */
+BESHttpCacheRevalidator::freshness BESHttpCacheRevalidator::get_freshness(const vector<string> &hdrs, long age,
+    long max_age, long max_stale)
+{
+    long lifetime = freshness_lifetime(hdrs, max_age);
+    if (lifetime < 0 || age <= lifetime) return fresh;
+
+    long swr = cache_control_seconds(get_header(hdrs, "cache-control"), "stale-while-revalidate");
+    if (swr < 0) swr = max_stale;
+
+    return age <= lifetime + swr ? stale_while_revalidate : stale;
+}
+
+/**
+ * @param cache_file The name of a resource's cache file
+ * @return The name of the file that holds the headers of the cached resource
+ */
+string BESHttpCacheRevalidator::headers_file_name(const string &cache_file)
+{
+    string::size_type slash = cache_file.find_last_of('/');
+    string dir = slash == string::npos ? "." : cache_file.substr(0, slash);
+    string name = slash == string::npos ? cache_file : cache_file.substr(slash + 1);
+
+    return BESUtil::assemblePath(BESUtil::assemblePath(dir, HEADERS_DIR), name + ".hdrs");
+}
+
+/**
+ * Open (and make, if needed) a resource's headers file.
+ *
+ * @return The open file descriptor or -1 on error, with errno set
+ */
+static int open_headers_file(const string &hdrs_file, int flags)
+{
+    string dir = hdrs_file.substr(0, hdrs_file.find_last_of('/'));
+    if (mkdir(dir.c_str(), 0775) != 0 && errno != EEXIST) return -1;
+
+    return open(hdrs_file.c_str(), flags | O_CREAT, 0666);
+}
+
+/**
+ * Read the cached response headers of a resource. Resources cached before
+ * their headers were saved have none.
+ *
+ * @param cache_file The name of the resource's cache file
+ * @param hdrs Value-result parameter; the headers
+ */
+void BESHttpCacheRevalidator::read_headers(const string &cache_file, vector<string> &hdrs)
+{
+    hdrs.clear();
+
+    ifstream hdr_ifs(headers_file_name(cache_file).c_str());
+    for (string line; getline(hdr_ifs, line);)
+        hdrs.push_back(line);
+}
+
+/**
+ * Replace the content of the open headers file with the headers, one per line.
+ * Writing the file, even with unchanged headers, sets its modification time,
+ * which is used as the time the resource was last validated.
+ */
+void BESHttpCacheRevalidator::write_headers(int fd, const vector<string> &hdrs)
+{
+    string content;
+    for (vector<string>::const_iterator i = hdrs.begin(), e = hdrs.end(); i != e; ++i)
+        content.append(*i).append("\n");
+
+    if (pwrite(fd, content.data(), content.size(), 0) != (ssize_t) content.size()
+        || ftruncate(fd, content.size()) != 0)
+        throw BESInternalError(string("Could not write the cached response headers: ") + strerror(errno), __FILE__,
+            __LINE__);
+}
+
+/**
+ * Save the response headers of a newly cached resource.
+ *
+ * @param cache_file The name of the resource's cache file
+ * @param hdrs The headers
+ */
+void BESHttpCacheRevalidator::save_headers(const string &cache_file, const vector<string> &hdrs)
+{
+    string hdrs_file = headers_file_name(cache_file);
+    int hdr_fd = open_headers_file(hdrs_file, O_WRONLY);
+    if (hdr_fd == -1)
+        throw BESInternalError("Could not open " + hdrs_file + ": " + strerror(errno), __FILE__, __LINE__);
+
+    try {
+        write_headers(hdr_fd, hdrs);
+    }
+    catch (...) {
+        close(hdr_fd);
+        throw;
+    }
+    close(hdr_fd);
+}
+
+/**
+ * The age of a cached resource is the time since it was retrieved or last
+ * revalidated, which is when its headers file was written. For resources
+ * cached without their headers, it's the time the resource was written.
+ *
+ * @return The age, in seconds
+ */
+long BESHttpCacheRevalidator::cached_age() const
+{
+    struct stat buf;
+    if (stat(headers_file_name(d_cache_file).c_str(), &buf) != 0 || buf.st_size == 0) {
+        if (stat(d_cache_file.c_str(), &buf) != 0) return 0;
+    }
+
+    return time(0) - buf.st_mtime;
+}
+
+/**
+ * @brief Check the freshness of the cached resource and revalidate it if it is stale
+ *
+ * If the revalidation fails, the stale copy is used.
+ *
+ * @param fd Value-result parameter; the open, read-locked, cache file. If a
+ * new copy of the resource replaces the old one, this is the new copy.
+ * @param hdrs Value-result parameter; the cached response headers
+ */
+void BESHttpCacheRevalidator::revalidate(int &fd, vector<string> &hdrs)
+{
+    if (d_max_age < 0) return;  // Revalidation is off
+
+    long age = cached_age();
+    long max_age = freshness_lifetime(hdrs, d_max_age);
+    freshness state = get_freshness(hdrs, age, d_max_age, d_stale_while_revalidate);
+    BESDEBUG(CACHE, prolog << d_url << " age: " << age << ", max-age: " << max_age << ", state: " << state << endl);
+
+    switch (state) {
+    case fresh:
+        break;
+
+    case stale_while_revalidate:
+        refresh_in_background(fd, hdrs, max_age);
+        break;
+
+    case stale:
+        if (refresh(fd, hdrs, max_age, true)) {
+            // The cache file holds a new copy; read-lock that in place of the old one.
+            d_cache->unlock_and_close(d_cache_file);
+            if (!d_cache->get_read_lock(d_cache_file, fd))
+                throw BESInternalError("Failed to acquire cache read lock for remote resource: '" + d_url + "'",
+                    __FILE__, __LINE__);
+            read_headers(d_cache_file, hdrs);
+        }
+        break;
+    }
+}
+
+/**
+ * Revalidate the cached resource. Only one process revalidates a resource at
+ * a time; the others wait for it (or give up if 'wait' is false) and then
+ * use its result.
+ *
+ * @param fd The open cache file
+ * @param hdrs The cached response headers; updated if the server says the
+ * resource is not modified
+ * @param max_age If the resource was revalidated by another process less
+ * than this many seconds ago, it is not revalidated again.
+ * @param wait If true, wait for another process that is revalidating the
+ * resource. If false, return instead.
+ * @return True if the cache file now holds a new copy of the resource.
+ */
+bool BESHttpCacheRevalidator::refresh(int fd, vector<string> &hdrs, long max_age, bool wait)
+{
+    string hdrs_file = headers_file_name(d_cache_file);
+    int hdr_fd = open_headers_file(hdrs_file, O_RDWR);
+    if (hdr_fd == -1) {
+        BESDEBUG(CACHE, prolog << "Could not open " << hdrs_file << ": " << strerror(errno) << endl);
+        return false;
+    }
+
+    // The lock is released when hdr_fd is closed.
+    struct flock lock;
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    lock.l_pid = getpid();
+    if (fcntl(hdr_fd, wait ? F_SETLKW : F_SETLK, &lock) == -1) {
+        BESDEBUG(CACHE, prolog << d_url << " is being revalidated by another process." << endl);
+        close(hdr_fd);
+        return false;
+    }
+
+    bool replaced = false;
+    struct stat current, ours;
+    if (stat(d_cache_file.c_str(), &current) == 0 && fstat(fd, &ours) == 0
+        && (current.st_ino != ours.st_ino || current.st_dev != ours.st_dev)) {
+        BESDEBUG(CACHE, prolog << d_url << " was replaced by another process." << endl);
+        replaced = true;
+    }
+    else if (cached_age() > max_age) {
+        replaced = conditional_get(hdr_fd, hdrs);
+    }
+
+    close(hdr_fd);
+    return replaced;
+}
+
+/**
+ * Make a conditional GET request for the resource using the ETag and
+ * Last-Modified values from its cached response headers. If the server
+ * responds with 304 (Not Modified) only the cached headers are updated. If it
+ * sends a new copy, that is written to a temporary file which then replaces
+ * the cache file, so processes reading the old copy are not disturbed. Errors
+ * are not fatal; the stale copy is kept.
+ *
+ * @param hdr_fd The open, write-locked, headers file
+ * @param hdrs The cached response headers
+ * @return True if a new copy replaced the cache file.
+ */
+bool BESHttpCacheRevalidator::conditional_get(int hdr_fd, vector<string> &hdrs)
+{
+    vector<string> request_headers;
+    string etag = get_header(hdrs, "etag");
+    if (!etag.empty()) request_headers.push_back("If-None-Match: " + etag);
+    string last_modified = get_header(hdrs, "last-modified");
+    if (!last_modified.empty()) request_headers.push_back("If-Modified-Since: " + last_modified);
+
+    // The new copy is written next to the headers file, out of the cache's
+    // view, and renamed into place.
+    string tmp_template = headers_file_name(d_cache_file);
+    vector<char> tmp_name(tmp_template.begin(), tmp_template.end());
+    const string suffix = "_XXXXXX";
+    tmp_name.insert(tmp_name.end(), suffix.begin(), suffix.end());
+    tmp_name.push_back('\0');
+    int tmp_fd = mkstemp(&tmp_name[0]);
+    if (tmp_fd == -1) {
+        BESDEBUG(CACHE, prolog << "Could not make a temporary file: " << strerror(errno) << endl);
+        return false;
+    }
+
+    bool replaced = false;
+    try {
+        vector<string> resp_hdrs;
+        long status = get(request_headers, tmp_fd, resp_hdrs);
+        BESDEBUG(CACHE, prolog << d_url << " HTTP status: " << status << endl);
+
+        if (status == 304) {
+            merge_headers(hdrs, resp_hdrs);
+            write_headers(hdr_fd, hdrs);
+        }
+        else if (status == 200) {
+            if (rename(&tmp_name[0], d_cache_file.c_str()) != 0)
+                throw BESInternalError(string("Could not replace the cached resource: ") + strerror(errno), __FILE__,
+                    __LINE__);
+            replaced = true;
+
+            write_headers(hdr_fd, resp_hdrs);
+
+            unsigned long long size = d_cache->update_cache_info(d_cache_file);
+            if (d_cache->cache_too_big(size)) d_cache->update_and_purge(d_cache_file);
+        }
+    }
+    catch (BESError &e) {
+        BESDEBUG(CACHE, prolog << "Using the stale copy of " << d_url << ": " << e.get_message() << endl);
+    }
+
+    close(tmp_fd);
+    if (!replaced) unlink(&tmp_name[0]);
+
+    return replaced;
+}
+
+/**
+ * Revalidate the resource in a background process (see
+ * BESUtil::fork_background_process()) so that the stale copy can be used now.
+ *
+ * @param fd The open cache file
+ * @param hdrs The cached response headers
+ * @param max_age Passed to refresh()
+ */
+void BESHttpCacheRevalidator::refresh_in_background(int fd, vector<string> &hdrs, long max_age)
+{
+    if (BESUtil::fork_background_process() == 0) {
+        try {
+            // Don't share this process' connections with its parent.
+            reset_connection();
+            refresh(fd, hdrs, max_age, false);
+        }
+        catch (BESError &e) {
+            // The resource will be revalidated by a later request.
+            BESDEBUG(CACHE, prolog << "Could not revalidate " << d_url << ": " << e.get_message() << endl);
+        }
+        _exit(0);
+    }
+}
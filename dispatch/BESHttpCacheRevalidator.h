@@ -0,0 +1,127 @@
+// BESHttpCacheRevalidator.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_BESHttpCacheRevalidator_h
+#define I_BESHttpCacheRevalidator_h 1
+
+#include <string>
+#include <vector>
+
+class BESFileLockingCache;
+
+/**
+ * @brief Revalidate the cached copies of remote (HTTP) resources
+ *
+ * The modules that cache remote resources (gateway, cmr, httpd_catalog)
+ * save the response headers of each resource in headers_file_name(), in the
+ * HEADERS_DIR subdirectory of the cache directory. The modification time of
+ * that file is the time the resource was last retrieved or revalidated.
+ *
+ * Revalidation is off unless the module's '<prefix>.MaxAge' key is set to
+ * zero or more. When it is set, a cached resource becomes stale once it is
+ * older than its freshness lifetime: the max-age of its Cache-Control
+ * header (no-cache means zero) or, if there is none, MaxAge. A stale
+ * resource is revalidated using a conditional GET (If-None-Match and
+ * If-Modified-Since) and replaced only if the server sends a new copy. For
+ * '<prefix>.StaleWhileRevalidate' seconds (or the stale-while-revalidate of
+ * its Cache-Control header) after it becomes stale, the stale copy is used
+ * and the revalidation is done by a background process.
+ *
+ * Each module specializes this class to make the HTTP request with its own
+ * curl code.
+ */
+class BESHttpCacheRevalidator {
+public:
+    enum freshness {
+        fresh,                  ///< Use the cached copy
+        stale_while_revalidate, ///< Use the cached copy and revalidate it in the background
+        stale                   ///< Revalidate the cached copy before it is used
+    };
+
+private:
+    BESFileLockingCache *d_cache;
+    std::string d_cache_file;
+    std::string d_url;
+
+    long d_max_age;
+    long d_stale_while_revalidate;
+
+    long cached_age() const;
+    bool refresh(int fd, std::vector<std::string> &hdrs, long max_age, bool wait);
+    bool conditional_get(int hdr_fd, std::vector<std::string> &hdrs);
+    void refresh_in_background(int fd, std::vector<std::string> &hdrs, long max_age);
+
+protected:
+    /**
+     * @brief GET the resource
+     *
+     * @param request_headers Headers to add to the request
+     * @param fd Write the body of the response to this file
+     * @param response_headers Value-result parameter; the response headers
+     * @return The HTTP status of the response
+     * @exception BESError if the request fails
+     */
+    virtual long get(const std::vector<std::string> &request_headers, int fd,
+        std::vector<std::string> &response_headers) = 0;
+
+    /**
+     * @brief Make a new connection for the requests of this object
+     *
+     * Called by the background process so it does not share its parent's
+     * connections.
+     */
+    virtual void reset_connection() = 0;
+
+    /// @return The URL of the resource
+    const std::string &get_url() const { return d_url; }
+
+public:
+    BESHttpCacheRevalidator(BESFileLockingCache *cache, const std::string &cache_file, const std::string &url,
+        const std::string &key_prefix);
+    virtual ~BESHttpCacheRevalidator() { }
+
+    virtual void revalidate(int &fd, std::vector<std::string> &hdrs);
+
+    /// @return The configured freshness lifetime in seconds; < 0 means revalidation is off
+    long get_max_age() const { return d_max_age; }
+    /// @return The configured number of seconds a stale resource may be used while it is revalidated
+    long get_stale_while_revalidate() const { return d_stale_while_revalidate; }
+
+    static std::string get_header(const std::vector<std::string> &hdrs, const std::string &name);
+    static void merge_headers(std::vector<std::string> &hdrs, const std::vector<std::string> &updates);
+    static long cache_control_seconds(const std::string &cache_control, const std::string &directive);
+
+    static long freshness_lifetime(const std::vector<std::string> &hdrs, long max_age);
+    static freshness get_freshness(const std::vector<std::string> &hdrs, long age, long max_age, long max_stale);
+
+    static const std::string HEADERS_DIR;
+
+    static std::string headers_file_name(const std::string &cache_file);
+
+    static void read_headers(const std::string &cache_file, std::vector<std::string> &hdrs);
+    static void write_headers(int fd, const std::vector<std::string> &hdrs);
+    static void save_headers(const std::string &cache_file, const std::vector<std::string> &hdrs);
+};
+
+#endif // I_BESHttpCacheRevalidator_h
@@ -39,8 +39,6 @@
 #include <unistd.h>
 #endif
 
-#include <setjmp.h> // Used for the timeout processing
-
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -66,7 +64,7 @@
 
 #include "BESDebug.h"
 #include "BESStopWatch.h"
-#include "BESTimeoutError.h"
+#include "BESDeadline.h"
 #include "BESInternalError.h"
 #include "BESInternalFatalError.h"
 #include "ServerAdministrator.h"
@@ -79,51 +77,21 @@
 using namespace std;
 using std::endl;
 
-static jmp_buf timeout_jump;
-static bool timeout_jump_valid = false;
-
-// Define this to use sigwait() in a child thread to detect that SIGALRM
-// has been raised (i.e., that the timeout interval has elapsed). This
-// does not currently work, but could be a way to get information about
-// a timeout back to the BES's client if the BES itslef were structured
-// differently. See my comment further down. jhrg 12/28/15
-#undef USE_SIGWAIT
-
-// timeout period in seconds; 0 --> no timeout. This is a static value so
-// that it can be accessed by the signal handler. jhrg 1/4/16
-// I've made this globally visible so that other code that might want to
-// alter the time out value can do so and this variable can be kept consistent.
-// See BESStreamResponseHandler::execute() for an example. jhrg 1/24/17
-volatile int bes_timeout = 0;
-
 #define BES_TIMEOUT_KEY "BES.TimeOutInSeconds"
-
-// This function uses the static variables timeout_jump_valid and timeout_jump
-// The code looks at the value of BES.TimeOutInSeconds and/or the timeout
-// context sent in the current request and, if that is greater than zero,
-// uses that as the maximum amount of time for the request. The system alarm
-// is set and this function is registered as the handler. If timeout_jump_valid
-// is true, then it will use longjmp() (yes, really...) to end the request. Look
-// below in execute_request() for the call to setjump() to see how this works.
-// See the SIGWAIT code that's commented out below for an alternative impl.
-// jhrg 5/31/16
+#define BES_TIMEOUT_BACKSTOP_KEY "BES.TimeOutBackstopInSeconds"
+
+// The request deadline (see BESDeadline) only works if the code that is
+// running checks it. The alarm set by the deadline's backstop, some time
+// after the deadline, catches requests that are stuck. There is nothing
+// useful that can be done for the request at that point, so end the child
+// listener without returning an error message to the OLFS/client, as the
+// BES did before it had a deadline. Only async-signal-safe calls are made
+// here.
 static void catch_sig_alarm(int sig)
 {
     if (sig == SIGALRM) {
-        LOG("BES timeout after " << bes_timeout << " seconds." << endl);
-
-        // Causes setjmp() below to return 1; see the call to
-        // execute_data_request_plan() in execute_request() below.
-        // jhrg 12/29/15
-        if (timeout_jump_valid)
-            longjmp(timeout_jump, 1);
-        else {
-            // This is the old version of this code; it forces the BES child
-            // listener to exit without returning an error message to the
-            // OLFS/client. jhrg 12/29/15
-            signal(SIGTERM, SIG_DFL);
-            raise(SIGTERM);
-        }
+        signal(SIGTERM, SIG_DFL);
+        raise(SIGTERM);
     }
 }
 
@@ -134,9 +102,6 @@ static void register_signal_handler()
     sigaddset(&act.sa_mask, SIGALRM);
     act.sa_flags = 0;
 
-    // Note that we do not set SA_RESTART so an interrupted system call
-    // will return with an error and errno set to EINTR.
-
     act.sa_handler = catch_sig_alarm;
     if (sigaction(SIGALRM, &act, 0))
         throw BESInternalFatalError("Could not register a handler to catch alarm/timeout.", __FILE__, __LINE__);
@@ -181,6 +146,10 @@ static void log_error(BESError &e)
         // only_log_to_verbose = false; // TODO was 'true.' jhrg 11/14/17
         break;
 
+    case BES_TIMEOUT_ERROR:
+        error_name = "BES Timeout Error";
+        break;
+
     default:
         error_name = "BES Error";
         break;
@@ -207,85 +176,9 @@ static void log_error(BESError &e)
 
 }
 
-#if USE_SIGWAIT
-
-// If the BES is changed so that the plan built here is run in a child thread,
-// then we can have a much more flexible signal catching scheme, including catching
-// the alarm signal used for the timeout. It's not possible to throw from a child
-// thread to a parent thread, but if the parent thread sees that SIGALRM is
-// raised, then it can stop the child thread (which is running the 'plan') and
-// return a suitable message to the front end. Similarly, the BES could also
-// handle a number of other signals using this scheme. These signals (SIGPIPE, ...)
-// are currently processed using while/for loop(s) in the bes/server code. It may
-// be that these signals are caught only in the master listener, but I can't
-// quite figure that out now... jhrg 12/28/15
-//
-// NB: It might be possible to edit this so that it writes info to the OLFS and
-// then uses the 'raise SIGTERM' technique to exit. That way the OLFS will at least
-// get a message about the timeout. I'm not sure how to close up the PPT part
-// of the conversation, however. The idea would be that the current command's DHI
-// would be passed in as an arg and then the stream accessed that way. The BESError
-// would be written to the stream and the child process killed. jhrg 12/2/9/15
-
-#include <pthread.h>
-
-// An alternative to a function that catches the signal; use sigwait()
-// in a child thread after marking the signal as blocked. When/if sigwait()
-// returns, look at the signal number and if it is the alarm, sort out
-// what to do (throw an exception, ...). NB: A signal handler cannot
-// portably throw an exception, but this code can.
-
-static pthread_t alarm_thread;
-
-static void* alarm_wait(void * /* arg */)
-{
-    BESDEBUG("bes", "Starting: " << __PRETTY_FUNCTION__ << endl);
-
-    // block SIGALRM
-    sigset_t sigset;
-    sigemptyset(&sigset);
-    sigaddset(&sigset, SIGALRM);
-    sigprocmask(SIG_BLOCK, &sigset, NULL);
-
-    // Might replace this with a while loop. Not sure about interactions
-    // with other signal processing code in the BES. jhrg 12/28/15
-    int sig;
-    int result = sigwait(&sigset, &sig);
-    if (result != 0) {
-        BESDEBUG("bes", "Fatal error establishing timeout: " << strerror(result) << endl);
-        throw BESInternalFatalError(string("Fatal error establishing timeout: ") + strerror(result), __FILE__, __LINE__);
-    }
-    else if (result == 0 && sig == SIGALRM) {
-        BESDEBUG("bes", "Timeout found in " << __PRETTY_FUNCTION__ << endl);
-        throw BESTimeoutError("Timeout", __FILE__, __LINE__);
-    }
-    else {
-        stringstream oss;
-        oss << "While waiting for a timeout, found signal '" << result << "' in " << __PRETTY_FUNCTION__ << ends;
-        BESDEBUG("bes", oss.str() << endl);
-        throw BESInternalFatalError(oss.str(), __FILE__, __LINE__);
-    }
-}
-
-static void wait_for_timeout()
-{
-    BESDEBUG("bes", "Entering: " << __PRETTY_FUNCTION__ << endl);
-
-    pthread_attr_t thread_attr;
-
-    if (pthread_attr_init(&thread_attr) != 0)
-    throw BESInternalFatalError("Failed to initialize pthread attributes.", __FILE__, __LINE__);
-    if (pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED /*PTHREAD_CREATE_JOINABLE*/) != 0)
-    throw BESInternalFatalError("Failed to complete pthread attribute initialization.", __FILE__, __LINE__);
-
-    int status = pthread_create(&alarm_thread, &thread_attr, alarm_wait, NULL);
-    if (status != 0)
-    throw BESInternalFatalError("Failed to start the timeout wait thread.", __FILE__, __LINE__);
-}
-#endif
 
 BESInterface::BESInterface(ostream *output_stream) :
-    d_strm(output_stream), d_timeout_from_keys(0), d_dhi_ptr(0), d_transmitter(0)
+    d_strm(output_stream), d_timeout_from_keys(0), d_timeout_backstop(0), d_dhi_ptr(0), d_transmitter(0)
 {
     if (!d_strm) {
         throw BESInternalError("Output stream must be set in order to output responses", __FILE__, __LINE__);
@@ -303,12 +196,11 @@ BESInterface::BESInterface(ostream *output_stream) :
         iss >> d_timeout_from_keys;
     }
 
-    // Install signal handler for alarm() here
-    register_signal_handler();
+    d_timeout_backstop = TheBESKeys::TheKeys()->read_int_key(BES_TIMEOUT_BACKSTOP_KEY, 60);
+    if (d_timeout_backstop < 0) d_timeout_backstop = 0;
 
-#if USE_SIGWAIT
-    wait_for_timeout();
-#endif
+    // Install signal handler for the backstop alarm() here
+    register_signal_handler();
 }
 
 #if 0
@@ -501,69 +393,53 @@ int BESInterface::execute_request(const string &from)
         // 'response object' (the C++ object that will hold the response) and
         // then calls the transmitter to actually send it or build and send it.
         //
-        // The timeout is also set in execute_data_request_plan(). The alarm signal
-        // handler (above), run when the timeout expires, will call longjmp with a
-        // return value of 1.
-        if (setjmp(timeout_jump) == 0) {
-            timeout_jump_valid = true;
-
-            // Set timeout? Use either the value from the keys or a context
-            bool found = false;
-            string context = BESContextManager::TheManager()->get_context("bes_timeout", found);
-            if (found) {
-                bes_timeout = strtol(context.c_str(), NULL, 10);
-                VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << "Set request timeout to " << bes_timeout << " seconds (from context)." << endl);
-                alarm(bes_timeout);
-            }
-            else if (d_timeout_from_keys != 0) {
-                bes_timeout = d_timeout_from_keys;
-                VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << "Set request timeout to " << bes_timeout << " seconds (from keys)." << endl);
-                alarm(bes_timeout);
-            }
-
-            // HK-474. The exception caused by the errant config file in the ticket is
-            // thrown from inside SaxParserWrapper::rethrowException(). It will be caught
-            // below. jhrg 11/12//19
-            execute_data_request_plan();
-
-            // Only clear the timeout if it has been set.
-            if (bes_timeout != 0) {
-                bes_timeout = 0;
-                alarm(0);
-            }
-
-            // Once we exit the block where setjmp() was called, the jump_buf is not valid
-            timeout_jump_valid = false;
+        // Set timeout? Use either the value from the keys or a context. The
+        // deadline does not interrupt the request; code that may run for a
+        // long time checks it and throws BESTimeoutError once it has passed.
+        BESDeadline *deadline = d_dhi_ptr->deadline;
+        deadline->set_backstop(d_timeout_backstop);
+        bool found = false;
+        string context = BESContextManager::TheManager()->get_context("bes_timeout", found);
+        if (found) {
+            long timeout = strtol(context.c_str(), NULL, 10);
+            deadline->start(timeout > 0 ? timeout : 0);
+            VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << "Set request timeout to " << deadline->get_timeout() << " seconds (from context)." << endl);
         }
-        else {
-            ostringstream oss;
-            oss << "BES listener timeout after " << bes_timeout << " seconds." << ends;
-            throw BESTimeoutError(oss.str(), __FILE__, __LINE__);
+        else if (d_timeout_from_keys != 0) {
+            deadline->start(d_timeout_from_keys);
+            VERBOSE(d_dhi_ptr->data[REQUEST_FROM] << "Set request timeout to " << deadline->get_timeout() << " seconds (from keys)." << endl);
         }
 
+        // HK-474. The exception caused by the errant config file in the ticket is
+        // thrown from inside SaxParserWrapper::rethrowException(). It will be caught
+        // below. jhrg 11/12//19
+        execute_data_request_plan();
+
+        deadline->cancel();
+
         d_dhi_ptr->executed = true;
     }
     catch (libdap::Error &e) {
-        timeout_jump_valid = false;
+        d_dhi_ptr->deadline->cancel();
         BESInternalFatalError ex(string("BES caught a libdap exception: ") + e.get_error_message(), __FILE__, __LINE__);
         status = handleException(ex, *d_dhi_ptr);
     }
     catch (BESError &e) {
-        timeout_jump_valid = false;
+        d_dhi_ptr->deadline->cancel();
         status = handleException(e, *d_dhi_ptr);
     }
     catch (bad_alloc &e) {
-        timeout_jump_valid = false;
+        d_dhi_ptr->deadline->cancel();
         BESInternalFatalError ex(string("BES out of memory: ") + e.what(), __FILE__, __LINE__);
         status = handleException(ex, *d_dhi_ptr);
     }
     catch (exception &e) {
-        timeout_jump_valid = false;
+        d_dhi_ptr->deadline->cancel();
         BESInternalFatalError ex(string("C++ Exception: ") + e.what(), __FILE__, __LINE__);
         status = handleException(ex, *d_dhi_ptr);
     }
     catch (...) {
-        timeout_jump_valid = false;
+        d_dhi_ptr->deadline->cancel();
         BESInternalError ex("An unidentified exception has been thrown", __FILE__, __LINE__);
         status = handleException(ex, *d_dhi_ptr);
     }
@@ -119,6 +119,7 @@ class BESInterface: public BESObj {
 private:
     std::ostream *d_strm;
     int d_timeout_from_keys; ///< Command timeout; can be overridden using setContext
+    int d_timeout_backstop; ///< End the process this many seconds after the timeout; zero means never
 
 protected:
     BESDataHandlerInterface *d_dhi_ptr; ///< Allocated by the child class
@@ -0,0 +1,222 @@
+// BESOpenFileCache.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_BESOpenFileCache_h
+#define I_BESOpenFileCache_h 1
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <ctime>
+#include <list>
+#include <string>
+
+#include "BESDebug.h"
+
+/**
+ * @brief A per-process cache of files held open by a handler's library
+ *
+ * A handler uses this to keep the files it reads open from one response or
+ * variable read to the next, evicting the least recently used files once
+ * there are more than get_max_entries(). The handler opens and closes the
+ * files using its library; this class only keeps track of them. A file is
+ * reused only if its device, inode, size and modification time have not
+ * changed since it was opened. Each get() or add() must be matched by a
+ * release(); a file that is in use is not closed by eviction.
+ *
+ * @note This is not thread-safe.
+ *
+ * @tparam H The library's file handle type
+ * @tparam D Data the handler keeps with each open file
+ */
+template<typename H, typename D = char>
+class BESOpenFileCache {
+public:
+    /// Close a file handle using the handler's library
+    typedef void (*close_function)(H handle);
+
+    /// An open file
+    struct entry {
+        std::string path;
+        H handle;
+        unsigned int in_use;    // get() and add() calls without a release()
+
+        dev_t dev;
+        ino_t ino;
+        off_t size;
+        time_t mtime;
+
+        D data;
+    };
+
+private:
+    std::list<entry *> d_entries;   // most recently used first
+    unsigned int d_max_entries;
+    close_function d_close;
+    std::string d_debug_key;
+
+    BESOpenFileCache(const BESOpenFileCache &);
+    BESOpenFileCache &operator=(const BESOpenFileCache &);
+
+    static bool same_file(const entry *e, const struct stat &sb)
+    {
+        return e->dev == sb.st_dev && e->ino == sb.st_ino && e->size == sb.st_size && e->mtime == sb.st_mtime;
+    }
+
+    // Close the least recently used files that are not in use until there
+    // are no more than max_entries.
+    void purge(unsigned int max_entries)
+    {
+        typename std::list<entry *>::iterator i = d_entries.end();
+        while (d_entries.size() > max_entries && i != d_entries.begin()) {
+            --i;
+            if ((*i)->in_use == 0) {
+                BESDEBUG(d_debug_key, "Closing cached file: " << (*i)->path << std::endl);
+                d_close((*i)->handle);
+                delete *i;
+                i = d_entries.erase(i);
+            }
+        }
+    }
+
+public:
+    /**
+     * @param close Closes a file handle
+     * @param debug_key The BESDEBUG context for messages about the cache
+     */
+    BESOpenFileCache(close_function close, const std::string &debug_key) :
+        d_max_entries(0), d_close(close), d_debug_key(debug_key)
+    {
+    }
+
+    // The files are not closed; handlers call clear() when they are done
+    // with the cache. This is often a static object and the library may be
+    // gone by the time it is destroyed.
+    virtual ~BESOpenFileCache()
+    {
+        for (typename std::list<entry *>::iterator i = d_entries.begin(), e = d_entries.end(); i != e; ++i)
+            delete *i;
+    }
+
+    /// @return The number of files that may be held open; zero means the cache is off.
+    unsigned int get_max_entries() const { return d_max_entries; }
+
+    /// @brief Set the number of files that may be held open
+    void set_max_entries(unsigned int max_entries)
+    {
+        d_max_entries = max_entries;
+        purge(d_max_entries);
+    }
+
+    /// @brief Close all of the files that are not in use
+    void clear() { purge(0); }
+
+    /**
+     * @brief Get an open file
+     *
+     * If the file has changed, its old handle is dropped from the cache; if
+     * that handle is in use, the handler closes it when it is released.
+     *
+     * @param path The file's pathname
+     * @param sb The file's current status
+     * @return The file's entry, or null if it must be opened.
+     */
+    entry *get(const std::string &path, const struct stat &sb)
+    {
+        for (typename std::list<entry *>::iterator i = d_entries.begin(), e = d_entries.end(); i != e; ++i) {
+            if ((*i)->path != path) continue;
+
+            entry *ent = *i;
+            d_entries.erase(i);
+
+            if (same_file(ent, sb)) {
+                BESDEBUG(d_debug_key, "Using cached file: " << path << std::endl);
+                d_entries.push_front(ent);
+                ++ent->in_use;
+                return ent;
+            }
+
+            BESDEBUG(d_debug_key, "Cached file has changed: " << path << std::endl);
+            if (ent->in_use == 0) d_close(ent->handle);
+            delete ent;
+            return 0;
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief Add a file the handler has just opened
+     *
+     * @param path The file's pathname
+     * @param sb The file's status when it was opened
+     * @param handle The file's handle
+     * @return The file's entry
+     */
+    entry *add(const std::string &path, const struct stat &sb, H handle)
+    {
+        entry *ent = new entry;
+        ent->path = path;
+        ent->handle = handle;
+        ent->in_use = 1;
+        ent->dev = sb.st_dev;
+        ent->ino = sb.st_ino;
+        ent->size = sb.st_size;
+        ent->mtime = sb.st_mtime;
+
+        d_entries.push_front(ent);
+        purge(d_max_entries);
+
+        return ent;
+    }
+
+    /// @return The entry for an open file handle, or null if it is not in the cache.
+    entry *find(H handle)
+    {
+        for (typename std::list<entry *>::iterator i = d_entries.begin(), e = d_entries.end(); i != e; ++i)
+            if ((*i)->handle == handle) return *i;
+
+        return 0;
+    }
+
+    /**
+     * @brief Release a file returned by get() or add()
+     *
+     * The file stays open while it is in the cache.
+     *
+     * @param handle The file's handle
+     * @return False if the file is not in the cache; the handler must close it.
+     */
+    bool release(H handle)
+    {
+        entry *ent = find(handle);
+        if (!ent) return false;
+
+        if (ent->in_use > 0) --ent->in_use;
+        purge(d_max_entries);
+        return true;
+    }
+};
+
+#endif // I_BESOpenFileCache_h
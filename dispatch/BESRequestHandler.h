@@ -111,6 +111,20 @@ public:
 
     virtual void add_attributes(BESDataHandlerInterface &dhi);
 
+    /**
+     * @brief Can the read() methods of this handler's variables run at the same time?
+     *
+     * Data responses are read ahead on worker threads (see DAP.ReadAhead)
+     * only for handlers that return true. Do not return true unless the
+     * handler and the libraries it uses are thread-safe.
+     *
+     * @return False, unless a handler says otherwise
+     */
+    virtual bool supports_concurrent_reads() const
+    {
+        return false;
+    }
+
     virtual void dump(std::ostream &strm) const;
 };
 
@@ -64,8 +64,6 @@ BESStreamResponseHandler::~BESStreamResponseHandler()
 {
 }
 
-extern volatile int bes_timeout; // defined in BESInterface. jhrg 1/24/17
-
 /** @brief executes the command 'get file <filename>;' by
  * streaming the specified file
  *
@@ -87,10 +85,7 @@ void BESStreamResponseHandler::execute(BESDataHandlerInterface &dhi)
     // operation and have that run from the call to BESInterface::transmist_data().
     // pcw talks about that below.
     // jhrg 1/24/17
-    if (bes_timeout != 0) {
-        bes_timeout = 0;
-        alarm(bes_timeout);
-    }
+    dhi.deadline->cancel();
 
     // What if there is a special way to stream back a data file?
     // Should we pass this off to the request handlers and put
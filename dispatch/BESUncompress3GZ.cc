@@ -31,20 +31,244 @@
 //      jgarcia     Jose Garcia <jgarcia@ucar.edu>
 
 #include <zlib.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <cstdio>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
+#include <vector>
 
+using std::endl;
 using std::ostringstream;
 using std::string;
+using std::vector;
 
 #include "BESUncompress3GZ.h"
 #include "BESInternalError.h"
-// #include "BESDebug.h"
+#include "BESDebug.h"
 
-#define CHUNK 4096
+#define CHUNK 65536
+
+// A BGZF block is at most 64KB, compressed or not
+#define BGZF_MAX_BLOCK 65536
+
+unsigned int BESUncompress3GZ::d_max_threads = 1;
+
+/** One member of a BGZF file */
+struct bgzf_block {
+    off_t offset;           // of the member in the compressed file
+    unsigned int size;      // of the whole member
+    off_t dest_offset;      // of the member's data in the uncompressed file
+    unsigned int isize;     // number of uncompressed bytes
+};
+
+static unsigned int get_uint16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get_uint32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static bool read_at(int fd, off_t offset, unsigned char *buf, size_t count)
+{
+    while (count > 0) {
+        ssize_t bytes = pread(fd, buf, count, offset);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        buf += bytes;
+        offset += bytes;
+        count -= bytes;
+    }
+    return true;
+}
+
+/**
+ * Build a list of the members of a BGZF file (the blocked gzip format
+ * written by bgzip). Every member of such a file records its own size in
+ * a 'BC' extra field and its uncompressed size in its trailer, so the
+ * members can be found without decompressing anything and then
+ * decompressed independently.
+ *
+ * @return False if the file is not a BGZF file, in which case 'blocks'
+ * is not complete.
+ */
+static bool index_bgzf(int fd, off_t file_size, vector<bgzf_block> &blocks)
+{
+    off_t offset = 0;
+    off_t dest_offset = 0;
+    while (offset < file_size) {
+        unsigned char header[12];
+        if (!read_at(fd, offset, header, sizeof(header))) return false;
+
+        // gzip magic number, deflate and FEXTRA
+        if (header[0] != 31 || header[1] != 139 || header[2] != 8 || !(header[3] & 4)) return false;
+
+        unsigned int xlen = get_uint16(header + 10);
+        vector<unsigned char> extra(xlen + 1);
+        if (!read_at(fd, offset + 12, &extra[0], xlen)) return false;
+
+        unsigned int size = 0;
+        for (unsigned int i = 0; i + 4 <= xlen;) {
+            unsigned int slen = get_uint16(&extra[i + 2]);
+            if (extra[i] == 'B' && extra[i + 1] == 'C' && slen == 2 && i + 6 <= xlen) {
+                size = get_uint16(&extra[i + 4]) + 1;
+                break;
+            }
+            i += 4 + slen;
+        }
+        // The member must hold its header, some data and the trailer
+        if (size < 12 + xlen + 8 || offset + size > file_size) return false;
+
+        unsigned char trailer[4];
+        if (!read_at(fd, offset + size - 4, trailer, sizeof(trailer))) return false;
+
+        bgzf_block block;
+        block.offset = offset;
+        block.size = size;
+        block.dest_offset = dest_offset;
+        block.isize = get_uint32(trailer);
+        if (block.isize > BGZF_MAX_BLOCK) return false;
+        blocks.push_back(block);
+
+        offset += size;
+        dest_offset += block.isize;
+    }
+
+    return true;
+}
+
+/** The members of a BGZF file that one thread decompresses */
+struct bgzf_thread_args {
+    int src_fd;
+    int dest_fd;
+    const bgzf_block *first;
+    const bgzf_block *last;
+    string error;
+};
+
+/**
+ * @brief Decompress a range of BGZF members, writing each to its place in
+ * the destination file.
+ */
+static void *bgzf_thread(void *arg_list)
+{
+    bgzf_thread_args *args = reinterpret_cast<bgzf_thread_args*>(arg_list);
+
+    vector<unsigned char> in(BGZF_MAX_BLOCK);
+    vector<unsigned char> out(BGZF_MAX_BLOCK);
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+        args->error = "Could not initialize zlib";
+        return 0;
+    }
+
+    for (const bgzf_block *b = args->first; b != args->last; ++b) {
+        if (!read_at(args->src_fd, b->offset, &in[0], b->size)) {
+            args->error = "Could not read compressed data";
+            break;
+        }
+
+        // The raw deflate data lies between the header and the trailer
+        unsigned int header_size = 12 + get_uint16(&in[10]);
+        strm.next_in = &in[header_size];
+        strm.avail_in = b->size - header_size - 8;
+        strm.next_out = &out[0];
+        strm.avail_out = out.size();
+        int status = inflate(&strm, Z_FINISH);
+        inflateReset(&strm);
+
+        if (status != Z_STREAM_END || out.size() - strm.avail_out != b->isize
+            || crc32(crc32(0L, Z_NULL, 0), &out[0], b->isize) != get_uint32(&in[b->size - 8])) {
+            args->error = "Corrupt compressed data";
+            break;
+        }
+
+        ssize_t bytes_written = pwrite(args->dest_fd, &out[0], b->isize, b->dest_offset);
+        if (bytes_written != (ssize_t) b->isize) {
+            args->error = "Could not write uncompressed data";
+            break;
+        }
+    }
+
+    inflateEnd(&strm);
+    return 0;
+}
+
+/**
+ * @brief Decompress a BGZF file using several threads
+ *
+ * @return False if the file is not a BGZF file or is too small to benefit
+ * from more than one thread. Nothing is written to the destination in
+ * that case.
+ */
+static bool uncompress_bgzf(const string &src, int dest_fd, unsigned int max_threads)
+{
+    int src_fd = open(src.c_str(), O_RDONLY);
+    if (src_fd < 0) return false;
+
+    vector<bgzf_block> blocks;
+    off_t file_size = lseek(src_fd, 0, SEEK_END);
+    if (file_size <= 0 || !index_bgzf(src_fd, file_size, blocks) || blocks.size() < 2) {
+        close(src_fd);
+        return false;
+    }
+
+    unsigned int num_threads = max_threads < blocks.size() ? max_threads : blocks.size();
+    BESDEBUG("uncompress", "BESUncompress3GZ::uncompress() - " << src << " has " << blocks.size()
+        << " BGZF members, using " << num_threads << " threads" << endl);
+
+    vector<bgzf_thread_args> args(num_threads);
+    vector<pthread_t> threads(num_threads);
+    vector<bool> started(num_threads, false);
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        args[i].src_fd = src_fd;
+        args[i].dest_fd = dest_fd;
+        args[i].first = &blocks[0] + (blocks.size() * i) / num_threads;
+        args[i].last = &blocks[0] + (blocks.size() * (i + 1)) / num_threads;
+        started[i] = pthread_create(&threads[i], NULL, bgzf_thread, &args[i]) == 0;
+        // If a thread cannot be started, decompress its members here
+        if (!started[i]) bgzf_thread(&args[i]);
+    }
+
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+
+    close(src_fd);
+
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        if (!args[i].error.empty())
+            throw BESInternalError(args[i].error + " while uncompressing " + src, __FILE__, __LINE__);
+    }
+
+    // Leave the file offset where a sequential write would have left it
+    const bgzf_block &last = blocks.back();
+    lseek(dest_fd, last.dest_offset + last.isize, SEEK_SET);
+
+    return true;
+}
+
+/** @brief Set the number of threads used to decompress a BGZF file
+ *
+ * Files compressed with bgzip are made up of many small, independent gzip
+ * members and these can be decompressed in parallel. Other gzip files are
+ * always decompressed with one thread.
+ *
+ * @param max_threads Use at most this many threads; 0 or 1 disables
+ * parallel decompression.
+ */
+void BESUncompress3GZ::set_max_threads(unsigned int max_threads)
+{
+    d_max_threads = max_threads;
+}
 
 /** @brief uncompress a file with the .gz file extension
  *
@@ -55,8 +279,11 @@ using std::string;
  */
 void BESUncompress3GZ::uncompress(const string &src, int dest_fd)
 {
+    if (d_max_threads > 1 && uncompress_bgzf(src, dest_fd, d_max_threads))
+        return;
+
     // buffer to hold the uncompressed data
-    char in[CHUNK];
+    vector<char> in(CHUNK);
 
     // open the file to be read by gzopen. If the file is not compressed
     // using gzip then all this function will do is trasnfer the data to the
@@ -66,17 +293,22 @@ void BESUncompress3GZ::uncompress(const string &src, int dest_fd)
         string err = "Could not open the compressed file " + src;
         throw BESInternalError(err, __FILE__, __LINE__);
     }
+    gzbuffer(gsrc, CHUNK);
 
     // gzread will read the data in uncompressed. All we have to do is write
     // it to the destination file.
     bool done = false;
     while (!done) {
-        int bytes_read = gzread(gsrc, in, CHUNK);
+        int bytes_read = gzread(gsrc, &in[0], CHUNK);
         if (bytes_read == 0) {
             done = true;
         }
+        else if (bytes_read < 0) {
+            gzclose(gsrc);
+            throw BESInternalError("Could not uncompress the file " + src, __FILE__, __LINE__);
+        }
         else {
-            int bytes_written = write(dest_fd, in, bytes_read);
+            int bytes_written = write(dest_fd, &in[0], bytes_read);
             if (bytes_written < bytes_read) {
                 ostringstream strm;
                 strm << "Error writing uncompressed data for file " << gsrc << ": wrote "
@@ -44,6 +44,10 @@
  * that file. The destination file must be already open for write or
  * read/write. This code will not close that file.
  *
+ * Files written by bgzip (BGZF) are made of many independent gzip members;
+ * when more than one thread is allowed (see set_max_threads()) those
+ * members are decompressed in parallel.
+ *
  * If any errors occur during this operation then a
  * BESContainerStorageException will be thrown
  *
@@ -52,8 +56,13 @@
  * @throws BESContainerStorageException if errors in uncompressing the file
  */
 class BESUncompress3GZ: public BESObj {
+private:
+    static unsigned int d_max_threads;
+
 public:
     static void uncompress(const std::string &src, int dest_fd);
+
+    static void set_max_threads(unsigned int max_threads);
 };
 
 #endif // BESUncompress3GZ_h_
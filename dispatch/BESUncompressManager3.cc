@@ -46,6 +46,8 @@ using std::string;
 
 BESUncompressManager3 *BESUncompressManager3::_instance = 0;
 
+static const string GZ_THREADS_KEY = "BES.Uncompress.Threads";
+
 /** @brief constructs an uncompression manager adding gz, z, and bz2
  * uncompression methods by default.
  *
@@ -54,9 +56,15 @@ BESUncompressManager3 *BESUncompressManager3::_instance = 0;
  * Looks for a configuration parameter for the number of times to try to
  * lock the cache (BES.Uncompress.NumTries) and the time in microseconds
  * between tries (BES.Uncompress.Retry).
+ *
+ * The number of threads used to decompress BGZF files is read from
+ * BES.Uncompress.Threads (default 4).
  */
 BESUncompressManager3::BESUncompressManager3()
 {
+    int threads = TheBESKeys::TheKeys()->read_int_key(GZ_THREADS_KEY, 4);
+    BESUncompress3GZ::set_max_threads(threads > 0 ? threads : 1);
+
     add_method("gz", BESUncompress3GZ::uncompress);
     add_method("bz2", BESUncompress3BZ2::uncompress);
     add_method("Z", BESUncompress3Z::uncompress);
@@ -34,6 +34,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #if HAVE_UNISTD_H
 #include <unistd.h>
@@ -67,6 +68,7 @@ using std::ostream;
 #include "BESNotFoundError.h"
 #include "BESInternalError.h"
 #include "BESLog.h"
+#include "BESDeadline.h"
 #include "BESCatalogList.h"
 
 #define CRLF "\r\n"
@@ -978,7 +980,59 @@ void BESUtil::conditional_timeout_cancel()
         if (dosettrue == doset || dosetyes == doset) cancel_timeout_on_send = true;
     }
     BESDEBUG(debug_key, __func__ << "() - cancel_timeout_on_send: " <<(cancel_timeout_on_send?"true":"false") << endl);
-    if (cancel_timeout_on_send) alarm(0);
+    if (cancel_timeout_on_send) BESDeadline::TheDeadline()->cancel();
+}
+
+/**
+ * @brief Start a background process that is not a child of this process
+ *
+ * This forks twice. The first child only forks the background process and
+ * exits, and is reaped here, so the background process is never a zombie
+ * and this process does not have to wait for it. The background process
+ * closes its copies of this process' sockets, so it does not hold the
+ * client's connection open, and cancels the request's deadline (see
+ * BESDeadline).
+ *
+ * @code
+ * int status = BESUtil::fork_background_process();
+ * if (status == 0) {
+ *     // The background process; do the work, catching all errors
+ *     _exit(0);
+ * }
+ * @endcode
+ *
+ * @return 0 in the background process, which must end by calling _exit();
+ * 1 in this process once the background process has started; -1 in this
+ * process if it could not be started.
+ */
+int BESUtil::fork_background_process()
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        pid_t background = fork();
+        if (background != 0) _exit(background == -1 ? 1 : 0);
+
+        for (int fd = getdtablesize() - 1; fd > 2; --fd) {
+            struct stat sb;
+            if (fstat(fd, &sb) == 0 && S_ISSOCK(sb.st_mode)) close(fd);
+        }
+        BESDeadline::TheDeadline()->cancel();
+
+        return 0;
+    }
+
+    if (pid == -1) {
+        BESDEBUG(debug_key, prolog << "fork() failed: " << strerror(errno) << endl);
+        return -1;
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        BESDEBUG(debug_key, prolog << "Could not start the background process." << endl);
+        return -1;
+    }
+
+    return 1;
 }
 
 /**
@@ -107,6 +107,7 @@ public:
 
     static bool endsWith(std::string const &fullString, std::string const &ending);
     static void conditional_timeout_cancel();
+    static int fork_background_process();
 
     static void replace_all(std::string &s, std::string find_this, std::string replace_with_this);
     static std::string normalize_path(const std::string &path, bool leading_separator, bool trailing_separator, const std::string separator = "/");
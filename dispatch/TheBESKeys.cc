@@ -383,7 +383,8 @@ int TheBESKeys::read_int_key(const string &key, int default_value)
         std::istringstream iss(value);
         int int_val;
         iss >> int_val;
-        if (iss.eof() || iss.bad() || iss.fail())
+        // eof() is set when the value is read from the end of the string
+        if (iss.bad() || iss.fail())
             return default_value;
         else
             return int_val;
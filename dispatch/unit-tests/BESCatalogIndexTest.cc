@@ -0,0 +1,257 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <unistd.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <memory>
+
+#include <GetOpt.h>
+
+#include "TheBESKeys.h"
+#include "BESError.h"
+#include "BESCatalogDirectory.h"
+#include "BESCatalogIndex.h"
+#include "CatalogNode.h"
+#include "CatalogItem.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+using namespace CppUnit;
+using namespace bes;
+
+static void compare_items(CatalogItem *expected, CatalogItem *item)
+{
+    CPPUNIT_ASSERT(item);
+    DBG(cerr << "Item: " << item->get_name() << endl);
+    CPPUNIT_ASSERT(item->get_name() == expected->get_name());
+    CPPUNIT_ASSERT(item->get_size() == expected->get_size());
+    CPPUNIT_ASSERT(item->get_lmt() == expected->get_lmt());
+    CPPUNIT_ASSERT(item->get_type() == expected->get_type());
+    CPPUNIT_ASSERT(item->is_data() == expected->is_data());
+}
+
+static void compare_nodes(CatalogNode *expected, CatalogNode *node)
+{
+    CPPUNIT_ASSERT(node);
+    DBG(cerr << "Node: " << node->get_name() << endl);
+    CPPUNIT_ASSERT(node->get_name() == expected->get_name());
+    CPPUNIT_ASSERT(node->get_catalog_name() == expected->get_catalog_name());
+    CPPUNIT_ASSERT(node->get_lmt() == expected->get_lmt());
+
+    if (expected->get_leaf()) {
+        compare_items(expected->get_leaf(), node->get_leaf());
+        return;
+    }
+
+    CPPUNIT_ASSERT(!node->get_leaf());
+    CPPUNIT_ASSERT(node->get_node_count() == expected->get_node_count());
+    CPPUNIT_ASSERT(node->get_leaf_count() == expected->get_leaf_count());
+
+    for (CatalogNode::item_iter i = expected->nodes_begin(), j = node->nodes_begin(), e = expected->nodes_end();
+        i != e; ++i, ++j)
+        compare_items(*i, *j);
+
+    for (CatalogNode::item_iter i = expected->leaves_begin(), j = node->leaves_begin(), e = expected->leaves_end();
+        i != e; ++i, ++j)
+        compare_items(*i, *j);
+}
+
+class BESCatalogIndexTest: public CppUnit::TestFixture {
+
+    string d_index_file;
+
+public:
+
+    // Called once before everything gets tested
+    BESCatalogIndexTest() : d_index_file(string(TEST_BUILD_DIR).append("/catalog_test.idx"))
+    {
+    }
+
+    // Called at the end of the test
+    ~BESCatalogIndexTest()
+    {
+    }
+
+    // Called before each test
+    void setUp()
+    {
+        TheBESKeys::ConfigFile = string(TEST_BUILD_DIR).append("/bes.conf");
+        unlink(d_index_file.c_str());
+    }
+
+    // Called after each test
+    void tearDown()
+    {
+        TheBESKeys::ConfigFile = "";
+        unlink(d_index_file.c_str());
+    }
+
+    // Build the index and test that each node it returns matches the node
+    // read from the file system.
+    void check_index(BESCatalogIndex &index, BESCatalogDirectory &catalog, const string &path)
+    {
+        auto_ptr<CatalogNode> expected(catalog.scan_node(path));
+        auto_ptr<CatalogNode> node(index.get_node(path));
+        compare_nodes(expected.get(), node.get());
+    }
+
+    void index_directories_test()
+    {
+        try {
+            BESCatalogDirectory catalog("default");
+            BESCatalogIndex index(&catalog, d_index_file, 0);
+            index.build();
+
+            check_index(index, catalog, "/");
+            check_index(index, catalog, "/child_dir");
+            check_index(index, catalog, "/child_dir/");
+        }
+        catch (BESError &e) {
+            cerr << "Error: " << e.get_verbose_message() << endl;
+            CPPUNIT_FAIL("Caught BESError");
+        }
+    }
+
+    void index_leaves_test()
+    {
+        try {
+            BESCatalogDirectory catalog("default");
+            BESCatalogIndex index(&catalog, d_index_file, 0);
+            index.build();
+
+            check_index(index, catalog, "/file1");
+            check_index(index, catalog, "/child_dir/child_file.conf");
+        }
+        catch (BESError &e) {
+            cerr << "Error: " << e.get_verbose_message() << endl;
+            CPPUNIT_FAIL("Caught BESError");
+        }
+    }
+
+    // Paths not in the index return null so the catalog can report them
+    void index_missing_test()
+    {
+        try {
+            BESCatalogDirectory catalog("default");
+            BESCatalogIndex index(&catalog, d_index_file, 0);
+            index.build();
+
+            CPPUNIT_ASSERT(index.get_node("/no_such_dir") == 0);
+            CPPUNIT_ASSERT(index.get_node("/child_dir/no_such_file") == 0);
+            // Excluded by the catalog's configuration
+            CPPUNIT_ASSERT(index.get_node("/README") == 0);
+        }
+        catch (BESError &e) {
+            cerr << "Error: " << e.get_verbose_message() << endl;
+            CPPUNIT_FAIL("Caught BESError");
+        }
+    }
+
+    // A second build copies the unchanged directories from the first
+    void index_rebuild_test()
+    {
+        try {
+            BESCatalogDirectory catalog("default");
+            BESCatalogIndex index(&catalog, d_index_file, 0);
+            index.build();
+            index.build();
+
+            check_index(index, catalog, "/");
+            check_index(index, catalog, "/child_dir");
+            check_index(index, catalog, "/child_dir/child_file1");
+        }
+        catch (BESError &e) {
+            cerr << "Error: " << e.get_verbose_message() << endl;
+            CPPUNIT_FAIL("Caught BESError");
+        }
+    }
+
+    CPPUNIT_TEST_SUITE( BESCatalogIndexTest );
+
+    CPPUNIT_TEST(index_directories_test);
+    CPPUNIT_TEST(index_leaves_test);
+    CPPUNIT_TEST(index_missing_test);
+    CPPUNIT_TEST(index_rebuild_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BESCatalogIndexTest);
+
+int main(int argc, char*argv[])
+{
+    int start = 0;
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd': {
+            debug = 1;  // debug is a static global
+            start = 1;
+            break;
+        }
+        case 'h': {     // help - show test names
+            cerr << "Usage: BESCatalogIndexTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = BESCatalogIndexTest::suite()->getTests();
+            unsigned int prefix_len = BESCatalogIndexTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BESCatalogIndexTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
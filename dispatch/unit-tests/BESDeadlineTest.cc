@@ -0,0 +1,216 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <unistd.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include "BESDeadline.h"
+#include "BESTimeoutError.h"
+#include "BESDataHandlerInterface.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+using namespace CppUnit;
+
+class BESDeadlineTest: public CppUnit::TestFixture {
+
+public:
+
+    // Called once before everything gets tested
+    BESDeadlineTest()
+    {
+    }
+
+    // Called at the end of the test
+    ~BESDeadlineTest()
+    {
+    }
+
+    // Called before each test
+    void setUp()
+    {
+    }
+
+    // Called after each test
+    void tearDown()
+    {
+        BESDeadline::TheDeadline()->cancel();
+    }
+
+    void no_deadline_test()
+    {
+        BESDeadline deadline;
+        CPPUNIT_ASSERT(!deadline.is_set());
+        CPPUNIT_ASSERT(!deadline.expired());
+        CPPUNIT_ASSERT(deadline.remaining_ms() == -1);
+        deadline.check(__FILE__, __LINE__);    // does not throw
+
+        deadline.start(0);
+        CPPUNIT_ASSERT(!deadline.is_set());
+    }
+
+    void deadline_test()
+    {
+        BESDeadline deadline;
+        deadline.start(10);
+        CPPUNIT_ASSERT(deadline.is_set());
+        CPPUNIT_ASSERT(deadline.get_timeout() == 10);
+        CPPUNIT_ASSERT(!deadline.expired());
+
+        long ms = deadline.remaining_ms();
+        DBG(cerr << "remaining: " << ms << endl);
+        CPPUNIT_ASSERT(ms > 9000 && ms <= 10000);
+
+        deadline.check(__FILE__, __LINE__);
+
+        deadline.cancel();
+        CPPUNIT_ASSERT(!deadline.is_set());
+        CPPUNIT_ASSERT(deadline.remaining_ms() == -1);
+    }
+
+    void expired_test()
+    {
+        BESDeadline deadline;
+        deadline.start(1);
+        sleep(2);
+
+        CPPUNIT_ASSERT(deadline.expired());
+        CPPUNIT_ASSERT(deadline.remaining_ms() == 0);
+
+        try {
+            deadline.check(__FILE__, __LINE__);
+            CPPUNIT_FAIL("Expected a BESTimeoutError");
+        }
+        catch (BESTimeoutError &e) {
+            DBG(cerr << "Caught: " << e.get_message() << endl);
+            CPPUNIT_ASSERT(e.get_bes_error_type() == BES_TIMEOUT_ERROR);
+        }
+    }
+
+    // The DHI carries the process' deadline, and copies share it
+    void dhi_deadline_test()
+    {
+        BESDataHandlerInterface dhi;
+        CPPUNIT_ASSERT(dhi.deadline == BESDeadline::TheDeadline());
+
+        dhi.deadline->start(10);
+        BESDataHandlerInterface copy(dhi);
+        CPPUNIT_ASSERT(copy.deadline->is_set());
+        CPPUNIT_ASSERT(BESDeadline::TheDeadline()->is_set());
+
+        copy.deadline->cancel();
+        CPPUNIT_ASSERT(!dhi.deadline->is_set());
+    }
+
+    // The backstop alarm is set after the deadline and cancelled with it.
+    // alarm(0) returns the seconds left on the alarm (and cancels it).
+    void backstop_test()
+    {
+        BESDeadline deadline;
+        deadline.start(10);
+        CPPUNIT_ASSERT(alarm(0) == 0);
+
+        deadline.set_backstop(5);
+        deadline.start(10);
+        unsigned int left = alarm(0);
+        DBG(cerr << "alarm: " << left << endl);
+        CPPUNIT_ASSERT(left > 10 && left <= 15);
+
+        deadline.start(10);
+        deadline.cancel();
+        CPPUNIT_ASSERT(alarm(0) == 0);
+
+        // No deadline, no alarm
+        deadline.start(0);
+        CPPUNIT_ASSERT(alarm(0) == 0);
+    }
+
+    CPPUNIT_TEST_SUITE( BESDeadlineTest );
+
+    CPPUNIT_TEST(no_deadline_test);
+    CPPUNIT_TEST(deadline_test);
+    CPPUNIT_TEST(expired_test);
+    CPPUNIT_TEST(dhi_deadline_test);
+    CPPUNIT_TEST(backstop_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BESDeadlineTest);
+
+int main(int argc, char*argv[])
+{
+    int start = 0;
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd': {
+            debug = 1;  // debug is a static global
+            start = 1;
+            break;
+        }
+        case 'h': {     // help - show test names
+            cerr << "Usage: BESDeadlineTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = BESDeadlineTest::suite()->getTests();
+            unsigned int prefix_len = BESDeadlineTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BESDeadlineTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
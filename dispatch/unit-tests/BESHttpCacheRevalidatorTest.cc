@@ -0,0 +1,481 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include "BESHttpCacheRevalidator.h"
+#include "BESFileLockingCache.h"
+#include "BESInternalError.h"
+#include "BESDebug.h"
+#include "TheBESKeys.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+using namespace CppUnit;
+
+typedef BESHttpCacheRevalidator R;
+
+static vector<string> headers(const string &h1, const string &h2 = "", const string &h3 = "")
+{
+    vector<string> hdrs;
+    hdrs.push_back(h1);
+    if (!h2.empty()) hdrs.push_back(h2);
+    if (!h3.empty()) hdrs.push_back(h3);
+    return hdrs;
+}
+
+static string contents(int fd)
+{
+    string s;
+    char buf[256];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = pread(fd, buf, sizeof(buf), offset)) > 0) {
+        s.append(buf, n);
+        offset += n;
+    }
+    return s;
+}
+
+/**
+ * A revalidator that 'gets' a canned response.
+ */
+class TestRevalidator: public BESHttpCacheRevalidator {
+protected:
+    virtual long get(const vector<string> &request_headers, int fd, vector<string> &response_headers)
+    {
+        ++d_requests;
+        d_request_headers = request_headers;
+        if (d_status == 200 && write(fd, d_body.data(), d_body.size()) != (ssize_t) d_body.size())
+            throw BESInternalError("Could not write the test response", __FILE__, __LINE__);
+        response_headers = d_response_headers;
+        return d_status;
+    }
+
+    virtual void reset_connection()
+    {
+    }
+
+public:
+    long d_status;
+    string d_body;
+    vector<string> d_response_headers;
+
+    int d_requests;
+    vector<string> d_request_headers;
+
+    TestRevalidator(BESFileLockingCache *cache, const string &cache_file) :
+        BESHttpCacheRevalidator(cache, cache_file, "http://test.opendap.org/data/file.nc", "RevalidatorTest"),
+            d_status(304), d_requests(0)
+    {
+    }
+};
+
+class BESHttpCacheRevalidatorTest: public CppUnit::TestFixture {
+private:
+    string d_cache_dir;
+    BESFileLockingCache *d_cache;
+    string d_cache_file;
+    int d_fd;
+
+    // Cache a resource whose headers were saved 'age' seconds ago
+    void cache_resource(const string &body, const vector<string> &hdrs, long age)
+    {
+        d_cache_file = d_cache->get_cache_file_name("http://test.opendap.org/data/file.nc");
+        CPPUNIT_ASSERT(d_cache->create_and_lock(d_cache_file, d_fd));
+        CPPUNIT_ASSERT(write(d_fd, body.data(), body.size()) == (ssize_t) body.size());
+        R::save_headers(d_cache_file, hdrs);
+        d_cache->exclusive_to_shared_lock(d_fd);
+
+        struct utimbuf times;
+        times.actime = times.modtime = time(0) - age;
+        CPPUNIT_ASSERT(utime(R::headers_file_name(d_cache_file).c_str(), &times) == 0);
+    }
+
+    // The only files in the cache directory with the cache's prefix are the
+    // resource and the cache's own control file
+    void check_cache_dir()
+    {
+        string resource = d_cache_file.substr(d_cache_file.find_last_of('/') + 1);
+
+        DIR *dip = opendir(d_cache_dir.c_str());
+        CPPUNIT_ASSERT(dip);
+        struct dirent *dit;
+        while ((dit = readdir(dip)) != NULL) {
+            string name = dit->d_name;
+            DBG(cerr << "cache dir entry: " << name << endl);
+            if (name.compare(0, 3, "rv_") == 0)
+                CPPUNIT_ASSERT(name == resource || name == "rv_cache_control");
+        }
+        closedir(dip);
+    }
+
+    long headers_age()
+    {
+        struct stat buf;
+        CPPUNIT_ASSERT(stat(R::headers_file_name(d_cache_file).c_str(), &buf) == 0);
+        return time(0) - buf.st_mtime;
+    }
+
+public:
+    BESHttpCacheRevalidatorTest() :
+        d_cache_dir(string(TEST_BUILD_DIR).append("/revalidator_cache")), d_cache(0), d_fd(-1)
+    {
+    }
+
+    ~BESHttpCacheRevalidatorTest()
+    {
+    }
+
+    void setUp()
+    {
+        TheBESKeys::ConfigFile = string(TEST_BUILD_DIR).append("/bes.conf");
+
+        string cmd = "rm -rf " + d_cache_dir + " && mkdir -p " + d_cache_dir;
+        CPPUNIT_ASSERT(system(cmd.c_str()) == 0);
+        d_cache = new BESFileLockingCache(d_cache_dir, "rv_", 10);
+    }
+
+    void tearDown()
+    {
+        if (!d_cache_file.empty()) d_cache->unlock_and_close(d_cache_file);
+        d_cache_file.clear();
+        delete d_cache;
+        d_cache = 0;
+
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "");
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.StaleWhileRevalidate", "");
+        TheBESKeys::ConfigFile = "";
+    }
+
+    void get_header_test()
+    {
+        vector<string> hdrs = headers("Content-Type: application/x-netcdf", "ETag:  \"abc\"", "X-Empty:");
+
+        CPPUNIT_ASSERT_EQUAL(string("application/x-netcdf"), R::get_header(hdrs, "content-type"));
+        CPPUNIT_ASSERT_EQUAL(string("\"abc\""), R::get_header(hdrs, "etag"));
+        CPPUNIT_ASSERT_EQUAL(string(""), R::get_header(hdrs, "x-empty"));
+        CPPUNIT_ASSERT_EQUAL(string(""), R::get_header(hdrs, "last-modified"));
+
+        // Trailing white space, including the CR of a raw header line, is removed
+        CPPUNIT_ASSERT_EQUAL(string("\"abc\""), R::get_header(headers("ETag: \"abc\" \r"), "etag"));
+    }
+
+    void merge_headers_test()
+    {
+        vector<string> hdrs = headers("Content-Type: application/x-netcdf", "ETag: \"abc\"",
+            "Cache-Control: max-age=60");
+        R::merge_headers(hdrs, headers("etag: \"def\"", "Date: Mon, 19 Oct 2020 12:00:00 GMT"));
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 4, hdrs.size());
+        CPPUNIT_ASSERT_EQUAL(string("Content-Type: application/x-netcdf"), hdrs[0]);
+        CPPUNIT_ASSERT_EQUAL(string("etag: \"def\""), hdrs[1]);
+        CPPUNIT_ASSERT_EQUAL(string("Cache-Control: max-age=60"), hdrs[2]);
+        CPPUNIT_ASSERT_EQUAL(string("Date: Mon, 19 Oct 2020 12:00:00 GMT"), hdrs[3]);
+    }
+
+    void cache_control_seconds_test()
+    {
+        CPPUNIT_ASSERT_EQUAL(3600L, R::cache_control_seconds("max-age=3600", "max-age"));
+        CPPUNIT_ASSERT_EQUAL(60L, R::cache_control_seconds("public, Max-Age=60", "max-age"));
+        CPPUNIT_ASSERT_EQUAL(10L, R::cache_control_seconds("s-maxage=5,max-age=10", "max-age"));
+        CPPUNIT_ASSERT_EQUAL(-1L, R::cache_control_seconds("s-max-age=5", "max-age"));
+        CPPUNIT_ASSERT_EQUAL(30L,
+            R::cache_control_seconds("max-age=10, stale-while-revalidate=30", "stale-while-revalidate"));
+        CPPUNIT_ASSERT_EQUAL(-1L, R::cache_control_seconds("no-cache", "max-age"));
+        CPPUNIT_ASSERT_EQUAL(-1L, R::cache_control_seconds("", "max-age"));
+    }
+
+    // With MaxAge < 0, the origin's max-age and no-cache are ignored
+    void freshness_lifetime_test()
+    {
+        vector<string> none = headers("ETag: \"abc\"");
+        vector<string> max_age = headers("Cache-Control: max-age=60");
+        vector<string> no_cache = headers("Cache-Control: no-cache");
+
+        CPPUNIT_ASSERT_EQUAL(-1L, R::freshness_lifetime(none, -1));
+        CPPUNIT_ASSERT_EQUAL(-1L, R::freshness_lifetime(max_age, -1));
+        CPPUNIT_ASSERT_EQUAL(-1L, R::freshness_lifetime(no_cache, -1));
+
+        CPPUNIT_ASSERT_EQUAL(600L, R::freshness_lifetime(none, 600));
+        CPPUNIT_ASSERT_EQUAL(60L, R::freshness_lifetime(max_age, 600));
+        CPPUNIT_ASSERT_EQUAL(0L, R::freshness_lifetime(no_cache, 600));
+    }
+
+    void get_freshness_test()
+    {
+        vector<string> none = headers("ETag: \"abc\"");
+        vector<string> swr = headers("Cache-Control: max-age=60, stale-while-revalidate=30");
+        vector<string> no_cache = headers("Cache-Control: no-cache");
+
+        // Revalidation off
+        CPPUNIT_ASSERT_EQUAL(R::fresh, R::get_freshness(no_cache, 1000000, -1, 0));
+        CPPUNIT_ASSERT_EQUAL(R::fresh, R::get_freshness(swr, 1000000, -1, 0));
+
+        CPPUNIT_ASSERT_EQUAL(R::fresh, R::get_freshness(none, 100, 100, 0));
+        CPPUNIT_ASSERT_EQUAL(R::stale, R::get_freshness(none, 101, 100, 0));
+        CPPUNIT_ASSERT_EQUAL(R::stale_while_revalidate, R::get_freshness(none, 101, 100, 10));
+        CPPUNIT_ASSERT_EQUAL(R::stale_while_revalidate, R::get_freshness(none, 110, 100, 10));
+        CPPUNIT_ASSERT_EQUAL(R::stale, R::get_freshness(none, 111, 100, 10));
+
+        // The origin's max-age and stale-while-revalidate take precedence
+        CPPUNIT_ASSERT_EQUAL(R::fresh, R::get_freshness(swr, 60, 10, 0));
+        CPPUNIT_ASSERT_EQUAL(R::stale_while_revalidate, R::get_freshness(swr, 90, 10, 0));
+        CPPUNIT_ASSERT_EQUAL(R::stale, R::get_freshness(swr, 91, 10, 1000));
+
+        CPPUNIT_ASSERT_EQUAL(R::fresh, R::get_freshness(no_cache, 0, 600, 0));
+        CPPUNIT_ASSERT_EQUAL(R::stale, R::get_freshness(no_cache, 1, 600, 0));
+    }
+
+    void headers_file_test()
+    {
+        string cache_file = d_cache_dir + "/rv_headers";
+
+        // Headers are saved in a subdirectory of the cache, out of its view
+        CPPUNIT_ASSERT_EQUAL(d_cache_dir + "/.headers/rv_headers.hdrs", R::headers_file_name(cache_file));
+
+        vector<string> hdrs = headers("Content-Type: text/plain", "ETag: \"a long etag value\"");
+        R::save_headers(cache_file, hdrs);
+        R::save_headers(cache_file, headers("ETag: \"b\""));  // a shorter set replaces the first
+
+        vector<string> read;
+        R::read_headers(cache_file, read);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, read.size());
+        CPPUNIT_ASSERT_EQUAL(string("ETag: \"b\""), read[0]);
+
+        unlink(R::headers_file_name(cache_file).c_str());
+        R::read_headers(cache_file, read);
+        CPPUNIT_ASSERT(read.empty());
+    }
+
+    // Without MaxAge, no request is made even though the origin said no-cache
+    void revalidation_off_test()
+    {
+        vector<string> hdrs = headers("Cache-Control: no-cache", "ETag: \"abc\"");
+        cache_resource("old", hdrs, 1000);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        CPPUNIT_ASSERT_EQUAL(-1L, r.get_max_age());
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(0, r.d_requests);
+        CPPUNIT_ASSERT_EQUAL(string("old"), contents(d_fd));
+    }
+
+    void fresh_test()
+    {
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "600");
+
+        vector<string> hdrs = headers("ETag: \"abc\"");
+        cache_resource("old", hdrs, 10);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(0, r.d_requests);
+    }
+
+    void not_modified_test()
+    {
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "60");
+
+        vector<string> hdrs = headers("ETag: \"abc\"", "Last-Modified: Mon, 19 Oct 2020 12:00:00 GMT");
+        cache_resource("old", hdrs, 1000);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        r.d_status = 304;
+        r.d_response_headers = headers("Date: Tue, 20 Oct 2020 12:00:00 GMT");
+        int fd = d_fd;
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(1, r.d_requests);
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, r.d_request_headers.size());
+        CPPUNIT_ASSERT_EQUAL(string("If-None-Match: \"abc\""), r.d_request_headers[0]);
+        CPPUNIT_ASSERT_EQUAL(string("If-Modified-Since: Mon, 19 Oct 2020 12:00:00 GMT"), r.d_request_headers[1]);
+
+        // The cached copy is kept, its headers are updated and it is fresh again
+        CPPUNIT_ASSERT_EQUAL(fd, d_fd);
+        CPPUNIT_ASSERT_EQUAL(string("old"), contents(d_fd));
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, hdrs.size());
+        vector<string> saved;
+        R::read_headers(d_cache_file, saved);
+        CPPUNIT_ASSERT(saved == hdrs);
+        CPPUNIT_ASSERT(headers_age() < 60);
+
+        check_cache_dir();
+    }
+
+    void modified_test()
+    {
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "60");
+
+        vector<string> hdrs = headers("ETag: \"abc\"");
+        cache_resource("old", hdrs, 1000);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        r.d_status = 200;
+        r.d_body = "new";
+        r.d_response_headers = headers("ETag: \"def\"");
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(1, r.d_requests);
+        CPPUNIT_ASSERT_EQUAL(string("new"), contents(d_fd));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, hdrs.size());
+        CPPUNIT_ASSERT_EQUAL(string("ETag: \"def\""), hdrs[0]);
+
+        check_cache_dir();
+    }
+
+    // The stale copy is used now and replaced by a background process
+    void stale_while_revalidate_test()
+    {
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "60");
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.StaleWhileRevalidate", "3600");
+
+        vector<string> hdrs = headers("ETag: \"abc\"");
+        cache_resource("old", hdrs, 1000);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        r.d_status = 200;
+        r.d_body = "new";
+        r.d_response_headers = headers("ETag: \"def\"");
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(0, r.d_requests);  // the request was made by another process
+        CPPUNIT_ASSERT_EQUAL(string("old"), contents(d_fd));
+        CPPUNIT_ASSERT_EQUAL(string("ETag: \"abc\""), hdrs[0]);
+
+        string replaced;
+        for (int i = 0; i < 50 && replaced != "new"; ++i) {
+            int fd = open(d_cache_file.c_str(), O_RDONLY);
+            CPPUNIT_ASSERT(fd != -1);
+            replaced = contents(fd);
+            close(fd);
+            if (replaced != "new") usleep(100000);
+        }
+        CPPUNIT_ASSERT_EQUAL(string("new"), replaced);
+    }
+
+    // A failed request leaves the stale copy in place
+    void error_test()
+    {
+        TheBESKeys::TheKeys()->set_key("RevalidatorTest.MaxAge", "0");
+
+        vector<string> hdrs = headers("ETag: \"abc\"");
+        cache_resource("old", hdrs, 10);
+
+        TestRevalidator r(d_cache, d_cache_file);
+        r.d_status = 500;
+        r.revalidate(d_fd, hdrs);
+
+        CPPUNIT_ASSERT_EQUAL(1, r.d_requests);
+        CPPUNIT_ASSERT_EQUAL(string("old"), contents(d_fd));
+        CPPUNIT_ASSERT_EQUAL(string("ETag: \"abc\""), hdrs[0]);
+    }
+
+    CPPUNIT_TEST_SUITE( BESHttpCacheRevalidatorTest );
+
+    CPPUNIT_TEST(get_header_test);
+    CPPUNIT_TEST(merge_headers_test);
+    CPPUNIT_TEST(cache_control_seconds_test);
+    CPPUNIT_TEST(freshness_lifetime_test);
+    CPPUNIT_TEST(get_freshness_test);
+    CPPUNIT_TEST(headers_file_test);
+    CPPUNIT_TEST(revalidation_off_test);
+    CPPUNIT_TEST(fresh_test);
+    CPPUNIT_TEST(not_modified_test);
+    CPPUNIT_TEST(modified_test);
+    CPPUNIT_TEST(stale_while_revalidate_test);
+    CPPUNIT_TEST(error_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BESHttpCacheRevalidatorTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,cache");
+            break;
+        case 'h': {     // help - show test names
+            std::cerr << "Usage: BESHttpCacheRevalidatorTest has the following tests:" << std::endl;
+            const std::vector<CppUnit::Test*> &tests = BESHttpCacheRevalidatorTest::suite()->getTests();
+            unsigned int prefix_len = BESHttpCacheRevalidatorTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                std::cerr << (*i)->getName().replace(0, prefix_len, "") << std::endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BESHttpCacheRevalidatorTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <GetOpt.h>
+
+#include "BESOpenFileCache.h"
+#include "BESDebug.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+using namespace CppUnit;
+
+// The handles the test 'library' has open
+static set<int> open_handles;
+static int next_handle = 1;
+
+static int open_file()
+{
+    open_handles.insert(next_handle);
+    return next_handle++;
+}
+
+static void close_file(int handle)
+{
+    CPPUNIT_ASSERT(open_handles.erase(handle) == 1);
+}
+
+typedef BESOpenFileCache<int, string> Cache;
+
+class BESOpenFileCacheTest: public TestFixture {
+private:
+    vector<string> d_files;
+
+    // Make a test file and return its name
+    string make_file(const string &name, const string &contents = "data")
+    {
+        string path = string(TEST_BUILD_DIR) + "/open_file_cache_" + name;
+        FILE *fp = fopen(path.c_str(), "w");
+        CPPUNIT_ASSERT(fp);
+        fputs(contents.c_str(), fp);
+        fclose(fp);
+        d_files.push_back(path);
+        return path;
+    }
+
+    static struct stat status(const string &path)
+    {
+        struct stat sb;
+        CPPUNIT_ASSERT(stat(path.c_str(), &sb) == 0);
+        return sb;
+    }
+
+    // Open 'path' the way a handler does
+    static int open(Cache &cache, const string &path)
+    {
+        struct stat sb = status(path);
+        Cache::entry *ent = cache.get(path, sb);
+        if (ent) return ent->handle;
+
+        int handle = open_file();
+        cache.add(path, sb, handle);
+        return handle;
+    }
+
+    static void close(Cache &cache, int handle)
+    {
+        if (!cache.release(handle)) close_file(handle);
+    }
+
+public:
+    BESOpenFileCacheTest()
+    {
+    }
+
+    ~BESOpenFileCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        open_handles.clear();
+    }
+
+    void tearDown()
+    {
+        for (vector<string>::iterator i = d_files.begin(), e = d_files.end(); i != e; ++i)
+            unlink(i->c_str());
+        d_files.clear();
+    }
+
+    CPPUNIT_TEST_SUITE( BESOpenFileCacheTest );
+
+    CPPUNIT_TEST(reuse_test);
+    CPPUNIT_TEST(evict_test);
+    CPPUNIT_TEST(in_use_test);
+    CPPUNIT_TEST(changed_file_test);
+    CPPUNIT_TEST(changed_in_use_test);
+    CPPUNIT_TEST(data_test);
+    CPPUNIT_TEST(clear_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void reuse_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(2);
+        string a = make_file("a");
+
+        int h = open(cache, a);
+        close(cache, h);
+        CPPUNIT_ASSERT_EQUAL(h, open(cache, a));
+        close(cache, h);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, open_handles.size());
+    }
+
+    // The least recently used file is closed
+    void evict_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(2);
+        string a = make_file("a"), b = make_file("b"), c = make_file("c");
+
+        int ha = open(cache, a);
+        close(cache, ha);
+        int hb = open(cache, b);
+        close(cache, hb);
+        close(cache, open(cache, a));   // a is now the most recently used
+        int hc = open(cache, c);
+        close(cache, hc);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, open_handles.size());
+        CPPUNIT_ASSERT(open_handles.count(ha) && open_handles.count(hc));
+        CPPUNIT_ASSERT(!cache.find(hb));
+    }
+
+    // A file that is in use is not closed, even if the cache is too big
+    void in_use_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(1);
+        string a = make_file("a"), b = make_file("b");
+
+        int ha = open(cache, a);
+        int hb = open(cache, b);
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, open_handles.size());
+
+        close(cache, ha);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, open_handles.size());
+        CPPUNIT_ASSERT(open_handles.count(hb));
+        close(cache, hb);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, open_handles.size());
+    }
+
+    void changed_file_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(2);
+        string a = make_file("a");
+
+        int h = open(cache, a);
+        close(cache, h);
+
+        make_file("a", "new data");
+        int h2 = open(cache, a);
+        CPPUNIT_ASSERT(h2 != h);
+        CPPUNIT_ASSERT(!open_handles.count(h));
+        close(cache, h2);
+    }
+
+    // A changed file's old handle is closed when it is released
+    void changed_in_use_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(2);
+        string a = make_file("a");
+
+        int h = open(cache, a);
+        make_file("a", "new data");
+        int h2 = open(cache, a);
+        CPPUNIT_ASSERT(h2 != h);
+        CPPUNIT_ASSERT(open_handles.count(h));
+
+        close(cache, h);
+        CPPUNIT_ASSERT(!open_handles.count(h));
+        close(cache, h2);
+        CPPUNIT_ASSERT(open_handles.count(h2));
+    }
+
+    // Data kept with a file lasts as long as the file is open
+    void data_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(2);
+        string a = make_file("a");
+
+        int h = open(cache, a);
+        cache.find(h)->data = "varids";
+        close(cache, h);
+
+        open(cache, a);
+        CPPUNIT_ASSERT_EQUAL(string("varids"), cache.find(h)->data);
+        close(cache, h);
+    }
+
+    void clear_test()
+    {
+        Cache cache(close_file, "open_file_cache");
+        cache.set_max_entries(4);
+        string a = make_file("a"), b = make_file("b");
+
+        close(cache, open(cache, a));
+        int hb = open(cache, b);
+        cache.clear();
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, open_handles.size());
+        CPPUNIT_ASSERT(open_handles.count(hb));
+
+        // With the cache off, every file is closed when it is released
+        cache.set_max_entries(0);
+        close(cache, hb);
+        CPPUNIT_ASSERT(open_handles.empty());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BESOpenFileCacheTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,open_file_cache");
+            break;
+        case 'h': {     // help - show test names
+            std::cerr << "Usage: BESOpenFileCacheTest has the following tests:" << std::endl;
+            const std::vector<CppUnit::Test*> &tests = BESOpenFileCacheTest::suite()->getTests();
+            unsigned int prefix_len = BESOpenFileCacheTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                std::cerr << (*i)->getName().replace(0, prefix_len, "") << std::endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BESOpenFileCacheTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
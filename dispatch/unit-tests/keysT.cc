@@ -310,6 +310,29 @@ CPPUNIT_TEST_SUITE( keysT );
             CPPUNIT_ASSERT(ret == val);
         }
 
+        cout << "*****************************************" << endl;
+        cout << "read integer keys" << endl;
+        try {
+            // The value ends the string, so the stream is at eof after the
+            // number is read; that is not an error.
+            TheBESKeys::TheKeys()->set_key("BES.INT1=42");
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.INT1", 7) == 42);
+            TheBESKeys::TheKeys()->set_key("BES.INT2", "-3");
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.INT2", 7) == -3);
+            TheBESKeys::TheKeys()->set_key("BES.INT3", "0");
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.INT3", 7) == 0);
+
+            // Values that are not integers, or are empty, get the default
+            TheBESKeys::TheKeys()->set_key("BES.INT4", "many");
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.INT4", 7) == 7);
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.KEY5", 7) == 7);
+            CPPUNIT_ASSERT(TheBESKeys::TheKeys()->read_int_key("BES.NOTFOUND", 7) == 7);
+        }
+        catch (BESError &e) {
+            cerr << e.get_message();
+            CPPUNIT_ASSERT(!"unable to set the key");
+        }
+
         cout << "*****************************************" << endl;
         cout << "Returning from keysT::run" << endl;
     }
@@ -39,6 +39,7 @@ using namespace CppUnit;
 #include <cerrno>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdlib>
 #include <dirent.h>
 #include <GetOpt.h>
@@ -46,6 +47,7 @@ using namespace CppUnit;
 using std::cerr;
 using std::endl;
 using std::ifstream;
+using std::ostringstream;
 using std::string;
 
 #include "config.h"
@@ -127,7 +129,20 @@ public:
     {
     }
 
-    void test_worker(string cache_prefix, string test_file_base, string test_file_suffix)
+    // Read a whole file
+    static string file_contents(const string &file_name)
+    {
+        ifstream strm(file_name.c_str(), std::ios::binary);
+        CPPUNIT_ASSERT( strm );
+        ostringstream oss;
+        oss << strm.rdbuf();
+        return oss.str();
+    }
+
+    // If 'baseline' is not empty, the whole of the uncompressed file is
+    // compared to that file in the cache directory; otherwise only its first
+    // line is checked.
+    void test_worker(string cache_prefix, string test_file_base, string test_file_suffix, string baseline = "")
     {
         DBG(cerr << __func__ << "() - BEGIN" << endl);
 
@@ -170,6 +185,14 @@ public:
                 DBG(cerr << __func__ << "() - expected contents = " << should_be << endl);
                 DBG(cerr << __func__ << "() -   result contents = " << sline << endl);
                 CPPUNIT_ASSERT( sline == should_be );
+
+                if (!baseline.empty()) {
+                    string expected = file_contents(cache_dir + baseline);
+                    string contents = file_contents(cache_file_name);
+                    DBG(cerr << __func__ << "() - expected " << expected.size() << " bytes, got " << contents.size() << endl);
+                    CPPUNIT_ASSERT( contents.size() == expected.size() );
+                    CPPUNIT_ASSERT( contents == expected );
+                }
             }
             catch (BESError &e) {
                 DBG(cerr << __func__ << "() - Caught BESError. msg: " << e.get_message() << endl);
@@ -237,6 +260,19 @@ public:
         DBG(cerr << __func__ << "() - END" << endl);
     }
 
+    // A multi-member (BGZF) file, decompressed using several threads
+    void bgzf_test()
+    {
+        DBG(cerr << __func__ << "() - BEGIN" << endl);
+        string cache_prefix = "zcache";
+        string test_file_base = "/bgzf_testfile.txt";
+        string test_file_suffix = ".gz";
+
+        // The file has many members; check that each one lands in its place
+        test_worker(cache_prefix, test_file_base, test_file_suffix, "/bgzf_testfile.txt.baseline");
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
     void Z_test()
     {
         DBG(cerr << __func__ << "() - BEGIN" << endl);
@@ -265,6 +301,7 @@ public:
 
     CPPUNIT_TEST( test_disabled_uncompress_cache );
     CPPUNIT_TEST( gz_test );
+    CPPUNIT_TEST( bgzf_test );
     CPPUNIT_TEST( libz2_test );
     CPPUNIT_TEST( Z_test );
 
@@ -28,6 +28,8 @@
 #include <cassert>
 #include <sstream>
 #include <memory>
+#include <vector>
+#include <algorithm>
 
 #include <BaseType.h>
 #include <Int32.h>
@@ -44,157 +46,138 @@
 #include <BESDebug.h>
 
 #include "BBoxFunction.h"
-#include "Odometer.h"
 #include "roi_util.h"
 
-// Set this to 1 to use special code for arrays of rank 1 and 2.
-// set it to 0 (... comment out, etc.) to use the general code for
-// all cases. I've run the unit and regression tests both ways.
-// jhrg 3/2/15
-#define UNWIND_BBOX_CODE 1
-
 using namespace std;
 using namespace libdap;
 
 namespace functions {
 
-unique_ptr<Array> bbox_helper(double min_value, double max_value, Array* the_array)
+/**
+ * Find the per-dimension minimum and maximum indices of the values in
+ * [min_value, max_value]. This is a single pass over the array's values,
+ * one row (the rightmost dimension) at a time. Within a row only the first
+ * and last matching values are needed, so the scan from the right stops at
+ * the last match.
+ *
+ * @return True if any values were found, false otherwise
+ */
+template<typename T>
+static bool bbox_indices(const T *values, const vector<unsigned int> &shape, double min_value, double max_value,
+    vector<unsigned int> &min_index, vector<unsigned int> &max_index)
 {
-    // Get the values as doubles
-    vector<double> the_values;
-    extract_double_array(the_array, the_values); // This function sets the size of the_values
+    unsigned int rank = shape.size();
+    unsigned long long length = 1;
+    for (unsigned int d = 0; d < rank; ++d)
+        length *= shape[d];
+    if (length == 0) return false;
 
-    // Build the response
-    unsigned int rank = the_array->dimensions();
-    unique_ptr<Array> response = roi_bbox_build_empty_bbox(rank, the_array->name());
+    const unsigned int X = shape[rank - 1];
+    const unsigned long long rows = length / X;
 
-    switch (rank) {
-    case 1: {
-        unsigned int X = the_array->dimension_size(the_array->dim_begin());
-        bool found_start = false;
-        unsigned int start = 0;
-        for (unsigned int i = 0; i < X && !found_start; ++i) {
-            if (the_values[i] >= min_value && the_values[i] <= max_value) {
-                start = i;
-                found_start = true;
-            }
-        }
-        // ! found_start == error?
-        if (!found_start) {
-            ostringstream oss("In function bbox(): No values between ", std::ios::ate);
-            oss << min_value << " and " << max_value << " were found in the array '" << the_array->name() << "'";
-            throw Error(oss.str());
-        }
-        bool found_stop = false;
-        unsigned int stop = X - 1;
-        for (int i = X - 1; i >= 0 && !found_stop; --i) {
-            if (the_values[i] >= min_value && the_values[i] <= max_value) {
-                stop = (unsigned int) (i);
-                found_stop = true;
-            }
-        }
-        // ! found_stop == error?
-        if (!found_stop) throw InternalErr(__FILE__, __LINE__, "In BBoxFunction: Found start but not stop.");
+    vector<unsigned int> outer(rank - 1, 0);   // indices of the current row
+    bool found = false;
+    for (unsigned long long row = 0; row < rows; ++row) {
+        const T *r = values + row * X;
 
-        Structure* slice = roi_bbox_build_slice(start, stop, the_array->dimension_name(the_array->dim_begin()));
-        response->set_vec_nocopy(0, slice);
-        break;
-    }
-    case 2: {
-        // quick reminder: rows == y == j; cols == x == i
-        Array::Dim_iter rows = the_array->dim_begin(), cols = the_array->dim_begin() + 1;
-        unsigned int Y = the_array->dimension_size(rows);
-        unsigned int X = the_array->dimension_size(cols);
-        unsigned int x_start = X - 1; //= 0;
-        unsigned int y_start = 0;
-        bool found_y_start = false;
-        // Must look at all rows to find the 'left-most' col with value
-        for (unsigned int j = 0; j < Y; ++j) {
-            bool found_x_start = false;
-            for (unsigned int i = 0; i < X && !found_x_start; ++i) {
-                unsigned int ind = j * X + i;
-                if (the_values[ind] >= min_value && the_values[ind] <= max_value) {
-                    x_start = min(i, x_start);
-                    found_x_start = true;
-                    if (!found_y_start) {
-                        y_start = j;
-                        found_y_start = true;
-                    }
+        unsigned int first = 0;
+        while (first < X && !(r[first] >= min_value && r[first] <= max_value))
+            ++first;
+
+        if (first < X) {
+            unsigned int last = X - 1;
+            while (last > first && !(r[last] >= min_value && r[last] <= max_value))
+                --last;
+
+            if (found) {
+                min_index[rank - 1] = min(min_index[rank - 1], first);
+                max_index[rank - 1] = max(max_index[rank - 1], last);
+                for (unsigned int d = 0; d < rank - 1; ++d) {
+                    min_index[d] = min(min_index[d], outer[d]);
+                    max_index[d] = max(max_index[d], outer[d]);
                 }
             }
-        }
-        // ! found_y_start == error?
-        if (!found_y_start) {
-            ostringstream oss("In function bbox(): No values between ", std::ios::ate);
-            oss << min_value << " and " << max_value << " were found in the array '" << the_array->name() << "'";
-            throw Error(oss.str());
-        }
-        unsigned int x_stop = 0;
-        unsigned int y_stop = 0;
-        bool found_y_stop = false;
-        // Must look at all rows to find the 'left-most' col with value
-        for (int j = Y - 1; j >= (int) (y_start); --j) {
-            bool found_x_stop = false;
-            for (int i = X - 1; i >= 0 && !found_x_stop; --i) {
-                unsigned int ind = j * X + i;
-                if (the_values[ind] >= min_value && the_values[ind] <= max_value) {
-                    x_stop = max((unsigned int) (i), x_stop);
-                    found_x_stop = true;
-                    if (!found_y_stop) {
-                        y_stop = j;
-                        found_y_stop = true;
-                    }
-                }
+            else {
+                min_index[rank - 1] = first;
+                max_index[rank - 1] = last;
+                for (unsigned int d = 0; d < rank - 1; ++d)
+                    min_index[d] = max_index[d] = outer[d];
+                found = true;
             }
         }
-        // ! found_stop == error?
-        if (!found_y_stop) throw InternalErr(__FILE__, __LINE__, "In BBoxFunction: Found start but not stop.");
 
-        response->set_vec_nocopy(0, roi_bbox_build_slice(y_start, y_stop, the_array->dimension_name(rows)));
-        response->set_vec_nocopy(1, roi_bbox_build_slice(x_start, x_stop, the_array->dimension_name(cols)));
-        break;
-    }
-    default: {
-        Odometer::shape shape(rank); // the shape of 'the_array'
-        int j = 0;
-        for (Array::Dim_iter i = the_array->dim_begin(), e = the_array->dim_end(); i != e; ++i) {
-            shape.at(j++) = the_array->dimension_size(i);
-        }
-        Odometer odometer(shape);
-        Odometer::shape indices(rank); // Holds a given index
-        Odometer::shape min = shape; // Holds the minimum values for each of rank dimensions
-        Odometer::shape max(rank, 0); // ... and the maximum. min and max define the bounding box
-        // NB: shape is initialized with the size of the array
-        do {
-            if (the_values[odometer.offset()] >= min_value && the_values[odometer.offset()] <= max_value) {
-                // record this index
-                odometer.indices(indices);
-                Odometer::shape::iterator m = min.begin();
-                Odometer::shape::iterator x = max.begin();
-                for (Odometer::shape::iterator i = indices.begin(), e = indices.end(); i != e; ++i, ++m, ++x) {
-                    if (*i < *m) *m = *i;
-
-                    if (*i > *x) *x = *i;
-                }
-            }
-        } while (odometer.next() != odometer.end());
-        // cheap test for 'did we find any values.' If we did, then the
-        // min index will have to be less than the shape (which is the
-        // size of the array). We only need to test one of the indices.
-        if (min[0] == shape[0]) {
-            ostringstream oss("In function bbox(): No values between ", std::ios::ate);
-            oss << min_value << " and " << max_value << " were found in the array '" << the_array->name() << "'";
-            throw Error(oss.str());
-        }
-        Odometer::shape::iterator m = min.begin();
-        Odometer::shape::iterator x = max.begin();
-        Array::Dim_iter d = the_array->dim_begin();
-        for (unsigned int i = 0; i < rank; ++i, ++m, ++x, ++d) {
-            response->set_vec_nocopy(i, roi_bbox_build_slice(*m, *x, the_array->dimension_name(d)));
+        // Advance to the next row
+        for (int d = (int) rank - 2; d >= 0; --d) {
+            if (++outer[d] < shape[d]) break;
+            outer[d] = 0;
         }
+    }
+
+    return found;
+}
+
+unique_ptr<Array> bbox_helper(double min_value, double max_value, Array* the_array)
+{
+    unsigned int rank = the_array->dimensions();
+    vector<unsigned int> shape(rank);
+    int j = 0;
+    for (Array::Dim_iter i = the_array->dim_begin(), e = the_array->dim_end(); i != e; ++i) {
+        shape.at(j++) = the_array->dimension_size(i);
+    }
+
+    // Scan the values in place, using their native type, instead of copying
+    // them to a vector<double> first.
+    vector<unsigned int> min_index(rank), max_index(rank);
+    bool found = false;
+    char *buf = the_array->get_buf();
+    switch (the_array->var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        found = bbox_indices(reinterpret_cast<dods_byte*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_int8_c:
+        found = bbox_indices(reinterpret_cast<dods_int8*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_int16_c:
+        found = bbox_indices(reinterpret_cast<dods_int16*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_uint16_c:
+        found = bbox_indices(reinterpret_cast<dods_uint16*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_int32_c:
+        found = bbox_indices(reinterpret_cast<dods_int32*>(buf), shape, min_value, max_value, min_index, max_index);
         break;
-    } // default
-    } // switch
+    case dods_uint32_c:
+        found = bbox_indices(reinterpret_cast<dods_uint32*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_int64_c:
+        found = bbox_indices(reinterpret_cast<dods_int64*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_uint64_c:
+        found = bbox_indices(reinterpret_cast<dods_uint64*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_float32_c:
+        found = bbox_indices(reinterpret_cast<dods_float32*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    case dods_float64_c:
+        found = bbox_indices(reinterpret_cast<dods_float64*>(buf), shape, min_value, max_value, min_index, max_index);
+        break;
+    default:
+        throw InternalErr(__FILE__, __LINE__, "In function bbox(): Type " + the_array->var()->type_name() + " not handled.");
+    }
+
+    if (!found) {
+        ostringstream oss("In function bbox(): No values between ", std::ios::ate);
+        oss << min_value << " and " << max_value << " were found in the array '" << the_array->name() << "'";
+        throw Error(oss.str());
+    }
+
+    // Build the response
+    unique_ptr<Array> response = roi_bbox_build_empty_bbox(rank, the_array->name());
+    Array::Dim_iter d = the_array->dim_begin();
+    for (unsigned int i = 0; i < rank; ++i, ++d) {
+        response->set_vec_nocopy(i, roi_bbox_build_slice(min_index[i], max_index[i], the_array->dimension_name(d)));
+    }
 
     response->set_read_p(true);
     response->set_send_p(true);
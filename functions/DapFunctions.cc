@@ -33,6 +33,7 @@
 #include <BESRequestHandlerList.h>
 
 #include <BESDebug.h>
+#include <TheBESKeys.h>
 
 #include "GeoGridFunction.h"
 #include "GridFunction.h"
@@ -51,6 +52,7 @@
 #include "RangeFunction.h"
 #include "BBoxCombFunction.h"
 #include "ScaleGrid.h"
+#include "GridMapCache.h"
 #include "TestFunction.h"
 
 #include "DapFunctionsRequestHandler.h"
@@ -102,6 +104,17 @@ void DapFunctions::initialize(const string &modname)
     GDALAllRegister();
     OGRRegisterAll();
 
+    // Values > 1 make scale_grid() and friends use GDAL's multithreaded warper
+    set_scale_threads(TheBESKeys::TheKeys()->read_int_key("BES.functions.ScaleThreads", 1));
+
+    // If true, linear_scale() returns Float32 values for Float32 variables
+    set_linear_scale_float32(TheBESKeys::TheKeys()->read_bool_key("BES.functions.LinearScaleFloat32", false));
+
+    // Number of Grid map vectors each BES process caches for grid() and
+    // geogrid(); zero disables the cache
+    int map_cache_entries = TheBESKeys::TheKeys()->read_int_key("BES.functions.MapCacheEntries", 0);
+    if (map_cache_entries > 0) set_map_cache_entries(map_cache_entries);
+
     // What to do with the orig error handler? Pitch it. jhrg 10/17/16
     /*CPLErrorHandler orig_err_handler =*/ (void) CPLSetErrorHandler(CPLQuietErrorHandler);
 
@@ -36,6 +36,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include <Array.h>
 #include <Grid.h>
@@ -45,6 +46,7 @@
 #include <debug.h>
 
 #include "GSEClause.h"
+#include "GridMapCache.h"
 #include "parser.h"
 #include "gse.tab.hh"
 
@@ -94,57 +96,106 @@ GSEClause::set_map_min_max_value(T min, T max)
     d_map_max_value = oss2.str();
 }
 
-// Read the map array, scan, set start and stop.
+// Starting at 'start', scan forward until the comparison is true and set
+// 'start' to that location. Note that each clause applies to exactly one
+// map. The 'i <= end' test keeps us from setting start _past_ the end ;-)
+// Then scan backward from 'stop' to set 'stop'. We scan all the way to the
+// actual start although it would probably work to stop at 'i >= start'.
+template<class T>
+static void
+scan_start_stop(const T *vals, relop op, double value, int &start, int &stop)
+{
+    int i = start;
+    int end = stop;
+    while (i <= end && !compare<T>(vals[i], op, value))
+        i++;
+
+    start = i;
+
+    i = end;
+    while (i >= 0 && !compare<T>(vals[i], op, value))
+        i--;
+
+    stop = i;
+}
+
+// The same as scan_start_stop() but for maps whose values are monotonic
+// and the ordering operators. For those the comparison is true for either
+// a prefix or a suffix of the map, so the boundary can be found with a
+// binary search and start and stop set from it.
+template<class T>
+static void
+search_start_stop(const T *vals, int length, MapDirection direction, relop op, double value, int &start, int &stop)
+{
+    bool less = (op == dods_less_op || op == dods_less_equal_op);
+    bool prefix = (direction == map_ascending) == less;
+
+    // Find 'boundary', the first index where the result of the comparison
+    // differs from its result for the prefix.
+    int lo = 0, hi = length;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (compare<T>(vals[mid], op, value) == prefix)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    int boundary = lo;
+
+    int end = stop;
+    if (prefix) {
+        if (start <= end && start >= boundary)
+            start = end + 1;
+        stop = min(end, boundary - 1);
+    }
+    else {
+        if (start <= end)
+            start = (max(start, boundary) <= end) ? max(start, boundary) : end + 1;
+        stop = (end >= boundary) ? end : -1;
+    }
+}
+
+static bool
+is_ordering_op(relop op)
+{
+    return op == dods_greater_op || op == dods_greater_equal_op || op == dods_less_op || op == dods_less_equal_op;
+}
+
+// Use the map's values (no copy), set start and stop.
 template<class T>
 void
 GSEClause::set_start_stop()
 {
-    T *vals = new T[d_map->length()];
-    d_map->value(vals);
+    const T *vals = reinterpret_cast<T*>(d_map->get_buf());
+    int length = d_map->length();
 
     // Set the map's max and min values for use in error messages (it's a lot
     // easier to do here, now, than later... 9/20/2001 jhrg)
     set_map_min_max_value<T>(vals[d_start], vals[d_stop]);
 
-    // Starting at the current start point in the map (initially index position
-    // zero), scan forward until the comparison is true. Set the new value
-    // of d_start to that location. Note that each clause applies to exactly
-    // one map. The 'i <= end' test keeps us from setting start _past_ the
-    // end ;-)
-    int i = d_start;
-    int end = d_stop;
-    while (i <= end && !compare<T>(vals[i], d_op1, d_value1))
-        i++;
-
-    d_start = i;
+    // Maps that are monotonic can be searched; the direction of cached maps
+    // is already known.
+    MapDirection direction = map_not_monotonic;
+    if (is_ordering_op(d_op1) && (d_op2 == dods_nop_op || is_ordering_op(d_op2))) {
+        const CachedMap *cached = get_cached_map(d_map);
+        direction = cached ? cached->direction() : map_direction(vals, length);
+    }
 
-    // Now scan backward from the end. We scan all the way to the actual start
-    // although it would probably work to stop at 'i >= d_start'.
-    i = end;
-    while (i >= 0 && !compare<T>(vals[i], d_op1, d_value1))
-        i--;
-    d_stop = i;
+    if (direction != map_not_monotonic)
+        search_start_stop<T>(vals, length, direction, d_op1, d_value1, d_start, d_stop);
+    else
+        scan_start_stop<T>(vals, d_op1, d_value1, d_start, d_stop);
 
     // Every clause must have one operator but the second is optional since
-    // the more complex form of a clause is optional. That is, the above two
-    // loops took care of constraints like 'x < 7' but we need the following
+    // the more complex form of a clause is optional. That is, the above
+    // took care of constraints like 'x < 7' but we need the following
     // for ones like '3 < x < 7'.
     if (d_op2 != dods_nop_op) {
-        int i = d_start;
-        int end = d_stop;
-        while (i <= end && !compare<T>(vals[i], d_op2, d_value2))
-            i++;
-
-        d_start = i;
-
-        i = end;
-        while (i >= 0 && !compare<T>(vals[i], d_op2, d_value2))
-            i--;
-
-        d_stop = i;
+        if (direction != map_not_monotonic)
+            search_start_stop<T>(vals, length, direction, d_op2, d_value2, d_start, d_stop);
+        else
+            scan_start_stop<T>(vals, d_op2, d_value2, d_start, d_stop);
     }
-    
-    delete[] vals;
 }
 
 void
@@ -32,6 +32,7 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>  //  for find_if
+#include <functional>
 
 //#define DODS_DEBUG
 //#define DODS_DEBUG2
@@ -277,22 +278,33 @@ void GeoConstraint::find_longitude_indeces(double left, double right,
     in the grid's latitude map of the top bounding box edge. Uses a closed
     interval for the test.
     @param  latitude_index_bottom Value-result parameter for the bottom edge
-    index. */
+    index.
+
+    @note If the direction of the latitude values is known (see
+    set_lat_direction()) and matches the sense, use a binary search in
+    place of the scans. */
 void GeoConstraint::find_latitude_indeces(double top, double bottom,
         LatitudeSense sense,
         int &latitude_index_top,
         int &latitude_index_bottom) const
 {
     int i, j;
+    double *lat_end = d_lat + d_lat_length;
 
     if (sense == normal) {
-	i = 0;
-        while (i < d_lat_length - 1 && top < d_lat[i])
-            ++i;
-
-        j = d_lat_length - 1;
-        while (j > 0 && bottom > d_lat[j])
-            --j;
+        if (d_lat_direction == map_descending) {
+            i = min((int)(lower_bound(d_lat, lat_end, top, greater<double>()) - d_lat), d_lat_length - 1);
+            j = max((int)(upper_bound(d_lat, lat_end, bottom, greater<double>()) - d_lat) - 1, 0);
+        }
+        else {
+            i = 0;
+            while (i < d_lat_length - 1 && top < d_lat[i])
+                ++i;
+
+            j = d_lat_length - 1;
+            while (j > 0 && bottom > d_lat[j])
+                --j;
+        }
 
         if (d_lat[i] == top)
             latitude_index_top = i;
@@ -306,13 +318,19 @@ void GeoConstraint::find_latitude_indeces(double top, double bottom,
                 (j + 1) < d_lat_length - 1 ? j + 1 : d_lat_length - 1;
     }
     else {
-        i = d_lat_length - 1;
-        while (i > 0 && d_lat[i] > top)
-            --i;
-
-        j = 0;
-        while (j < d_lat_length - 1 && d_lat[j] < bottom)
-            ++j;
+        if (d_lat_direction == map_ascending) {
+            i = max((int)(upper_bound(d_lat, lat_end, top) - d_lat) - 1, 0);
+            j = min((int)(lower_bound(d_lat, lat_end, bottom) - d_lat), d_lat_length - 1);
+        }
+        else {
+            i = d_lat_length - 1;
+            while (i > 0 && d_lat[i] > top)
+                --i;
+
+            j = 0;
+            while (j < d_lat_length - 1 && d_lat[j] < bottom)
+                ++j;
+        }
 
         if (d_lat[i] == top)
             latitude_index_top = i;
@@ -550,6 +568,7 @@ void GeoConstraint::reorder_data_longitude_axis(Array &a, Array::Dim_iter lon_di
 GeoConstraint::GeoConstraint()
         : d_array_data(0), d_array_data_size(0),
         d_lat(0), d_lon(0), d_lat_length(0), d_lon_length(0),
+        d_lat_direction(map_not_monotonic),
 	d_latitude_index_top(0),
 	d_latitude_index_bottom(0),
 	d_longitude_index_left(0),
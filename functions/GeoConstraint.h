@@ -29,6 +29,9 @@
 #include <string>
 #include <sstream>
 #include <set>
+#include <vector>
+
+#include "functions_util.h"
 
 namespace libdap {
 class BaseType;
@@ -123,6 +126,7 @@ private:
     double *d_lon;              //< Holds the longitude values
     int d_lat_length;           //< Elements (not bytes) in the latitude vector
     int d_lon_length;           //< ... longitude vector
+    MapDirection d_lat_direction;   //< Direction of d_lat, if known
 
     // These four are indexes of the constraint
     int d_latitude_index_top;
@@ -237,6 +241,12 @@ public:
     {
         d_lon = lon;
     }
+    /** If the direction of the latitude values is known, the latitude
+        indexes can be found using a binary search. */
+    void set_lat_direction(MapDirection direction)
+    {
+        d_lat_direction = direction;
+    }
 
     int get_lat_length() const
     {
@@ -39,6 +39,7 @@
 #include "GridGeoConstraint.h"
 #include "gse_parser.h"
 #include "grid_utils.h"
+#include "GridMapCache.h"
 
 using namespace libdap;
 
@@ -141,7 +142,13 @@ function_geogrid(int argc, BaseType *argv[], DDS &, BaseType **btpp)
     while (i != l_grid->map_end())
         (*i++)->set_send_p(true);
 
+    // Maps found in the map cache are loaded and marked as read so they
+    // are not read again.
+    load_cached_maps(l_grid);
+
     l_grid->read();
+
+    cache_grid_maps(l_grid);
     // Calling read() above sets the read_p flag for the entire grid; clear it
     // for the grid's array so that later on the code will be sure to read it
     // under all circumstances.
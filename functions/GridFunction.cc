@@ -40,6 +40,7 @@
 #include "GridFunction.h"
 #include "gse_parser.h"
 #include "grid_utils.h"
+#include "GridMapCache.h"
 
 using namespace libdap;
 
@@ -122,8 +123,14 @@ function_grid(int argc, BaseType *argv[], DDS &, BaseType **btpp)
     while (i != l_grid->map_end())
         (*i++)->set_send_p(true);
 
+    // Maps found in the map cache are loaded and marked as read so they
+    // are not read again.
+    load_cached_maps(l_grid);
+
     l_grid->read();
 
+    cache_grid_maps(l_grid);
+
     DBG(cerr << "grid: past map read" << endl);
 
     // argv[1..n] holds strings; each are little expressions to be parsed.
@@ -32,6 +32,8 @@
 
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 
 //#define DODS_DEBUG
 
@@ -44,12 +46,36 @@
 #include <debug.h>
 
 #include "GridGeoConstraint.h"
+#include "GridMapCache.h"
 
 using namespace std;
 using namespace libdap;
 
 namespace functions {
 
+/** Get the values of a latitude or longitude map as doubles, using the
+    map cache when it holds them.
+
+    @param map The map
+    @param direction If not null, value-result parameter for the direction
+    of the values if they came from the cache, otherwise map_not_monotonic.
+    @return The values; the caller must delete[] them. */
+static double *get_map_values(Array *map, MapDirection *direction = 0)
+{
+    const CachedMap *cached = get_cached_map(map);
+    if (!cached) {
+        if (direction) *direction = map_not_monotonic;
+        return extract_double_array(map);   // throws Error
+    }
+
+    const vector<double> &values = cached->values();
+    double *dest = new double[values.size()];
+    copy(values.begin(), values.end(), dest);
+    if (direction) *direction = cached->direction();
+
+    return dest;
+}
+
 /** @brief Initialize GeoConstraint with a Grid.
 
     @param grid Set the GeoConstraint to use this Grid variable. It is the
@@ -141,7 +167,9 @@ bool GridGeoConstraint::build_lat_lon_maps()
             if (!d_latitude->read_p())
                 d_latitude->read();
 
-            set_lat(extract_double_array(d_latitude));   // throws Error
+            MapDirection direction;
+            set_lat(get_map_values(d_latitude, &direction));   // throws Error
+            set_lat_direction(direction);
             set_lat_length(d_latitude->length());
 
             set_lat_dim(d);
@@ -157,7 +185,7 @@ bool GridGeoConstraint::build_lat_lon_maps()
             if (!d_longitude->read_p())
                 d_longitude->read();
 
-            set_lon(extract_double_array(d_longitude));
+            set_lon(get_map_values(d_longitude));
             set_lon_length(d_longitude->length());
 
             set_lon_dim(d);
@@ -195,7 +223,9 @@ bool GridGeoConstraint::build_lat_lon_maps(Array *lat, Array *lon)
             if (!d_latitude->read_p())
                 d_latitude->read();
 
-            set_lat(extract_double_array(d_latitude));   // throws Error
+            MapDirection direction;
+            set_lat(get_map_values(d_latitude, &direction));   // throws Error
+            set_lat_direction(direction);
             set_lat_length(d_latitude->length());
 
             set_lat_dim(d);
@@ -208,7 +238,7 @@ bool GridGeoConstraint::build_lat_lon_maps(Array *lat, Array *lon)
             if (!d_longitude->read_p())
                 d_longitude->read();
 
-            set_lon(extract_double_array(d_longitude));
+            set_lon(get_map_values(d_longitude));
             set_lon_length(d_longitude->length());
 
             set_lon_dim(d);
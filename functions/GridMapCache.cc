@@ -0,0 +1,183 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ implementation of the OPeNDAP
+// Hyrax data server
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Authors: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+
+#include "config.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <Array.h>
+#include <Grid.h>
+#include <util.h>
+
+#include <ObjMemCache.h>
+#include <CacheKey.h>
+
+#include <BESDebug.h>
+
+#include "GridMapCache.h"
+
+using namespace std;
+using namespace libdap;
+
+namespace functions {
+
+static ObjMemCache *map_cache = 0;
+
+/**
+ * Build the cache key for a map. Only whole (unconstrained), one
+ * dimensional numeric maps of datasets that are files are cached. The key
+ * holds the dataset's modification time and size, so the maps of a
+ * dataset that has been replaced are not used.
+ *
+ * @return The key or an empty string if the map cannot be cached.
+ */
+static string map_cache_key(Array *map)
+{
+    if (map->dataset().empty() || map->dimensions() != 1 || !map->var()->is_simple_type()
+        || map->var()->type() == dods_str_c || map->var()->type() == dods_url_c)
+        return "";
+
+    if (map->length() != map->dimension_size(map->dim_begin(), false))
+        return "";
+
+    string version = dataset_version(map->dataset());
+    if (version.empty()) return "";
+
+    return map->dataset() + "#" + version + "#" + map->FQN();
+}
+
+/**
+ * @brief Copy a map's values
+ * @param map A map that has been read
+ */
+CachedMap::CachedMap(Array *map) :
+    d_buf(map->width(true))
+{
+    if (!d_buf.empty())
+        memcpy(&d_buf[0], map->get_buf(), d_buf.size());
+
+    extract_double_array(map, d_values);
+    d_direction = map_direction(d_values);
+}
+
+CachedMap::~CachedMap()
+{
+}
+
+/**
+ * @brief Load the cached values into a map and mark it as read
+ * @param map The map; it must be the same size as the cached map
+ * @return True if the values were loaded, false if the sizes differ
+ */
+bool CachedMap::load_values(Array *map) const
+{
+    if ((vector<char>::size_type) map->width(true) != d_buf.size() || d_buf.empty())
+        return false;
+
+    map->val2buf(const_cast<char*>(&d_buf[0]));
+    map->set_read_p(true);
+
+    return true;
+}
+
+/**
+ * @brief Set the number of map vectors cached by each BES process
+ * @param entries Zero disables the cache
+ */
+void set_map_cache_entries(unsigned int entries)
+{
+    if (entries > 0 && !map_cache) {
+        map_cache = new ObjMemCache(entries, 0.2);
+        BESDEBUG("functions", "set_map_cache_entries() - Caching up to " << entries << " map vectors." << endl);
+    }
+}
+
+/**
+ * @brief Get the cached values of a map
+ * @param map The map
+ * @return The cached values, which are owned by the cache, or null if the
+ * map is not cached. Don't hold onto the pointer; adding maps to the cache
+ * may purge it.
+ */
+const CachedMap *get_cached_map(Array *map)
+{
+    if (!map_cache) return 0;
+
+    string key = map_cache_key(map);
+    if (key.empty()) return 0;
+
+    return dynamic_cast<CachedMap*>(map_cache->get(key));
+}
+
+/**
+ * @brief Load cached values into a Grid's maps
+ *
+ * Call this before reading the Grid. Maps loaded from the cache are
+ * marked as read so that (for most handlers) Grid::read() won't read
+ * them again.
+ *
+ * @param grid The Grid
+ */
+void load_cached_maps(Grid *grid)
+{
+    if (!map_cache) return;
+
+    for (Grid::Map_iter m = grid->map_begin(), e = grid->map_end(); m != e; ++m) {
+        Array *map = static_cast<Array*>(*m);
+        if (map->read_p()) continue;
+
+        const CachedMap *cached = get_cached_map(map);
+        if (cached && cached->load_values(map)) {
+            BESDEBUG("functions", "load_cached_maps() - Loaded " << map->FQN() << " from the cache." << endl);
+        }
+    }
+}
+
+/**
+ * @brief Add the (read) maps of a Grid to the cache
+ *
+ * Call this after reading the Grid and before applying any constraints
+ * to its maps.
+ *
+ * @param grid The Grid
+ */
+void cache_grid_maps(Grid *grid)
+{
+    if (!map_cache) return;
+
+    for (Grid::Map_iter m = grid->map_begin(), e = grid->map_end(); m != e; ++m) {
+        Array *map = static_cast<Array*>(*m);
+        if (!map->read_p()) continue;
+
+        string key = map_cache_key(map);
+        if (key.empty() || map_cache->get(key)) continue;
+
+        map_cache->add(new CachedMap(map), key);
+    }
+}
+
+} // namespace functions
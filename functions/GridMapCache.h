@@ -0,0 +1,83 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of bes, A C++ implementation of the OPeNDAP
+// Hyrax data server
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Authors: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _grid_map_cache_h
+#define _grid_map_cache_h 1
+
+#include <vector>
+
+#include <DapObj.h>
+
+#include "functions_util.h"
+
+namespace libdap {
+class Array;
+class Grid;
+}
+
+namespace functions {
+
+/**
+ * The values of a Grid's map vector, held in a per-process cache so that
+ * repeated grid() and geogrid() calls on a dataset do not read the map
+ * again and do not have to test the values to see if they are monotonic.
+ *
+ * @see load_cached_maps(), cache_grid_maps()
+ */
+class CachedMap: public libdap::DapObj {
+private:
+    std::vector<char> d_buf;        // The map's values, as read
+    std::vector<double> d_values;   // ... as doubles
+    MapDirection d_direction;
+
+    CachedMap(const CachedMap &);
+    CachedMap &operator=(const CachedMap &);
+
+public:
+    CachedMap(libdap::Array *map);
+    virtual ~CachedMap();
+
+    const std::vector<double> &values() const
+    {
+        return d_values;
+    }
+
+    MapDirection direction() const
+    {
+        return d_direction;
+    }
+
+    bool load_values(libdap::Array *map) const;
+};
+
+void set_map_cache_entries(unsigned int entries);
+
+const CachedMap *get_cached_map(libdap::Array *map);
+
+void load_cached_maps(libdap::Grid *grid);
+void cache_grid_maps(libdap::Grid *grid);
+
+} // namespace functions
+
+#endif // _grid_map_cache_h
@@ -26,8 +26,10 @@
 #include "config.h"
 
 #include <sstream>
+#include <memory>
 
 #include <BaseType.h>
+#include <Float32.h>
 #include <Float64.h>
 #include <Str.h>
 #include <Array.h>
@@ -144,12 +146,136 @@ static double get_missing_value(BaseType *var)
     return get_attribute_double_value(var, "missing_value");
 }
 
+// If true, Float32 sources are scaled to Float32 instead of Float64
+static bool linear_scale_float32 = false;
+
+/**
+ * @brief Should linear_scale() preserve Float32?
+ *
+ * By default the scaled values are always Float64. When this is set,
+ * Float32 Arrays, Grids and scalars are scaled to Float32, halving the
+ * size of the result. DapFunctions::initialize() sets this from
+ * BES.functions.LinearScaleFloat32.
+ */
+void set_linear_scale_float32(bool state)
+{
+    linear_scale_float32 = state;
+}
+
+/**
+ * @brief The linear_scale() kernel
+ *
+ * Scale 'length' values from 'src' into 'dest'. The loop body has no
+ * branches (the missing value test is a select), so the compiler can
+ * vectorize it for each source/destination type pair. Values equal to
+ * the missing value, compared as doubles, are copied unscaled.
+ *
+ * @param src The source values
+ * @param dest The result; must hold at least 'length' values
+ * @param length The number of values
+ * @param m The slope
+ * @param b The y intercept
+ * @param missing The missing value
+ * @param use_missing If false, ignore 'missing'
+ */
+template<typename T, typename D>
+static void linear_scale_kernel(const T *src, D *dest, unsigned long length, double m, double b, double missing,
+    bool use_missing)
+{
+    if (use_missing) {
+        // Compare as doubles; the missing value may not be a value of type
+        // T (e.g., -9999 for Byte data or -9999.5 for Int16 data).
+        const D missing_d = static_cast<D>(missing);
+        for (unsigned long i = 0; i < length; ++i)
+            dest[i] = (static_cast<double>(src[i]) == missing) ? missing_d : static_cast<D>(src[i] * m + b);
+    }
+    else {
+        for (unsigned long i = 0; i < length; ++i)
+            dest[i] = static_cast<D>(src[i] * m + b);
+    }
+}
+
+template<typename D>
+static void linear_scale_values(Array &source, D *dest, double m, double b, double missing, bool use_missing)
+{
+    unsigned long length = source.length();
+    char *buf = source.get_buf();
+
+    switch (source.var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        linear_scale_kernel(reinterpret_cast<dods_byte*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_int8_c:
+        linear_scale_kernel(reinterpret_cast<dods_int8*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_int16_c:
+        linear_scale_kernel(reinterpret_cast<dods_int16*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_uint16_c:
+        linear_scale_kernel(reinterpret_cast<dods_uint16*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_int32_c:
+        linear_scale_kernel(reinterpret_cast<dods_int32*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_uint32_c:
+        linear_scale_kernel(reinterpret_cast<dods_uint32*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_int64_c:
+        linear_scale_kernel(reinterpret_cast<dods_int64*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_uint64_c:
+        linear_scale_kernel(reinterpret_cast<dods_uint64*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_float32_c:
+        linear_scale_kernel(reinterpret_cast<dods_float32*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    case dods_float64_c:
+        linear_scale_kernel(reinterpret_cast<dods_float64*>(buf), dest, length, m, b, missing, use_missing);
+        break;
+    default:
+        throw Error(malformed_expr, "The linear_scale() function works only for numeric Grids, Arrays and scalars.");
+    }
+}
+
+/**
+ * @brief Scale an Array that has been read
+ *
+ * The result has the same name, (constrained) shape and attributes as
+ * 'source'. Its value buffer is allocated once and the scaled values are
+ * written straight into it from the source's buffer, so the source values
+ * are not copied to an intermediate array of doubles first.
+ *
+ * @return A new Array the caller must delete.
+ */
+static Array *linear_scale_array(Array &source, double m, double b, double missing, bool use_missing)
+{
+    bool use_float32 = linear_scale_float32 && source.var()->type() == dods_float32_c;
+
+    BaseType *proto = use_float32 ? static_cast<BaseType*>(new Float32(source.name()))
+        : static_cast<BaseType*>(new Float64(source.name()));
+    std::unique_ptr<Array> result(new Array(source.name(), 0));
+    result->add_var_nocopy(proto);
+    for (Array::Dim_iter d = source.dim_begin(), e = source.dim_end(); d != e; ++d)
+        result->append_dim(source.dimension_size(d, true), source.dimension_name(d));
+    result->set_attr_table(source.get_attr_table());
+
+    result->reserve_value_capacity(source.length());
+    if (use_float32)
+        linear_scale_values(source, reinterpret_cast<dods_float32*>(result->get_buf()), m, b, missing, use_missing);
+    else
+        linear_scale_values(source, reinterpret_cast<dods_float64*>(result->get_buf()), m, b, missing, use_missing);
+    result->set_read_p(true);
+    result->set_send_p(source.send_p());
+
+    return result.release();
+}
+
 BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double missing, bool use_missing)
 {
     // Read the data, scale and return the result. Must replace the new data
     // in a constructor (i.e., Array part of a Grid).
     BaseType *dest = 0;
-    double *data;
     if (bt->type() == dods_grid_c) {
         // Grab the whole Grid; note that the scaling is done only on the array part
         Grid &source = dynamic_cast<Grid&>(*bt);
@@ -163,33 +289,16 @@ BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double
         source.set_send_p(true);
         source.read();
 
-        // Get the Array part and read the values
-        Array *a = source.get_array();
-        //a->read();
-        data = extract_double_array(a);
-
-        // Now scale the data.
-        int length = a->length();
-        for (int i = 0; i < length; ++i)
-            data[i] = data[i] * m + b;
-
-        // Copy source Grid to result Grid. Could improve on this by not using this
-        // trick since it copies all of 'source' to 'dest', including the main Array.
-        // The next bit of code will replace those values with the newly scaled ones.
-        Grid *result = new Grid(source);
-
-        // Now load the transferred values; use Float64 as the new type of the result
-        // Grid Array.
-        result->get_array()->add_var_nocopy(new Float64(source.name()));
-        result->get_array()->set_value(data, length);
-        delete[] data;
-
-        // FIXME result->set_send_p(true);
-        BESDEBUG("function", "function_linear_scale_worker() - Grid send_p: " << source.send_p() << endl);
-        BESDEBUG("function",
-                "function_linear_scale_worker() - Grid Array send_p: " << source.get_array()->send_p() << endl);
+        // Build the result Grid from the scaled Array and copies of the maps;
+        // copying the whole source Grid would copy the unscaled Array too.
+        std::unique_ptr<Grid> result(new Grid(source.name()));
+        result->set_attr_table(source.get_attr_table());
+        result->set_array(linear_scale_array(*source.get_array(), m, b, missing, use_missing));
+        for (Grid::Map_iter i = source.map_begin(), e = source.map_end(); i != e; ++i)
+            result->add_map(static_cast<Array*>(*i), true);
+        result->set_send_p(true);
 
-        dest = result;
+        dest = result.release();
     }
     else if (bt->is_vector_type()) {
         Array &source = dynamic_cast<Array&>(*bt);
@@ -202,29 +311,22 @@ BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double
         else
             source.read();
 
-        data = extract_double_array(&source);
-        int length = source.length();
-        for (int i = 0; i < length; ++i)
-            data[i] = data[i] * m + b;
-
-        Array *result = new Array(source);
-
-        result->add_var_nocopy(new Float64(source.name()));
-        result->set_value(data, length);
-
-        delete[] data; // val2buf copies.
-
-        dest = result;
+        dest = linear_scale_array(source, m, b, missing, use_missing);
     }
     else if (bt->is_simple_type() && !(bt->type() == dods_str_c || bt->type() == dods_url_c)) {
         double data = extract_double_value(bt);
         if (!use_missing || !double_eq(data, missing)) data = data * m + b;
 
-        Float64 *fdest = new Float64(bt->name());
-
-        fdest->set_value(data);
-        // dest->val2buf(static_cast<void*> (&data));
-        dest = fdest;
+        if (linear_scale_float32 && bt->type() == dods_float32_c) {
+            Float32 *fdest = new Float32(bt->name());
+            fdest->set_value(data);
+            dest = fdest;
+        }
+        else {
+            Float64 *fdest = new Float64(bt->name());
+            fdest->set_value(data);
+            dest = fdest;
+        }
     }
     else {
         throw Error(malformed_expr, "The linear_scale() function works only for numeric Grids, Arrays and scalars.");
@@ -241,7 +343,8 @@ BaseType *function_linear_scale_worker(BaseType *bt, double m, double b, double
  @param argv An array of pointers to each argument, wrapped in a child of BaseType
  @param btpp A pointer to the return value; caller must delete.
 
- @return The scaled variable, represented using Float64
+ @return The scaled variable, represented using Float64 (or Float32, see
+ set_linear_scale_float32())
  @exception Error Thrown if scale_factor is not given and the COARDS
  attributes cannot be found OR if the source variable is not a
  numeric scalar, Array or Grid. */
@@ -313,7 +416,8 @@ void function_dap2_linear_scale(int argc, BaseType * argv[], DDS &, BaseType **b
  @param argv An array of pointers to each argument, wrapped in a child of BaseType
  @param btpp A pointer to the return value; caller must delete.
 
- @return The scaled variable, represented using Float64
+ @return The scaled variable, represented using Float64 (or Float32, see
+ set_linear_scale_float32())
  @exception Error Thrown if scale_factor is not given and the COARDS
  attributes cannot be found OR if the source variable is not a
  numeric scalar, Array or Grid. */
@@ -33,6 +33,8 @@ class DDS;
 
 namespace functions {
 
+void set_linear_scale_float32(bool state);
+
 /**
  * The linear_scale() function applies the familiar y = mx + b equation to data.
  */
@@ -52,6 +52,7 @@
 #include <util.h>
 
 #include <BESDebug.h>
+#include <BESDeadline.h>
 
 #include "MakeMaskFunction.h"
 #include "Odometer.h"
@@ -79,16 +80,8 @@ string make_mask_info =
 int
 find_value_index(double value, const vector<double> &map)
 {
-    // If C++ hadn't borked passing functions to stl algorithms, we could use...
-    //vector<double>::iterator loc = find_if(map.begin(), map.end(), bind2nd(ptr_fun(double_eq), value));
-
-    for (vector<double>::const_iterator i = map.begin(), e = map.end(); i != e; ++i) {
-        if (double_eq(*i, value, 0.1)) {        // FIXME Hack: 0.1 epsilon is a hack. jhrg 5/25/15
-            return i - map.begin(); // there's an official iterator diff function somewhere...
-        }
-    }
-
-    return -1;
+    // FIXME Hack: 0.1 epsilon is a hack. jhrg 5/25/15
+    return find_map_index(value, map, map_not_monotonic, 0.1);
 }
 
 /**
@@ -143,11 +136,16 @@ template<typename T>
 void make_mask_helper(const vector<Array*> dims, Array *tuples, vector<dods_byte> &mask)
 {
     vector< vector<double> > dim_value_vecs(dims.size());
+    // Most maps are monotonic; if so, the tuple values can be found using a
+    // binary search instead of scanning the map for each one.
+    vector<MapDirection> dim_directions(dims.size());
     int i = 0;  // index the dim_value_vecs vector of vectors;
     for (vector<Array*>::const_iterator d = dims.begin(), e = dims.end(); d != e; ++d) {
         // This version of extract...() takes the vector<double> by reference:
         // In util.cc/h: void extract_double_array(Array *a, vector<double> &dest)
-        extract_double_array(*d, dim_value_vecs.at(i++));
+        extract_double_array(*d, dim_value_vecs.at(i));
+        dim_directions.at(i) = map_direction(dim_value_vecs.at(i));
+        ++i;
     }
 
     // Construct and Odometer used to calculate offsets
@@ -171,21 +169,15 @@ void make_mask_helper(const vector<Array*> dims, Array *tuples, vector<dods_byte
     // NB: 'data' holds the tuple values
 
     // unsigned int tuple_offset = 0;       // an optimization...
+    vector<int> indices(nDims);
     for (int n = 0; n < nTuples; ++n) {
-        vector<double> tuple(nDims);
-        // Build the next tuple
+        // find indices for tuple-values in the specified
+	// target-grid dimensions
         for (int dim = 0; dim < nDims; ++dim) {
             // could replace 'tuple * nDims' with 'tuple_offset'
-            tuple[dim] = data[n * nDims + dim];
+            // FIXME Hack: 0.1 epsilon is a hack. jhrg 5/25/15
+            indices[dim] = find_map_index(data[n * nDims + dim], dim_value_vecs[dim], dim_directions[dim], 0.1);
         }
-
-        DBG(cerr << "tuple: ");
-        DBGN(copy(tuple.begin(), tuple.end(), ostream_iterator<int>(std::cerr, " ")));
-        DBGN(cerr << endl);
-
-        // find indices for tuple-values in the specified
-	// target-grid dimensions
-	vector<int> indices = find_value_indices(tuple, dim_value_vecs);
 	DBG(cerr << "indices: ");
         DBGN(copy(indices.begin(), indices.end(), ostream_iterator<int>(std::cerr, " ")));
         DBGN(cerr << endl);
@@ -262,6 +254,7 @@ void function_dap2_make_mask(int argc, BaseType * argv[], DDS &, BaseType **btpp
         // 2 swath data).
         assert(a->dimension_size(a->dim_begin()) == shape.at(i));
 
+        BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
         a->read();
         a->set_read_p(true);
         dims.push_back(a);
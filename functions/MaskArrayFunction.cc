@@ -48,6 +48,7 @@
 #include <BaseTypeFactory.h>
 
 #include <BESDebug.h>
+#include <BESDeadline.h>
 
 #include "MakeArrayFunction.h"
 #include "functions_util.h"
@@ -76,22 +77,20 @@ string mask_array_info =
 template <typename T>
 void mask_array_helper(Array *array, double no_data_value, const vector<dods_byte> &mask)
 {
-    // Read the data array's data
+    // Read the data array's data, unless the request has run out of time
+    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
     array->read();
     array->set_read_p(true);
-    vector<T> data(array->length());
-    array->value(&data[0]);
 
-    assert(data.size() == mask.size());
+    assert((vector<dods_byte>::size_type)array->length() == mask.size());
 
-    // mask the data array
-    vector<dods_byte>::const_iterator mi = mask.begin();
-    for (typename vector<T>::iterator i = data.begin(), e = data.end(); i != e; ++i) {
-        if (!*mi++) *i = no_data_value;
+    // mask the data array in place; there's no need to copy the values out
+    // and back in again.
+    T *data = reinterpret_cast<T*>(array->get_buf());
+    const T no_data = static_cast<T>(no_data_value);
+    for (vector<dods_byte>::size_type i = 0, e = mask.size(); i < e; ++i) {
+        if (!mask[i]) data[i] = no_data;
     }
-
-    // reset the values
-    array->set_value(data, data.size());
 }
 
 /**
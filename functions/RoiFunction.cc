@@ -42,6 +42,7 @@
 #include <ServerFunctionsList.h>
 
 #include <BESDebug.h>
+#include <BESDeadline.h>
 #include <roi_util.h>
 
 #include "RoiFunction.h"
@@ -127,6 +128,7 @@ function_dap2_roi(int argc, BaseType *argv[], DDS &, BaseType **btpp)
         // showing  up as true. jhrg 2/26/15 Hack and move on...
         //if (!the_array->read_p())
         the_array->set_read_p(false);
+        BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
         the_array->read();
         the_array->set_read_p(true);
 
@@ -78,6 +78,8 @@ std::unique_ptr<GDALDataset> build_src_dataset(libdap::Array *data, libdap::Arra
 std::unique_ptr<GDALDataset> build_src_dataset_3D(libdap::Array *data, libdap::Array *t,libdap::Array *x, libdap::Array *y,
     const std::string &srs = "WGS84");
 
+void set_scale_threads(unsigned int threads);
+
 std::unique_ptr<GDALDataset> scale_dataset(std::unique_ptr<GDALDataset>& src, const SizeBox &size,
     const std::string &crs = "", const std::string &interp = "nearest");
 
@@ -42,6 +42,8 @@
 #include <util.h>
 #include <ServerFunctionsList.h>
 
+#include <BESDeadline.h>
+
 #include "TabularSequence.h"
 #include "TabularFunction.h"
 
@@ -58,6 +60,7 @@ namespace functions {
  */
 static void read_array_values(Array *a)
 {
+    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
     a->read();
     a->set_read_p(true);
 }
@@ -206,142 +209,63 @@ void TabularFunction::read_values(const vector<Array*> &arrays)
 }
 
 /**
- * @brief Load the values into a vector of a vector of BaseType pointers.
- *
- * Given a vector of the arrays that will supply values for this Sequence,
- * build up the values and load them into the SequenceValues/D4SeqValues
- * object that is the value-result parameter.
+ * Add the columns of the response table for a group of arrays. Each
+ * array's values are copied to the response once, as a single typed
+ * column; the response builds the rows as they are serialized.
  *
- * @note This code depends on each Array in 'arrays' having already read its
- * values. It will throw Error if that is not the case.
- *
- * @param the_arrays Extract data from these arrays
- * @param sv The destination object; a value-result parameter, passed
- * by reference. Note that DAP2's SequenceValues and DAP4's D4SeqValues
- * are both typedefs to a vector of vectors of BaseType pointers, so
- * both D2 and D4 objects can use this code.
+ * @param arrays Add columns for these arrays. Their values must have been read.
+ * @param response Add the columns to this table
  */
-void TabularFunction::build_sequence_values(const vector<Array*> &the_arrays, SequenceValues &sv)
+void TabularFunction::add_columns(const vector<Array*> &arrays, TabularSequence &response)
 {
-    // This can be optimized for most cases because we're storing objects for Byte, Int32, ...
-    // values where we could be storing native types. But this is DAP2 code... jhrg 2/3/15
-    //
-    // NB: SequenceValues == vector< vector<BaseType*> *>, and
-    // D4SeqRow, BaseTypeRow == vector<BaseType*>
-    for (SequenceValues::size_type i = 0; i < sv.size(); ++i) {
-
-        BaseTypeRow *row = new BaseTypeRow(the_arrays.size());
-
-        for (BaseTypeRow::size_type j = 0; j < the_arrays.size(); ++j) {
-            DBG(cerr << "the_arrays.at(" << j << ") " << the_arrays.at(j) << endl);
-            // i == row number; j == column (or array) number
-            (*row)[j]/*->at(j)*/= the_arrays[j]/*.at(j)*/->var(i)->ptr_duplicate();
-
-            (*row)[j]->set_send_p(true);
-            (*row)[j]->set_read_p(true);
-        }
-
-        sv[i]/*.at(i)*/= row;
+    for (vector<Array*>::const_iterator i = arrays.begin(), e = arrays.end(); i != e; ++i) {
+        response.add_var((*i)->var());
+        response.add_column(static_cast<Array*>((*i)->ptr_duplicate()));
     }
 }
 
-/**
- * Combine the two SequenceValues vectors to form one table. The dep
- * SequenceValues are the left hand columns and the indep are the right
- * hand ones. Because there can be more dep values than indep values
- * (but dep == indep * N, where N is an integer > 0), and because
- * std::vector append operations are faster than inserts, this code loops
- * over dep and inserts elements from indep, returning deps as the function
- * result.
- *
- * @note The notions of dependent and independent variables are somewhat
- * phony. In general, indep will hold the variables like Lat and Lon that
- * are [x][y] while dep will hold variables like temp which may be either
- * [x][y] _or_ [b][x][y]. In the former case, this code will actually
- * never be called and in the latter case the size of 'b' is N in the
- * above description.
- *
- * @param dep The 'dependent' variables; A value-result parameter
- * @param indep The 'independent' variables
- */
-void TabularFunction::combine_sequence_values(SequenceValues &dep, const SequenceValues &indep)
-{
-    SequenceValues::const_iterator ii = indep.begin(), ie = indep.end();
-    for (SequenceValues::iterator i = dep.begin(), e = dep.end(); i != e; ++i) {
-        // When we get to the end of the indep variables, start over
-        // This test is at the start of the loop so that we can test ii == ie on exit
-        if (ii == ie) ii = indep.begin();
-        // This call to insert() copies the pointers, but that will lead to duplicate
-        // calls to delete when Sequence deletes the SequenceValues object. Could be
-        // replaced with reference counted pointers??? jhrg 3/13/15
-        // (*i)->insert((*i)->end(), (*ii)->begin(), (*ii)->end());
-        for (BaseTypeRow::iterator btr_i = (*ii)->begin(), btr_e = (*ii)->end(); btr_i != btr_e; ++btr_i) {
-            (*i)->push_back((*btr_i)->ptr_duplicate());
-        }
-        ++ii;
-    }
-
-    assert(ii == ie);
-}
-
 /**
  * Given the shape information about the independent and dependent
- * variables, add an extra variable to the dep_vars vector to hold the
+ * variables, add an extra column to the response to hold the
  * values of the extra index.
  *
  * For example, suppose indep_shape is [2][3] and dep_shape is [5][2][3],
- * then this code would add a single integer variable to dep_vars that
+ * then this code would add a single integer column to the response that
  * will hold values ranging from 0 to 4 to represent the additional
- * left-most dimension in dep_shape.
+ * left-most dimension in dep_shape. The values are computed as the rows
+ * are built, not stored.
  *
  * This function should only be called if the dependent and independent
  * variable shape meets the criteria outlined above. In a production build
  * (#define NDEBUG) there are no sanity checks made here.
  *
- * @note This function not only adds the new variables to the dep_vars
- * parameter, it also loads those variables with values.
- *
  * @todo Extend this to support more than one additional dimension.
  *
  * @param indep_shape The shape common to all 'independent' variables
  * @param dep_shape The shape common to all 'dependent' variables
- * @param dep_vars The value result parameter that holds the dependent
- * variables. On return this has nominally been extended by one or more
- * new variables. The new variables contain values.
+ * @param dep_vars The dependent variables; the first one supplies the
+ * name of the new column.
+ * @param response Add the column to this table
  */
 void TabularFunction::add_index_column(const Shape &indep_shape, const Shape &dep_shape,
-        vector<Array*> &dep_vars)
+        const vector<Array*> &dep_vars, TabularSequence &response)
 {
     assert(dep_vars.size() > 0);
     assert(dep_shape.size() == indep_shape.size() + 1);
 
-    // load a vector with values for the new variable
     unsigned long num_indep_values = number_of_values(indep_shape);
     unsigned long num_dep_values = number_of_values(dep_shape);
-    vector<dods_uint32> index_vals(num_dep_values);
 
     assert(num_dep_values == num_indep_values * dep_shape.at(0));
 
-    // dep_shape.at(0) == the left-most dimension size
-    vector<dods_uint32>::iterator iv = index_vals.begin();
-    for (Shape::size_type i = 0; i < dep_shape.at(0); ++i) {
-        assert(iv != index_vals.end());
-        fill(iv, iv + num_indep_values, i);
-        iv += num_indep_values;
-    }
-
     // Figure out what to call the new variable/column
     string new_column_name = dep_vars.at(0)->dimension_name(dep_vars.at(0)->dim_begin());
     if (new_column_name.empty())
         new_column_name = "index";
 
-    // Make the new column var
-    Array *a = new Array(new_column_name, new UInt32(new_column_name));
-    a->append_dim(num_dep_values, new_column_name);
-    a->set_value(index_vals, (int)index_vals.size());
-    a->set_read_p(true);
-
-    dep_vars.insert(dep_vars.begin(), a);
+    UInt32 index(new_column_name);
+    response.add_var(&index);      // add_var() copies its arg
+    response.add_index_column(num_indep_values, num_dep_values);
 }
 
 /**
@@ -408,18 +332,12 @@ void TabularFunction::function_dap2_tabular(int argc, BaseType *argv[], DDS &, B
             throw Error("In function tabular(): Expected all of the 'independent' variables to have the same shape.");
     }
 
-    // Read the values and load them into a SequenceValues object
     read_values(indep_vars);
-    unsigned long num_indep_values = number_of_values(indep_shape);
-    SequenceValues indep_sv(num_indep_values);
-    build_sequence_values(indep_vars, indep_sv);
 
-    // Set the reference to the result. If there are any dependent variables,
-    // 'result' will be set to 'dep_vars' once that has been hasked and the
-    // indep_vars merged in.
-    SequenceValues &result = indep_sv;
+    auto_ptr<TabularSequence> response(new TabularSequence("table"));
 
-    // If there are dependent variables, process them
+    // If there are dependent variables, process them. Their columns (and
+    // the index column) are to the left of the independent variables'.
     if (dep_vars.size() > 0) {
         Shape dep_shape = array_shape(dep_vars.at(0));
         // Test that all the dep arrays have the same shape
@@ -440,36 +358,18 @@ void TabularFunction::function_dap2_tabular(int argc, BaseType *argv[], DDS &, B
             throw Error("In function tabular(): The 'independent' array shapes must match the right-most dimensions of the 'dependent' variables.");
 
         read_values(dep_vars);
-        unsigned long num_dep_values = number_of_values(dep_shape);
-        SequenceValues dep_sv(num_dep_values);
-
-        // Add and extra variable for extra dimension's index
-        add_index_column(indep_shape, dep_shape, dep_vars);
 
-        build_sequence_values(dep_vars, dep_sv);
+        // Add and extra column for extra dimension's index
+        add_index_column(indep_shape, dep_shape, dep_vars, *response);
 
-        // Now combine the dependent and independent variables; put the
-        // result in the dependent variable vector and assign the 'result'
-        // reference to it.
-        combine_sequence_values(dep_sv, indep_sv);
-        result = dep_sv;
+        add_columns(dep_vars, *response);
     }
 
-    auto_ptr<TabularSequence> response(new TabularSequence("table"));
-
-    if (dep_vars.size() > 0) {
-        // set the columns of the response
-        for (SequenceValues::size_type n = 0; n < dep_vars.size(); ++n) {
-            response->add_var(dep_vars[n]->var());
-        }
-    }
-
-    for (SequenceValues::size_type n = 0; n < indep_vars.size(); ++n) {
-        response->add_var(indep_vars[n]->var());
-    }
+    // The independent variables have fewer values than the dependent
+    // ones; the table repeats them for each value of the index column.
+    add_columns(indep_vars, *response);
 
-    // set the values of the response
-    response->set_value(result);
+    response->set_send_p(true);
     response->set_read_p(true);
 
     *btpp = response.release();
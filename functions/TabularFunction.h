@@ -32,6 +32,8 @@ class DDS;
 
 namespace functions {
 
+class TabularSequence;
+
 class TabularFunction: public libdap::ServerFunction
 {
 private:
@@ -60,10 +62,9 @@ private:
 
     static void read_values(const std::vector<libdap::Array*> &arrays);
 
-    static void build_sequence_values(const std::vector<libdap::Array*> &arrays, SequenceValues &sv);
-    static void combine_sequence_values(SequenceValues &dep, const SequenceValues &indep);
+    static void add_columns(const std::vector<libdap::Array*> &arrays, TabularSequence &response);
     static void add_index_column(const Shape &indep_shape, const Shape &dep_shape,
-            std::vector<libdap::Array*> &dep_vars);
+            const std::vector<libdap::Array*> &dep_vars, TabularSequence &response);
 
 public:
     TabularFunction()
@@ -40,6 +40,7 @@
 #include <Float64.h>
 #include <Str.h>
 #include <Url.h>
+#include <Array.h>
 
 #include <DDS.h>
 #include <ConstraintEvaluator.h>
@@ -73,6 +74,180 @@ write_start_of_instance(Marshaller &m)
     m.put_opaque( (char *)&start_of_instance, 1 ) ;
 }
 
+void TabularSequence::m_duplicate_columns(const TabularSequence &rhs)
+{
+    for (vector<Column>::const_iterator i = rhs.d_columns.begin(), e = rhs.d_columns.end(); i != e; ++i) {
+        Array *a = i->d_array ? static_cast<Array*>(i->d_array->ptr_duplicate()) : 0;
+        d_columns.push_back(Column(a, i->d_period));
+    }
+
+    d_num_rows = rhs.d_num_rows;
+}
+
+void TabularSequence::m_delete_columns()
+{
+    for (vector<Column>::iterator i = d_columns.begin(), e = d_columns.end(); i != e; ++i) {
+        delete i->d_array;
+    }
+
+    d_columns.clear();
+    d_num_rows = 0;
+}
+
+/**
+ * Build the rows of the table (a SequenceValues object) from its columns
+ * and release the columns. All of the rows and variables are included;
+ * this is what the table holds, not what a constraint selects.
+ */
+void TabularSequence::m_build_rows()
+{
+    if (d_columns.empty()) return;
+
+    SequenceValues rows;
+    rows.reserve(d_num_rows);
+    for (unsigned long row = 0; row < d_num_rows; ++row) {
+        load_prototypes_with_row(row);
+
+        BaseTypeRow *btr = new BaseTypeRow();
+        for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i)
+            btr->push_back((*i)->ptr_duplicate());
+
+        rows.push_back(btr);
+    }
+
+    m_delete_columns();
+    Sequence::set_value(rows);
+}
+
+/** @brief Set the rows of the table; any columns are released. */
+void TabularSequence::set_value(SequenceValues &values)
+{
+    m_delete_columns();
+    Sequence::set_value(values);
+}
+
+SequenceValues TabularSequence::value()
+{
+    m_build_rows();
+    return Sequence::value();
+}
+
+SequenceValues &TabularSequence::value_ref()
+{
+    m_build_rows();
+    return Sequence::value_ref();
+}
+
+BaseTypeRow *TabularSequence::row_value(size_t row)
+{
+    m_build_rows();
+    return Sequence::row_value(row);
+}
+
+BaseType *TabularSequence::var_value(size_t row, const string &name)
+{
+    m_build_rows();
+    return Sequence::var_value(row, name);
+}
+
+BaseType *TabularSequence::var_value(size_t row, size_t i)
+{
+    m_build_rows();
+    return Sequence::var_value(row, i);
+}
+
+int TabularSequence::number_of_rows() const
+{
+    return d_columns.empty() ? Sequence::number_of_rows() : d_num_rows;
+}
+
+/**
+ * @brief Add a column of values to the table
+ *
+ * Columns are matched to the Sequence's variables in the order they are
+ * added, so the caller must add the variables (add_var()) in the same order.
+ * The array's values must have been read. If the array has fewer elements
+ * than the table has rows, its values are repeated; row r of the table uses
+ * element r % a->length().
+ *
+ * @param a The column's values; the TabularSequence takes ownership
+ */
+void TabularSequence::add_column(Array *a)
+{
+    if (!a->read_p())
+        throw InternalErr(__FILE__, __LINE__, "Expected the values of a table column to be read.");
+
+    d_columns.push_back(Column(a, 0));
+    d_num_rows = max(d_num_rows, (unsigned long) a->length());
+}
+
+/**
+ * @brief Add a column that holds a row index
+ *
+ * The values of the column are computed as the rows are built; row r
+ * holds r / period. The matching variable must be a UInt32.
+ *
+ * @param period The number of rows for each value of the index
+ * @param num_rows The number of rows in the table
+ */
+void TabularSequence::add_index_column(unsigned long period, unsigned long num_rows)
+{
+    d_columns.push_back(Column(0, period));
+    d_num_rows = max(d_num_rows, num_rows);
+}
+
+/**
+ * Load the values of one row of the table's columns into the Sequence's
+ * prototype variables.
+ *
+ * @param row The row number
+ */
+void TabularSequence::load_prototypes_with_row(unsigned long row)
+{
+    Vars_iter i = d_vars.begin();
+    for (vector<Column>::iterator c = d_columns.begin(), ce = d_columns.end(); c != ce; ++c, ++i) {
+        if (!c->d_array) {
+            static_cast<UInt32*>(*i)->set_value(row / c->d_period);
+            continue;
+        }
+
+        unsigned long n = row % c->d_array->length();
+        char *buf = c->d_array->get_buf();
+        switch ((*i)->type()) {
+        case dods_byte_c:
+            static_cast<Byte*>(*i)->set_value(reinterpret_cast<dods_byte*>(buf)[n]);
+            break;
+        case dods_int16_c:
+            static_cast<Int16*>(*i)->set_value(reinterpret_cast<dods_int16*>(buf)[n]);
+            break;
+        case dods_int32_c:
+            static_cast<Int32*>(*i)->set_value(reinterpret_cast<dods_int32*>(buf)[n]);
+            break;
+        case dods_uint16_c:
+            static_cast<UInt16*>(*i)->set_value(reinterpret_cast<dods_uint16*>(buf)[n]);
+            break;
+        case dods_uint32_c:
+            static_cast<UInt32*>(*i)->set_value(reinterpret_cast<dods_uint32*>(buf)[n]);
+            break;
+        case dods_float32_c:
+            static_cast<Float32*>(*i)->set_value(reinterpret_cast<dods_float32*>(buf)[n]);
+            break;
+        case dods_float64_c:
+            static_cast<Float64*>(*i)->set_value(reinterpret_cast<dods_float64*>(buf)[n]);
+            break;
+        case dods_str_c:
+            // Strings are not held in the Vector's buffer; var() loads its prototype
+            static_cast<Str*>(*i)->set_value(static_cast<Str*>(c->d_array->var(n))->value());
+            break;
+        case dods_url_c:
+            static_cast<Url*>(*i)->set_value(static_cast<Url*>(c->d_array->var(n))->value());
+            break;
+        default:
+            throw InternalErr(__FILE__, __LINE__, "Expected a scalar type when loading values for selection expression evaluation.");
+        }
+    }
+}
+
 void TabularSequence::load_prototypes_with_values(BaseTypeRow &btr, bool safe)
 {
     // For each of the prototype variables in the Sequence, load it
@@ -143,6 +318,29 @@ TabularSequence::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, b
 {
     DBG(cerr << "Entering TabularSequence::serialize for " << name() << endl);
 
+    // The values are held as columns; build each row in the prototypes
+    if (!d_columns.empty()) {
+        for (unsigned long row = 0; row < d_num_rows; ++row) {
+            load_prototypes_with_row(row);
+
+            // Evaluate the CE against this row; continue (skipping this row) if it fails
+            if (ce_eval && !eval.eval_selection(dds, dataset()))
+                continue;
+
+            write_start_of_instance(m);
+
+            for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+                if ((*i)->send_p()) {
+                    (*i)->serialize(eval, dds, m, false);
+                }
+            }
+        }
+
+        write_end_of_sequence(m);
+
+        return true;
+    }
+
     SequenceValues &values = value_ref();
     //ce_eval = true; Commented out here and changed in BESDapResponseBuilder. jhrg 3/10/15
 
@@ -202,6 +400,33 @@ void TabularSequence::intern_data(ConstraintEvaluator &eval, DDS &dds)
     // after doing some profiling to see if this code can be meaningfully
     // optimized
     SequenceValues result;      // These values satisfy the CE
+
+    // The values are held as columns; this is the only place where an
+    // object is made for each value.
+    if (!d_columns.empty()) {
+        for (unsigned long row = 0; row < d_num_rows; ++row) {
+            load_prototypes_with_row(row);
+
+            if (!eval.eval_selection(dds, dataset()))
+                continue;
+
+            BaseTypeRow *result_row = new BaseTypeRow();
+            for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+                if ((*i)->send_p()) {
+                    result_row->push_back((*i)->ptr_duplicate());
+                }
+            }
+
+            result.push_back(result_row);
+        }
+
+        m_delete_columns();
+        set_value(result);
+
+        DBG(cerr << "Leaving TabularSequence::intern_data" << endl);
+        return;
+    }
+
     SequenceValues &values = value_ref();
 
     for (SequenceValues::iterator i = values.begin(), e = values.end(); i != e; ++i) {
@@ -252,6 +477,8 @@ TabularSequence::dump(ostream &strm) const
 {
     strm << BESIndent::LMarg << "TabularSequence::dump - (" << (void *)this << ")" << endl ;
     BESIndent::Indent() ;
+    strm << BESIndent::LMarg << "columns: " << d_columns.size() << endl ;
+    strm << BESIndent::LMarg << "column rows: " << d_num_rows << endl ;
     Sequence::dump(strm) ;
     BESIndent::UnIndent() ;
 }
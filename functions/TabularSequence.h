@@ -42,25 +42,54 @@
 #ifndef _tabular_sequence_h
 #define _tabular_sequence_h 1
 
+#include <vector>
+
 #include <Sequence.h>
 
 namespace libdap {
 class ConstraintEvaluator;
 class DDS;
 class Marshaller;
+class Array;
 }
 
 namespace functions {
 
 /** @brief Specialization of Sequence for tables of data
  *
- * Assumes that the data are loaded into the Sequence using set_value()
+ * The data are loaded into the Sequence using either set_value() or
+ * add_column()/add_index_column(). In the latter case the values are held
+ * as one typed Array per column and each row is built in the Sequence's
+ * prototype variables as it is serialized, so no per-value objects are
+ * made. intern_data() and the methods that access the Sequence's rows
+ * (value(), value_ref(), var_value(), ...) turn the columns into rows (a
+ * SequenceValues object) for the code that needs them.
  */
 class TabularSequence: public libdap::Sequence
 {
 private:
+    /**
+     * A column of the table. For a column that holds values, row r of the
+     * table is element r % length of d_array. For an index column (d_array
+     * is null), row r holds r / d_period.
+     */
+    struct Column {
+        libdap::Array *d_array;     // Owned by the TabularSequence
+        unsigned long d_period;
+
+        Column(libdap::Array *a, unsigned long period) : d_array(a), d_period(period) { }
+    };
+
+    std::vector<Column> d_columns;
+    unsigned long d_num_rows;
+
+    void m_duplicate_columns(const TabularSequence &rhs);
+    void m_delete_columns();
+    void m_build_rows();
+
 protected:
     void load_prototypes_with_values(libdap::BaseTypeRow &btr, bool safe = true);
+    void load_prototypes_with_row(unsigned long row);
 
 public:
     /** The Sequence constructor requires only the name of the variable
@@ -71,7 +100,7 @@ public:
         created.
 
         @brief The Sequence constructor. */
-    TabularSequence(const string &n) : Sequence(n) { }
+    TabularSequence(const string &n) : Sequence(n), d_num_rows(0) { }
 
     /** The Sequence server-side constructor requires the name of the variable
         to be created and the dataset name from which this variable is being
@@ -83,12 +112,16 @@ public:
         variable is being created.
 
         @brief The Sequence server-side constructor. */
-    TabularSequence(const string &n, const string &d) : Sequence(n, d) { }
+    TabularSequence(const string &n, const string &d) : Sequence(n, d), d_num_rows(0) { }
 
     /** @brief The Sequence copy constructor. */
-    TabularSequence(const TabularSequence &rhs) : Sequence(rhs) { }
+    TabularSequence(const TabularSequence &rhs) : Sequence(rhs), d_num_rows(0) {
+        m_duplicate_columns(rhs);
+    }
 
-    virtual ~TabularSequence() { }
+    virtual ~TabularSequence() {
+        m_delete_columns();
+    }
 
     virtual BaseType *ptr_duplicate() { return new TabularSequence(*this); }
 
@@ -98,9 +131,28 @@ public:
 
         static_cast<Sequence &>(*this) = rhs; // run Sequence=
 
+        m_delete_columns();
+        m_duplicate_columns(rhs);
+
         return *this;
     }
 
+    void add_column(libdap::Array *a);
+    void add_index_column(unsigned long period, unsigned long num_rows);
+
+    /** @return The number of rows held as columns; zero if the values are
+     * held using set_value() */
+    unsigned long num_column_rows() const { return d_num_rows; }
+
+    // These build the rows from the columns (see m_build_rows())
+    virtual void set_value(libdap::SequenceValues &values);
+    virtual libdap::SequenceValues value();
+    virtual libdap::SequenceValues &value_ref();
+    virtual libdap::BaseTypeRow *row_value(size_t row);
+    virtual libdap::BaseType *var_value(size_t row, const string &name);
+    virtual libdap::BaseType *var_value(size_t row, size_t i);
+    virtual int number_of_rows() const;
+
     virtual bool serialize(libdap::ConstraintEvaluator &eval, libdap::DDS &dds, libdap::Marshaller &m, bool ce_eval = true);
     virtual void intern_data(libdap::ConstraintEvaluator &eval, libdap::DDS &dds);
 
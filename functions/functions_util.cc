@@ -29,6 +29,8 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <algorithm>
+#include <functional>
 
 #include "BaseType.h"
 #include "Byte.h"
@@ -174,4 +176,55 @@ unsigned int extract_uint_value(BaseType *arg)
     }
 }
 
+/**
+ * @brief Are the values of a map monotonic?
+ *
+ * Compute this once for a map and pass it to find_map_index() so repeated
+ * lookups in the same map can use a binary search.
+ *
+ * @see map_direction(const T *, unsigned long)
+ */
+MapDirection map_direction(const vector<double> &map)
+{
+    return map_direction(map.empty() ? 0 : &map[0], map.size());
+}
+
+/**
+ * @brief Find the first index of a value in a map
+ *
+ * For monotonic maps this uses a binary search to find the values within
+ * epsilon of 'value' and then returns the first of those that double_eq()
+ * accepts. Other maps are scanned linearly.
+ *
+ * @param value The value to look for
+ * @param map The map values
+ * @param direction The map's direction, from map_direction()
+ * @param epsilon Passed to double_eq()
+ * @return The index of value in map or -1 if the value is not found
+ */
+int find_map_index(double value, const vector<double> &map, MapDirection direction, double epsilon)
+{
+    vector<double>::const_iterator first, last;
+    switch (direction) {
+    case map_ascending:
+        first = lower_bound(map.begin(), map.end(), value - epsilon);
+        last = upper_bound(first, map.end(), value + epsilon);
+        break;
+    case map_descending:
+        first = lower_bound(map.begin(), map.end(), value + epsilon, greater<double>());
+        last = upper_bound(first, map.end(), value - epsilon, greater<double>());
+        break;
+    default:
+        first = map.begin();
+        last = map.end();
+        break;
+    }
+
+    for (vector<double>::const_iterator i = first; i != last; ++i) {
+        if (double_eq(*i, value, epsilon)) return i - map.begin();
+    }
+
+    return -1;
+}
+
 } // namespace functions
@@ -50,6 +50,39 @@ void check_number_type_array(libdap::BaseType *btp, unsigned int rank = 0);
 
 unsigned int extract_uint_value(libdap::BaseType *arg);
 
+/// Direction of a map vector's values; see map_direction()
+enum MapDirection { map_not_monotonic = 0, map_ascending = 1, map_descending = -1 };
+
+/**
+ * @brief Are the values of a map monotonic?
+ *
+ * Compute this once for a map and use it to choose a binary search over
+ * a linear scan for lookups in the map. A map that holds a NaN is not
+ * monotonic.
+ *
+ * @param map The map values
+ * @param length The number of values
+ * @return map_ascending if the values never decrease, map_descending if
+ * they never increase and map_not_monotonic otherwise. A map with fewer
+ * than two values is ascending.
+ */
+template<typename T> MapDirection map_direction(const T *map, unsigned long length)
+{
+    bool ascending = true, descending = true;
+    for (unsigned long i = 1; i < length && (ascending || descending); ++i) {
+        if (!(map[i] >= map[i - 1])) ascending = false;
+        if (!(map[i] <= map[i - 1])) descending = false;
+    }
+
+    if (ascending) return map_ascending;
+    if (descending) return map_descending;
+    return map_not_monotonic;
+}
+
+MapDirection map_direction(const std::vector<double> &map);
+
+int find_map_index(double value, const std::vector<double> &map, MapDirection direction, double epsilon);
+
 #if 0
 /// We might move these into functions_util over time if they become generally
 /// useful. jhrg 5/1/15
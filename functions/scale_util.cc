@@ -34,6 +34,7 @@
 #include <limits>
 #include <sstream>
 #include <cassert>
+#include <cstdint>
 
 #include <gdal.h>
 #include <gdal_priv.h>
@@ -390,6 +391,38 @@ Array *build_array_from_gdal_dataset(GDALDataset *source, const Array *dest)
 }
 }
 
+/**
+ * @brief Used to transfer all bands of a gdal dataset to a dap Array
+ *
+ * All of the bands are read with one GDALDataset::RasterIO() call, which
+ * lays them out band-sequentially in the buffer; that is the same order
+ * as a [t][y][x] DAP Array.
+ *
+ * @param source Read from this dataset
+ * @param x Cols
+ * @param y Rows
+ * @param t Bands
+ * @param a Set the values in this array
+ * @return Return a pointer to parameter 'a'
+ */
+template <typename T>
+static Array *transfer_values_helper_3D(GDALDataset *source, const unsigned long x, const unsigned long y,
+    const unsigned long t, Array *a)
+{
+    vector<T> buf(x * y * t);
+    CPLErr error = source->RasterIO(GF_Read, 0, 0, x, y, &buf[0], x, y, get_array_type(a), t, NULL /*all bands*/,
+        0, 0, 0);
+
+    if (error != CPLE_None) {
+        string msg = string("Could not extract data for translated GDAL Dataset.") + CPLGetLastErrorMsg();
+        BESDEBUG(DEBUG_KEY, "ERROR transfer_values_helper_3D(): " << msg << endl);
+        throw BESError(msg, BES_INTERNAL_ERROR, __FILE__, __LINE__);
+    }
+    a->set_value(buf, buf.size());
+
+    return a;
+}
+
 /**
  * @brief Extract data from a gdal dataset and store it in a dap Array
  *
@@ -400,36 +433,49 @@ Array *build_array_from_gdal_dataset(GDALDataset *source, const Array *dest)
 Array *build_array_from_gdal_dataset_3D(GDALDataset *source3D, const Array *dest){
 
     // DAP array result
-    int t_size = source3D->GetRasterCount();
-    int x_size = source3D->GetRasterBand(1)->GetXSize();
-    int y_size = source3D->GetRasterBand(1)->GetYSize();
-    Array *result = new Array("result", const_cast<Array*>(dest)->var()->ptr_duplicate());
+    unsigned long t_size = source3D->GetRasterCount();
+    unsigned long x_size = source3D->GetRasterXSize();
+    unsigned long y_size = source3D->GetRasterYSize();
+    unique_ptr<Array> result(new Array("result", const_cast<Array*>(dest)->var()->ptr_duplicate()));
     result->append_dim(t_size);
     result->append_dim(y_size);
     result->append_dim(x_size);
 
-    vector<dods_float32> res(t_size * x_size * y_size);
-    for(int i=0; i< t_size; i++) {
-        // get the data
-        GDALRasterBand *band = source3D->GetRasterBand(i+1);
-        if (!band)
-            throw Error(string("Could not get the GDALRasterBand for the GDALDataset: ") + CPLGetLastErrorMsg());
-        vector<double> gt(6);
-        source3D->GetGeoTransform(&gt[0]);
-        // Extract data from band
-        vector<dods_float32> buf(x_size * y_size);
-        CPLErr error = band->RasterIO(GF_Read, 0, 0, x_size, y_size, &buf[0], x_size, y_size, get_array_type(dest),
-            0, 0);
-        if (error != CPLE_None)
-            throw Error(string("Could not extract data for translated GDAL Dataset.") + CPLGetLastErrorMsg());
-        if(i==0){
-            res =buf;
-        }else{
-            res.insert(res.end(), buf.begin(), buf.end());
-        }
+    switch (result->var()->type()) {
+    case dods_byte_c:
+    case dods_uint8_c:
+        transfer_values_helper_3D<dods_byte>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_uint16_c:
+        transfer_values_helper_3D<dods_uint16>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_int16_c:
+        transfer_values_helper_3D<dods_int16>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_uint32_c:
+        transfer_values_helper_3D<dods_uint32>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_int32_c:
+        transfer_values_helper_3D<dods_int32>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_float32_c:
+        transfer_values_helper_3D<dods_float32>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_float64_c:
+        transfer_values_helper_3D<dods_float64>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_int8_c:
+        transfer_values_helper_3D<dods_int8>(source3D, x_size, y_size, t_size, result.get());
+        break;
+    case dods_uint64_c:
+    case dods_int64_c:
+    default:
+        string msg = "The source array to a geo-function contained an unsupported numeric type.";
+        BESDEBUG(DEBUG_KEY,"ERROR build_array_from_gdal_dataset_3D(): " << msg << endl);
+        throw BESError(msg,BES_SYNTAX_USER_ERROR,__FILE__,__LINE__);
     }
-    result->set_value(res, res.size());
-    return result;
+
+    return result.release();
 }
 
 
@@ -758,45 +804,72 @@ void read_band_data(const Array *src, GDALRasterBand* band)
 }
 
 /**
- * @brief Share the Array's internal buffer with GDAL
+ * @brief Add a band to a MEM dataset that references existing memory
  *
- * This can avoid allocating temporary memory.
+ * The MEMory driver supports the DATAPOINTER option to AddBand(), which
+ * makes the new band a view of the caller's buffer. The buffer must hold
+ * x * y values laid out row-major and must outlive the dataset.
  *
- * @note This does not seem to work.
- *
- * @param src The Array
- * @param ds The GDALDataset; modified so that it has a new band
+ * @param ds The GDALDataset; must use the MEM driver
+ * @param type The GDAL type of the values in 'data'
+ * @param data Pointer to the values
+ * @param name Used for error messages
  */
-void add_band_data(const Array *src, GDALDataset* ds)
+static void add_band_pointer(GDALDataset *ds, GDALDataType type, void *data, const string &name)
 {
-    Array *a = const_cast<Array*>(src);
-
-    //assert(a->dimensions() == 2);
-
-    a->read();
-
-    // The MEMory driver supports the DATAPOINTER option.
     char **options = NULL;
     ostringstream oss;
-    oss << reinterpret_cast<unsigned long>(a->get_buf());
+    oss << reinterpret_cast<uintptr_t>(data);
     options = CSLSetNameValue(options, "DATAPOINTER", oss.str().c_str());
 
-    CPLErr error = ds->AddBand(get_array_type(a), options);
+    CPLErr error = ds->AddBand(type, options);
 
     CSLDestroy(options);
 
     if (error != CPLE_None){
-    	string msg ="Could not add data for grid '" + a->name() + "': " + CPLGetLastErrorMsg();
+    	string msg ="Could not add data for grid '" + name + "': " + CPLGetLastErrorMsg();
     	BESDEBUG(DEBUG_KEY,"ERROR add_band_data(): " << msg << endl);
         throw BESError(msg,BES_INTERNAL_ERROR,__FILE__,__LINE__);
     }
 }
 
-#define ADD_BAND 0
+/**
+ * @brief Share the Array's internal buffer with GDAL
+ *
+ * This avoids allocating temporary memory and copying the Array's values
+ * into it. The dataset must have been created with zero bands (otherwise
+ * the data end up in a second band) and the Array must outlive the
+ * dataset.
+ *
+ * @param src The Array
+ * @param ds The GDALDataset; modified so that it has a new band
+ */
+void add_band_data(const Array *src, GDALDataset* ds)
+{
+    Array *a = const_cast<Array*>(src);
+
+    if (!array_is_effectively_2D(src)) {
+    	stringstream ss;
+    	ss << "Cannot perform geo-spatial operations on an Array (";
+    	ss << a->name() << ") with " << a->dimensions() << " dimensions.";
+    	ss << "Because the constrained shape of the array: ";
+    	a->print_decl(ss,"",false,true,true);
+    	ss << " is not a two-dimensional array." << endl;
+    	BESDEBUG(DEBUG_KEY, ss.str());
+        throw BESError(ss.str(), BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+    }
+
+    a->read();
+
+    add_band_pointer(ds, get_array_type(a), a->get_buf(), a->name());
+}
 
 /**
  * @brief Build a GDAL Dataset object for this data/lon/lat combination
  *
+ * The dataset's one band references the values held by 'data'; they
+ * are not copied, so 'data' must outlive the returned dataset.
+ *
  * @note Supported values for the srs parameter
  * "WGS84": same as "EPSG:4326" but has no dependence on EPSG data files.
  * "WGS72": same as "EPSG:4322" but has no dependence on EPSG data files.
@@ -823,14 +896,13 @@ unique_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const
     SizeBox array_size = get_size_box(x, y);
 
     // The MEM driver takes no creation options jhrg 10/6/16
+    // No bands; add_band_data() adds one that references data's buffer.
     unique_ptr<GDALDataset> ds(driver->Create("result", array_size.x_size, array_size.y_size,
-    		1 /* nBands*/, get_array_type(data), NULL /* driver_options */));
+    		0 /* nBands*/, get_array_type(data), NULL /* driver_options */));
 
-#if ADD_BAND
     add_band_data(data, ds.get());
-#endif
 
-    // Get the one band for this dataset and load it with data
+    // Get the one band for this dataset
 	GDALRasterBand *band = ds->GetRasterBand(1);
 	if (!band) {
 		string msg = "Could not get the GDAL RasterBand for Array '" + data->name() + "': " + CPLGetLastErrorMsg();
@@ -842,10 +914,6 @@ unique_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const
 	double no_data = get_missing_data_value(data);
 	band->SetNoDataValue(no_data);
 
-#if !ADD_BAND
-	read_band_data(data, band);
-#endif
-
 	vector<double> geo_transform = get_geotransform_data(x, y);
     ds->SetGeoTransform(&geo_transform[0]);
 
@@ -867,6 +935,101 @@ unique_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const
     return ds;
 }
 
+// Number of threads GDAL uses when scaling; see set_scale_threads()
+static unsigned int scale_threads = 1;
+
+/**
+ * @brief How many threads should GDAL use when scaling?
+ *
+ * The default (1) uses GDALTranslate() as before; larger values switch
+ * the scale functions to GDALWarp() with its multithreaded warp options.
+ * DapFunctions::initialize() sets this from BES.functions.ScaleThreads.
+ *
+ * @param threads The number of threads; zero is treated as one.
+ */
+void set_scale_threads(unsigned int threads)
+{
+    scale_threads = threads ? threads : 1;
+}
+
+/**
+ * @brief Scale a GDAL dataset using the multithreaded warper
+ *
+ * GDALWarp() splits the destination into chunks and, with '-multi' and
+ * the NUM_THREADS warp option, computes the chunks (and all bands in a
+ * chunk) on separate threads. Unlike GDALTranslate() it cannot assign a
+ * CRS without reprojecting, so 'crs' is set on the result afterwards.
+ *
+ * @param src The source GDALDataset
+ * @param size The destination size
+ * @param crs The CRS to use for the result (default is to use the CRS of 'src')
+ * @param interp The interpolation algorithm to use
+ * @param threads Number of warp threads
+ * @return An auto_ptr to the result (a new GDALDataset instance)
+ */
+static unique_ptr<GDALDataset> warp_dataset(unique_ptr<GDALDataset>& src, const SizeBox &size, const string &crs,
+    const string &interp, unsigned int threads)
+{
+    char **argv = NULL;
+    argv = CSLAddString(argv, "-of");       // output format
+    argv = CSLAddString(argv, "MEM");
+
+    argv = CSLAddString(argv, "-ts");       // output size
+    ostringstream oss;
+    oss << size.x_size;
+    argv = CSLAddString(argv, oss.str().c_str());    // size x
+    oss.str("");
+    oss << size.y_size;
+    argv = CSLAddString(argv, oss.str().c_str());    // size y
+
+    argv = CSLAddString(argv, "-r");    // resampling
+    argv = CSLAddString(argv, interp.c_str());
+
+    argv = CSLAddString(argv, "-multi");
+    argv = CSLAddString(argv, "-wo");
+    oss.str("");
+    oss << "NUM_THREADS=" << threads;
+    argv = CSLAddString(argv, oss.str().c_str());
+
+    if (BESISDEBUG(DEBUG_KEY)) {
+        char **local = argv;
+        while (*local) {
+            BESDEBUG(DEBUG_KEY, "argv: " << *local++ << endl);
+        }
+    }
+
+    GDALWarpAppOptions *options = GDALWarpAppOptionsNew(argv, NULL /*binary options*/);
+    CSLDestroy(argv);
+
+    GDALDatasetH src_handle = static_cast<GDALDatasetH>(src.get());
+    int usage_error = CE_None;   // result
+    GDALDatasetH dst_handle = GDALWarp("warped_dst", NULL, 1, &src_handle, options, &usage_error);
+    GDALWarpAppOptionsFree(options);
+    if (!dst_handle || usage_error != CE_None) {
+        GDALClose(dst_handle);
+        string msg = string("Error calling GDAL warp: ") + CPLGetLastErrorMsg();
+        BESDEBUG(DEBUG_KEY, "ERROR warp_dataset(): " << msg << endl);
+        throw BESError(msg, BES_INTERNAL_ERROR, __FILE__, __LINE__);
+    }
+
+    unique_ptr<GDALDataset> dst(static_cast<GDALDataset*>(dst_handle));
+
+    if (!crs.empty()) {
+        OGRSpatialReference dst_srs;
+        if (OGRERR_NONE != dst_srs.SetFromUserInput(crs.c_str())) {
+            string msg = "Could not set '" + crs + "' as the result CRS.";
+            BESDEBUG(DEBUG_KEY, "ERROR warp_dataset(): " << msg << endl);
+            throw BESError(msg, BES_SYNTAX_USER_ERROR, __FILE__, __LINE__);
+        }
+        char *pszSRS_WKT = NULL;
+        dst_srs.exportToWkt(&pszSRS_WKT);
+        dst->SetProjection(pszSRS_WKT);
+        CPLFree(pszSRS_WKT);
+    }
+
+    return dst;
+}
+
 /**
  * @brief Scale a GDAL dataset
  *
@@ -880,6 +1043,9 @@ unique_ptr<GDALDataset> build_src_dataset(Array *data, Array *x, Array *y, const
 unique_ptr<GDALDataset> scale_dataset(unique_ptr<GDALDataset>& src, const SizeBox &size, const string &crs /*""*/,
     const string &interp /*nearest*/)
 {
+    if (scale_threads > 1)
+        return warp_dataset(src, size, crs, interp, scale_threads);
+
     char **argv = NULL;
     argv = CSLAddString(argv, "-of");       // output format
     argv = CSLAddString(argv, "MEM");
@@ -940,6 +1106,9 @@ unique_ptr<GDALDataset> scale_dataset(unique_ptr<GDALDataset>& src, const SizeBo
 unique_ptr<GDALDataset> scale_dataset_3D(unique_ptr<GDALDataset>& src, const SizeBox &size, const string &crs /*""*/,
     const string &interp /*nearest*/)
 {
+    if (scale_threads > 1)
+        return warp_dataset(src, size, crs, interp, scale_threads);
+
     char **argv = NULL;
     argv = CSLAddString(argv, "-of");       // output format
     argv = CSLAddString(argv, "MEM");
@@ -1076,11 +1245,12 @@ Grid *scale_dap_grid(const Grid *g, const SizeBox &size, const string &crs, cons
     return scale_dap_array(data, x, y, size, crs, interp);
 }
 
-#define ADD_BAND 0
-
 /**
  * @brief Build a GDAL Dataset object for this data/time/lon/lat combination
  *
+ * Each band references one time step of the values held by 'data'; they
+ * are not copied, so 'data' must outlive the returned dataset.
+ *
  * @note Supported values for the srs parameter
  * "WGS84": same as "EPSG:4326" but has no dependence on EPSG data files.
  * "WGS72": same as "EPSG:4322" but has no dependence on EPSG data files.
@@ -1098,8 +1268,6 @@ Grid *scale_dap_grid(const Grid *g, const SizeBox &size, const string &crs, cons
  */
 unique_ptr<GDALDataset> build_src_dataset_3D(Array *data, Array *t, Array *x, Array *y, const string &srs)
 {
-    Array *d = dynamic_cast<Array*>(data);
-
     GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("MEM");
     if(!driver){
         string msg = string("Could not get the Memory driver for GDAL: ") + CPLGetLastErrorMsg();
@@ -1111,14 +1279,20 @@ unique_ptr<GDALDataset> build_src_dataset_3D(Array *data, Array *t, Array *x, Ar
     int nBands = t->length();
     BESDEBUG(DEBUG_KEY, "nBands = " << nBands << endl);
     int nBytes = data->prototype()->width();
-    const int data_size = x->length() * y->length();
-    unsigned int dsize = data_size * nBytes;
+    // Bytes in one band; computed in size_t so large grids don't overflow int
+    const size_t dsize = static_cast<size_t>(x->length()) * y->length() * nBytes;
 
-    unique_ptr<GDALDataset> ds(driver->Create("result", array_size.x_size, array_size.y_size, nBands, get_array_type(d),
-            NULL /* driver_options */));
+    // No bands; each band added below references one time step of data's buffer.
+    unique_ptr<GDALDataset> ds(driver->Create("result", array_size.x_size, array_size.y_size, 0 /* nBands*/,
+        get_array_type(data), NULL /* driver_options */));
     data->read();
+
+    GDALDataType type = get_array_type(data);
+    double no_data = get_missing_data_value(data);
+
     // start band loop
     for(int i=1; i<=nBands; i++){
+        add_band_pointer(ds.get(), type, data->get_buf() + dsize*(i-1), data->name());
 
         GDALRasterBand *band = ds->GetRasterBand(i);
         if (!band) {
@@ -1127,16 +1301,7 @@ unique_ptr<GDALDataset> build_src_dataset_3D(Array *data, Array *t, Array *x, Ar
             throw BESError(msg,BES_INTERNAL_ERROR,__FILE__,__LINE__);
         }
 
-        double no_data = get_missing_data_value(data);
         band->SetNoDataValue(no_data);
-
-        #if !ADD_BAND
-        CPLErr error = band->RasterIO(GF_Write, 0, 0, x->length(), y->length(), data->get_buf() + dsize*(i-1), x->length(), y->length(), get_array_type(data), 0, 0);
-                            if (error != CPLE_None)
-                                                    throw Error("Could not write data for band: " + long_to_string(i) + ": " + string(CPLGetLastErrorMsg()));
-        #endif
-
-
     } // end band loop
     vector<double> geo_transform = get_geotransform_data(x, y);
     ds->SetGeoTransform(&geo_transform[0]);
@@ -32,7 +32,9 @@
 
 #include <GetOpt.h>
 #include <BaseType.h>
+#include <Int16.h>
 #include <Int32.h>
+#include <Float32.h>
 #include <Float64.h>
 #include <Str.h>
 #include <Array.h>
@@ -158,6 +160,10 @@ CPPUNIT_TEST_SUITE( CEFunctionsTest );
     // Tests for linear_scale
     CPPUNIT_TEST(linear_scale_args_test);
     CPPUNIT_TEST(linear_scale_array_test);
+    CPPUNIT_TEST(linear_scale_array_missing_test);
+    CPPUNIT_TEST(linear_scale_array_missing_out_of_range_test);
+    CPPUNIT_TEST(linear_scale_array_missing_fractional_test);
+    CPPUNIT_TEST(linear_scale_array_float32_test);
     CPPUNIT_TEST(linear_scale_grid_test);
     CPPUNIT_TEST(linear_scale_grid_attributes_test);
     CPPUNIT_TEST(linear_scale_grid_attributes_test2);
@@ -453,6 +459,152 @@ CPPUNIT_TEST_SUITE( CEFunctionsTest );
         }
     }
 
+    // Values equal to the missing value are not scaled
+    void linear_scale_array_missing_test()
+    {
+        try {
+            Array *a = dynamic_cast<Grid&>(*dds->var("a")).get_array();
+            CPPUNIT_ASSERT(a);
+            BaseType *argv[4];
+            argv[0] = a;
+            argv[1] = new Float64("");
+            dynamic_cast<Float64*>(argv[1])->set_value(0.1);            //m
+            argv[2] = new Float64("");
+            dynamic_cast<Float64*>(argv[2])->set_value(10);            //b
+            argv[3] = new Float64("");
+            dynamic_cast<Float64*>(argv[3])->set_value(0);            //missing
+            BaseType *scaled = 0;
+            function_dap2_linear_scale(4, argv, *dds, &scaled);
+            CPPUNIT_ASSERT(scaled->type() == dods_array_c && scaled->var()->type() == dods_float64_c);
+            double *values = extract_double_array(dynamic_cast<Array*>(scaled));
+            CPPUNIT_ASSERT(values[0] == 0);
+            CPPUNIT_ASSERT(values[1] == 10.1);
+            CPPUNIT_ASSERT(values[9] == 10.9);
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(!"Error in linear_scale_array_missing_test()");
+        }
+    }
+
+    // A missing value that is out of range for the source type matches
+    // none of the values
+    void linear_scale_array_missing_out_of_range_test()
+    {
+        try {
+            Array *a = dynamic_cast<Grid&>(*dds->var("a")).get_array();
+            CPPUNIT_ASSERT(a && a->var()->type() == dods_byte_c);
+            BaseType *argv[4];
+            argv[0] = a;
+            argv[1] = new Float64("");
+            dynamic_cast<Float64*>(argv[1])->set_value(0.1);            //m
+            argv[2] = new Float64("");
+            dynamic_cast<Float64*>(argv[2])->set_value(10);            //b
+            argv[3] = new Float64("");
+            dynamic_cast<Float64*>(argv[3])->set_value(-9999);            //missing
+            BaseType *scaled = 0;
+            function_dap2_linear_scale(4, argv, *dds, &scaled);
+            double *values = extract_double_array(dynamic_cast<Array*>(scaled));
+            CPPUNIT_ASSERT(values[0] == 10);
+            CPPUNIT_ASSERT(values[1] == 10.1);
+            CPPUNIT_ASSERT(values[9] == 10.9);
+            delete[] values;
+            delete scaled;
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(!"Error in linear_scale_array_missing_out_of_range_test()");
+        }
+    }
+
+    // A fractional missing value is not truncated to match integer values
+    void linear_scale_array_missing_fractional_test()
+    {
+        try {
+            Array source("x", new Int16("x"));
+            source.append_dim(3);
+            dods_int16 data[3] = { -9999, 1, 2 };
+            source.val2buf(data);
+            source.set_read_p(true);
+
+            BaseType *argv[4];
+            argv[0] = &source;
+            argv[1] = new Float64("");
+            dynamic_cast<Float64*>(argv[1])->set_value(2);            //m
+            argv[2] = new Float64("");
+            dynamic_cast<Float64*>(argv[2])->set_value(1);            //b
+            argv[3] = new Float64("");
+            dynamic_cast<Float64*>(argv[3])->set_value(-9999.5);            //missing
+            BaseType *scaled = 0;
+            function_dap2_linear_scale(4, argv, *dds, &scaled);
+            CPPUNIT_ASSERT(scaled->type() == dods_array_c && scaled->var()->type() == dods_float64_c);
+            double *values = extract_double_array(dynamic_cast<Array*>(scaled));
+            DBG(cerr << "values[0]: " << values[0] << endl);
+            CPPUNIT_ASSERT(values[0] == -19997);
+            CPPUNIT_ASSERT(values[1] == 3);
+            CPPUNIT_ASSERT(values[2] == 5);
+            delete[] values;
+            delete scaled;
+
+            // The same value, given exactly, is missing
+            dynamic_cast<Float64*>(argv[3])->set_value(-9999);
+            function_dap2_linear_scale(4, argv, *dds, &scaled);
+            values = extract_double_array(dynamic_cast<Array*>(scaled));
+            CPPUNIT_ASSERT(values[0] == -9999);
+            CPPUNIT_ASSERT(values[1] == 3);
+            delete[] values;
+            delete scaled;
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(!"Error in linear_scale_array_missing_fractional_test()");
+        }
+    }
+
+    // With set_linear_scale_float32(true), Float32 Arrays are scaled to
+    // Float32 and other types are still scaled to Float64
+    void linear_scale_array_float32_test()
+    {
+        set_linear_scale_float32(true);
+        try {
+            Array source("x", new Float32("x"));
+            source.append_dim(3);
+            dods_float32 data[3] = { 0, 1.5, -9999 };
+            source.val2buf(data);
+            source.set_read_p(true);
+
+            BaseType *argv[4];
+            argv[0] = &source;
+            argv[1] = new Float64("");
+            dynamic_cast<Float64*>(argv[1])->set_value(2);            //m
+            argv[2] = new Float64("");
+            dynamic_cast<Float64*>(argv[2])->set_value(1);            //b
+            argv[3] = new Float64("");
+            dynamic_cast<Float64*>(argv[3])->set_value(-9999);            //missing
+            BaseType *scaled = 0;
+            function_dap2_linear_scale(4, argv, *dds, &scaled);
+            CPPUNIT_ASSERT(scaled->type() == dods_array_c && scaled->var()->type() == dods_float32_c);
+            CPPUNIT_ASSERT(dynamic_cast<Array*>(scaled)->length() == 3);
+            double *values = extract_double_array(dynamic_cast<Array*>(scaled));
+            CPPUNIT_ASSERT(values[0] == 1);
+            CPPUNIT_ASSERT(values[1] == 4);
+            CPPUNIT_ASSERT(values[2] == -9999);
+            delete[] values;
+            delete scaled;
+
+            argv[0] = dynamic_cast<Grid&>(*dds->var("a")).get_array();
+            function_dap2_linear_scale(3, argv, *dds, &scaled);
+            CPPUNIT_ASSERT(scaled->var()->type() == dods_float64_c);
+            delete scaled;
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            set_linear_scale_float32(false);
+            CPPUNIT_ASSERT(!"Error in linear_scale_array_float32_test()");
+        }
+        set_linear_scale_float32(false);
+    }
+
     void linear_scale_grid_test()
     {
         try {
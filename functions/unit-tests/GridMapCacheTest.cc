@@ -0,0 +1,407 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Tests for the grid map cache and the map searches in GSEClause.
+
+#include "config.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Float64.h>
+#include <Int32.h>
+#include <Byte.h>
+#include <Array.h>
+#include <Grid.h>
+#include <GetOpt.h>
+#include <util.h>
+#include <debug.h>
+
+#include "GSEClause.h"
+#include "GridMapCache.h"
+
+#include <test_config.h>
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+using namespace functions;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false)
+
+namespace functions {
+
+class GridMapCacheTest: public TestFixture {
+private:
+    // Any file will do as a 'dataset'; only its name, time and size are used
+    string d_dataset;
+
+    // Make a Grid with one map; the map's values are 'values'
+    static Grid *make_grid(const string &dataset, const vector<dods_float64> &values, bool read = true)
+    {
+        Grid *grid = new Grid("sst", dataset);
+
+        Array *a = new Array("sst", dataset, new Byte("sst", dataset));
+        a->append_dim(values.size(), "x");
+        grid->add_var_nocopy(a, libdap::array);
+
+        Array *map = new Array("x", dataset, new Float64("x", dataset));
+        map->append_dim(values.size(), "x");
+        if (read) {
+            map->set_value(const_cast<vector<dods_float64>&>(values), values.size());
+            map->set_read_p(true);
+        }
+        grid->add_var_nocopy(map, libdap::maps);
+
+        return grid;
+    }
+
+    static Array *get_map(Grid *grid)
+    {
+        return static_cast<Array*>(*grid->map_begin());
+    }
+
+    static bool compare(double elem, relop op, double value)
+    {
+        switch (op) {
+        case dods_greater_op: return elem > value;
+        case dods_greater_equal_op: return elem >= value;
+        case dods_less_op: return elem < value;
+        case dods_less_equal_op: return elem <= value;
+        case dods_equal_op: return elem == value;
+        case dods_not_equal_op: return elem != value;
+        default: return false;
+        }
+    }
+
+    // The start and stop a linear scan finds (see GSEClause)
+    static void scan(const vector<dods_float64> &values, relop op, double value, int &start, int &stop)
+    {
+        int i = start;
+        int end = stop;
+        while (i <= end && !compare(values[i], op, value))
+            i++;
+        start = i;
+
+        i = end;
+        while (i >= 0 && !compare(values[i], op, value))
+            i--;
+        stop = i;
+    }
+
+    // Build a clause on a Grid holding 'values' and check its start and stop
+    // against a scan.
+    void check_clause(const vector<dods_float64> &values, double value1, relop op1, double value2 = 0,
+        relop op2 = dods_nop_op)
+    {
+        int start = 0;
+        int stop = values.size() - 1;
+        scan(values, op1, value1, start, stop);
+        if (op2 != dods_nop_op) scan(values, op2, value2, start, stop);
+
+        auto_ptr<Grid> grid(make_grid(d_dataset, values));
+        GSEClause *clause;
+        if (op2 == dods_nop_op)
+            clause = new GSEClause(grid.get(), "x", value1, op1);
+        else
+            clause = new GSEClause(grid.get(), "x", value1, op1, value2, op2);
+
+        DBG(cerr << "op " << op1 << " " << value1 << ": start " << clause->get_start() << " (" << start << "), stop "
+            << clause->get_stop() << " (" << stop << ")" << endl);
+
+        bool ok = clause->get_start() == start && clause->get_stop() == stop;
+
+        // The clause deletes its map, which the Grid holds.
+        clause->set_map(0);
+        delete clause;
+
+        CPPUNIT_ASSERT(ok);
+    }
+
+    static vector<dods_float64> ascending()
+    {
+        vector<dods_float64> values;
+        for (int i = 0; i < 10; ++i)
+            values.push_back(i * 10.0);     // 0, 10, ..., 90
+        return values;
+    }
+
+    static vector<dods_float64> descending()
+    {
+        vector<dods_float64> values = ascending();
+        reverse(values.begin(), values.end());
+        return values;
+    }
+
+    void check_all_ops(const vector<dods_float64> &values)
+    {
+        const relop ops[] = { dods_greater_op, dods_greater_equal_op, dods_less_op, dods_less_equal_op };
+        const double tests[] = { -10.0, 0.0, 35.0, 40.0, 90.0, 100.0 };
+        for (unsigned int o = 0; o < sizeof(ops) / sizeof(ops[0]); ++o)
+            for (unsigned int t = 0; t < sizeof(tests) / sizeof(tests[0]); ++t)
+                check_clause(values, tests[t], ops[o]);
+    }
+
+public:
+    GridMapCacheTest()
+    {
+    }
+    ~GridMapCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_dataset = string(TEST_SRC_DIR) + "/ce-functions-testsuite/geo_grid.dds";
+    }
+
+    void tearDown()
+    {
+    }
+
+    CPPUNIT_TEST_SUITE( GridMapCacheTest );
+
+    CPPUNIT_TEST(search_ascending_test);
+    CPPUNIT_TEST(search_descending_test);
+    CPPUNIT_TEST(search_two_ops_test);
+    CPPUNIT_TEST(search_outside_range_test);
+    CPPUNIT_TEST(scan_not_monotonic_test);
+    CPPUNIT_TEST(cache_disabled_test);
+    CPPUNIT_TEST(cache_test);
+    CPPUNIT_TEST(cache_not_a_file_test);
+    CPPUNIT_TEST(cache_constrained_map_test);
+    CPPUNIT_TEST(cache_stale_test);
+    CPPUNIT_TEST(search_cached_map_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void search_ascending_test()
+    {
+        check_all_ops(ascending());
+    }
+
+    void search_descending_test()
+    {
+        check_all_ops(descending());
+    }
+
+    void search_two_ops_test()
+    {
+        check_clause(ascending(), 25.0, dods_greater_op, 65.0, dods_less_op);
+        check_clause(ascending(), 20.0, dods_greater_equal_op, 60.0, dods_less_equal_op);
+        check_clause(descending(), 25.0, dods_greater_op, 65.0, dods_less_op);
+        check_clause(descending(), 60.0, dods_less_equal_op, 20.0, dods_greater_equal_op);
+        // No values between them
+        check_clause(ascending(), 31.0, dods_greater_op, 39.0, dods_less_op);
+    }
+
+    void search_outside_range_test()
+    {
+        vector<dods_float64> values = ascending();
+        check_clause(values, 1000.0, dods_greater_op);
+        check_clause(values, -1000.0, dods_less_op);
+        check_clause(values, 1000.0, dods_less_op);
+        check_clause(values, -1000.0, dods_greater_op);
+
+        values = descending();
+        check_clause(values, 1000.0, dods_greater_op);
+        check_clause(values, -1000.0, dods_less_op);
+    }
+
+    // Maps with repeated values are monotonic; others use the scan
+    void scan_not_monotonic_test()
+    {
+        dods_float64 v[] = { 0, 10, 10, 20, 20, 20, 30, 40, 40, 50 };
+        check_all_ops(vector<dods_float64>(v, v + 10));
+
+        dods_float64 w[] = { 50, 10, 80, 20, 0, 90, 30, 40, 70, 60 };
+        check_all_ops(vector<dods_float64>(w, w + 10));
+        check_clause(vector<dods_float64>(w, w + 10), 40.0, dods_equal_op);
+    }
+
+    // Must run before set_map_cache_entries() is called
+    void cache_disabled_test()
+    {
+        auto_ptr<Grid> grid(make_grid(d_dataset, ascending()));
+        cache_grid_maps(grid.get());
+        CPPUNIT_ASSERT(!get_cached_map(get_map(grid.get())));
+    }
+
+    void cache_test()
+    {
+        set_map_cache_entries(10);
+
+        auto_ptr<Grid> grid(make_grid(d_dataset, descending()));
+        cache_grid_maps(grid.get());
+
+        const CachedMap *cached = get_cached_map(get_map(grid.get()));
+        CPPUNIT_ASSERT(cached);
+        CPPUNIT_ASSERT(cached->direction() == map_descending);
+        vector<dods_float64> values = descending();
+        CPPUNIT_ASSERT(cached->values() == vector<double>(values.begin(), values.end()));
+
+        // The values are loaded into a Grid that has not been read
+        auto_ptr<Grid> unread(make_grid(d_dataset, descending(), false));
+        CPPUNIT_ASSERT(!get_map(unread.get())->read_p());
+        load_cached_maps(unread.get());
+        CPPUNIT_ASSERT(get_map(unread.get())->read_p());
+
+        vector<dods_float64> loaded(10);
+        get_map(unread.get())->value(&loaded[0]);
+        CPPUNIT_ASSERT(loaded == descending());
+    }
+
+    void cache_not_a_file_test()
+    {
+        set_map_cache_entries(10);
+
+        auto_ptr<Grid> grid(make_grid("http://localhost/not_a_file.nc", ascending()));
+        cache_grid_maps(grid.get());
+        CPPUNIT_ASSERT(!get_cached_map(get_map(grid.get())));
+
+        auto_ptr<Grid> no_name(make_grid("", ascending()));
+        cache_grid_maps(no_name.get());
+        CPPUNIT_ASSERT(!get_cached_map(get_map(no_name.get())));
+    }
+
+    void cache_constrained_map_test()
+    {
+        set_map_cache_entries(10);
+
+        string dataset = string(TEST_SRC_DIR) + "/ce-functions-testsuite/geo_grid.das";
+        auto_ptr<Grid> grid(make_grid(dataset, ascending(), false));
+        Array *map = get_map(grid.get());
+        map->add_constraint(map->dim_begin(), 2, 1, 5);
+        vector<dods_float64> all = ascending();
+        vector<dods_float64> values(all.begin() + 2, all.begin() + 6);
+        map->set_value(values, values.size());
+        map->set_read_p(true);
+
+        cache_grid_maps(grid.get());
+        CPPUNIT_ASSERT(!get_cached_map(map));
+    }
+
+    // A dataset that changes after its maps are cached does not use them
+    void cache_stale_test()
+    {
+        set_map_cache_entries(10);
+
+        string dataset = string(TEST_BUILD_DIR) + "/map_cache_test.dds";
+        {
+            ofstream out(dataset.c_str());
+            out << "Dataset { } map_cache_test;" << endl;
+        }
+        struct utimbuf times;
+        times.actime = times.modtime = 1000000000;
+        utime(dataset.c_str(), &times);
+
+        auto_ptr<Grid> grid(make_grid(dataset, ascending()));
+        cache_grid_maps(grid.get());
+        CPPUNIT_ASSERT(get_cached_map(get_map(grid.get())));
+
+        times.actime = times.modtime = 1000000001;
+        utime(dataset.c_str(), &times);
+        CPPUNIT_ASSERT(!get_cached_map(get_map(grid.get())));
+
+        auto_ptr<Grid> unread(make_grid(dataset, ascending(), false));
+        load_cached_maps(unread.get());
+        CPPUNIT_ASSERT(!get_map(unread.get())->read_p());
+
+        unlink(dataset.c_str());
+    }
+
+    // Clauses on a map in the cache use its direction
+    void search_cached_map_test()
+    {
+        set_map_cache_entries(10);
+
+        // A dataset no other test caches maps for
+        d_dataset = string(TEST_SRC_DIR) + "/ce-functions-testsuite/geo_grid.das";
+
+        auto_ptr<Grid> grid(make_grid(d_dataset, ascending()));
+        cache_grid_maps(grid.get());
+        CPPUNIT_ASSERT(get_cached_map(get_map(grid.get())));
+
+        check_all_ops(ascending());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(GridMapCacheTest);
+
+} // namespace functions
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != EOF)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: GridMapCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = GridMapCacheTest::suite()->getTests();
+            unsigned int prefix_len = GridMapCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = GridMapCacheTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
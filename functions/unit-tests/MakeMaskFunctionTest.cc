@@ -26,6 +26,7 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <cmath>
 #include <sstream>
 #include <iterator>
 
@@ -52,6 +53,7 @@
 #include "test_utils.h"
 
 #include "MakeMaskFunction.h"
+#include "functions_util.h"
 
 using namespace CppUnit;
 using namespace libdap;
@@ -204,6 +206,30 @@ public:
         CPPUNIT_ASSERT(find_value_index(11.0, data) == -1);
     }
 
+    void find_map_index_test()
+    {
+        double init_values[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        vector<double> up(init_values, init_values + sizeof(init_values) / sizeof(double));
+        vector<double> down(up.rbegin(), up.rend());
+        double init_values2[] = { 3, 1, 2 };
+        vector<double> neither(init_values2, init_values2 + sizeof(init_values2) / sizeof(double));
+
+        CPPUNIT_ASSERT(map_direction(up) == map_ascending);
+        CPPUNIT_ASSERT(map_direction(down) == map_descending);
+        CPPUNIT_ASSERT(map_direction(neither) == map_not_monotonic);
+
+        double init_values3[] = { 1, 2, NAN, 4 };
+        CPPUNIT_ASSERT(map_direction(init_values3, 4) == map_not_monotonic);
+        CPPUNIT_ASSERT(map_direction(init_values3, 2) == map_ascending);
+
+        CPPUNIT_ASSERT(find_map_index(4.0, up, map_ascending, 0.1) == 3);
+        CPPUNIT_ASSERT(find_map_index(4.05, up, map_ascending, 0.1) == 3);
+        CPPUNIT_ASSERT(find_map_index(11.0, up, map_ascending, 0.1) == -1);
+        CPPUNIT_ASSERT(find_map_index(4.0, down, map_descending, 0.1) == 6);
+        CPPUNIT_ASSERT(find_map_index(0.0, down, map_descending, 0.1) == -1);
+        CPPUNIT_ASSERT(find_map_index(2.0, neither, map_not_monotonic, 0.1) == 2);
+    }
+
     void find_value_indices_test()
     {
         double init_values[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
@@ -385,6 +411,7 @@ CPPUNIT_TEST_SUITE( MakeMaskFunctionTest );
 
     CPPUNIT_TEST(no_arg_test);
     CPPUNIT_TEST(find_value_index_test);
+    CPPUNIT_TEST(find_map_index_test);
     CPPUNIT_TEST(find_value_indices_test);
     CPPUNIT_TEST(all_indices_valid_test);
     CPPUNIT_TEST(make_mask_helper_test_1);
@@ -523,6 +523,51 @@ public:
         }
     }
 
+    // Same as above, but using GDALWarp() with two threads
+    void test_scaling_with_gdal_warp()
+    {
+        try {
+            Array *data = dynamic_cast<Array*>(small_dds->var("data"));
+            Array *lon = dynamic_cast<Array*>(small_dds->var("lon"));
+            Array *lat = dynamic_cast<Array*>(small_dds->var("lat"));
+
+            unique_ptr<GDALDataset> src = build_src_dataset(data, lon, lat);
+
+            const int dst_size = 22;
+            SizeBox size(dst_size, dst_size);
+            set_scale_threads(2);
+            unique_ptr<GDALDataset> dst = scale_dataset(src, size);
+            set_scale_threads(1);
+
+            CPPUNIT_ASSERT(dst->GetRasterCount() == 1);
+
+            GDALRasterBand *band = dst->GetRasterBand(1);
+            if (!band)
+                throw Error(string("Could not get the GDALRasterBand for the GDALDataset: ") + CPLGetLastErrorMsg());
+
+            CPPUNIT_ASSERT(band->GetXSize() == dst_size);
+            CPPUNIT_ASSERT(band->GetYSize() == dst_size);
+            CPPUNIT_ASSERT(band->GetRasterDataType() == get_array_type(data));
+
+            double min, max;
+            CPLErr error = band->GetStatistics(false, true, &min, &max, NULL, NULL);
+            DBG(cerr << "min: " << min << ", max: " << max << " (error: " << error << ")" << endl);
+            CPPUNIT_ASSERT(same_as(min, 1.0));  // The no data value is carried over by the warper
+            CPPUNIT_ASSERT(double_eq(max, 8.9));
+
+            vector<double> gt(6);
+            dst->GetGeoTransform(&gt[0]);
+            CPPUNIT_ASSERT(gt[0] == -0.5);  // min lon
+            CPPUNIT_ASSERT(gt[3] == 4);  // max lat
+
+            GDALClose(dst.release());
+        }
+        catch (Error &e) {
+            set_scale_threads(1);
+            CPPUNIT_FAIL(e.get_error_message());
+        }
+    }
+
     void test_build_array_from_gdal_dataset()
     {
         try {
@@ -642,6 +687,7 @@ public:
     CPPUNIT_TEST(test_add_band_data);
     CPPUNIT_TEST(test_build_src_dataset);
     CPPUNIT_TEST(test_scaling_with_gdal);
+    CPPUNIT_TEST(test_scaling_with_gdal_warp);
     CPPUNIT_TEST(test_build_array_from_gdal_dataset);
     CPPUNIT_TEST(test_build_maps_from_gdal_dataset);
 
@@ -48,6 +48,7 @@
 #include <test_config.h>
 
 #include "TabularFunction.h"
+#include "TabularSequence.h"
 
 using namespace CppUnit;
 using namespace libdap;
@@ -287,7 +288,7 @@ public:
         unsigned long num_values = TabularFunction::number_of_values(shape);
         CPPUNIT_ASSERT(num_values == 8);
 
-        SequenceValues sv(num_values);
+        TabularSequence table("table");
         try {
             TabularFunction::read_values(arrays);
         }
@@ -299,7 +300,7 @@ public:
         }
 
         try {
-            TabularFunction::build_sequence_values(arrays, sv);
+            TabularFunction::add_columns(arrays, table);
         }
         catch (Error &e) {
             CPPUNIT_FAIL(e.get_error_message());
@@ -308,6 +309,11 @@ public:
             CPPUNIT_FAIL(e.what());
         }
 
+        // The values are held as columns until the rows are accessed
+        CPPUNIT_ASSERT(table.num_column_rows() == num_values);
+        SequenceValues &sv = table.value_ref();
+        CPPUNIT_ASSERT(table.num_column_rows() == 0);
+
         for (SequenceValues::size_type i = 0; i < sv.size(); ++i) {
             BaseTypeRow *row = sv.at(i);
             for (BaseTypeRow::size_type j = 0; j < row->size(); ++j) {
@@ -372,23 +378,18 @@ public:
 
         unsigned long num_a_values = TabularFunction::number_of_values(a_shape);
         CPPUNIT_ASSERT(num_a_values == 2);
-        SequenceValues a_sv(num_a_values);
         TabularFunction::read_values(a);
-        TabularFunction::build_sequence_values(a, a_sv);
-        CPPUNIT_ASSERT(a_sv.size() == 2);
 
         unsigned long num_b_values = TabularFunction::number_of_values(b_shape);
         //CPPUNIT_ASSERT(num_b_values == 8);
         CPPUNIT_ASSERT(num_b_values == 2);
-        SequenceValues b_sv(num_b_values);
 
         TabularFunction::read_values(b);
-        TabularFunction::build_sequence_values(b, b_sv);
-        CPPUNIT_ASSERT(b_sv.size() == 2);
 
-        SequenceValues &result = b_sv;
+        TabularSequence table("table");
         try {
-            TabularFunction::combine_sequence_values(b_sv, a_sv);
+            TabularFunction::add_columns(b, table);
+            TabularFunction::add_columns(a, table);
         }
         catch (Error &e) {
             CPPUNIT_FAIL(e.get_error_message());
@@ -397,6 +398,8 @@ public:
             CPPUNIT_FAIL(e.what());
         }
 
+        SequenceValues &result = table.value_ref();
+
         // This loop is mostly so that we can see the values when using -d
         for (SequenceValues::size_type i = 0; i < result.size(); ++i) {
             BaseTypeRow *row = result.at(i);
@@ -459,21 +462,18 @@ public:
 
         unsigned long num_indep_values = TabularFunction::number_of_values(indep_shape);
         CPPUNIT_ASSERT(num_indep_values == 2);
-        SequenceValues indep_sv(num_indep_values);
         TabularFunction::read_values(indep_vars);
-        TabularFunction::build_sequence_values(indep_vars, indep_sv);
-        CPPUNIT_ASSERT(indep_sv.size() == 2);
 
         unsigned long num_dep_values = TabularFunction::number_of_values(dep_shape);
         CPPUNIT_ASSERT(num_dep_values == 8);
-        SequenceValues dep_sv(num_dep_values);
         TabularFunction::read_values(dep_vars);
-        TabularFunction::build_sequence_values(dep_vars, dep_sv);
-        CPPUNIT_ASSERT(dep_sv.size() == 8);
 
-        SequenceValues &result = dep_sv;
+        // The 'independent' variables have fewer values than the 'dependent'
+        // ones; the table repeats them.
+        TabularSequence table("table");
         try {
-            TabularFunction::combine_sequence_values(dep_sv, indep_sv);
+            TabularFunction::add_columns(dep_vars, table);
+            TabularFunction::add_columns(indep_vars, table);
         }
         catch (Error &e) {
             CPPUNIT_FAIL(e.get_error_message());
@@ -482,6 +482,8 @@ public:
             CPPUNIT_FAIL(e.what());
         }
 
+        SequenceValues &result = table.value_ref();
+
         // This loop is mostly so that we can see the values when using -d
         for (SequenceValues::size_type i = 0; i < result.size(); ++i) {
             BaseTypeRow *row = result.at(i);
@@ -521,6 +523,11 @@ public:
             CPPUNIT_ASSERT(row->at(0)->type() == dods_float32_c);
             CPPUNIT_ASSERT(row->at(1)->type() == dods_byte_c);
             CPPUNIT_ASSERT(row->at(2)->type() == dods_int32_c);
+
+            CPPUNIT_ASSERT(static_cast<Byte*>(row->at(1))->value()
+                == reinterpret_cast<dods_byte*>(indep_vars.at(0)->get_buf())[i % 2]);
+            CPPUNIT_ASSERT(static_cast<Int32*>(row->at(2))->value()
+                == reinterpret_cast<dods_int32*>(indep_vars.at(1)->get_buf())[i % 2]);
         }
     }
 
@@ -545,30 +552,32 @@ public:
 
         unsigned long num_indep_values = TabularFunction::number_of_values(indep_shape);
         CPPUNIT_ASSERT(num_indep_values == 2);
-        //SequenceValues indep_sv(num_indep_values);
-        //TabularFunction::read_values(indep_vars);
-        //TabularFunction::build_sequence_values(indep_vars, indep_sv);
-        //CPPUNIT_ASSERT(indep_sv.size() == 2);
 
         unsigned long num_dep_values = TabularFunction::number_of_values(dep_shape);
         CPPUNIT_ASSERT(num_dep_values == 8);
-        SequenceValues dep_sv(num_dep_values);
 
         TabularFunction::read_values(dep_vars);
         CPPUNIT_ASSERT(dep_vars.size() == 1);
 
-        TabularFunction::add_index_column(indep_shape, dep_shape, dep_vars);
-        CPPUNIT_ASSERT(dep_vars.size() == 2);
-        CPPUNIT_ASSERT(dep_vars.at(0)->type() == dods_array_c);
-        CPPUNIT_ASSERT(dep_vars.at(0)->var()->type() == dods_uint32_c);
-        DBG(cerr << "first dep var name: " << dep_vars.at(0)->name() << endl);
-        DBG(cerr << "second dep var name: " << dep_vars.at(1)->name() << endl);
+        TabularSequence table("table");
+        TabularFunction::add_index_column(indep_shape, dep_shape, dep_vars, table);
+        TabularFunction::add_columns(dep_vars, table);
+
+        CPPUNIT_ASSERT(distance(table.var_begin(), table.var_end()) == 2);
+        CPPUNIT_ASSERT((*table.var_begin())->type() == dods_uint32_c);
+        DBG(cerr << "index column name: " << (*table.var_begin())->name() << endl);
 
-        vector<dods_uint32> synth(8);
-        dep_vars.at(0)->value(&synth[0]);
+        table.set_send_p(true);
+        table.intern_data(ce, *four_var_mixed);
+
+        SequenceValues &result = table.value_ref();
+        CPPUNIT_ASSERT(result.size() == 8);
+        for (SequenceValues::size_type i = 0; i < result.size(); ++i) {
+            CPPUNIT_ASSERT(static_cast<UInt32*>(result.at(i)->at(0))->value() == i / 2);
+        }
 
-        CPPUNIT_ASSERT(synth.at(0) == 0);
-        CPPUNIT_ASSERT(synth.at(7) == 3);
+        CPPUNIT_ASSERT(static_cast<UInt32*>(result.at(0)->at(0))->value() == 0);
+        CPPUNIT_ASSERT(static_cast<UInt32*>(result.at(7)->at(0))->value() == 3);
     }
 
     void four_var_test()
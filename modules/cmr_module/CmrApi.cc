@@ -28,7 +28,11 @@
  *  Created on: July, 13 2018
  *      Author: ndp
  */
+#include <pthread.h>
+
 #include <memory>
+#include <algorithm>
+#include <ctime>
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
@@ -42,8 +46,11 @@
 
 #include <util.h>
 #include <debug.h>
+#include <DapObj.h>
+#include <ObjMemCache.h>
 
 #include <BESError.h>
+#include <BESInternalError.h>
 #include <BESSyntaxUserError.h>
 #include <BESDebug.h>
 #include <BESUtil.h>
@@ -53,6 +60,7 @@
 #include "CmrNames.h"
 #include "RemoteHttpResource.h"
 #include "CmrError.h"
+#include "curl_utils.h"
 #include "rjson_utils.h"
 
 using namespace std;
@@ -61,6 +69,138 @@ using namespace std;
 
 namespace cmr {
 
+// CMR will not return more than this many granules per page
+static const unsigned long CMR_PAGE_SIZE = 2000;
+
+/**
+ * The facet values or granules returned by a CMR query, held in the memory
+ * cache along with the time they were retrieved.
+ */
+class CmrResult: public libdap::DapObj {
+public:
+    time_t d_time;
+    vector<string> d_values;
+    vector<Granule> d_granules;
+
+    CmrResult() : d_time(time(0)) { }
+    virtual ~CmrResult() { }
+};
+
+static ObjMemCache *result_cache = 0;
+static long result_ttl = 0;
+
+/**
+ * Get the per-process memory cache for query results. Its size and the
+ * lifetime of its entries are set using CMR.MemCache.Entries and
+ * CMR.MemCache.TTL. The cache is off unless CMR.MemCache.Entries is set.
+ *
+ * @return The cache or null if it is disabled
+ */
+static ObjMemCache *get_result_cache()
+{
+    static bool initialized = false;
+    if (!initialized) {
+        int entries = TheBESKeys::TheKeys()->read_int_key(CMR_MEM_CACHE_ENTRIES, 0);
+        result_ttl = TheBESKeys::TheKeys()->read_int_key(CMR_MEM_CACHE_TTL, 300);
+        if (entries > 0 && result_ttl > 0) result_cache = new ObjMemCache(entries, 0.2);
+        initialized = true;
+    }
+
+    return result_cache;
+}
+
+/**
+ * @return The cached result for 'key' or null if there is none or it has
+ * expired.
+ */
+static CmrResult *get_cached_result(const string &key)
+{
+    ObjMemCache *cache = get_result_cache();
+    if (!cache) return 0;
+
+    CmrResult *result = static_cast<CmrResult *>(cache->get(key));
+    if (result && time(0) - result->d_time > result_ttl) {
+        BESDEBUG(MODULE, prolog << "Cached result expired: " << key << endl);
+        cache->remove(key);     // deletes result
+        result = 0;
+    }
+
+    return result;
+}
+
+/**
+ * One page of a granule search, retrieved and parsed by its own thread.
+ */
+struct granule_page {
+    string url;
+    rapidjson::Document doc;
+    string error;
+
+    granule_page(const string &u) : url(u) { }
+};
+
+/**
+ * Thread function that retrieves and parses one granule_page; errors are
+ * recorded in the granule_page.
+ *
+ * These requests bypass the CMR (file) cache. CmrCache is a process-wide
+ * singleton whose locks are fcntl() locks, which belong to the process, so
+ * two threads would both be granted the 'exclusive' lock on a cache file,
+ * and its table of open descriptors is not guarded. Only the first page of
+ * a search, which is also used for granule counts, is cached on disk; the
+ * other pages are held by the memory cache when it is enabled.
+ */
+static void *fetch_granule_page(void *arg)
+{
+    granule_page *page = static_cast<granule_page *>(arg);
+    CURL *curl = 0;
+    FILE *fp = 0;
+
+    try {
+        char error_buffer[CURL_ERROR_SIZE];
+        curl = init(error_buffer);
+        configureProxy(curl, page->url);
+
+        fp = tmpfile();
+        if (!fp) throw BESInternalError("Could not make a temporary file for a CMR response.", __FILE__, __LINE__);
+
+        vector<string> resp_hdrs;
+        long status = read_url(curl, page->url, fileno(fp), &resp_hdrs, 0, error_buffer);
+        if (status >= 400)
+            throw CmrError("The request for '" + page->url + "' returned a status of " + libdap::long_to_string(status),
+                __FILE__, __LINE__);
+
+        rewind(fp);
+        char readBuffer[65536];
+        rapidjson::FileReadStream frs(fp, readBuffer, sizeof(readBuffer));
+        page->doc.ParseStream(frs);
+        if (page->doc.HasParseError())
+            throw CmrError("The response from '" + page->url + "' is not a JSON document.", __FILE__, __LINE__);
+    }
+    catch (BESError &e) {
+        page->error = e.get_message();
+    }
+    catch (libdap::Error &e) {
+        page->error = e.get_error_message();
+    }
+    catch (...) {
+        page->error = "Unknown error while reading " + page->url;
+    }
+
+    if (fp) fclose(fp);
+    if (curl) curl_easy_cleanup(curl);
+
+    return 0;
+}
+
+CmrApi::CmrApi() : cmr_search_endpoint_url("https://cmr.earthdata.nasa.gov/search")
+{
+    bool found = false;
+    string endpoint;
+    TheBESKeys::TheKeys()->get_value(CMR_SEARCH_ENDPOINT, endpoint, found);
+    if (found && !endpoint.empty()) cmr_search_endpoint_url = endpoint;
+}
+
 /**
  *
  */
@@ -336,6 +476,14 @@ CmrApi::get_years(string collection_name, vector<string> &years_result){
     // bool result;
     string msg;
 
+    string key = "years/" + collection_name;
+    CmrResult *cached = get_cached_result(key);
+    if (cached) {
+        years_result.insert(years_result.end(), cached->d_values.begin(), cached->d_values.end());
+        return;
+    }
+    auto_ptr<CmrResult> result(new CmrResult());
+
     string url = BESUtil::assemblePath(cmr_search_endpoint_url,"granules.json") + "?concept_id="+collection_name +"&include_facets=v2";
     rapidjson::Document doc;
     rju.getJsonDoc(url,doc);
@@ -345,8 +493,11 @@ CmrApi::get_years(string collection_name, vector<string> &years_result){
     for (rapidjson::SizeType k = 0; k < years.Size(); k++) { // Uses SizeType instead of size_t
         const rapidjson::Value& year_obj = years[k];
         string year = rju.getStringValue(year_obj,"title");
-        years_result.push_back(year);
+        result->d_values.push_back(year);
     }
+
+    years_result.insert(years_result.end(), result->d_values.begin(), result->d_values.end());
+    if (get_result_cache()) get_result_cache()->add(result.release(), key);
 } // CmrApi::get_years()
 
 
@@ -364,6 +515,14 @@ CmrApi::get_months(string collection_name, string r_year, vector<string> &months
 
     stringstream msg;
 
+    string key = "months/" + collection_name + "/" + r_year;
+    CmrResult *cached = get_cached_result(key);
+    if (cached) {
+        months_result.insert(months_result.end(), cached->d_values.begin(), cached->d_values.end());
+        return;
+    }
+    auto_ptr<CmrResult> result(new CmrResult());
+
     string url = BESUtil::assemblePath(cmr_search_endpoint_url,"granules.json")
         + "?concept_id="+collection_name
         +"&include_facets=v2"
@@ -412,9 +571,11 @@ CmrApi::get_months(string collection_name, string r_year, vector<string> &months
     for (rapidjson::SizeType i = 0; i < months.Size(); i++) { // Uses SizeType instead of size_t
         const rapidjson::Value& month = months[i];
         string month_id = rju.getStringValue(month,"title");
-        months_result.push_back(month_id);
+        result->d_values.push_back(month_id);
     }
-    return;
+
+    months_result.insert(months_result.end(), result->d_values.begin(), result->d_values.end());
+    if (get_result_cache()) get_result_cache()->add(result.release(), key);
 
 } // CmrApi::get_months()
 
@@ -426,6 +587,14 @@ CmrApi::get_days(string collection_name, string r_year, string r_month, vector<s
     rjson_utils rju;
     stringstream msg;
 
+    string key = "days/" + collection_name + "/" + r_year + "/" + r_month;
+    CmrResult *cached = get_cached_result(key);
+    if (cached) {
+        days_result.insert(days_result.end(), cached->d_values.begin(), cached->d_values.end());
+        return;
+    }
+    auto_ptr<CmrResult> result(new CmrResult());
+
     string url = BESUtil::assemblePath(cmr_search_endpoint_url,"granules.json")
         + "?concept_id="+collection_name
         +"&include_facets=v2"
@@ -441,8 +610,11 @@ CmrApi::get_days(string collection_name, string r_year, string r_month, vector<s
     for (rapidjson::SizeType i = 0; i < days.Size(); i++) { // Uses SizeType instead of size_t
         const rapidjson::Value& day = days[i];
         string day_id = rju.getStringValue(day,"title");
-        days_result.push_back(day_id);
+        result->d_values.push_back(day_id);
     }
+
+    days_result.insert(days_result.end(), result->d_values.begin(), result->d_values.end());
+    if (get_result_cache()) get_result_cache()->add(result.release(), key);
 }
 
 
@@ -450,21 +622,17 @@ CmrApi::get_days(string collection_name, string r_year, string r_month, vector<s
 /**
  *
  */
+class GranuleIdCollector: public GranuleVisitor {
+    vector<string> &d_ids;
+public:
+    GranuleIdCollector(vector<string> &ids) : d_ids(ids) { }
+    virtual void visit(Granule &granule) { d_ids.push_back(granule.getId()); }
+};
+
 void
 CmrApi::get_granule_ids(string collection_name, string r_year, string r_month, string r_day, vector<string> &granules_ids){
-    rjson_utils rju;
-    stringstream msg;
-    rapidjson::Document cmr_doc;
-
-    granule_search(collection_name, r_year, r_month, r_day, cmr_doc);
-
-    const rapidjson::Value& entries = get_entries(cmr_doc);
-    for (rapidjson::SizeType i = 0; i < entries.Size(); i++) { // Uses SizeType instead of size_t
-        const rapidjson::Value& granule = entries[i];
-        string day_id = rju.getStringValue(granule,"id");
-        granules_ids.push_back(day_id);
-    }
-
+    GranuleIdCollector collector(granules_ids);
+    get_granules(collection_name, r_year, r_month, r_day, collector);
 }
 
 
@@ -475,23 +643,25 @@ unsigned long
 CmrApi::granule_count(string collection_name, string r_year, string r_month, string r_day){
     stringstream msg;
     rapidjson::Document cmr_doc;
-    granule_search(collection_name, r_year, r_month, r_day, cmr_doc);
+    unsigned long hits = granule_search(collection_name, r_year, r_month, r_day, cmr_doc);
+    if (hits) return hits;
     const rapidjson::Value& entries = get_entries(cmr_doc);
     return entries.Size();
 }
 
 /**
- * Locates granules in the collection matching the year, month, and day. Any or all of
- * year, month, and day may be the empty string.
+ * Build the URL for one page of a granule search.
  */
-void
-CmrApi::granule_search(string collection_name, string r_year, string r_month, string r_day, rapidjson::Document &result_doc){
-    rjson_utils rju;
-
+string
+CmrApi::granule_search_url(const string &collection_name, const string &r_year, const string &r_month, const string &r_day,
+    unsigned long page_num){
     string url = BESUtil::assemblePath(cmr_search_endpoint_url,"granules.json")
         + "?concept_id="+collection_name
         + "&include_facets=v2"
-        + "&page_size=2000";
+        + "&page_size=" + libdap::long_to_string(CMR_PAGE_SIZE);
+
+    if (page_num > 1)
+        url += "&page_num=" + libdap::long_to_string(page_num);
 
     if(!r_year.empty())
         url += "&temporal_facet[0][year]="+r_year;
@@ -502,31 +672,129 @@ CmrApi::granule_search(string collection_name, string r_year, string r_month, st
     if(!r_day.empty())
         url += "&temporal_facet[0][day]="+r_day;
 
+    return url;
+}
+
+/**
+ * Locates granules in the collection matching the year, month, and day. Any or all of
+ * year, month, and day may be the empty string. Only the first page of results is
+ * returned.
+ *
+ * @return The total number of matching granules (the CMR-Hits header) or zero if
+ * CMR did not say.
+ */
+unsigned long
+CmrApi::granule_search(string collection_name, string r_year, string r_month, string r_day, rapidjson::Document &result_doc){
+    rjson_utils rju;
+
+    string url = granule_search_url(collection_name, r_year, r_month, r_day, 1);
+
     BESDEBUG(MODULE, prolog << "CMR Granule Search Request Url: : " << url << endl);
-    rju.getJsonDoc(url,result_doc);
+    unsigned long hits = 0;
+    rju.getJsonDoc(url,result_doc,hits);
     BESDEBUG(MODULE, prolog << "Got JSON Document: "<< endl << rju.jsonDocToString(result_doc) << endl);
+
+    return hits;
 }
 
 
 
 /**
- * Returns all of the Granules in the collection matching the date.
+ * Passes each of the Granules in the collection matching the date to the
+ * visitor, in the order CMR returns them. Each page of results is released
+ * once its Granules have been visited. If CMR has more than one page of
+ * results, the pages after the first are retrieved CMR.SearchThreads at a
+ * time, in parallel.
  */
 void
-CmrApi::get_granules(string collection_name, string r_year, string r_month, string r_day, vector<Granule *> &granules){
-    stringstream msg;
-    rapidjson::Document cmr_doc;
+CmrApi::get_granules(string collection_name, string r_year, string r_month, string r_day, GranuleVisitor &visitor){
+    string key = "granules/" + collection_name + "/" + r_year + "/" + r_month + "/" + r_day;
+    CmrResult *cached = get_cached_result(key);
+    if (cached) {
+        for (size_t i = 0; i < cached->d_granules.size(); i++)
+            visitor.visit(cached->d_granules[i]);
+        return;
+    }
 
-    granule_search(collection_name, r_year, r_month, r_day, cmr_doc);
+    // Only save the granules if they can be cached.
+    auto_ptr<CmrResult> result(get_result_cache() ? new CmrResult() : 0);
 
-    const rapidjson::Value& entries = get_entries(cmr_doc);
-    for (rapidjson::SizeType i = 0; i < entries.Size(); i++) { // Uses SizeType instead of size_t
-        const rapidjson::Value& granule_obj = entries[i];
-        // rapidjson::Value grnl(granule_obj, cmr_doc.GetAllocator());
-        Granule *g = new Granule(granule_obj);
-        granules.push_back(g);
+    unsigned long pages = 1;
+    {
+        rapidjson::Document cmr_doc;
+        unsigned long hits = granule_search(collection_name, r_year, r_month, r_day, cmr_doc);
+        if (hits > CMR_PAGE_SIZE) pages = (hits + CMR_PAGE_SIZE - 1) / CMR_PAGE_SIZE;
+
+        const rapidjson::Value& entries = get_entries(cmr_doc);
+        for (rapidjson::SizeType i = 0; i < entries.Size(); i++) { // Uses SizeType instead of size_t
+            Granule granule(entries[i]);
+            if (result.get()) result->d_granules.push_back(granule);
+            visitor.visit(granule);
+        }
+    }
+    BESDEBUG(MODULE, prolog << "Granule search for " << key << " has " << pages << " page(s)" << endl);
+
+    unsigned long threads = TheBESKeys::TheKeys()->read_int_key(CMR_SEARCH_THREADS, 4);
+    if (threads < 1) threads = 1;
+
+    for (unsigned long first = 2; first <= pages; first += threads) {
+        unsigned long last = min(first + threads - 1, pages);
+
+        vector<granule_page *> batch;
+        vector<pthread_t> tids;
+        for (unsigned long page_num = first; page_num <= last; page_num++) {
+            batch.push_back(new granule_page(granule_search_url(collection_name, r_year, r_month, r_day, page_num)));
+            pthread_t tid;
+            if (batch.size() > 1 && pthread_create(&tid, 0, fetch_granule_page, batch.back()) == 0)
+                tids.push_back(tid);
+            else if (batch.size() > 1)
+                fetch_granule_page(batch.back());
+        }
+        // This thread gets the first page of the batch itself.
+        fetch_granule_page(batch[0]);
+        for (size_t i = 0; i < tids.size(); i++)
+            pthread_join(tids[i], 0);
+
+        try {
+            for (size_t p = 0; p < batch.size(); p++) {
+                if (!batch[p]->error.empty()) throw CmrError(batch[p]->error, __FILE__, __LINE__);
+
+                const rapidjson::Value& entries = get_entries(batch[p]->doc);
+                for (rapidjson::SizeType i = 0; i < entries.Size(); i++) {
+                    Granule granule(entries[i]);
+                    if (result.get()) result->d_granules.push_back(granule);
+                    visitor.visit(granule);
+                }
+
+                delete batch[p];
+                batch[p] = 0;
+            }
+        }
+        catch (...) {
+            for (size_t p = 0; p < batch.size(); p++)
+                delete batch[p];
+            throw;
+        }
     }
 
+    if (result.get()) get_result_cache()->add(result.release(), key);
+}
+
+class GranuleCollector: public GranuleVisitor {
+    vector<Granule *> &d_granules;
+public:
+    GranuleCollector(vector<Granule *> &granules) : d_granules(granules) { }
+    virtual void visit(Granule &granule) { d_granules.push_back(new Granule(granule)); }
+};
+
+/**
+ * Returns all of the Granules in the collection matching the date. The caller
+ * must delete them.
+ */
+void
+CmrApi::get_granules(string collection_name, string r_year, string r_month, string r_day, vector<Granule *> &granules){
+    GranuleCollector collector(granules);
+    get_granules(collection_name, r_year, r_month, r_day, collector);
 }
 
 
@@ -546,23 +814,29 @@ CmrApi::get_collection_ids(std::vector<std::string> &collection_ids){
 /**
  * Returns all of the Granules in the collection matching the date.
  */
-cmr::Granule* CmrApi::get_granule(string collection_name, string r_year, string r_month, string r_day, string granule_id)
-{
-    vector<Granule *> granules;
-    Granule *result = 0;
-
-    get_granules(collection_name, r_year, r_month, r_day, granules);
-    for(size_t i=0; i<granules.size() ;i++){
-        string id = granules[i]->getName();
-        BESDEBUG(MODULE, prolog << "Comparing granule id: " << granule_id << " to collection member id: " << id << endl);
-        if( id == granule_id){
-            result = granules[i];
-        }
-        else {
-            delete granules[i];
-            granules[i] = 0;
+class GranuleFinder: public GranuleVisitor {
+    const string &d_name;
+public:
+    Granule *d_granule;
+
+    GranuleFinder(const string &name) : d_name(name), d_granule(0) { }
+    virtual ~GranuleFinder() { delete d_granule; }
+    virtual void visit(Granule &granule) {
+        BESDEBUG(MODULE, "GranuleFinder::visit() - Comparing granule id: " << d_name << " to collection member id: " << granule.getName() << endl);
+        if (granule.getName() == d_name) {
+            delete d_granule;
+            d_granule = new Granule(granule);
         }
     }
+};
+
+cmr::Granule* CmrApi::get_granule(string collection_name, string r_year, string r_month, string r_day, string granule_id)
+{
+    GranuleFinder finder(granule_id);
+    get_granules(collection_name, r_year, r_month, r_day, finder);
+
+    Granule *result = finder.d_granule;
+    finder.d_granule = 0;
     return result;
 }
 
@@ -41,7 +41,25 @@
 
 namespace cmr {
 
+/**
+ * Receives the granules found by CmrApi::get_granules() one at a time, so
+ * callers do not have to hold all of them in memory at once.
+ */
+class GranuleVisitor {
+public:
+    virtual ~GranuleVisitor() { }
+    virtual void visit(Granule &granule) = 0;
+};
 
+/**
+ * Queries CMR for the temporal facets and granules of a collection.
+ *
+ * Granule searches that match more than one page of results fetch the
+ * remaining pages in parallel (CMR.SearchThreads at a time). Those pages
+ * are not saved in the CMR (file) cache, which cannot be shared by threads.
+ * If CMR.MemCache.Entries is set, the results of the queries are held in a
+ * per-process memory cache for CMR.MemCache.TTL seconds.
+ */
 class CmrApi {
 private:
     std::string cmr_search_endpoint_url;
@@ -54,11 +72,13 @@ private:
     const rapidjson::Value& get_children(const rapidjson::Value& obj);
     const rapidjson::Value& get_feed(const rapidjson::Document &cmr_doc);
     const rapidjson::Value& get_entries(const rapidjson::Document &cmr_doc);
-    void  granule_search(std::string collection_name, std::string r_year, std::string r_month, std::string r_day,rapidjson::Document &result_doc);
+    std::string granule_search_url(const std::string &collection_name, const std::string &r_year, const std::string &r_month,
+        const std::string &r_day, unsigned long page_num);
+    unsigned long granule_search(std::string collection_name, std::string r_year, std::string r_month, std::string r_day,rapidjson::Document &result_doc);
 
 
 public:
-    CmrApi() : cmr_search_endpoint_url("https://cmr.earthdata.nasa.gov/search") {}
+    CmrApi();
 
     void get_years(std::string collection_name, std::vector<std::string> &years_result);
     void get_months(std::string collection_name, std::string year, std::vector<std::string> &months_result);
@@ -66,6 +86,7 @@ public:
     void get_granule_ids(std::string collection_name, std::string r_year, std::string r_month, std::string r_day, std::vector<std::string> &granules_result);
     void get_granule_ids(std::string collection_name, std::string r_year, std::string r_month, std::vector<std::string> &granules_result);
     void get_granules(std::string collection_name, std::string r_year, std::string r_month, std::string r_day, std::vector<cmr::Granule *> &granules);
+    void get_granules(std::string collection_name, std::string r_year, std::string r_month, std::string r_day, GranuleVisitor &visitor);
     void get_collection_ids(std::vector<std::string> &collection_ids);
     unsigned long granule_count(std::string collection_name,std:: string r_year, std::string r_month, std::string r_day);
     cmr::Granule *get_granule(const std::string path);
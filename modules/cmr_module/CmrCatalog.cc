@@ -71,6 +71,17 @@ using namespace std;
 
 namespace cmr {
 
+/**
+ * Add a leaf to a CatalogNode for each Granule the CmrApi finds.
+ */
+class GranuleLeafBuilder: public GranuleVisitor {
+    CatalogNode *d_node;
+    BESCatalogUtils *d_utils;
+public:
+    GranuleLeafBuilder(CatalogNode *node, BESCatalogUtils *utils) : d_node(node), d_utils(utils) { }
+    virtual void visit(Granule &granule) { d_node->add_leaf(granule.getCatalogItem(d_utils)); }
+};
+
 /**
  * @brief A catalog based on NASA's CMR system
  *
@@ -234,11 +245,8 @@ CmrCatalog::get_node_NEW(const string &ppath) const
                     string month = path_elements[3];
                     string day = path_elements[4];
                     BESDEBUG(MODULE, prolog << "Getting granule leaves for collection: " << collection << " year: " << year << " month: " << month <<  " day: " << day << endl);
-                    vector<Granule *> granules;
-                    cmrApi.get_granules(collection, year, month, day, granules);
-                    for(size_t i=0; i<granules.size() ; i++){
-                        node->add_leaf(granules[i]->getCatalogItem(get_catalog_utils()));
-                    }
+                    GranuleLeafBuilder leaf_builder(node, get_catalog_utils());
+                    cmrApi.get_granules(collection, year, month, day, leaf_builder);
                 }
                 break;
 
@@ -435,11 +443,8 @@ CmrCatalog::get_node_OLD(const string &ppath) const
                     string month = path_elements[3];
                     string day = path_elements[4];
                     BESDEBUG(MODULE, prolog << "Getting granule leaves for collection: " << collection << " year: " << year << " month: " << month <<  " day: " << day << endl);
-                    vector<Granule *> granules;
-                    cmrApi.get_granules(collection, year, month, day, granules);
-                    for(size_t i=0; i<granules.size() ; i++){
-                        node->add_leaf(granules[i]->getCatalogItem(get_catalog_utils()));
-                    }
+                    GranuleLeafBuilder leaf_builder(node, get_catalog_utils());
+                    cmrApi.get_granules(collection, year, month, day, leaf_builder);
                 }
                     break;
                 default:
@@ -34,6 +34,10 @@
 // These are the names of the be keys used to configure the handler.
 #define CMR_COLLECTIONS "CMR.Collections"
 #define CMR_FACETS "CMR.Facets"
+#define CMR_SEARCH_ENDPOINT "CMR.SearchEndpoint"
+#define CMR_SEARCH_THREADS "CMR.SearchThreads"
+#define CMR_MEM_CACHE_ENTRIES "CMR.MemCache.Entries"
+#define CMR_MEM_CACHE_TTL "CMR.MemCache.TTL"
 
 #define CMR_WHITELIST "Cmr.Whitelist"
 #define CMR_MIMELIST "Cmr.MimeTypes"
@@ -29,6 +29,7 @@
 
 #include "util.h"
 #include "BESDebug.h"
+#include "BESDeadline.h"
 #include "BESSyntaxUserError.h"
 #include "CmrUtils.h"
 #include "WhiteList.h"
@@ -577,6 +578,11 @@ long read_url(CURL *curl,
     // value/result parameter to get the raw response header information .
     curl_easy_setopt(curl, CURLOPT_WRITEHEADER, resp_hdrs);
 
+    // Limit the transfer to the time left before the request's deadline (0 is no limit)
+    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+    long timeout_ms = BESDeadline::TheDeadline()->remaining_ms();
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms < 0 ? 0L : std::max(timeout_ms, 1L));
+
     // This call is the one that makes curl go get the thing.
     CURLcode res = curl_easy_perform(curl);
 
@@ -585,6 +591,7 @@ long read_url(CURL *curl,
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, 0);
 
     if (res != 0){
+        BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
         BESDEBUG(MODULE, prolog << "OUCH! CURL returned an error! curl msg:  " << curl_easy_strerror(res) << endl);
         BESDEBUG(MODULE, prolog << "OUCH! CURL returned an error! error_buffer:  " << error_buffer << endl);
         throw libdap::Error(error_buffer);
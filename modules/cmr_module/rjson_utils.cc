@@ -22,6 +22,7 @@
 //
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 //
+#include <cstdlib>
 #include <sstream>
 
 #include "rapidjson/document.h"
@@ -55,15 +56,26 @@ namespace cmr {
  */
 void
 rjson_utils::getJsonDoc(const string &url, rapidjson::Document &doc){
+    unsigned long cmr_hits;
+    getJsonDoc(url, doc, cmr_hits);
+}
+
+/**
+ * Retrieve and parse a JSON document, returning the number of matching
+ * items CMR reported in the response's CMR-Hits header.
+ *
+ * @param url The URL of the document
+ * @param doc Value-result parameter for the parsed document
+ * @param cmr_hits Value-result parameter; zero if the response had no CMR-Hits header
+ */
+void
+rjson_utils::getJsonDoc(const string &url, rapidjson::Document &doc, unsigned long &cmr_hits){
     BESDEBUG(MODULE,prolog << "Trying url: " << url << endl);
     cmr::RemoteHttpResource rhr(url);
     rhr.retrieveResource();
-    if(BESDebug::IsSet(MODULE)){
-        string cmr_hits = rhr.get_http_response_header("cmr-hits");
-        stringstream msg(prolog);
-        msg << "CMR-Hits: "<< cmr_hits << endl;
-        *(BESDebug::GetStrm()) << msg.str();
-    }
+    string hits = rhr.get_http_response_header("cmr-hits");
+    BESDEBUG(MODULE, prolog << "CMR-Hits: "<< hits << endl);
+    cmr_hits = hits.empty() ? 0 : strtoul(hits.c_str(), 0, 10);
     FILE* fp = fopen(rhr.getCacheFileName().c_str(), "r"); // non-Windows use "r"
     char readBuffer[65536];
     rapidjson::FileReadStream frs(fp, readBuffer, sizeof(readBuffer));
@@ -42,6 +42,7 @@ namespace cmr {
 class rjson_utils {
 public:
     void getJsonDoc(const std::string &url, rapidjson::Document &d);
+    void getJsonDoc(const std::string &url, rapidjson::Document &d, unsigned long &cmr_hits);
     std::string getStringValue(const rapidjson::Value& object, const std::string &name);
     // bool getBooleanValue(const rapidjson::Value& object, const std::string name);
     std::string jsonDocToString(rapidjson::Document &d);
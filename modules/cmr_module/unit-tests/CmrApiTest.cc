@@ -21,7 +21,16 @@
 //
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <fstream>
 #include <memory>
+#include <sstream>
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
@@ -64,6 +73,99 @@ static bool bes_debug = false;
 
 namespace cmr {
 
+/**
+ * Serve canned granule search results from a child process. Page N of any
+ * search is the file page_N.json in the granule_search data directory and
+ * every response has the given CMR-Hits header. Requests for pages that do
+ * not exist get a 500 response.
+ */
+class CannedCmrServer {
+private:
+    int d_sock;
+    int d_port;
+    pid_t d_pid;
+    string d_dir;
+    unsigned long d_hits;
+
+    static string read_file(const string &name)
+    {
+        ifstream ifs(name.c_str());
+        return string((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    }
+
+    void respond(int client)
+    {
+        string request;
+        char buf[1024];
+        ssize_t n;
+        while (request.find("\r\n\r\n") == string::npos && (n = read(client, buf, sizeof(buf))) > 0)
+            request.append(buf, n);
+
+        string request_line = request.substr(0, request.find("\r\n"));
+        string page = "1";
+        string::size_type pos = request_line.find("page_num=");
+        if (pos != string::npos) {
+            pos += strlen("page_num=");
+            page = request_line.substr(pos, request_line.find_first_not_of("0123456789", pos) - pos);
+        }
+
+        string body = read_file(d_dir + "/page_" + page + ".json");
+        ostringstream response;
+        response << (body.empty() ? "HTTP/1.1 500 Internal Server Error" : "HTTP/1.1 200 OK") << "\r\n"
+            << "Content-Type: application/json; charset=utf-8\r\n"
+            << "CMR-Hits: " << d_hits << "\r\n"
+            << "Content-Length: " << body.size() << "\r\n"
+            << "Connection: close\r\n\r\n" << body;
+
+        string r = response.str();
+        for (string::size_type done = 0; done < r.size() && (n = write(client, r.data() + done, r.size() - done)) > 0;)
+            done += n;
+    }
+
+public:
+    CannedCmrServer(unsigned long hits) :
+        d_sock(-1), d_port(0), d_pid(-1), d_dir(string(TEST_SRC_DIR) + "/../data/granule_search"), d_hits(hits)
+    {
+        d_sock = socket(AF_INET, SOCK_STREAM, 0);
+        CPPUNIT_ASSERT(d_sock != -1);
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        CPPUNIT_ASSERT(bind(d_sock, (struct sockaddr *) &addr, len) == 0);
+        CPPUNIT_ASSERT(listen(d_sock, 16) == 0);
+        CPPUNIT_ASSERT(getsockname(d_sock, (struct sockaddr *) &addr, &len) == 0);
+        d_port = ntohs(addr.sin_port);
+
+        d_pid = fork();
+        CPPUNIT_ASSERT(d_pid != -1);
+        if (d_pid == 0) {
+            for (;;) {
+                int client = accept(d_sock, 0, 0);
+                if (client == -1) continue;
+                respond(client);
+                close(client);
+            }
+        }
+    }
+
+    ~CannedCmrServer()
+    {
+        kill(d_pid, SIGTERM);
+        waitpid(d_pid, 0, 0);
+        close(d_sock);
+    }
+
+    /// @return The CMR search endpoint served by this server
+    string endpoint() const
+    {
+        return "http://localhost:" + libdap::long_to_string(d_port) + "/search";
+    }
+};
+
 class CmrApiTest: public CppUnit::TestFixture {
 private:
 
@@ -116,6 +218,8 @@ public:
     // Called after each test
     void tearDown()
     {
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_ENDPOINT, "");
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_THREADS, "");
     }
 
 
@@ -585,6 +689,52 @@ public:
         CPPUNIT_ASSERT(gct_helper("C1276812822-GES_DISC", "2000",   "", "") == 366); // 2000 is a leap year
     }
 
+    // 4001 hits is three pages; the second and third are fetched in parallel.
+    void get_granules_paged_test() {
+        CannedCmrServer server(4001);
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_ENDPOINT, server.endpoint());
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_THREADS, "2");
+
+        CmrApi cmr;
+        vector<Granule *> granules;
+        cmr.get_granules("C0000000001-TEST", "2020", "01", "", granules);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 5, granules.size());
+        for (size_t i = 0; i < granules.size(); ++i) {
+            string n = libdap::long_to_string(i + 1);
+            DBG(cerr << "granule: " << granules[i]->getName() << endl);
+            CPPUNIT_ASSERT_EQUAL(string("G" + n + "-TEST"), granules[i]->getId());
+            CPPUNIT_ASSERT_EQUAL(string("granule_" + n + ".nc"), granules[i]->getName());
+            CPPUNIT_ASSERT_EQUAL(string("http://test.opendap.org/data/granule_" + n + ".nc"),
+                granules[i]->getDataAccessUrl());
+            delete granules[i];
+        }
+    }
+
+    // One page at a time gets the same granules, in the same order
+    void get_granules_paged_one_thread_test() {
+        CannedCmrServer server(4001);
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_ENDPOINT, server.endpoint());
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_THREADS, "1");
+
+        CmrApi cmr;
+        vector<string> ids;
+        cmr.get_granule_ids("C0000000001-TEST", "2020", "02", "", ids);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 5, ids.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+            CPPUNIT_ASSERT_EQUAL(string("G" + libdap::long_to_string(i + 1) + "-TEST"), ids[i]);
+    }
+
+    // 6001 hits is four pages but the server has only three
+    void get_granules_page_error_test() {
+        CannedCmrServer server(6001);
+        TheBESKeys::TheKeys()->set_key(CMR_SEARCH_ENDPOINT, server.endpoint());
+
+        CmrApi cmr;
+        vector<string> ids;
+        CPPUNIT_ASSERT_THROW(cmr.get_granule_ids("C0000000001-TEST", "2020", "03", "", ids), CmrError);
+    }
 
     CPPUNIT_TEST_SUITE( CmrApiTest );
 
@@ -596,6 +746,9 @@ public:
     CPPUNIT_TEST(get_granules_month_test);
     CPPUNIT_TEST(get_granules_data_access_urls_month_test);
     CPPUNIT_TEST(granule_count_test);
+    CPPUNIT_TEST(get_granules_paged_test);
+    CPPUNIT_TEST(get_granules_paged_one_thread_test);
+    CPPUNIT_TEST(get_granules_page_error_test);
 
 
     CPPUNIT_TEST_SUITE_END();
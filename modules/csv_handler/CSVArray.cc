@@ -0,0 +1,123 @@
+// CSVArray.cc
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include <vector>
+#include <string>
+
+#include "CSVArray.h"
+#include "CSV_Obj.h"
+
+#include <BESInternalError.h>
+#include <BESNotFoundError.h>
+#include <BESDebug.h>
+
+using namespace libdap;
+
+using std::string;
+using std::vector;
+using std::endl;
+
+/**
+ * Set the array's values using the values of the field. If the array is
+ * constrained, only the values selected by the constraint are used.
+ */
+template<typename T>
+static void set_field_values(Array *ar, vector<T> *values)
+{
+	Array::Dim_iter d = ar->dim_begin();
+	int start = ar->dimension_start(d, true);
+	int stride = ar->dimension_stride(d, true);
+	int stop = ar->dimension_stop(d, true);
+
+	if (start == 0 && stride == 1 && stop == (int) values->size() - 1) {
+		ar->set_value(*values, values->size());
+	}
+	else {
+		vector<T> subset;
+		subset.reserve(ar->length());
+		for (int i = start; i <= stop; i += stride) {
+			subset.push_back(values->at(i));
+		}
+		ar->set_value(subset, subset.size());
+	}
+}
+
+CSVArray::CSVArray(const string &n, const string &d, BaseType *v) :
+		Array(n, d, v)
+{
+}
+
+CSVArray::CSVArray(const CSVArray &rhs) :
+		Array(rhs)
+{
+}
+
+CSVArray::~CSVArray()
+{
+}
+
+BaseType *
+CSVArray::ptr_duplicate()
+{
+	return new CSVArray(*this);
+}
+
+bool CSVArray::read()
+{
+	if (read_p()) return true;
+
+	BESDEBUG("csv", "CSVArray::read() - Reading field " << name() << " from " << dataset() << endl);
+
+	CSV_Obj csvObj;
+	if (!csvObj.open(dataset())) {
+		throw BESNotFoundError(string("Unable to open file ").append(dataset()), __FILE__, __LINE__);
+	}
+	csvObj.load();
+
+	string type = csvObj.getFieldType(name());
+	void *data = csvObj.getFieldData(name());
+
+	if (type.compare(string(STRING)) == 0) {
+		set_field_values(this, (vector<string>*) data);
+	}
+	else if (type.compare(string(INT16)) == 0) {
+		set_field_values(this, (vector<dods_int16>*) data);
+	}
+	else if (type.compare(string(INT32)) == 0) {
+		set_field_values(this, (vector<dods_int32>*) data);
+	}
+	else if (type.compare(string(FLOAT32)) == 0) {
+		set_field_values(this, (vector<dods_float32>*) data);
+	}
+	else if (type.compare(string(FLOAT64)) == 0) {
+		set_field_values(this, (vector<dods_float64>*) data);
+	}
+	else {
+		throw BESInternalError(string("Unknown type for field ").append(name()), __FILE__, __LINE__);
+	}
+
+	set_read_p(true);
+
+	return true;
+}
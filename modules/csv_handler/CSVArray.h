@@ -0,0 +1,48 @@
+// CSVArray.h
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef I_CSVArray_h
+#define I_CSVArray_h 1
+
+#include <string>
+
+#include <Array.h>
+
+/**
+ * One field of a CSV file. The field's values are read when the array
+ * is read, so building a DDS or DMR does not read any values and a data
+ * request reads only the fields it projects.
+ */
+class CSVArray: public libdap::Array {
+public:
+	CSVArray(const std::string &n, const std::string &d, libdap::BaseType *v);
+	CSVArray(const CSVArray &rhs);
+	virtual ~CSVArray();
+
+	virtual libdap::BaseType *ptr_duplicate();
+
+	virtual bool read();
+};
+
+#endif // I_CSVArray_h
@@ -50,9 +50,11 @@ using std::string;
 
 #include <BESLog.h>
 #include <BESDebug.h>
+#include <TheBESKeys.h>
 
 #include "CSVRequestHandler.h"
 #include "CSVModule.h"
+#include "CSV_Reader.h"
 
 #define CSV_NAME "csv"
 #define CSV_CATALOG "catalog"
@@ -75,6 +77,12 @@ void CSVModule::initialize(const string &modname)
 
 	BESDebug::Register("csv");
 
+	// Number of CSV record indexes each BES process caches; zero disables
+	// the cache. Each column of a dataset is read by its own CSVArray, so
+	// without the cache the file's records are found once per column.
+	int entries = TheBESKeys::TheKeys()->read_int_key("CSV.IndexCacheEntries", 16);
+	if (entries > 0) CSV_Reader::setIndexCacheEntries(entries);
+
 	BESDEBUG("csv", "Done Initializing CSV Handler: " << modname << endl);
 }
 
@@ -36,10 +36,42 @@
 #include <iostream>
 #include <cstdlib>
 
+#include <sstream>
+
 #include "CSV_Data.h"
+#include "CSV_Reader.h"
+#include "CSV_Utils.h"
+
+#include <BESInternalError.h>
 
 using std::string;
 using std::vector;
+using std::ostringstream;
+
+// Convert the field's value for every record and append them to 'values'
+template<typename T, typename C>
+static void load_column(CSV_Field* field, const CSV_Reader& reader, vector<T>* values, C convert) {
+  int records = reader.getRecordCount();
+  values->reserve(values->size() + records);
+
+  // 'token' is reused so that its storage is allocated only once
+  string token;
+  for(int record = 0; record < records; ++record) {
+    if(!reader.getField(record, field->getIndex(), token)) {
+      ostringstream err;
+      err << "Record " << record << " has no value for field " << field->getName();
+      throw BESInternalError(err.str(), __FILE__, __LINE__);
+    }
+    CSV_Utils::slim(token);
+    values->push_back(convert(token));
+  }
+}
+
+static string to_str(const string& s) { return s; }
+static float to_float32(const string& s) { return atof(s.c_str()); }
+static double to_float64(const string& s) { return atof(s.c_str()); }
+static short to_int16(const string& s) { return atoi(s.c_str()); }
+static int to_int32(const string& s) { return atoi(s.c_str()); }
 
 CSV_Data::CSV_Data() : data(0), type(""), initialized(false) {
 }
@@ -107,6 +139,45 @@ void CSV_Data::insert(CSV_Field* field, void* value) {
   }
 }
 
+/** Read the values of a field for every record, converting them to the
+ * field's type once, as they are read.
+ *
+ * @param field The field
+ * @param reader An open reader for the file that holds the field
+ */
+void CSV_Data::load(CSV_Field* field, const CSV_Reader& reader) {
+  if(initialized)
+    return;
+
+  type = field->getType();
+  if(type.compare(string(STRING)) == 0) {
+    vector<string>* values = new vector<string>();
+    data = values;
+    initialized = true;
+    load_column(field, reader, values, to_str);
+  } else if(type.compare(string(FLOAT32)) == 0) {
+    vector<float>* values = new vector<float>();
+    data = values;
+    initialized = true;
+    load_column(field, reader, values, to_float32);
+  } else if(type.compare(string(FLOAT64)) == 0) {
+    vector<double>* values = new vector<double>();
+    data = values;
+    initialized = true;
+    load_column(field, reader, values, to_float64);
+  } else if(type.compare(string(INT16)) == 0) {
+    vector<short>* values = new vector<short>();
+    data = values;
+    initialized = true;
+    load_column(field, reader, values, to_int16);
+  } else if(type.compare(string(INT32)) == 0) {
+    vector<int>* values = new vector<int>();
+    data = values;
+    initialized = true;
+    load_column(field, reader, values, to_int32);
+  }
+}
+
 void* CSV_Data::getData() {
   return data;
 }
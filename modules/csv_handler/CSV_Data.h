@@ -39,6 +39,8 @@
 
 #include"CSV_Header.h"
 
+class CSV_Reader;
+
 static const char STRING[]  = "String";
 static const char BYTE[]    = "Byte";
 static const char INT32[]   = "Int32";
@@ -52,6 +54,9 @@ class CSV_Data {
   ~CSV_Data();
 
   void insert(CSV_Field* field, void* value);
+  void load(CSV_Field* field, const CSV_Reader& reader);
+
+  bool isLoaded() const { return initialized; }
 
   void* getData();
   std::string getType();
@@ -87,41 +87,19 @@ bool CSV_Obj::open(const string& filepath)
 	return _reader->open(filepath);
 }
 
+/**
+ * Read the header. The values of a field are not read until they are
+ * needed; see getFieldData().
+ */
 void CSV_Obj::load()
 {
 	vector<string> txtLine;
-	bool OnHeader = true;
 	_reader->reset();
-	while (!_reader->eof()) {
-		_reader->get(txtLine);
-
-		if (OnHeader) {
-			if (_header->populate(&txtLine)) {
-				for (unsigned int i = 0; i < txtLine.size(); i++) {
-					_data->push_back(new CSV_Data());
-				}
-			}
-			OnHeader = false;
-		}
-		else if (!txtLine.empty()) {
-			int index = 0;
-			vector<CSV_Data *>::iterator it = _data->begin();
-			vector<CSV_Data *>::iterator et = _data->end();
-			for (; it != et; it++) {
-				CSV_Data *d = (*it);
-				string token = txtLine.at(index);
-				CSV_Utils::slim(token);
-				CSV_Field *f = _header->getField(index);
-				if (!f) {
-					ostringstream err;
-					err << " Attempting to add value " << token << " to field " << index << ", field does not exist";
-					throw BESInternalError(err.str(), __FILE__, __LINE__);
-				}
-				d->insert(f, &token);
-				index++;
-			}
+	_reader->get(txtLine);
+	if (_header->populate(&txtLine)) {
+		for (unsigned int i = 0; i < txtLine.size(); i++) {
+			_data->push_back(new CSV_Data());
 		}
-		txtLine.clear();
 	}
 }
 
@@ -137,27 +115,9 @@ string CSV_Obj::getFieldType(const string& fieldName)
 
 int CSV_Obj::getRecordCount()
 {
-	CSV_Data* alphaField = _data->at(0);
-	string type = alphaField->getType();
+	if (_data->empty()) return -1;
 
-	if (type.compare(string(STRING)) == 0) {
-		return ((vector<string>*) alphaField->getData())->size();
-	}
-	else if (type.compare(string(FLOAT32)) == 0) {
-		return ((vector<float>*) alphaField->getData())->size();
-	}
-	else if (type.compare(string(FLOAT64)) == 0) {
-		return ((vector<double>*) alphaField->getData())->size();
-	}
-	else if (type.compare(string(INT16)) == 0) {
-		return ((vector<short>*) alphaField->getData())->size();
-	}
-	else if (type.compare(string(INT32)) == 0) {
-		return ((vector<int>*) alphaField->getData())->size();
-	}
-	else {
-		return -1;
-	}
+	return _reader->getRecordCount();
 }
 
 void *
@@ -169,6 +129,7 @@ CSV_Obj::getFieldData(const string& field)
 		int index = f->getIndex();
 		CSV_Data *d = _data->at(index);
 		if (d) {
+			d->load(f, *_reader);
 			ret = d->getData();
 		}
 		else {
@@ -32,83 +32,249 @@
 //      pwest       Patrick West <pwest@ucar.edu>
 //      jgarcia     Jose Garcia <jgarcia@ucar.edu>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <DapObj.h>
+#include <ObjMemCache.h>
+
 #include "CSV_Reader.h"
 #include "CSV_Utils.h"
 #include "BESUtil.h"
+#include "BESDebug.h"
 
 using std::ostream;
-using std::fstream;
 using std::endl;
-using std::ios;
 using std::string;
 using std::vector;
 
-CSV_Reader::CSV_Reader()
+ObjMemCache *CSV_Reader::_index_cache = 0;
+
+/**
+ * The line index of a file, as cached. The size and modification time of
+ * the file are used to tell if the index is still good.
+ */
+class CSV_Index: public libdap::DapObj {
+public:
+    off_t _size;
+    time_t _mtime;
+    vector<size_t> _lines;
+
+    CSV_Index(off_t size, time_t mtime, const vector<size_t> &lines) :
+	_size(size), _mtime(mtime), _lines(lines)
+    {
+    }
+    virtual ~CSV_Index()
+    {
+    }
+};
+
+CSV_Reader::CSV_Reader() :
+    _fd(-1), _map(0), _size(0), _current(0)
 {
-    _stream_in = new fstream() ;
 }
 
 CSV_Reader::~CSV_Reader()
 {
-    if( _stream_in )
+    close() ;
+}
+
+bool
+CSV_Reader::open( const string& filepath )
+{
+    _filepath = filepath ;
+    _fd = ::open( filepath.c_str(), O_RDONLY ) ;
+    if( _fd < 0 )
+    {
+	return false ;
+    }
+
+    struct stat buf ;
+    if( fstat( _fd, &buf ) != 0 )
     {
-	if( _stream_in->is_open() )
+	close() ;
+	return false ;
+    }
+
+    _size = buf.st_size ;
+    if( _size > 0 )
+    {
+	void *map = mmap( 0, _size, PROT_READ, MAP_PRIVATE, _fd, 0 ) ;
+	if( map == MAP_FAILED )
+	{
+	    close() ;
+	    return false ;
+	}
+	_map = static_cast<const char *>( map ) ;
+    }
+
+    CSV_Index *cached = 0 ;
+    if( _index_cache )
+    {
+	cached = dynamic_cast<CSV_Index *>( _index_cache->get( filepath ) ) ;
+	if( cached && ( cached->_size != buf.st_size || cached->_mtime != buf.st_mtime ) )
+	{
+	    _index_cache->remove( filepath ) ;
+	    cached = 0 ;
+	}
+    }
+
+    if( cached )
+    {
+	BESDEBUG( "csv", "CSV_Reader::open() - Using the cached index for " << filepath << endl ) ;
+	_lines = cached->_lines ;
+    }
+    else
+    {
+	index() ;
+	if( _index_cache )
 	{
-	    _stream_in->close();
+	    _index_cache->add( new CSV_Index( buf.st_size, buf.st_mtime, _lines ), filepath ) ;
 	}
-	delete _stream_in;
-	_stream_in = 0 ;
     }
+
+    _current = 0 ;
+    return true ;
 }
 
-bool
-CSV_Reader::open( const string& filepath )
+/** @brief Find the start of the header and of every non-empty line after it
+ */
+void
+CSV_Reader::index()
 {
-    bool ret = false ;
-    _filepath = filepath ;
-    _stream_in->open( filepath.c_str(), fstream::in ) ;
-    if( !(_stream_in->fail()) && _stream_in->is_open() )
+    _lines.clear() ;
+    if( _size == 0 )
     {
-	ret = true ;
+	return ;
     }
-    return ret ;
+
+    // The header is the first line, even if it is empty
+    _lines.push_back( 0 ) ;
+    const char *p = _map ;
+    const char *end = _map + _size ;
+    while( (p = (const char *)memchr( p, '\n', end - p )) )
+    {
+	++p ;
+	if( p == end )
+	{
+	    break ;
+	}
+	if( *p != '\n' )
+	{
+	    _lines.push_back( p - _map ) ;
+	}
+    }
+
+    BESDEBUG( "csv", "CSV_Reader::index() - Found " << getRecordCount() << " records in " << _filepath << endl ) ;
+}
+
+/** @brief Get the start and length (without the newline) of an indexed line
+ */
+void
+CSV_Reader::line( vector<size_t>::size_type n, const char *&start, size_t &length ) const
+{
+    start = _map + _lines[n] ;
+    const char *end = (const char *)memchr( start, '\n', _size - _lines[n] ) ;
+    length = end ? (size_t)(end - start) : _size - _lines[n] ;
 }
 
 bool
-CSV_Reader::close() const
+CSV_Reader::close()
 {
-    bool ret = false ;
-    if( _stream_in )
+    bool ret = true ;
+    if( _map )
+    {
+	if( munmap( const_cast<char *>( _map ), _size ) != 0 )
+	{
+	    ret = false ;
+	}
+	_map = 0 ;
+    }
+    if( _fd >= 0 )
     {
-	_stream_in->close() ;
-	if( !(_stream_in->bad()) && !(_stream_in->is_open()) )
+	if( ::close( _fd ) != 0 )
 	{
-	    ret = true ;
+	    ret = false ;
 	}
+	_fd = -1 ;
     }
+    _lines.clear() ;
+    _current = 0 ;
     return ret ;
 }
 
 bool
 CSV_Reader::eof() const
 {
-    return _stream_in->eof() ;
+    return _current >= _lines.size() ;
 }
 
 void
 CSV_Reader::reset()
 {
-    _stream_in->seekg( ios::beg ) ;
+    _current = 0 ;
 }
 
-
+/** @brief Get the fields of the next line
+ *
+ * The header is the first line returned; empty lines are skipped.
+ */
 void
 CSV_Reader::get( vector<string> &row )
 {
-    string line ;
+    if( eof() )
+    {
+	return ;
+    }
+
+    const char *start = 0 ;
+    size_t length = 0 ;
+    line( _current++, start, length ) ;
+    CSV_Utils::split( string( start, length ), ',', row ) ;
+}
+
+/** @brief The number of records (non-empty lines after the header)
+ */
+int
+CSV_Reader::getRecordCount() const
+{
+    return _lines.empty() ? 0 : _lines.size() - 1 ;
+}
+
+/** @brief Get one field of a record
+ *
+ * @param record Zero-based record number
+ * @param column Zero-based field number
+ * @param token Value-result parameter that holds the field, as it appears
+ * in the file
+ * @return false if the record has fewer fields than 'column'
+ */
+bool
+CSV_Reader::getField( int record, int column, string &token ) const
+{
+    const char *start = 0 ;
+    size_t length = 0 ;
+    line( record + 1, start, length ) ;
+    return CSV_Utils::field( start, length, ',', column, token ) ;
+}
 
-    getline( *_stream_in, line ) ;
-    CSV_Utils::split( line, ',', row ) ;
+/** @brief Set the number of line indexes cached by each BES process
+ *
+ * @param entries Zero disables the cache
+ */
+void
+CSV_Reader::setIndexCacheEntries( unsigned int entries )
+{
+    if( entries > 0 && !_index_cache )
+    {
+	_index_cache = new ObjMemCache( entries, 0.2 ) ;
+	BESDEBUG( "csv", "CSV_Reader::setIndexCacheEntries() - Caching up to " << entries << " indexes" << endl ) ;
+    }
 }
 
 void
@@ -117,9 +283,10 @@ CSV_Reader::dump( ostream &strm ) const
     strm << BESIndent::LMarg << "CSV_Reader::dump - ("
 	 << (void *)this << ")" << endl ;
     BESIndent::Indent() ;
-    if( _stream_in )
+    if( _map )
     {
 	strm << BESIndent::LMarg << "File " << _filepath << " is open" << endl ;
+	strm << BESIndent::LMarg << "records: " << getRecordCount() << endl ;
     }
     else
     {
@@ -43,22 +43,50 @@
 
 #include <BESObj.h>
 
+class ObjMemCache;
+
+/**
+ * Reads a CSV file using a memory map of the file and an index of the
+ * offsets of its lines. The index is built by open() with one pass over
+ * the mapped file; the first line is the header and the remaining non-empty
+ * lines are the records. Fields of a record are found by scanning only that
+ * record's line, so a column can be read without splitting every field of
+ * every record.
+ *
+ * The indexes can be cached (by file path) for use by later requests, see
+ * setIndexCacheEntries().
+ */
 class CSV_Reader: public BESObj {
 private:
 	std::string _filepath;
-	std::fstream * _stream_in;
+	int _fd;
+	const char * _map;
+	size_t _size;
+	std::vector<size_t> _lines;	// start of the header, then each record
+	std::vector<size_t>::size_type _current;
+
+	static ObjMemCache * _index_cache;
+
+	void index();
+	void line(std::vector<size_t>::size_type n, const char *&start, size_t &length) const;
+
 public:
 	CSV_Reader();
 	virtual ~CSV_Reader();
 
 	bool open(const std::string& filepath);
-	bool close() const;
+	bool close();
 	bool eof() const;
 
 	void reset();
 
 	void get(std::vector<std::string> &row);
 
+	int getRecordCount() const;
+	bool getField(int record, int column, std::string &token) const;
+
+	static void setIndexCacheEntries(unsigned int entries);
+
 	virtual void dump(std::ostream &strm) const;
 };
 
@@ -33,10 +33,12 @@
 //      jgarcia     Jose Garcia <jgarcia@ucar.edu>
 
 #include <list>
+#include <cstring>
 
 #include "CSV_Utils.h"
 
 #include <BESUtil.h>
+#include <BESInternalError.h>
 
 using std::vector;
 using std::string;
@@ -80,6 +82,87 @@ CSV_Utils::split( const string& str, char delimiter,
     }
 }
 
+/** @brief Extracts one field of a delimited line
+ *
+ * The fields are found the same way split() finds them (a field that starts
+ * with a double quote runs to the matching end quote and may hold the
+ * delimiter), but only the fields up to the one asked for are scanned and
+ * nothing is copied except that field.
+ *
+ * @param str The line, not null terminated and without its newline
+ * @param length Number of characters in the line
+ * @param delimiter The field delimiter
+ * @param n Zero-based number of the field to get
+ * @param token Value-result parameter holding the field, quotes and all
+ * @return true if the field was found, false if the line has fewer fields
+ * @throws BESInternalError if a quoted value is malformed
+ */
+bool
+CSV_Utils::field( const char *str, size_t length, char delimiter, int n,
+		  string &token )
+{
+    size_t start = 0 ;
+    for( int i = 0; ; i++ )
+    {
+	size_t end = 0 ;
+	if( start < length && str[start] == '"' )
+	{
+	    size_t qstart = start + 1 ;
+	    bool endquote = false ;
+	    while( !endquote )
+	    {
+		const char *q = qstart < length ?
+		    (const char *)memchr( str + qstart, '"', length - qstart ) : 0 ;
+		if( !q )
+		{
+		    string err = "CSV_Utils::field - No end quote after value "
+				 + string( str + start, length - start ) ;
+		    throw BESInternalError( err, __FILE__, __LINE__ ) ;
+		}
+		size_t aquote = q - str ;
+		// an escaped quote does not end the value unless the escape
+		// character is itself escaped
+		if( str[aquote - 1] != '\\' || str[aquote - 2] == '\\' )
+		    endquote = true ;
+		qstart = aquote + 1 ;
+	    }
+	    if( qstart != length && str[qstart] != delimiter )
+	    {
+		string err = "CSV_Utils::field - No delim after end quote "
+			     + string( str + start, qstart - start ) ;
+		throw BESInternalError( err, __FILE__, __LINE__ ) ;
+	    }
+	    end = qstart ;
+	}
+	else
+	{
+	    const char *d = start < length ?
+		(const char *)memchr( str + start, delimiter, length - start ) : 0 ;
+	    end = d ? (size_t)(d - str) : length ;
+	}
+
+	if( i == n )
+	{
+	    token.assign( str + start, end - start ) ;
+	    return true ;
+	}
+	if( end >= length )
+	    return false ;
+
+	start = end + 1 ;
+	if( start == length )
+	{
+	    // a trailing delimiter ends the line with an empty field
+	    if( i + 1 == n )
+	    {
+		token.clear() ;
+		return true ;
+	    }
+	    return false ;
+	}
+    }
+}
+
 /** @brief Strips leading and trailing double quotes from string
  *
  * There must be a leading and trailing quote for them to be removed. If
@@ -90,7 +173,7 @@ CSV_Utils::split( const string& str, char delimiter,
 void
 CSV_Utils::slim( string& str )
 {
-    if( *(--str.end()) == '\"' and *str.begin() == '\"' )
+    if( !str.empty() and *(--str.end()) == '\"' and *str.begin() == '\"' )
 	str = str.substr( 1, str.length() - 2 ) ;
 }
 
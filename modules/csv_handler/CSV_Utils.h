@@ -47,6 +47,9 @@ public:
     static void			split( const std::string& str,
 				       char delimiter,
 					   std::vector<std::string> &tokens ) ;
+    static bool			field( const char *str, size_t length,
+				       char delimiter, int n,
+				       std::string &token ) ;
     static void			slim( std::string& str ) ;
 } ;
 
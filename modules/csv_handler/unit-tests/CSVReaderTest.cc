@@ -0,0 +1,368 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of csv_handler, A C++ implementation of the OPeNDAP
+// Hyrax data server
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <BESDebug.h>
+#include <BESInternalError.h>
+
+#include "GetOpt.h"
+
+#include "CSV_Reader.h"
+#include "CSV_Obj.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+
+class CSVReaderTest: public CppUnit::TestFixture {
+private:
+    string d_temperature;
+    string d_tmp;
+
+    void write_tmp(const string &text)
+    {
+        ofstream out(d_tmp.c_str(), ios::trunc);
+        out << text;
+    }
+
+    // Give the temporary file a fixed modification time
+    void touch_tmp(time_t mtime)
+    {
+        struct utimbuf times;
+        times.actime = mtime;
+        times.modtime = mtime;
+        CPPUNIT_ASSERT(utime(d_tmp.c_str(), &times) == 0);
+    }
+
+public:
+    CSVReaderTest()
+    {
+    }
+
+    ~CSVReaderTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_temperature = string(TEST_SRC_DIR) + "/../data/temperature.csv";
+        d_tmp = string(TEST_BUILD_DIR) + "/csv_reader_test.csv";
+    }
+
+    void tearDown()
+    {
+        remove(d_tmp.c_str());
+    }
+
+    CPPUNIT_TEST_SUITE( CSVReaderTest );
+
+    CPPUNIT_TEST(index_test);
+    CPPUNIT_TEST(index_empty_lines_test);
+    CPPUNIT_TEST(index_no_final_newline_test);
+    CPPUNIT_TEST(index_empty_file_test);
+    CPPUNIT_TEST(get_field_test);
+    CPPUNIT_TEST(get_field_quoted_test);
+    CPPUNIT_TEST(get_rows_test);
+    CPPUNIT_TEST(index_cache_test);
+    CPPUNIT_TEST(load_field_test);
+    CPPUNIT_TEST(load_field_once_test);
+    CPPUNIT_TEST(load_lazy_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void index_test()
+    {
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_temperature));
+        CPPUNIT_ASSERT_EQUAL(5, reader.getRecordCount());
+        CPPUNIT_ASSERT(reader.close());
+        CPPUNIT_ASSERT_EQUAL(0, reader.getRecordCount());
+    }
+
+    void index_empty_lines_test()
+    {
+        write_tmp("\"a<Int32>\"\n1\n\n2\n\n\n3\n");
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_tmp));
+        CPPUNIT_ASSERT_EQUAL(3, reader.getRecordCount());
+
+        string token;
+        CPPUNIT_ASSERT(reader.getField(1, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("2"), token);
+        CPPUNIT_ASSERT(reader.getField(2, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("3"), token);
+    }
+
+    void index_no_final_newline_test()
+    {
+        write_tmp("\"a<Int32>\"\n1\n2");
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_tmp));
+        CPPUNIT_ASSERT_EQUAL(2, reader.getRecordCount());
+
+        string token;
+        CPPUNIT_ASSERT(reader.getField(1, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("2"), token);
+    }
+
+    void index_empty_file_test()
+    {
+        write_tmp("");
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_tmp));
+        CPPUNIT_ASSERT_EQUAL(0, reader.getRecordCount());
+        CPPUNIT_ASSERT(reader.eof());
+    }
+
+    void get_field_test()
+    {
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_temperature));
+
+        string token;
+        CPPUNIT_ASSERT(reader.getField(0, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("\"CMWM\""), token);
+        CPPUNIT_ASSERT(reader.getField(4, 3, token));
+        CPPUNIT_ASSERT_EQUAL(string("269.69"), token);
+        CPPUNIT_ASSERT(reader.getField(4, 4, token));
+        CPPUNIT_ASSERT_EQUAL(string("\"FOOBAR\""), token);
+
+        // A trailing comma ends the record with an empty field
+        CPPUNIT_ASSERT(reader.getField(0, 4, token));
+        CPPUNIT_ASSERT_EQUAL(string(""), token);
+        CPPUNIT_ASSERT(!reader.getField(0, 5, token));
+    }
+
+    void get_field_quoted_test()
+    {
+        write_tmp("\"a<String>\",\"b<Int32>\"\n\"x,y\",1\n\"say \\\"hi\\\"\",2\n");
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_tmp));
+
+        string token;
+        CPPUNIT_ASSERT(reader.getField(0, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("\"x,y\""), token);
+        CPPUNIT_ASSERT(reader.getField(0, 1, token));
+        CPPUNIT_ASSERT_EQUAL(string("1"), token);
+        CPPUNIT_ASSERT(reader.getField(1, 0, token));
+        CPPUNIT_ASSERT_EQUAL(string("\"say \\\"hi\\\"\""), token);
+        CPPUNIT_ASSERT(reader.getField(1, 1, token));
+        CPPUNIT_ASSERT_EQUAL(string("2"), token);
+    }
+
+    // get() returns the header and then each record, split into fields
+    void get_rows_test()
+    {
+        CSV_Reader reader;
+        CPPUNIT_ASSERT(reader.open(d_temperature));
+
+        int rows = 0;
+        vector<string> row;
+        while (!reader.eof()) {
+            row.clear();
+            reader.get(row);
+            ++rows;
+        }
+        CPPUNIT_ASSERT_EQUAL(6, rows);
+        CPPUNIT_ASSERT_EQUAL(string("\"FOOB\""), row[0]);
+
+        reader.reset();
+        row.clear();
+        reader.get(row);
+        CPPUNIT_ASSERT_EQUAL((vector<string>::size_type)5, row.size());
+        CPPUNIT_ASSERT_EQUAL(string("\"Station<String>\""), row[0]);
+    }
+
+    void index_cache_test()
+    {
+        CSV_Reader::setIndexCacheEntries(4);
+
+        write_tmp("\"a<Int32>\"\n1\n2\n");
+        touch_tmp(1000000000);
+        {
+            CSV_Reader reader;
+            CPPUNIT_ASSERT(reader.open(d_tmp));
+            CPPUNIT_ASSERT_EQUAL(2, reader.getRecordCount());
+        }
+
+        // Same size and modification time: the cached index is used, so the
+        // empty line is not noticed. This is how the test sees the cache.
+        write_tmp("\"a<Int32>\"\n\n12\n");
+        touch_tmp(1000000000);
+        {
+            CSV_Reader reader;
+            CPPUNIT_ASSERT(reader.open(d_tmp));
+            CPPUNIT_ASSERT_EQUAL(2, reader.getRecordCount());
+        }
+
+        // A new modification time makes the reader index the file again
+        touch_tmp(1000000001);
+        {
+            CSV_Reader reader;
+            CPPUNIT_ASSERT(reader.open(d_tmp));
+            CPPUNIT_ASSERT_EQUAL(1, reader.getRecordCount());
+
+            string token;
+            CPPUNIT_ASSERT(reader.getField(0, 0, token));
+            CPPUNIT_ASSERT_EQUAL(string("12"), token);
+        }
+
+        // So does a new size
+        write_tmp("\"a<Int32>\"\n1\n2\n3\n");
+        touch_tmp(1000000001);
+        {
+            CSV_Reader reader;
+            CPPUNIT_ASSERT(reader.open(d_tmp));
+            CPPUNIT_ASSERT_EQUAL(3, reader.getRecordCount());
+        }
+    }
+
+    void load_field_test()
+    {
+        CSV_Obj obj;
+        CPPUNIT_ASSERT(obj.open(d_temperature));
+        obj.load();
+
+        CPPUNIT_ASSERT_EQUAL(5, obj.getRecordCount());
+        CPPUNIT_ASSERT_EQUAL(string("Float32"), obj.getFieldType("latitude"));
+
+        vector<float> *lat = static_cast<vector<float> *>(obj.getFieldData("latitude"));
+        CPPUNIT_ASSERT_EQUAL((vector<float>::size_type)5, lat->size());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(-34.7, (*lat)[0], 0.0001);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(-32.9, (*lat)[4], 0.0001);
+
+        // Quotes are removed from string values
+        vector<string> *station = static_cast<vector<string> *>(obj.getFieldData("Station"));
+        CPPUNIT_ASSERT_EQUAL(string("BWWJ"), (*station)[1]);
+        vector<string> *notes = static_cast<vector<string> *>(obj.getFieldData("Notes"));
+        CPPUNIT_ASSERT_EQUAL(string(""), (*notes)[0]);
+        CPPUNIT_ASSERT_EQUAL(string("Blah"), (*notes)[3]);
+
+        vector<string> record = obj.getRecord(2);
+        CPPUNIT_ASSERT_EQUAL((vector<string>::size_type)5, record.size());
+        CPPUNIT_ASSERT_EQUAL(string("CWQK"), record[0]);
+    }
+
+    void load_field_once_test()
+    {
+        CSV_Obj obj;
+        CPPUNIT_ASSERT(obj.open(d_temperature));
+        obj.load();
+
+        void *first = obj.getFieldData("temperature_K");
+        CPPUNIT_ASSERT(first);
+        CPPUNIT_ASSERT(obj.getFieldData("temperature_K") == first);
+        CPPUNIT_ASSERT_EQUAL((vector<float>::size_type)5, static_cast<vector<float> *>(first)->size());
+    }
+
+    // Only the fields that are asked for are read, so a short record only
+    // matters to the fields it is missing.
+    void load_lazy_test()
+    {
+        write_tmp("\"a<Int32>\",\"b<Int32>\",\"c<String>\"\n1,2,\"x\"\n3\n4,5,\"y\"\n");
+        CSV_Obj obj;
+        CPPUNIT_ASSERT(obj.open(d_tmp));
+        obj.load();
+        CPPUNIT_ASSERT_EQUAL(3, obj.getRecordCount());
+
+        vector<int> *a = static_cast<vector<int> *>(obj.getFieldData("a"));
+        CPPUNIT_ASSERT_EQUAL((vector<int>::size_type)3, a->size());
+        CPPUNIT_ASSERT_EQUAL(3, (*a)[1]);
+        CPPUNIT_ASSERT_EQUAL(4, (*a)[2]);
+
+        try {
+            obj.getFieldData("b");
+            CPPUNIT_FAIL("Expected an error for the short record");
+        }
+        catch (BESInternalError &e) {
+            DBG(cerr << "Expected error: " << e.get_message() << endl);
+        }
+
+        CPPUNIT_ASSERT_THROW(obj.getFieldData("no_such_field"), BESInternalError);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CSVReaderTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,csv");
+            break;
+        case 'h': {     // help - show test names
+            std::cerr << "Usage: CSVReaderTest has the following tests:" << std::endl;
+            const std::vector<CppUnit::Test*> &tests = CSVReaderTest::suite()->getTests();
+            unsigned int prefix_len = CSVReaderTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                std::cerr << (*i)->getName().replace(0, prefix_len, "") << std::endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = CSVReaderTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
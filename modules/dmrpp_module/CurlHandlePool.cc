@@ -31,6 +31,7 @@
 #include <cstring>
 #include <unistd.h>
 #include <ctime>
+#include <algorithm>
 
 #include <curl/curl.h>
 
@@ -46,6 +47,7 @@
 #include "BESDebug.h"
 #include "BESInternalError.h"
 #include "BESForbiddenError.h"
+#include "BESDeadline.h"
 #include <TheBESKeys.h>
 #include "WhiteList.h"
 
@@ -324,6 +326,8 @@ void dmrpp_easy_handle::read_data()
             ++tries;
 
             if (CURLE_OK != curl_code) {
+                // A transfer stopped by the request's deadline is a timeout
+                BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
                 throw BESInternalError(string("Data transfer error: ").append(curl_error_msg(curl_code, d_errbuf)),
                     __FILE__, __LINE__);
             }
@@ -337,6 +341,7 @@ void dmrpp_easy_handle::read_data()
                             curl_error_msg(curl_code, d_errbuf)), __FILE__, __LINE__);
                 }
                 else {
+                    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
                     LOG("HTTP transfer 500 error, will retry (trial " << tries << " for: " << d_url << ").");
                     usleep(retry_time);
                     retry_time *= 2;
@@ -350,6 +355,7 @@ void dmrpp_easy_handle::read_data()
     else {
         CURLcode curl_code = curl_easy_perform(d_handle);
         if (CURLE_OK != curl_code) {
+            BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
             throw BESInternalError(string("Data transfer error: ").append(curl_error_msg(curl_code, d_errbuf)),
                 __FILE__, __LINE__);
         }
@@ -468,8 +474,10 @@ void dmrpp_multi_handle::read_data()
             CURL *eh = msg->easy_handle;
 
             CURLcode res = msg->data.result;
-            if (res != CURLE_OK)
+            if (res != CURLE_OK) {
+                BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
                 throw BESInternalError(string("Error HTTP: ").append(curl_easy_strerror(res)), __FILE__, __LINE__);
+            }
 
             // Note: 'eh' is the easy handle returned by culr_multi_info_read(),
             // but in it's private field is our dmrpp_easy_handle object. We need
@@ -774,6 +782,9 @@ CurlHandlePool::get_easy_handle(Chunk *chunk)
         throw BESForbiddenError(msg ,__FILE__,__LINE__);
     }
 
+    // Don't start a transfer after the request has run out of time
+    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
     Lock lock(d_get_easy_handle_mutex); // RAII
 
     dmrpp_easy_handle *handle = 0;
@@ -804,6 +815,12 @@ CurlHandlePool::get_easy_handle(Chunk *chunk)
             throw BESInternalError(string("CURL Error setting chunk as data buffer: ").append(curl_error_msg(res, handle->d_errbuf)),
             __FILE__, __LINE__);
 
+        // Limit the transfer to the time left before the request's deadline (0 is no limit)
+        long timeout_ms = BESDeadline::TheDeadline()->remaining_ms();
+        if (CURLE_OK != (res = curl_easy_setopt(handle->d_handle, CURLOPT_TIMEOUT_MS, timeout_ms < 0 ? 0L : max(timeout_ms, 1L))))
+            throw BESInternalError(string("CURL Error setting the transfer timeout: ").append(curl_error_msg(res, handle->d_errbuf)),
+            __FILE__, __LINE__);
+
         // store the easy_handle so that we can call release_handle in multi_handle::read_data()
         if (CURLE_OK != (res = curl_easy_setopt(handle->d_handle, CURLOPT_PRIVATE, reinterpret_cast<void*>(handle))))
             throw BESInternalError(string("CURL Error setting easy_handle as private data: ").append(curl_error_msg(res, handle->d_errbuf)), __FILE__,
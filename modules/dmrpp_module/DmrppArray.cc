@@ -47,6 +47,7 @@
 
 #include "BESLog.h"
 #include "BESInternalError.h"
+#include "BESDeadline.h"
 #include "BESDebug.h"
 
 #include "CurlHandlePool.h"
@@ -469,6 +470,8 @@ void DmrppArray::read_contiguous()
 				else if (error != 0) {
 					BESInternalError e(*error, __FILE__, __LINE__);
 					delete error;
+					// A thread that ran out of time reports a timeout
+					BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
 					throw e;
 				}
 				else if (chunks_to_read.size() > 0) {
@@ -1166,6 +1169,8 @@ void DmrppArray::read_chunks_unconstrained()
                 else if (error != 0) {
                     BESInternalError e(*error, __FILE__, __LINE__);
                     delete error;
+                    // A thread that ran out of time reports a timeout
+                    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
                     throw e;
                 }
                 else if (chunks_to_read.size() > 0) {
@@ -72,6 +72,9 @@ public:
 	static bool dap_build_vers(BESDataHandlerInterface &dhi);
 	static bool dap_build_help(BESDataHandlerInterface &dhi);
 
+	// Variables are read using the curl handle pool, which is thread-safe
+	virtual bool supports_concurrent_reads() const { return true; }
+
 	virtual void dump(std::ostream &strm) const;
 };
 
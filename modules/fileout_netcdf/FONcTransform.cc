@@ -50,6 +50,7 @@ using std::istringstream;
 #include <Sequence.h>
 #include <BESDebug.h>
 #include <BESInternalError.h>
+#include <BESDeadline.h>
 
 #include "DapFunctionUtils.h"
 
@@ -206,6 +207,10 @@ void FONcTransform::transform()
         i = _fonc_vars.begin();
         e = _fonc_vars.end();
         for (; i != e; i++) {
+            // Stop writing once the request has run out of time; the file
+            // is closed below
+            BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
             FONcBaseType *fbt = *i;
             BESDEBUG("fonc", "FONcTransform::transform() - Writing data for variable:  " << fbt->name() << endl);
             fbt->write(_ncid);
@@ -37,6 +37,11 @@
 
 static char rcsid[] not_used = { "$Id$" };
 
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -48,6 +53,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <D4Group.h>
 #include <Error.h>
 #include <InternalErr.h>
+#include <mime_util.h>
 
 #include "FFArray.h"
 #include "util_ff.h"
@@ -60,7 +66,7 @@ FFArray::ptr_duplicate()
 }
 
 FFArray::FFArray(const string &n, const string &d, BaseType *v, const string &iff) :
-        Array(n, d, v), d_input_format_file(iff)
+        Array(n, d, v), d_input_format_file(iff), d_direct_offset(-1)
 {
 }
 
@@ -258,6 +264,11 @@ bool FFArray::read()
         throw Error(unknown_error, "Constraint returned an empty dataset.");
     }
 
+    if (d_direct_offset >= 0) {
+        read_direct(&start[0], &stride[0], &edge[0]);
+        return true;
+    }
+
     string output_format = makeND_output_format(name(), var()->type(), var()->width(),
             ndims, &start[0], &edge[0], &stride[0], &dname[0]);
 
@@ -324,3 +335,91 @@ bool FFArray::extract_array(const string &ds, const string &if_fmt, const string
 
     return true;
 }
+
+// Read 'count' bytes at 'offset'; throw Error if the file is too short.
+static void read_bytes(int fd, off_t offset, char *buf, size_t count, const string &ds)
+{
+    while (count > 0) {
+        ssize_t bytes = pread(fd, buf, count, offset);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            throw Error(unknown_error, "Could not read values from the dataset " + path_to_filename(ds) + ".");
+        buf += bytes;
+        offset += bytes;
+        count -= bytes;
+    }
+}
+
+/**
+ * Read the constrained values of an array that is stored in the dataset as
+ * a contiguous, row-major block of binary values in the host's byte order.
+ * ff_read_descriptors() works out which arrays those are using the
+ * dataset's format descriptors, so this skips FreeForm altogether: only the
+ * selected rows are read and each run along the rightmost dimension is read
+ * with one call.
+ */
+void FFArray::read_direct(const long *start, const long *stride, const long *edge)
+{
+    const int ndims = dimensions();
+    const int last = ndims - 1;
+    const long w = var()->width();  // bytes per element
+
+    // Number of elements between successive indexes of each dimension
+    vector<off_t> step(ndims);
+    off_t s = 1;
+    for (int d = last; d >= 0; --d) {
+        step[d] = s;
+        s *= dimension_size(dim_begin() + d, false);
+    }
+
+    // A strided run is read in one piece and then thinned out
+    const long span = (edge[last] - 1) * stride[last] + 1;
+    vector<char> run(stride[last] == 1 ? 0 : span * w);
+
+    vector<char> values(length() * w);
+    char *dest = &values[0];
+
+    int fd = open(dataset().c_str(), O_RDONLY);
+    if (fd < 0)
+        throw Error(unknown_error, "Could not open the dataset " + path_to_filename(dataset()) + ".");
+
+    try {
+        vector<long> index(ndims, 0);   // of the leftmost ndims-1 dimensions
+        for (;;) {
+            off_t element = start[last];
+            for (int d = 0; d < last; ++d)
+                element += (start[d] + index[d] * stride[d]) * step[d];
+            off_t pos = d_direct_offset + element * w;
+
+            if (stride[last] == 1) {
+                read_bytes(fd, pos, dest, edge[last] * w, dataset());
+            }
+            else {
+                read_bytes(fd, pos, &run[0], run.size(), dataset());
+                for (long i = 0; i < edge[last]; ++i)
+                    memcpy(dest + i * w, &run[i * stride[last] * w], w);
+            }
+            dest += edge[last] * w;
+
+            int d = last - 1;
+            while (d >= 0 && ++index[d] == edge[d]) {
+                index[d] = 0;
+                --d;
+            }
+            if (d < 0)
+                break;
+        }
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+
+    BESDEBUG("ff", "FFArray::read_direct: Read " << values.size() << " bytes at offset " << d_direct_offset << endl);
+
+    val2buf(&values[0]);
+    set_read_p(true);
+}
@@ -46,18 +46,28 @@ class FFArray: public Array {
 private:
     string d_input_format_file;
 
+    // Byte offset of the array's first element in the dataset if its values
+    // can be read directly (see ff_read_descriptors()); -1 otherwise.
+    long d_direct_offset;
 
     long Arr_constraint(long *cor, long *step, long *edg, string *dim_nms, bool *has_stride);
 
     /** Read an array of simple types into this objects _buf field. */
     template<class T> bool extract_array(const string &ds, const string &if_fmt, const string &o_fmt);
 
+    void read_direct(const long *start, const long *stride, const long *edge);
+
 public:
     FFArray(const string &n, const string &d, BaseType *v, const string &iff);
     virtual ~FFArray();
 
     virtual BaseType *ptr_duplicate();
 
+    /** Read this array from the dataset without using FreeForm.
+        @param offset Offset of the first element; -1 to use FreeForm */
+    void set_direct_offset(long offset) { d_direct_offset = offset; }
+    long get_direct_offset() const { return d_direct_offset; }
+
     virtual bool read();
 };
 
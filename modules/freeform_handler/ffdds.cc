@@ -68,6 +68,53 @@
 
 #include "FFRequestHandler.h"
 
+/**
+ * Can the values of an array be read straight from the dataset? They can
+ * if the array is a plain block of binary values: host byte order, no
+ * separation, grouping or granularity, no scaling or conversion and a
+ * FreeForm type that is stored just as the DAP type is. The array's offset
+ * in the dataset comes from its FreeForm format descriptor; file headers are
+ * not included in that offset, so datasets with headers are left to FreeForm.
+ *
+ * @return The offset of the array's first element or -1 if FreeForm must
+ * be used to read the array.
+ */
+static long direct_read_offset(PROCESS_INFO_PTR pinfo, VARIABLE_PTR var, BaseType *bt, bool has_header)
+{
+    FORMAT_PTR format = PINFO_FORMAT(pinfo);
+    if (has_header || !PINFO_IS_FILE(pinfo) || !IS_BINARY(format) || !IS_ARRAY(format) || format->num_vars != 1)
+        return -1;
+
+    if (var->eqn_info || var->precision != 0 || PINFO_BYTE_ORDER(pinfo) != endian())
+        return -1;
+
+    switch (FFV_DATA_TYPE(var)) {
+    case FFV_UINT8:
+    case FFV_INT16:
+    case FFV_UINT16:
+    case FFV_INT32:
+    case FFV_UINT32:
+    case FFV_FLOAT32:
+    case FFV_FLOAT64:
+        break;
+    default:
+        return -1;
+    }
+
+    ARRAY_DESCRIPTOR_PTR array = PINFO_ARRAY_MAP(pinfo)->super_array;
+    if (array->type != NDARRT_CONTIGUOUS || array->element_size != (long) bt->width()
+        || (long) (var->end_pos - var->start_pos + 1) != (long) bt->width())
+        return -1;
+
+    for (int d = 0; d < array->num_dim; ++d) {
+        if (array->granularity[d] != 1 || array->separation[d] != 0 || array->grouping[d] != 0
+            || array->index_dir[d] != 1)
+            return -1;
+    }
+
+    return PINFO_FIRST_ARRAY_OFFSET(pinfo);
+}
+
 void ff_read_descriptors(DDS &dds_table, const string &filename)
 {
     if (!file_exist(filename.c_str()))
@@ -131,6 +178,11 @@ void ff_read_descriptors(DDS &dds_table, const string &filename)
     Sequence *seq = NULL;
 
     try {
+        // File headers move the arrays; see direct_read_offset()
+        PROCESS_INFO_LIST header_list = NULL;
+        bool has_header = db_ask(dbin, DBASK_PROCESS_INFO, FFF_INPUT | FFF_HEADER, &header_list) == 0 && header_list;
+        if (header_list)
+            ff_destroy_process_info_list(header_list);
 
         int num_names = 0;
         error = db_ask(dbin, DBASK_VAR_NAMES, FFF_INPUT | FFF_DATA, &num_names, &var_names_vector);
@@ -264,7 +316,9 @@ void ff_read_descriptors(DDS &dds_table, const string &filename)
                 is_array = false;
             }
             else {
-                ar = new FFArray(cp, filename, bt, input_format_file);
+                FFArray *ffa = new FFArray(cp, filename, bt, input_format_file);
+                ffa->set_direct_offset(direct_read_offset(pinfo, var, bt, has_header));
+                ar = ffa;
                 delete bt;
                 newseq = true; // An array terminates the old sequence
                 is_array = true;
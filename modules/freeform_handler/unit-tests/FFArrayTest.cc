@@ -0,0 +1,322 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of ff_handler, a data handler for the OPeNDAP data
+// server.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config_ff.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <BaseTypeFactory.h>
+#include <DDS.h>
+#include <Error.h>
+
+#include <BESDebug.h>
+
+#include "GetOpt.h"
+
+#include "FFArray.h"
+#include "FFRequestHandler.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+using namespace libdap;
+
+extern void ff_read_descriptors(DDS &dds, const string &filename);
+
+// The format descriptor code reads these settings of the handler; the
+// handler itself is not linked into this test.
+bool FFRequestHandler::d_RSS_format_support = false;
+string FFRequestHandler::d_RSS_format_files = "";
+bool FFRequestHandler::d_Regex_format_support = false;
+std::map<string, string> FFRequestHandler::d_fmt_regex_map;
+
+class FFArrayTest: public CppUnit::TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    DDS *d_dds;
+
+    // Build the DDS of a dataset in the handler's data directory, or in
+    // this directory if 'local' is true
+    void read_dds(const string &dataset, bool local = false)
+    {
+        d_dds = new DDS(&d_factory, dataset);
+        ff_read_descriptors(*d_dds, string(TEST_SRC_DIR) + (local ? "/" : "/../data/") + dataset);
+    }
+
+    FFArray *array(const string &name)
+    {
+        FFArray *a = dynamic_cast<FFArray *>(d_dds->var(name));
+        CPPUNIT_ASSERT(a);
+        return a;
+    }
+
+    // The values of an array that has been read, as bytes
+    static vector<char> values(Array *a)
+    {
+        vector<char> bytes(a->width(true));
+        void *buf = &bytes[0];
+        a->buf2val(&buf);
+        return bytes;
+    }
+
+    // Read the array directly and, from a copy made before the read, using
+    // FreeForm; both must get the same values.
+    static vector<char> read_both_ways(FFArray *a)
+    {
+        CPPUNIT_ASSERT(a->get_direct_offset() >= 0);
+
+        auto_ptr<FFArray> ff(static_cast<FFArray *>(a->ptr_duplicate()));
+        ff->set_direct_offset(-1);
+
+        a->read();
+        ff->read();
+
+        vector<char> direct = values(a);
+        vector<char> freeform = values(ff.get());
+        DBG(cerr << a->name() << ": " << direct.size() << " bytes" << endl);
+        CPPUNIT_ASSERT(direct.size() == freeform.size());
+        CPPUNIT_ASSERT(direct == freeform);
+
+        return direct;
+    }
+
+public:
+    FFArrayTest() :
+        d_dds(0)
+    {
+    }
+
+    ~FFArrayTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_dds = 0;
+    }
+
+    void tearDown()
+    {
+        delete d_dds;
+        d_dds = 0;
+    }
+
+    CPPUNIT_TEST_SUITE( FFArrayTest );
+
+    CPPUNIT_TEST(direct_offsets_test);
+    CPPUNIT_TEST(direct_read_test);
+    CPPUNIT_TEST(direct_read_int_test);
+    CPPUNIT_TEST(direct_read_1d_test);
+    CPPUNIT_TEST(direct_read_strided_test);
+    CPPUNIT_TEST(direct_read_row_test);
+    CPPUNIT_TEST(direct_read_corner_test);
+    CPPUNIT_TEST(fallback_ascii_test);
+    CPPUNIT_TEST(fallback_scaled_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    // dbl_data2.bin holds five 10x20 float64 arrays, one after another
+    void direct_offsets_test()
+    {
+        read_dds("dbl_data2.bin");
+
+        const char *names[] = { "xf", "yf", "zf", "tf", "uf" };
+        for (long i = 0; i < 5; ++i)
+            CPPUNIT_ASSERT_EQUAL(i * 10 * 20 * 8, array(names[i])->get_direct_offset());
+    }
+
+    void direct_read_test()
+    {
+        read_dds("dbl_data2.bin");
+
+        const char *names[] = { "xf", "yf", "zf", "tf", "uf" };
+        for (int i = 0; i < 5; ++i) {
+            vector<char> v = read_both_ways(array(names[i]));
+            CPPUNIT_ASSERT(v.size() == 10 * 20 * sizeof(dods_float64));
+        }
+    }
+
+    void direct_read_int_test()
+    {
+        read_dds("int_data3.bin");
+
+        const char *names[] = { "x", "y", "z", "t", "u" };
+        for (int i = 0; i < 5; ++i) {
+            vector<char> v = read_both_ways(array(names[i]));
+            CPPUNIT_ASSERT(v.size() == 10 * 10 * sizeof(dods_int32));
+        }
+    }
+
+    void direct_read_1d_test()
+    {
+        read_dds("int_data.bin");
+
+        FFArray *x = array("x");
+        Array::Dim_iter d = x->dim_begin();
+        x->add_constraint(d, 2, 1, 6);
+
+        vector<char> v = read_both_ways(x);
+        CPPUNIT_ASSERT(v.size() == 5 * sizeof(dods_int32));
+    }
+
+    // Strides in both dimensions; the strided run along the rightmost
+    // dimension is read in one piece and thinned out.
+    void direct_read_strided_test()
+    {
+        read_dds("dbl_data2.bin");
+
+        // The values of the whole array, for the expected values
+        FFArray *whole = array("zf");
+        auto_ptr<FFArray> part(static_cast<FFArray *>(whole->ptr_duplicate()));
+        vector<char> all_bytes = read_both_ways(whole);
+        const dods_float64 *all = reinterpret_cast<const dods_float64 *>(&all_bytes[0]);
+
+        Array::Dim_iter r = part->dim_begin();
+        Array::Dim_iter c = r + 1;
+        part->add_constraint(r, 1, 3, 8);
+        part->add_constraint(c, 2, 4, 19);
+
+        vector<char> bytes = read_both_ways(part.get());
+        const dods_float64 *v = reinterpret_cast<const dods_float64 *>(&bytes[0]);
+        CPPUNIT_ASSERT(bytes.size() == 3 * 5 * sizeof(dods_float64));
+
+        int k = 0;
+        for (int i = 1; i <= 8; i += 3)
+            for (int j = 2; j <= 19; j += 4)
+                CPPUNIT_ASSERT(v[k++] == all[i * 20 + j]);
+    }
+
+    void direct_read_row_test()
+    {
+        read_dds("dbl_data.bin");
+
+        FFArray *xf = array("xf");
+        Array::Dim_iter r = xf->dim_begin();
+        xf->add_constraint(r, 5, 1, 5);
+
+        vector<char> v = read_both_ways(xf);
+        CPPUNIT_ASSERT(v.size() == 20 * sizeof(dods_float64));
+    }
+
+    void direct_read_corner_test()
+    {
+        read_dds("dbl_data.bin");
+
+        FFArray *xf = array("xf");
+        Array::Dim_iter r = xf->dim_begin();
+        xf->add_constraint(r, 9, 1, 9);
+        xf->add_constraint(r + 1, 19, 1, 19);
+
+        vector<char> v = read_both_ways(xf);
+        CPPUNIT_ASSERT(v.size() == sizeof(dods_float64));
+    }
+
+    // ASCII arrays must be read by FreeForm
+    void fallback_ascii_test()
+    {
+        read_dds("t3.dat");
+
+        const char *names[] = { "inger1", "inger2", "reel1", "inger3" };
+        for (int i = 0; i < 4; ++i) {
+            FFArray *a = array(names[i]);
+            CPPUNIT_ASSERT_EQUAL(-1L, a->get_direct_offset());
+            a->read();
+            CPPUNIT_ASSERT(a->read_p());
+        }
+
+        CPPUNIT_ASSERT_EQUAL(20U, array("reel1")->width(true) / (unsigned int) sizeof(dods_float32));
+    }
+
+    // scaled_data.bin is a copy of int_data.bin; its format gives the
+    // values two implied decimal places, so FreeForm must convert them.
+    void fallback_scaled_test()
+    {
+        read_dds("scaled_data.bin", true);
+
+        FFArray *x = array("x");
+        CPPUNIT_ASSERT_EQUAL(-1L, x->get_direct_offset());
+        x->read();
+        CPPUNIT_ASSERT(x->read_p());
+        CPPUNIT_ASSERT_EQUAL(10, x->length());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FFArrayTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,ff");
+            break;
+        case 'h': {     // help - show test names
+            std::cerr << "Usage: FFArrayTest has the following tests:" << std::endl;
+            const std::vector<CppUnit::Test*> &tests = FFArrayTest::suite()->getTests();
+            unsigned int prefix_len = FFArrayTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                std::cerr << (*i)->getName().replace(0, prefix_len, "") << std::endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = FFArrayTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -27,12 +27,15 @@
 
 #include "config.h"
 
+#include <unistd.h>
+
 #include <sstream>
 
 #include "BESInternalError.h"
 
 #include "BESDebug.h"
 #include "BESUtil.h"
+#include "BESHttpCacheRevalidator.h"
 
 #include "GatewayCache.h"
 #include "GatewayUtils.h"
@@ -42,6 +45,47 @@
 using namespace std;
 using namespace gateway;
 
+namespace {
+
+/**
+ * Revalidate cached resources using the gateway's curl code.
+ */
+class GatewayRevalidator: public BESHttpCacheRevalidator {
+private:
+    CURL *&d_curl;
+    char *d_error_buffer;
+    const vector<string> &d_request_headers;
+
+protected:
+    virtual long get(const vector<string> &request_headers, int fd, vector<string> &response_headers)
+    {
+        vector<string> req_hdrs(d_request_headers);
+        req_hdrs.insert(req_hdrs.end(), request_headers.begin(), request_headers.end());
+        try {
+            return read_url(d_curl, get_url(), fd, &response_headers, &req_hdrs, d_error_buffer);
+        }
+        catch (libdap::Error &e) {
+            throw BESInternalError(e.get_error_message(), __FILE__, __LINE__);
+        }
+    }
+
+    virtual void reset_connection()
+    {
+        d_curl = init(d_error_buffer);
+        configureProxy(d_curl, get_url());
+    }
+
+public:
+    GatewayRevalidator(GatewayCache *cache, const string &cache_file, const string &url, CURL *&curl,
+        char *error_buffer, const vector<string> &request_headers) :
+        BESHttpCacheRevalidator(cache, cache_file, url, "Gateway.Cache"), d_curl(curl), d_error_buffer(error_buffer),
+            d_request_headers(request_headers)
+    {
+    }
+};
+
+} // namespace
+
 /**
  * Builds a RemoteHttpResource object associated with the passed \c url parameter.
  *
@@ -148,12 +192,8 @@ void RemoteHttpResource::retrieveResource()
     BESDEBUG("gateway",
         "RemoteHttpResource::retrieveResource() - d_resourceCacheFileName: " << d_resourceCacheFileName << endl);
 
-    // @FIXME MAKE THIS RETRIEVE THE CACHED DATA TYPE IF THE CACHED RESPONSE IF FOUND
-    // We need to know the type of the resource. HTTP headers are the preferred  way to determine the type.
-    // Unfortunately, the current code losses both the HTTP headers sent from the request and the derived type
-    // to subsequent accesses of the cached object. Since we have to have a type, for now we just set the type
-    // from the url. If down below we DO an HTTP GET then the headers will be evaluated and the type set by setType()
-    // But really - we gotta fix this.
+    // Start with the type given by the URL; if the resource's response headers
+    // are found (or it is retrieved) they are used by setType().
     GatewayUtils::Get_type_from_url(d_remoteResourceUrl, d_type);
     BESDEBUG("gateway", "RemoteHttpResource::retrieveResource() - d_type: " << d_type << endl);
 
@@ -162,6 +202,12 @@ void RemoteHttpResource::retrieveResource()
         if (cache->get_read_lock(d_resourceCacheFileName, d_fd)) {
             BESDEBUG("gateway",
                 "RemoteHttpResource::retrieveResource() - Remote resource is already in cache. cache_file_name: " << d_resourceCacheFileName << endl);
+
+            BESHttpCacheRevalidator::read_headers(d_resourceCacheFileName, *d_response_headers);
+            GatewayRevalidator(cache, d_resourceCacheFileName, d_remoteResourceUrl, d_curl, d_error_buffer,
+                *d_request_headers).revalidate(d_fd, *d_response_headers);
+            if (!d_response_headers->empty()) setType(d_response_headers);
+
             d_initialized = true;
             return;
         }
@@ -171,21 +217,19 @@ void RemoteHttpResource::retrieveResource()
         // First make an empty file and get an exclusive lock on it.
         if (cache->create_and_lock(d_resourceCacheFileName, d_fd)) {
 
-            // Write the remote resource to the cache file.
+            // Write the remote resource to the cache file and save its response
+            // headers so later requests can determine its type and revalidate it.
             try {
                 writeResourceToFile(d_fd);
+                BESHttpCacheRevalidator::save_headers(d_resourceCacheFileName, *d_response_headers);
             }
             catch(...){
                 // If things went south then we need to dump the file because we'll end up with an empty/bogus file clogging the cache
                 unlink(d_resourceCacheFileName.c_str());
+                unlink(BESHttpCacheRevalidator::headers_file_name(d_resourceCacheFileName).c_str());
                 throw;
             }
 
-            // #########################################################################################################
-            // I think right here is where I would be able to cache the data type/response headers. While I have
-            // the exclusive lock I could open another cache file for metadata and write to it.
-            // #########################################################################################################
-
             // Change the exclusive lock on the new file to a shared lock. This keeps
             // other processes from purging the new file and ensures that the reading
             // process can use it.
@@ -214,6 +258,8 @@ void RemoteHttpResource::retrieveResource()
             if (cache->get_read_lock(d_resourceCacheFileName, d_fd)) {
                 BESDEBUG("gateway",
                     "RemoteHttpResource::retrieveResource() - Remote resource is in cache. cache_file_name: " << d_resourceCacheFileName << endl);
+                BESHttpCacheRevalidator::read_headers(d_resourceCacheFileName, *d_response_headers);
+                if (!d_response_headers->empty()) setType(d_response_headers);
                 d_initialized = true;
                 return;
             }
@@ -274,7 +320,6 @@ void RemoteHttpResource::writeResourceToFile(int fd)
 
         BESDEBUG("gateway", "RemoteHttpResource::writeResourceToFile() - Reset file descriptor." << endl);
 
-        // @TODO CACHE THE DATA TYPE OR THE HTTP HEADERS SO WHEN WE ARE RETRIEVING THE CACHED OBJECT WE CAN GET THE CORRECT TYPE
         setType(d_response_headers);
     }
     catch (libdap::Error &e) {
@@ -361,8 +406,6 @@ void RemoteHttpResource::setType(const vector<string> *resp_hdrs)
         //throw BESSyntaxUserError( err, __FILE__, __LINE__ ) ;
     }
 
-    // @TODO CACHE THE DATA TYPE OR THE HTTP HEADERS SO WHEN WE ARE RETRIEVING THE CACHED OBJECT WE CAN GET THE CORRECT TYPE
-
     d_type = type;
 
     BESDEBUG("gateway", "RemoteHttpResource::setType() - END" << endl);
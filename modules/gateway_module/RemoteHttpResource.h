@@ -45,6 +45,10 @@ namespace gateway {
  * retrieve the content of the resource and place it in a local disk cache
  * for rapid (subsequent) access. It can be configure to use a proxy server
  * for the outgoing requests.
+ *
+ * The response headers are cached along with the resource. When
+ * Gateway.Cache.MaxAge is set, stale resources are revalidated by
+ * BESHttpCacheRevalidator.
  */
 class RemoteHttpResource {
 private:
@@ -77,7 +77,7 @@ GDALArray::read()
 
     if (read_p()) return true;
 
-    GDALDatasetH hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+    GDALDatasetH hDS = gdal_open_cached(filename);
     if (hDS == NULL)
         throw Error(string(CPLGetLastErrorMsg()));
 
@@ -90,11 +90,11 @@ GDALArray::read()
         set_read_p(true);
     }
     catch (...) {
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         throw;
     }
 
-    GDALClose(hDS);
+    gdal_close_cached(hDS);
 
     return true;
 }
@@ -85,7 +85,7 @@ bool GDALGrid::read()
 	if (read_p()) // nothing to do
 		return true;
 
-    GDALDatasetH hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+    GDALDatasetH hDS = gdal_open_cached(filename);
     if (hDS == NULL)
         throw Error(string(CPLGetLastErrorMsg()));
 
@@ -109,11 +109,11 @@ bool GDALGrid::read()
         array->set_read_p(true);
     }
     catch (...) {
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         throw;
     }
 
-    GDALClose(hDS);
+    gdal_close_cached(hDS);
 
 	return true;
 }
@@ -54,6 +54,7 @@
 #include <BESDapError.h>
 #include <BESInternalFatalError.h>
 #include <BESUtil.h>
+#include <TheBESKeys.h>
 
 #include <BESDebug.h>
 
@@ -78,10 +79,14 @@ GDALRequestHandler::GDALRequestHandler(const string &name) :
     add_method(VERS_RESPONSE, GDALRequestHandler::gdal_build_version);
 
     GDALAllRegister();
+
+    // Keep this many datasets open in each BES process; see gdal_utils.cc
+    gdal_set_dataset_cache_entries(TheBESKeys::TheKeys()->read_int_key("GDAL.DatasetCacheEntries", 0));
 }
 
 GDALRequestHandler::~GDALRequestHandler()
 {
+    gdal_clear_dataset_cache();
 }
 
 bool GDALRequestHandler::gdal_build_das(BESDataHandlerInterface & dhi)
@@ -97,14 +102,14 @@ bool GDALRequestHandler::gdal_build_das(BESDataHandlerInterface & dhi)
         DAS *das = bdas->get_das();
         string filename = dhi.container->access();
 
-        hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+        hDS = gdal_open_cached(filename);
 
         if (hDS == NULL)
             throw Error(string(CPLGetLastErrorMsg()));
 
         gdal_read_dataset_attributes(*das, hDS);
 
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         hDS = 0;
 
         Ancillary::read_ancillary_das(*das, filename);
@@ -112,19 +117,19 @@ bool GDALRequestHandler::gdal_build_das(BESDataHandlerInterface & dhi)
         bdas->clear_container();
     }
     catch (BESError &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw;
     }
     catch (InternalErr & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (Error & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (...) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESInternalFatalError("unknown exception caught building DAS", __FILE__, __LINE__);
     }
 
@@ -147,33 +152,33 @@ bool GDALRequestHandler::gdal_build_dds(BESDataHandlerInterface & dhi)
         dds->filename(filename);
         dds->set_dataset_name(name_path(filename)/*filename.substr(filename.find_last_of('/') + 1)*/);
 
-        hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+        hDS = gdal_open_cached(filename);
 
         if (hDS == NULL)
             throw Error(string(CPLGetLastErrorMsg()));
 
         gdal_read_dataset_variables(dds, hDS, filename,true);
 
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         hDS = 0;
 
         bdds->set_constraint(dhi);
         bdds->clear_container();
     }
     catch (BESError &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw;
     }
     catch (InternalErr & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (Error & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (...) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESInternalFatalError("unknown exception caught building DDS", __FILE__, __LINE__);
     }
 
@@ -198,7 +203,7 @@ bool GDALRequestHandler::gdal_build_data(BESDataHandlerInterface & dhi)
         dds->filename(filename);
         dds->set_dataset_name(name_path(filename)/*filename.substr(filename.find_last_of('/') + 1)*/);
 
-        hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+        hDS = gdal_open_cached(filename);
 
         if (hDS == NULL)
             throw Error(string(CPLGetLastErrorMsg()));
@@ -206,7 +211,7 @@ bool GDALRequestHandler::gdal_build_data(BESDataHandlerInterface & dhi)
         // The das will not be generated. KY 10/30/19
         gdal_read_dataset_variables(dds, hDS, filename,false);
 
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         hDS = 0;
 
         bdds->set_constraint(dhi);
@@ -215,19 +220,19 @@ bool GDALRequestHandler::gdal_build_data(BESDataHandlerInterface & dhi)
         bdds->clear_container();
     }
     catch (BESError &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw;
     }
     catch (InternalErr & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (Error & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (...) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESInternalFatalError("unknown exception caught building DAS", __FILE__, __LINE__);
     }
 
@@ -250,7 +255,7 @@ bool GDALRequestHandler::gdal_build_dmr_using_dds(BESDataHandlerInterface &dhi)
 	DDS dds(&factory, name_path(filename), "3.2");
 	dds.filename(filename);
 
-    GDALDatasetH hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+    GDALDatasetH hDS = gdal_open_cached(filename);
 
     if (hDS == NULL)
         throw Error(string(CPLGetLastErrorMsg()));
@@ -258,19 +263,19 @@ bool GDALRequestHandler::gdal_build_dmr_using_dds(BESDataHandlerInterface &dhi)
 	try {
 		gdal_read_dataset_variables(&dds, hDS, filename,true);
 
-		GDALClose(hDS);
+		gdal_close_cached(hDS);
 		hDS = 0;
 	}
 	catch (InternalErr &e) {
-	    if (hDS) GDALClose(hDS);
+	    if (hDS) gdal_close_cached(hDS);
 		throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
 	}
 	catch (Error &e) {
-	    if (hDS) GDALClose(hDS);
+	    if (hDS) gdal_close_cached(hDS);
 		throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
 	}
 	catch (...) {
-	    if (hDS) GDALClose(hDS);
+	    if (hDS) gdal_close_cached(hDS);
 		throw BESDapError("Caught unknown error building GDAL DMR response", true, unknown_error, __FILE__, __LINE__);
 	}
 
@@ -313,24 +318,24 @@ bool GDALRequestHandler::gdal_build_dmr(BESDataHandlerInterface &dhi)
     GDALDatasetH hDS = 0;
 
     try {
-        hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+        hDS = gdal_open_cached(filename);
         if (hDS == NULL) throw Error(string(CPLGetLastErrorMsg()));
 
         gdal_read_dataset_variables(dmr, hDS, filename);
 
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         hDS = 0;
     }
     catch (InternalErr &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (Error &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (...) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         throw BESDapError("Caught unknown error building GDAL DMR response", true, unknown_error, __FILE__, __LINE__);
     }
 
@@ -399,7 +404,7 @@ void GDALRequestHandler::add_attributes(BESDataHandlerInterface &dhi) {
         // sets the current container for the DAS.
         if (!container_name.empty()) das->container_name(container_name);
 
-        hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+        hDS = gdal_open_cached(filename);
         if (hDS == NULL)
             throw Error(string(CPLGetLastErrorMsg()));
 
@@ -409,7 +414,7 @@ void GDALRequestHandler::add_attributes(BESDataHandlerInterface &dhi) {
         dds->transfer_attributes(das);
 
         delete das;
-        GDALClose(hDS);
+        gdal_close_cached(hDS);
         hDS = 0;
         BESDEBUG("gdal", "Data ACCESS in add_attributes(): set the including attribute flag to true: "<<filename << endl);
         bdds->set_ia_flag(true);
@@ -417,22 +422,22 @@ void GDALRequestHandler::add_attributes(BESDataHandlerInterface &dhi) {
     }
 
     catch (BESError &e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         if (das) delete das;
         throw;
     }
     catch (InternalErr & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         if (das) delete das;
         throw BESDapError(e.get_error_message(), true, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (Error & e) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         if (das) delete das;
         throw BESDapError(e.get_error_message(), false, e.get_error_code(), __FILE__, __LINE__);
     }
     catch (...) {
-        if (hDS) GDALClose(hDS);
+        if (hDS) gdal_close_cached(hDS);
         if (das) delete das;
         throw BESInternalFatalError("unknown exception caught building DDS", __FILE__, __LINE__);
     }
@@ -21,6 +21,9 @@
 
 #include "config.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -50,8 +53,12 @@
 #include <D4BaseTypeFactory.h>
 #include <debug.h>
 
+#include <BESOpenFileCache.h>
+
 #include "GDALTypes.h"
+#include "gdal_utils.h"
 
+using namespace std;
 using namespace libdap;
 
 /************************************************************************/
@@ -644,16 +651,39 @@ void read_data_array(GDALArray *array, const GDALRasterBandH &hBand)
     /*      Allocate buffer.                                                */
     /* -------------------------------------------------------------------- */
     int nPixelSize = GDALGetDataTypeSize(array->get_gdal_buf_type()) / 8;
-    vector<char> pData(nBufXSize * nBufYSize * nPixelSize);
+
+    // If the Array holds exactly the values read, read them into its own
+    // storage instead of reading into a buffer and copying that.
+    bool direct = array->length() == nBufXSize * nBufYSize && array->var()->width() == (unsigned int) nPixelSize;
+
+    vector<char> pData;
+    char *buf;
+    if (direct) {
+        array->reserve_value_capacity(nBufXSize * nBufYSize);
+        buf = array->get_buf();
+    }
+    else {
+        pData.resize(nBufXSize * nBufYSize * nPixelSize);
+        buf = &pData[0];
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*      Tell the driver which blocks will be read so it can fetch them  */
+    /*      together (e.g., one multi-range request for a remote COG).      */
+    /* -------------------------------------------------------------------- */
+#if GDAL_VERSION_MAJOR >= 2
+    GDALRasterAdviseRead(hBand, nWinXOff, nWinYOff, nWinXSize, nWinYSize, nBufXSize, nBufYSize,
+        array->get_gdal_buf_type(), 0);
+#endif
 
     /* -------------------------------------------------------------------- */
     /*      Read request into buffer.                                       */
     /* -------------------------------------------------------------------- */
-    CPLErr eErr = GDALRasterIO(hBand, GF_Read, nWinXOff, nWinYOff, nWinXSize, nWinYSize, &pData[0], nBufXSize,
+    CPLErr eErr = GDALRasterIO(hBand, GF_Read, nWinXOff, nWinYOff, nWinXSize, nWinYSize, buf, nBufXSize,
         nBufYSize, array->get_gdal_buf_type(), 0, 0);
     if (eErr != CE_None) throw Error("Error reading: " + array->name());
 
-    array->val2buf(&pData[0]);
+    if (!direct) array->val2buf(buf);
 }
 
 /**
@@ -742,3 +772,72 @@ void read_map_array(Array *map, const GDALRasterBandH &hBand, const GDALDatasetH
 // New
 //
 
+
+static void close_dataset(GDALDatasetH hDS)
+{
+    GDALClose(hDS);
+}
+
+// GDALOpen() reads a dataset's header and, for many drivers, its tile or strip
+// index, and each open dataset has its own part of GDAL's block cache. Keeping
+// datasets open saves that work for the DAS, DDS and data responses, for each
+// band of a dataset, and across requests.
+static BESOpenFileCache<GDALDatasetH> gdal_dataset_cache(close_dataset, "gdal");
+
+/**
+ * @brief Set the number of datasets kept open
+ *
+ * If zero (the default) datasets are not kept open and gdal_open_cached() and
+ * gdal_close_cached() just call GDALOpen() and GDALClose().
+ */
+void gdal_set_dataset_cache_entries(unsigned int entries)
+{
+    gdal_dataset_cache.set_max_entries(entries);
+}
+
+/**
+ * @brief Close all of the datasets kept open that are not in use
+ *
+ * Call this before the GDAL drivers are unloaded.
+ */
+void gdal_clear_dataset_cache()
+{
+    gdal_dataset_cache.clear();
+}
+
+/**
+ * @brief Open a GDAL dataset (read only), reusing an open dataset if possible
+ *
+ * Only datasets that are files are kept open; others, such as /vsicurl/
+ * URLs, are opened every time. Each call must be matched by a call to
+ * gdal_close_cached().
+ *
+ * @param filename The dataset's file
+ * @return The dataset handle or NULL if GDALOpen() failed
+ */
+GDALDatasetH gdal_open_cached(const string &filename)
+{
+    struct stat sb;
+    if (gdal_dataset_cache.get_max_entries() == 0 || stat(filename.c_str(), &sb) != 0)
+        return GDALOpen(filename.c_str(), GA_ReadOnly);
+
+    BESOpenFileCache<GDALDatasetH>::entry *dataset = gdal_dataset_cache.get(filename, sb);
+    if (dataset) return dataset->handle;
+
+    GDALDatasetH hDS = GDALOpen(filename.c_str(), GA_ReadOnly);
+    if (hDS) gdal_dataset_cache.add(filename, sb, hDS);
+
+    return hDS;
+}
+
+/**
+ * @brief Release a dataset opened by gdal_open_cached()
+ *
+ * The dataset stays open while it is kept by the handler.
+ *
+ * @param hDS The dataset handle
+ */
+void gdal_close_cached(GDALDatasetH hDS)
+{
+    if (!gdal_dataset_cache.release(hDS)) GDALClose(hDS);
+}
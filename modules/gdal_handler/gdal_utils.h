@@ -32,4 +32,12 @@ void gdal_read_dataset_variables(libdap::DMR *dmr, const GDALDatasetH &hDS, cons
 void read_data_array(GDALArray *array, const GDALRasterBandH &hBand);
 void read_map_array(libdap::Array *map, const GDALRasterBandH &hBand, const GDALDatasetH &hDS);
 
+// Keep GDAL datasets open in each BES process (see BESOpenFileCache). Use
+// these in place of GDALOpen() and GDALClose().
+void gdal_set_dataset_cache_entries(unsigned int entries);
+void gdal_clear_dataset_cache();
+
+GDALDatasetH gdal_open_cached(const std::string &filename);
+void gdal_close_cached(GDALDatasetH hDS);
+
 #endif /* MODULES_GDAL_HANDLER_GDAL_UTILS_H_ */
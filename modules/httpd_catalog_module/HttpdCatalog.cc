@@ -190,6 +190,42 @@ HttpdCatalog::get_node(const string &ppath) const
     return node;
 }
 
+/**
+ * @brief Write the site map for the catalog, or the part of it under 'path'.
+ *
+ * The remote directories are crawled in parallel; see HttpdDirScraper::get_site_map().
+ *
+ * @param prefix Prefix for each line
+ * @param node_suffix Suffix for nodes; if empty, nodes are not written.
+ * @param leaf_suffix Suffix for leaves; if empty, leaves are not written.
+ * @param out Write the site map here
+ * @param path The catalog path at which to start.
+ */
+void HttpdCatalog::get_site_map(const string &prefix, const string &node_suffix, const string &leaf_suffix,
+    ostream &out, const string &path) const
+{
+    HttpdDirScraper hds;
+
+    if (path.empty() || path == "/") {
+        if (!node_suffix.empty())
+            out << prefix << "/" << node_suffix << endl;
+
+        for (map<string, string>::const_iterator it = d_httpd_catalogs.begin(); it != d_httpd_catalogs.end(); ++it) {
+            string url = it->second;
+            if (!BESUtil::endsWith(url, "/")) url.append("/");
+            hds.get_site_map(url, "/" + it->first + "/", prefix, node_suffix, leaf_suffix, out);
+        }
+    }
+    else {
+        string url = path_to_access_url(path);
+        if (!BESUtil::endsWith(url, "/")) url.append("/");
+        string node_path = path;
+        if (!BESUtil::endsWith(node_path, "/")) node_path.append("/");
+        if (node_path[0] != '/') node_path = "/" + node_path;
+        hds.get_site_map(url, node_path, prefix, node_suffix, leaf_suffix, out);
+    }
+}
+
 /**
  * @brief Takes a path which begins with the name of an HttpdCatalog collection and
  * returns the associated access url for the referenced thingy.
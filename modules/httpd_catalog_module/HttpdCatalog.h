@@ -68,17 +68,8 @@ public:
      */
     virtual std::string get_root() const { return ""; }
 
-    /**
-     * Maybe someday...
-     */
-    virtual void get_site_map(
-        const std::string &/*prefix*/,
-        const std::string &/*node_suffix*/,
-        const std::string &/*leaf_suffix*/,
-		std::ostream &/*out*/,
-        const std::string &/*path = "/"*/) const {
-        BESDEBUG(MODULE, "The HttpdCatalog::get_site_map() method is not currently supported. SKIPPING. file: " << __FILE__ << " line: "  << __LINE__ << std::endl);
-    }
+    virtual void get_site_map(const std::string &prefix, const std::string &node_suffix, const std::string &leaf_suffix,
+        std::ostream &out, const std::string &path = "/") const;
 
     virtual bes::CatalogNode *get_node(const std::string &path) const;
 
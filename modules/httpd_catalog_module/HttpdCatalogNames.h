@@ -44,6 +44,10 @@
 #define HTTPD_CATALOG_PROXYPASSWORD "Httpd_Catalog.ProxyPassword"
 #define HTTPD_CATALOG_PROXYUSERPW "Httpd_Catalog.ProxyUserPW"
 #define HTTPD_CATALOG_USE_INTERNAL_CACHE "Httpd_Catalog.UseInternalCache"
+#define HTTPD_CATALOG_CRAWL_THREADS "Httpd_Catalog.Crawl.Threads"
+#define HTTPD_CATALOG_NODE_CACHE_ENTRIES "Httpd_Catalog.NodeCache.Entries"
+#define HTTPD_CATALOG_SITE_MAP_MAX_DEPTH "Httpd_Catalog.SiteMap.MaxDepth"
+#define HTTPD_CATALOG_SITE_MAP_MAX_PAGES "Httpd_Catalog.SiteMap.MaxPages"
 
 #define MODULE HTTPD_CATALOG
 
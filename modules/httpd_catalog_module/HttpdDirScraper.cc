@@ -28,16 +28,31 @@
 #include <stdlib.h>     /* atol */
 #include <ctype.h> /* isalpha and isdigit */
 #include <time.h> /* mktime */
+#include <pthread.h>
+
+#include <cstdio>
+#include <algorithm>
 
 #include <BESDebug.h>
+#include <BESLog.h>
 #include <BESUtil.h>
 #include <BESRegex.h>
 #include <BESCatalogList.h>
 #include <BESCatalogUtils.h>
 #include <CatalogItem.h>
+#include <BESInternalError.h>
+#include <BESHttpCacheRevalidator.h>
+#include <TheBESKeys.h>
+#include <WhiteList.h>
+
+#include <util.h>
+#include <Error.h>
+#include <DapObj.h>
+#include <ObjMemCache.h>
 
 #include "RemoteHttpResource.h"
 #include "HttpdCatalogNames.h"
+#include "curl_utils.h"
 
 #include "HttpdDirScraper.h"
 
@@ -71,6 +86,8 @@ HttpdDirScraper::HttpdDirScraper()
  */
 long HttpdDirScraper::get_size_val(const string size_str) const
 {
+    if (size_str.empty()) return 0;
+
     char scale_c = *size_str.rbegin();
     long scale = 1;
 
@@ -149,6 +166,9 @@ string HttpdDirScraper::httpd_time_to_iso_8601(const string httpd_time) const
     BESUtil::tokenize(httpd_time, tokens, delimiters);
 
     BESDEBUG(MODULE, prolog << "Found " << tokens.size() << " tokens." << endl);
+    // No time was listed; leave the item's last modified time empty.
+    if (tokens.size() < 2) return "";
+
     vector<string>::iterator it = tokens.begin();
     int i = 0;
     if (BESDebug::IsSet(MODULE)) {
@@ -256,11 +276,229 @@ time_t HttpdDirScraper::parse_time_format_B(const vector<string> tokens) const
 }
 
 /**
- * @brief Converts an Apache httpd directory page into a collection of bes::CatalogItems.
+ * The items parsed from one httpd directory page along with the validators
+ * (Last-Modified and ETag) sent with the page. These are what the node cache
+ * holds.
+ */
+class HttpdDirPage: public libdap::DapObj {
+public:
+    string d_last_modified;
+    string d_etag;
+    map<string, CatalogItem *> d_items;
+
+    HttpdDirPage(const string &last_modified, const string &etag) :
+        d_last_modified(last_modified), d_etag(etag)
+    {
+    }
+
+    virtual ~HttpdDirPage()
+    {
+        for (map<string, CatalogItem *>::iterator i = d_items.begin(), e = d_items.end(); i != e; ++i)
+            delete i->second;
+    }
+
+    /// @return True if the page has a validator that can be used to test if it has changed
+    bool has_validator() const
+    {
+        return !d_last_modified.empty() || !d_etag.empty();
+    }
+
+    /// @return True if a response with these validators holds the same page
+    bool is_valid(const string &last_modified, const string &etag) const
+    {
+        if (!d_last_modified.empty() && d_last_modified == last_modified) return true;
+        return !d_etag.empty() && d_etag == etag;
+    }
+
+    /// Add copies of this page's items to 'items'
+    void copy_items(map<string, CatalogItem *> &items) const
+    {
+        for (map<string, CatalogItem *>::const_iterator i = d_items.begin(), e = d_items.end(); i != e; ++i) {
+            const CatalogItem *item = i->second;
+            items.insert(pair<string, CatalogItem *>(i->first,
+                new CatalogItem(item->get_name(), item->get_size(), item->get_lmt(), item->is_data(), item->get_type())));
+        }
+    }
+};
+
+/**
+ * Get the per-process node cache. Its size is set using
+ * Httpd_Catalog.NodeCache.Entries; zero turns the cache off.
  *
- * If one considers each Apache httpd generated directory page to be equivalent to
- * a bes::CatalogNode then this method examines the contents of the httpd directory page and
- * builds child node and leaf bes:CatalogItems based on what it finds.
+ * @return The cache or null if it is disabled
+ */
+static ObjMemCache *get_node_cache()
+{
+    static ObjMemCache *node_cache = 0;
+    static bool initialized = false;
+    if (!initialized) {
+        int entries = TheBESKeys::TheKeys()->read_int_key(HTTPD_CATALOG_NODE_CACHE_ENTRIES, 100);
+        if (entries > 0) node_cache = new ObjMemCache(entries, 0.2);
+        initialized = true;
+    }
+
+    return node_cache;
+}
+
+/**
+ * Add a copy of 'page' to the node cache if the cache is enabled and the
+ * page can be validated.
+ */
+static void cache_page(const string &url, const HttpdDirPage &page)
+{
+    ObjMemCache *cache = get_node_cache();
+    if (!cache || !page.has_validator()) return;
+
+    HttpdDirPage *copy = new HttpdDirPage(page.d_last_modified, page.d_etag);
+    page.copy_items(copy->d_items);
+    cache->remove(url);
+    cache->add(copy, url);
+}
+
+/**
+ * One token of an HTML page: a start tag, an end tag or a run of text.
+ */
+struct html_token {
+    enum token_type { start_tag, end_tag, characters } type;
+    string name;    // The lower case tag name, for tags
+    string href;    // The value of the href attribute, for start tags
+    string text;    // The text, for text tokens
+};
+
+/**
+ * Get the next token from an HTML page. This is just enough of an HTML
+ * tokenizer to read the directory pages made by httpd; comments, doctype
+ * declarations and processing instructions are skipped and only the href
+ * attribute of a tag is kept. Quoted attribute values may contain '>'.
+ *
+ * @param page The HTML page
+ * @param pos Value-result parameter; where to start and, on return, the
+ * position after the token.
+ * @param token Value-result parameter for the token
+ * @return False if there are no more tokens.
+ */
+static bool next_html_token(const string &page, string::size_type &pos, html_token &token)
+{
+    const string::size_type len = page.length();
+
+    while (pos < len) {
+        token.name.clear();
+        token.href.clear();
+        token.text.clear();
+
+        if (page[pos] != '<') {
+            string::size_type end = page.find('<', pos);
+            if (end == string::npos) end = len;
+            token.type = html_token::characters;
+            token.text = page.substr(pos, end - pos);
+            pos = end;
+            return true;
+        }
+
+        if (page.compare(pos, 4, "<!--") == 0) {
+            string::size_type end = page.find("-->", pos + 4);
+            pos = (end == string::npos) ? len : end + 3;
+            continue;
+        }
+
+        string::size_type i = pos + 1;
+        bool closing = (i < len && page[i] == '/');
+        if (closing) ++i;
+
+        if (i < len && (page[i] == '!' || page[i] == '?')) {
+            string::size_type end = page.find('>', i);
+            pos = (end == string::npos) ? len : end + 1;
+            continue;
+        }
+
+        string::size_type name_start = i;
+        while (i < len && isalnum(page[i]))
+            ++i;
+        token.type = closing ? html_token::end_tag : html_token::start_tag;
+        token.name = BESUtil::lowercase(page.substr(name_start, i - name_start));
+
+        // Scan the attributes, keeping the href.
+        while (i < len && page[i] != '>') {
+            if (isspace(page[i]) || page[i] == '/') {
+                ++i;
+                continue;
+            }
+
+            string::size_type attr_start = i;
+            while (i < len && !isspace(page[i]) && page[i] != '=' && page[i] != '>')
+                ++i;
+            if (i == attr_start) {
+                ++i;
+                continue;
+            }
+            string attr = BESUtil::lowercase(page.substr(attr_start, i - attr_start));
+
+            string value;
+            if (i < len && page[i] == '=') {
+                ++i;
+                if (i < len && (page[i] == '"' || page[i] == '\'')) {
+                    char quote = page[i++];
+                    string::size_type end = page.find(quote, i);
+                    if (end == string::npos) end = len;
+                    value = page.substr(i, end - i);
+                    i = (end < len) ? end + 1 : len;
+                }
+                else {
+                    string::size_type value_start = i;
+                    while (i < len && !isspace(page[i]) && page[i] != '>')
+                        ++i;
+                    value = page.substr(value_start, i - value_start);
+                }
+            }
+
+            if (attr == "href") token.href = value;
+        }
+
+        pos = (i < len) ? i + 1 : len;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the name, relative to the directory page at 'url', of a link on that page.
+ *
+ * Links may be relative ("file.nc"), absolute paths ("/data/dir/file.nc") or
+ * absolute URLs ("http://host/data/dir/file.nc"). Only links to items in the
+ * directory at 'url' (or its subdirectories) have a name; links to other hosts
+ * and to parent or sibling directories do not.
+ *
+ * @param url The url of the httpd directory page; must end in '/'
+ * @param href The link's href
+ * @param name Value-result parameter; the link relative to 'url'
+ * @return True if the link is to an item in the directory, false otherwise.
+ */
+bool HttpdDirScraper::get_relative_href(const string &url, const string &href, string &name)
+{
+    if (href.find("http://") == 0 || href.find("https://") == 0) {
+        if (href.find(url) != 0) return false;
+        name = href.substr(url.length());
+    }
+    else if (!href.empty() && href[0] == '/') {
+        // The path part of the url, e.g., '/data/' for 'http://test.opendap.org/data/'
+        string::size_type path_start = url.find("://");
+        path_start = (path_start == string::npos) ? 0 : url.find('/', path_start + 3);
+        if (path_start == string::npos) return false;
+
+        string dir_path = url.substr(path_start);
+        if (href.find(dir_path) != 0) return false;
+        name = href.substr(dir_path.length());
+    }
+    else {
+        name = href;
+    }
+
+    return !name.empty();
+}
+
+/**
+ * @brief Add the bes::CatalogItem for one link on an httpd directory page.
  *
  * isData: The besCatalogItem objects that are leaves are evaluated against the BES_DEFAULT_CATALOG
  * TypeMatch by retrieving the BES_DEFAULT_CATALOG's BESCatalogUtils and then calling
@@ -268,163 +506,517 @@ time_t HttpdDirScraper::parse_time_format_B(const vector<string> tokens) const
  * TypeMatch string.
  *
  * @param url The url of the source httpd directory.
+ * @param link The link's href
+ * @param link_text The link's text; empty if the link is an image.
+ * @param time_str The last modified time listed for the link
+ * @param size_str The size listed for the link
+ * @param items Add the new item here.
+ */
+void HttpdDirScraper::addPageItem(const string &url, const string &link, const string &link_text,
+    const string &time_str, const string &size_str, map<string, CatalogItem *> &items) const
+{
+    static BESRegex hrefExcludeRegex("(^#.*$)|(^\\?C.*$)|(redirect\\/)|(^\\/$)|(^<img.*$)");
+    static BESRegex nameExcludeRegex("^Parent Directory$");
+
+    BESDEBUG(MODULE, prolog << "href: " << link << " Link Text: " << link_text << endl);
+    BESDEBUG(MODULE, prolog << "time_str: '" << time_str << "' size_str: '" << size_str << "'" << endl);
+
+    string href;
+    if (!(link_text.length()) || (link_text.find("<<<") != string::npos) || (link_text.find(">>>") != string::npos)) {
+        BESDEBUG(MODULE, prolog << "SKIPPING(image|copy|<<<|>>>): " << link << endl);
+    }
+    else if (!get_relative_href(url, link, href)) {
+        BESDEBUG(MODULE, prolog << "SKIPPING(null, remote or outside the directory): " << link << endl);
+    }
+    else if (hrefExcludeRegex.match(href.c_str(), href.length(), 0) > 0) {
+        BESDEBUG(MODULE, prolog << "SKIPPING(hrefExcludeRegex) - href: '" << href << "'"<< endl);
+    }
+    else if (nameExcludeRegex.match(link_text.c_str(), link_text.length(), 0) > 0) {
+        BESDEBUG(MODULE, prolog << "SKIPPING(nameExcludeRegex) - name: '" << link_text << "'" << endl);
+    }
+    else if (BESUtil::endsWith(href, "/")) {
+        string node_name = href.substr(0, href.length() - 1);
+        // it's a directory aka a node
+        BESDEBUG(MODULE, prolog << "NODE: " << node_name << endl);
+        CatalogItem *childNode = new CatalogItem();
+        childNode->set_type(CatalogItem::node);
+        childNode->set_name(node_name);
+        childNode->set_is_data(false);
+        childNode->set_lmt(httpd_time_to_iso_8601(time_str));
+        // FIXME: For nodes the size should be the number of children, but how without crawling?
+        childNode->set_size(get_size_val(size_str));
+
+        items.insert(pair<string, CatalogItem *>(node_name, childNode));
+    }
+    else {
+        // It's a file aka a leaf
+        BESDEBUG(MODULE, prolog << "LEAF: " << href << endl);
+        const BESCatalogUtils *cat_utils = BESCatalogList::TheCatalogList()->find_catalog(BES_DEFAULT_CATALOG)->get_catalog_utils();
+        CatalogItem *leafItem = new CatalogItem();
+        leafItem->set_type(CatalogItem::leaf);
+        leafItem->set_name(href);
+        leafItem->set_is_data(cat_utils->is_data(href));
+        leafItem->set_lmt(httpd_time_to_iso_8601(time_str));
+        leafItem->set_size(get_size_val(size_str));
+
+        items.insert(pair<string, CatalogItem *>(href, leafItem));
+    }
+}
+
+/**
+ * @brief Converts the text of an Apache httpd directory page into a collection of bes::CatalogItems.
+ *
+ * If one considers each Apache httpd generated directory page to be equivalent to
+ * a bes::CatalogNode then this method examines the contents of the httpd directory page and
+ * builds child node and leaf bes:CatalogItems based on what it finds.
+ *
+ * The page is read in one pass. Each link is followed by its last modified time and size,
+ * either in the next two td elements (FancyIndexing with HTMLTable) or as text following
+ * the link (a pre-formatted listing).
+ *
+ * @param url The url of the source httpd directory.
+ * @param page_str The page
  * @param items The map (list sorted by href) of catalog Items generated by the scrape processes. The map's
  * key is the bes::CatalogItem::name().
  */
-void HttpdDirScraper::createHttpdDirectoryPageMap(std::string url, std::map<std::string, bes::CatalogItem *> &items) const
+void HttpdDirScraper::parseHttpdDirectoryPage(const string &url, const string &page_str,
+    map<string, CatalogItem *> &items) const
 {
-    const BESCatalogUtils *cat_utils = BESCatalogList::TheCatalogList()->find_catalog(BES_DEFAULT_CATALOG)->get_catalog_utils();
+    html_token token;
+    string::size_type pos = 0;
+
+    bool in_anchor = false;     // inside <a> ... </a>
+    bool link_has_img = false;
+    bool pending = false;       // a link has been read; looking for its time and size
+    bool in_td = false;
+    string href, link_text, td_text, trailing_text;
+    vector<string> cells;
+
+    while (true) {
+        bool more = next_html_token(page_str, pos, token);
+
+        // A pending link is added once its time and size are found, or at the
+        // next link, the end of its table row or the end of the page.
+        if (pending && (!more || (token.type == html_token::start_tag && token.name == "a")
+            || (token.type == html_token::end_tag && token.name == "tr") || cells.size() == 2)) {
+            string time_str, size_str;
+            if (cells.size() == 2) {
+                time_str = cells[0];
+                size_str = cells[1];
+            }
+            else if (cells.empty()) {
+                // "<a href="x">x</a>   19-Oct-2018 19:32   23K"
+                vector<string> words;
+                BESUtil::tokenize(trailing_text, words, " \t\r\n");
+                if (words.size() > 2) {
+                    time_str = words[0] + " " + words[1];
+                    size_str = words[2];
+                }
+            }
+            addPageItem(url, href, link_has_img ? "" : link_text, time_str, size_str, items);
+            pending = false;
+        }
+
+        if (!more) break;
 
+        if (token.type == html_token::characters) {
+            if (in_anchor)
+                link_text.append(token.text);
+            else if (in_td)
+                td_text.append(token.text);
+            else if (pending && cells.empty())
+                trailing_text.append(token.text);
+        }
+        else if (token.name == "a" && token.type == html_token::start_tag) {
+            in_anchor = true;
+            link_has_img = false;
+            href = token.href;
+            link_text.clear();
+        }
+        else if (in_anchor) {
+            if (token.name == "img")
+                link_has_img = true;
+            else if (token.name == "a") {
+                in_anchor = false;
+                pending = true;
+                in_td = false;
+                cells.clear();
+                trailing_text.clear();
+            }
+        }
+        else if (pending && token.name == "td") {
+            if (token.type == html_token::start_tag) {
+                in_td = true;
+                td_text.clear();
+            }
+            else if (in_td) {
+                in_td = false;
+                BESUtil::removeLeadingAndTrailingBlanks(td_text);
+                cells.push_back(td_text);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Converts an Apache httpd directory page into a collection of bes::CatalogItems.
+ *
+ * The page is retrieved using RemoteHttpResource (and so is held in the RemoteHttpResourceCache).
+ * If the node cache holds the items for a page with the same Last-Modified or ETag header,
+ * those are used instead of parsing the page again.
+ *
+ * @param url The url of the source httpd directory.
+ * @param items The map (list sorted by href) of catalog Items generated by the scrape processes. The map's
+ * key is the bes::CatalogItem::name().
+ */
+void HttpdDirScraper::createHttpdDirectoryPageMap(std::string url, std::map<std::string, bes::CatalogItem *> &items) const
+{
     // Go get the text from the remote resource
     RemoteHttpResource rhr(url);
     rhr.retrieveResource();
+
+    HttpdDirPage page(rhr.get_http_response_header("last-modified"), rhr.get_http_response_header("etag"));
+
+    ObjMemCache *cache = get_node_cache();
+    HttpdDirPage *cached = cache ? static_cast<HttpdDirPage *>(cache->get(url)) : 0;
+    if (cached && cached->is_valid(page.d_last_modified, page.d_etag)) {
+        BESDEBUG(MODULE, prolog << "Using the cached items for " << url << endl);
+        cached->copy_items(items);
+        return;
+    }
+
     ifstream t(rhr.getCacheFileName().c_str());
     stringstream buffer;
     buffer << t.rdbuf();
-    string pageStr = buffer.str();
-
-    string aOpenStr = "<a ";
-    string aCloseStr = "</a>";
-    string hrefStr = "href=\"";
-    string tdOpenStr = "<td ";
-    string tdCloseStr = "</td>";
-
-    BESRegex hrefExcludeRegex("(^#.*$)|(^\\?C.*$)|(redirect\\/)|(^\\/$)|(^<img.*$)");
-    BESRegex nameExcludeRegex("^Parent Directory$");
-
-    bool done = false;
-    int next_start = 0;
-    while (!done) {
-        int aOpenIndex = pageStr.find(aOpenStr, next_start);
-        if (aOpenIndex < 0) {
-            done = true;
+
+    parseHttpdDirectoryPage(url, buffer.str(), page.d_items);
+    cache_page(url, page);
+    page.copy_items(items);
+}
+
+/**
+ * One directory page fetched by the crawler.
+ */
+struct crawl_page {
+    string url;
+    HttpdDirPage *cached;   // a copy of the cached page, if any
+    string last_modified;   // ... and its validators
+    string etag;
+
+    long status;
+    vector<string> resp_hdrs;
+    string body;
+    string error;
+
+    crawl_page(const string &u) : url(u), cached(0), status(0) { }
+    ~crawl_page()
+    {
+        delete cached;
+    }
+};
+
+/**
+ * The pages a crawler fetches and the next one to fetch, shared by the
+ * crawler threads.
+ */
+struct crawl_queue {
+    vector<crawl_page *> &pages;
+    size_t next;
+    pthread_mutex_t mutex;
+
+    crawl_queue(vector<crawl_page *> &p) : pages(p), next(0)
+    {
+        pthread_mutex_init(&mutex, 0);
+    }
+    ~crawl_queue()
+    {
+        pthread_mutex_destroy(&mutex);
+    }
+};
+
+/**
+ * One crawler thread and its curl handle.
+ */
+struct crawl_thread {
+    crawl_queue *queue;
+    CURL *curl;
+    char error_buffer[CURL_ERROR_SIZE];
+};
+
+/**
+ * Fetch one page, with a conditional GET if there are validators for it.
+ * Errors are recorded in the page.
+ */
+static void fetch_crawl_page(crawl_thread *thread, crawl_page *page)
+{
+    FILE *fp = 0;
+    try {
+        configureProxy(thread->curl, page->url);
+
+        vector<string> request_headers;
+        if (!page->last_modified.empty()) request_headers.push_back("If-Modified-Since: " + page->last_modified);
+        if (!page->etag.empty()) request_headers.push_back("If-None-Match: " + page->etag);
+
+        fp = tmpfile();
+        if (!fp) throw BESInternalError("Could not make a temporary file for a directory page.", __FILE__, __LINE__);
+
+        page->status = read_url(thread->curl, page->url, fileno(fp), &page->resp_hdrs, &request_headers,
+            thread->error_buffer);
+
+        if (page->status == 200 || page->status == 0) {
+            // read_url() writes using the file descriptor
+            rewind(fp);
+            char buf[65536];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+                page->body.append(buf, n);
+        }
+        else if (page->status != 304) {
+            page->error = "The request for '" + page->url + "' returned a status of "
+                + libdap::long_to_string(page->status);
+        }
+    }
+    catch (BESError &e) {
+        page->error = e.get_message();
+    }
+    catch (libdap::Error &e) {
+        page->error = e.get_error_message();
+    }
+
+    if (fp) fclose(fp);
+}
+
+/**
+ * Crawler thread function; fetch pages until there are none left.
+ */
+static void *crawl_worker(void *arg)
+{
+    crawl_thread *thread = static_cast<crawl_thread *>(arg);
+    crawl_queue *queue = thread->queue;
+
+    while (true) {
+        pthread_mutex_lock(&queue->mutex);
+        size_t i = queue->next++;
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (i >= queue->pages.size()) break;
+
+        fetch_crawl_page(thread, queue->pages[i]);
+    }
+
+    return 0;
+}
+
+/**
+ * Wait for the crawler threads and free their curl handles and pages
+ * after a crawl fails.
+ */
+static void abandon_crawl(vector<pthread_t> &tids, vector<crawl_thread> &threads, vector<crawl_page *> &work)
+{
+    for (size_t t = 0; t < tids.size(); ++t)
+        pthread_join(tids[t], 0);
+    for (size_t t = 0; t < threads.size(); ++t)
+        if (threads[t].curl) curl_easy_cleanup(threads[t].curl);
+    for (size_t p = 0; p < work.size(); ++p)
+        delete work[p];
+}
+
+/**
+ * @brief Fetch and parse a group of directory pages in parallel.
+ *
+ * At most Httpd_Catalog.Crawl.Threads pages are fetched at once. Pages in
+ * the node cache are revalidated with a conditional GET. These requests do
+ * not use the RemoteHttpResourceCache, which cannot be shared by threads.
+ *
+ * @param urls The pages to fetch
+ * @param pages Value-result parameter; the parsed pages are added, keyed by URL.
+ */
+void HttpdDirScraper::fetchPages(const vector<string> &urls, map<string, HttpdDirPage *> &pages) const
+{
+    ObjMemCache *cache = get_node_cache();
+
+    vector<crawl_page *> work;
+    for (vector<string>::const_iterator i = urls.begin(), e = urls.end(); i != e; ++i) {
+        crawl_page *page = new crawl_page(*i);
+        work.push_back(page);
+        HttpdDirPage *cached = cache ? static_cast<HttpdDirPage *>(cache->get(*i)) : 0;
+        if (cached) {
+            page->cached = new HttpdDirPage(cached->d_last_modified, cached->d_etag);
+            cached->copy_items(page->cached->d_items);
+            page->last_modified = cached->d_last_modified;
+            page->etag = cached->d_etag;
+        }
+    }
+
+    unsigned long num_threads = TheBESKeys::TheKeys()->read_int_key(HTTPD_CATALOG_CRAWL_THREADS, 4);
+    if (num_threads < 1) num_threads = 1;
+    num_threads = min(num_threads, (unsigned long) work.size());
+
+    crawl_queue queue(work);
+    vector<crawl_thread> threads(num_threads);
+    vector<pthread_t> tids;
+    try {
+        // Make the curl handles and the white list here; neither curl_easy_init()
+        // (until libcurl has been initialized) nor get_white_list() is thread-safe.
+        bes::WhiteList::get_white_list();
+        for (size_t t = 0; t < threads.size(); ++t) {
+            threads[t].queue = &queue;
+            threads[t].curl = 0;
+            threads[t].curl = init(threads[t].error_buffer);
+        }
+
+        // This thread is the first of the crawler threads
+        for (size_t t = 1; t < threads.size(); ++t) {
+            pthread_t tid;
+            if (pthread_create(&tid, 0, crawl_worker, &threads[t]) == 0) tids.push_back(tid);
         }
-        else {
-            int aCloseIndex = pageStr.find(aCloseStr, aOpenIndex + aOpenStr.length());
-            if (aCloseIndex < 0) {
-                done = true;
+        if (!threads.empty()) crawl_worker(&threads[0]);
+        for (size_t t = 0; t < tids.size(); ++t)
+            pthread_join(tids[t], 0);
+        tids.clear();
+
+        for (size_t t = 0; t < threads.size(); ++t)
+            curl_easy_cleanup(threads[t].curl);
+        threads.clear();
+
+        for (size_t p = 0; p < work.size(); ++p) {
+            crawl_page *page = work[p];
+            if (!page->error.empty()) throw BESInternalError(page->error, __FILE__, __LINE__);
+
+            HttpdDirPage *dir_page = 0;
+            if (page->status == 304 && page->cached) {
+                BESDEBUG(MODULE, prolog << "Not modified: " << page->url << endl);
+                dir_page = page->cached;
+                page->cached = 0;
             }
             else {
-                int length;
-
-                // Locate the entire <a /> element
-                BESDEBUG(MODULE, prolog << "aOpenIndex: " << aOpenIndex << endl);
-                BESDEBUG(MODULE, prolog << "aCloseIndex: " << aCloseIndex << endl);
-                length = aCloseIndex + aCloseStr.length() - aOpenIndex;
-                string aElemStr = pageStr.substr(aOpenIndex, length);
-                BESDEBUG(MODULE, prolog << "Processing link: " << aElemStr << endl);
-
-                // Find the link text
-                int start = aElemStr.find(">") + 1;
-                int end = aElemStr.find("<", start);
-                length = end - start;
-                string linkText = aElemStr.substr(start, length);
-                BESDEBUG(MODULE, prolog << "Link Text: " << linkText << endl);
-
-                // Locate the href attribute
-                start = aElemStr.find(hrefStr) + hrefStr.length();
-                end = aElemStr.find("\"", start);
-                length = end - start;
-                string href = aElemStr.substr(start, length);
-                BESDEBUG(MODULE, prolog << "href: " << href << endl);
-
-                // attempt to get time string
-                string time_str;
-                int start_pos = getNextElementText(pageStr, "td", aCloseIndex + aCloseStr.length(), time_str);
-                BESDEBUG(MODULE, prolog << "time_str: '" << time_str << "'" << endl);
-
-                // attempt to get size string
-                string size_str;
-                start_pos = getNextElementText(pageStr, "td", start_pos, size_str);
-                BESDEBUG(MODULE, prolog << "size_str: '" << size_str << "'" << endl);
-
-                if ((linkText.find("<img") != string::npos) || !(linkText.length()) || (linkText.find("<<<") != string::npos)
-                    || (linkText.find(">>>") != string::npos)) {
-                    BESDEBUG(MODULE, prolog << "SKIPPING(image|copy|<<<|>>>): " << aElemStr << endl);
-                }
-                else {
-                    if (href.length() == 0 || (((href.find("http://") == 0) || (href.find("https://") == 0)) && !(href.find(url) == 0))) {
-                        // SKIPPING
-                        BESDEBUG(MODULE, prolog << "SKIPPING(null or remote): " << href << endl);
-                    }
-                    else if (hrefExcludeRegex.match(href.c_str(), href.length(), 0) > 0) {
-                        // SKIPPING
-                        BESDEBUG(MODULE, prolog << "SKIPPING(hrefExcludeRegex) - href: '" << href << "'"<< endl);
-                    }
-                    else if (nameExcludeRegex.match(linkText.c_str(), linkText.length(), 0) > 0) {
-                        // SKIPPING
-                        BESDEBUG(MODULE, prolog << "SKIPPING(nameExcludeRegex) - name: '" << linkText << "'" << endl);
-                    }
-                    else if (BESUtil::endsWith(href, "/")) {
-                        string node_name = href.substr(0, href.length() - 1);
-                        // it's a directory aka a node
-                        BESDEBUG(MODULE, prolog << "NODE: " << node_name << endl);
-                        bes::CatalogItem *childNode = new bes::CatalogItem();
-                        childNode->set_type(CatalogItem::node);
-                        childNode->set_name(node_name);
-                        childNode->set_is_data(false);
-                        string iso_8601_time = httpd_time_to_iso_8601(time_str);
-                        childNode->set_lmt(iso_8601_time);
-                        // FIXME: For nodes the size should be the number of children, but how without crawling?
-                        long size = get_size_val(size_str);
-                        childNode->set_size(size);
-
-                        items.insert(pair<std::string, bes::CatalogItem *>(node_name, childNode));
-                    }
-                    else {
-                        // It's a file aka a leaf
-                        BESDEBUG(MODULE, prolog << "LEAF: " << href << endl);
-                        CatalogItem *leafItem = new CatalogItem();
-                        leafItem->set_type(CatalogItem::leaf);
-                        leafItem->set_name(href);
-                        leafItem->set_is_data(cat_utils->is_data(href));
-                        string iso_8601_time = httpd_time_to_iso_8601(time_str);
-                        leafItem->set_lmt(iso_8601_time);
-                        long size = get_size_val(size_str);
-                        leafItem->set_size(size);
-
-                        items.insert(pair<std::string, bes::CatalogItem *>(href, leafItem));
-                    }
-                }
+                dir_page = new HttpdDirPage(BESHttpCacheRevalidator::get_header(page->resp_hdrs, "last-modified"),
+                    BESHttpCacheRevalidator::get_header(page->resp_hdrs, "etag"));
+                parseHttpdDirectoryPage(page->url, page->body, dir_page->d_items);
+                cache_page(page->url, *dir_page);
             }
-            next_start = aCloseIndex + aCloseStr.length();
+            pages[page->url] = dir_page;
+
+            delete page;
+            work[p] = 0;
         }
     }
+    catch (BESError &e) {
+        LOG("Could not crawl the httpd directories: " << e.get_message() << endl);
+        abandon_crawl(tids, threads, work);
+        throw;
+    }
+    catch (libdap::Error &e) {
+        LOG("Could not crawl the httpd directories: " << e.get_error_message() << endl);
+        abandon_crawl(tids, threads, work);
+        throw BESInternalError(e.get_error_message(), __FILE__, __LINE__);
+    }
 }
 
 /**
- * Get's the text content of the next element_name element beginning at startIndex.
- * The correctness of this is very limitied and it works just well enough to grab the td elements that
- * hold last modified time and size in the httpd directory content. Just sayin.
+ * @brief Crawl the tree of httpd directory pages rooted at 'url'.
  *
- * @param page_str The string to examine.
- * @param element_name the name of the element whose text to get.
- * @param startIndex The index in page_str at which to begin the search.
- * @param resultText The text content of the element.
- * @param trim If true then leading and trailing whitespace will be removed from the result string. default: true
- * @return The next start index, after the td element closer.
+ * The tree is crawled one level at a time and each level's pages are fetched
+ * in parallel. The crawl stops at Httpd_Catalog.SiteMap.MaxDepth levels below
+ * 'url' or once Httpd_Catalog.SiteMap.MaxPages pages have been read, whichever
+ * comes first; the pages of directories below that are not read.
+ *
+ * @param url The root of the tree; must end in '/'
+ * @param pages Value-result parameter; the pages of the tree, keyed by URL.
+ * The caller must delete the HttpdDirPage objects.
+ */
+void HttpdDirScraper::crawl(const string &url, map<string, HttpdDirPage *> &pages) const
+{
+    unsigned long max_depth = TheBESKeys::TheKeys()->read_int_key(HTTPD_CATALOG_SITE_MAP_MAX_DEPTH, 16);
+    unsigned long max_pages = TheBESKeys::TheKeys()->read_int_key(HTTPD_CATALOG_SITE_MAP_MAX_PAGES, 10000);
+
+    vector<string> level(1, url);
+    for (unsigned long depth = 0; !level.empty(); ++depth) {
+        if (depth > max_depth || pages.size() + level.size() > max_pages) {
+            LOG("The site map of " << url << " is incomplete; it is more than " << max_depth
+                << " directories deep or has more than " << max_pages << " directories." << endl);
+            if (depth <= max_depth && pages.size() < max_pages) {
+                level.resize(max_pages - pages.size());
+                fetchPages(level, pages);
+            }
+            break;
+        }
+
+        BESDEBUG(MODULE, prolog << "Crawling " << level.size() << " pages." << endl);
+        fetchPages(level, pages);
+
+        vector<string> next_level;
+        for (vector<string>::iterator i = level.begin(), e = level.end(); i != e; ++i) {
+            HttpdDirPage *page = pages[*i];
+            for (map<string, CatalogItem *>::iterator j = page->d_items.begin(), je = page->d_items.end(); j != je; ++j) {
+                if (j->second->get_type() != CatalogItem::node) continue;
+                string child = BESUtil::pathConcat(*i, j->second->get_name()) + "/";
+                if (pages.find(child) == pages.end()) next_level.push_back(child);
+            }
+        }
+        level.swap(next_level);
+    }
+}
+
+/**
+ * The pages read by a crawl; deleted when the crawl is done.
  */
-int HttpdDirScraper::getNextElementText(const string &page_str, string element_name, int startIndex, string &resultText, bool trim) const
+struct crawled_pages {
+    map<string, HttpdDirPage *> d_pages;
+
+    ~crawled_pages()
+    {
+        for (map<string, HttpdDirPage *>::iterator i = d_pages.begin(), e = d_pages.end(); i != e; ++i)
+            delete i->second;
+    }
+};
+
+/**
+ * Write the site map for one crawled page and, depth first, its children.
+ * A directory whose page was not crawled is listed without its contents.
+ */
+static void write_site_map(const string &url, const string &path, const map<string, HttpdDirPage *> &pages,
+    const string &prefix, const string &node_suffix, const string &leaf_suffix, ostream &out)
 {
-    string e_open_str = "<" + element_name + " ";
-    string e_close_str = "</" + element_name + ">";
+    if (!node_suffix.empty())
+        out << prefix << path << node_suffix << endl;
 
-    // Locate the next "element_name"  element
-    int start = page_str.find(e_open_str, startIndex);
-    int end = page_str.find(e_close_str, start + e_open_str.length());
-    int length = end + e_close_str.length() - start;
-    string element_str = page_str.substr(start, length);
+    map<string, HttpdDirPage *>::const_iterator page = pages.find(url);
+    if (page == pages.end()) return;
 
-    // Find the text
-    start = element_str.find(">") + 1;
-    end = element_str.find("<", start);
-    length = end - start;
-    resultText = element_str.substr(start, length);
+    const map<string, CatalogItem *> &items = page->second->d_items;
+    for (map<string, CatalogItem *>::const_iterator i = items.begin(), e = items.end(); i != e; ++i) {
+        if (i->second->get_type() == CatalogItem::node)
+            write_site_map(BESUtil::pathConcat(url, i->first) + "/", path + i->first + "/", pages, prefix,
+                node_suffix, leaf_suffix, out);
+    }
 
-    if (trim) BESUtil::removeLeadingAndTrailingBlanks(resultText);
+    // For leaves, only write the data items
+    for (map<string, CatalogItem *>::const_iterator i = items.begin(), e = items.end(); i != e; ++i) {
+        if (i->second->get_type() == CatalogItem::leaf && i->second->is_data() && !leaf_suffix.empty())
+            out << prefix << path << i->first << leaf_suffix << endl;
+    }
+}
 
-    BESDEBUG(MODULE, prolog << "resultText: '" << resultText << "'" << endl);
-    return startIndex + element_str.length();
+/**
+ * @brief Write the site map for the tree of httpd directory pages rooted at 'url'.
+ *
+ * The output matches BESCatalogDirectory::get_site_map(): nodes, depth first,
+ * followed by the data leaves of each node.
+ *
+ * @param url The root of the tree; must end in '/'
+ * @param path The catalog path of 'url'; must end in '/'
+ * @param prefix Prefix for each line
+ * @param node_suffix Suffix for nodes; if empty, nodes are not written.
+ * @param leaf_suffix Suffix for leaves; if empty, leaves are not written.
+ * @param out Write the site map here
+ */
+void HttpdDirScraper::get_site_map(const string &url, const string &path, const string &prefix,
+    const string &node_suffix, const string &leaf_suffix, ostream &out) const
+{
+    crawled_pages pages;
+    crawl(url, pages.d_pages);
+    write_site_map(url, path, pages.d_pages, prefix, node_suffix, leaf_suffix, out);
 }
 
 /*
@@ -27,25 +27,42 @@
 #define MODULES_CMR_MODULE_HTTPDDIRSCRAPER_H_
 
 #include <set>
+#include <map>
+#include <vector>
 #include <string>
+#include <ostream>
 
 #include <CatalogNode.h>
 #include "HttpdCatalog.h"
 
 namespace httpd_catalog {
 
+class HttpdDirPage;
+
 /**
  * @brief This class builds a BES CatalogNode response from an httpd-generated directory page.
  *
  * The scraping is done procedurally. The primary assumption is that links that point to nodes always end
  * in "/". Links that end in other characters are assumed to be links to "leaves".
+ *
+ * The items parsed from each page are held in a per-process node cache, keyed by the page's URL, and
+ * are reused for as long as the page's Last-Modified (or ETag) header does not change. The size of the
+ * cache is set using Httpd_Catalog.NodeCache.Entries.
  */
 class HttpdDirScraper {
 private:
+    friend class HttpdDirScraperTest;
+
     std::map<std::string,int> d_months;
 
-    int getNextElementText(const std::string &page_str, std::string element_name, int startIndex, std::string &resultText, bool trim=true) const;
+    void parseHttpdDirectoryPage(const std::string &url, const std::string &page_str,
+        std::map<std::string, bes::CatalogItem *> &items) const;
+    static bool get_relative_href(const std::string &url, const std::string &href, std::string &name);
+    void addPageItem(const std::string &url, const std::string &link, const std::string &link_text,
+        const std::string &time_str, const std::string &size_str, std::map<std::string, bes::CatalogItem *> &items) const;
     void createHttpdDirectoryPageMap(std::string url, std::map<std::string, bes::CatalogItem *> &items) const;
+    void crawl(const std::string &url, std::map<std::string, HttpdDirPage *> &pages) const;
+    void fetchPages(const std::vector<std::string> &urls, std::map<std::string, HttpdDirPage *> &pages) const;
     long get_size_val(const std::string size_str) const;
     std::string httpd_time_to_iso_8601(const std::string httpd_time) const;
     std::string httpd_time_to_iso_8601_new(const std::string httpd_time) const;
@@ -56,6 +73,9 @@ public:
     HttpdDirScraper();
     ~HttpdDirScraper() { }
     virtual bes::CatalogNode *get_node(const std::string &url, const std::string &path) const;
+
+    void get_site_map(const std::string &url, const std::string &path, const std::string &prefix,
+        const std::string &node_suffix, const std::string &leaf_suffix, std::ostream &out) const;
 };
 } // namespace httpd_catalog
 
@@ -36,6 +36,7 @@
 #include <BESDebug.h>
 #include <BESUtil.h>
 #include <BESInternalError.h>
+#include <BESHttpCacheRevalidator.h>
 
 #include "curl_utils.h"
 #include "HttpdCatalogNames.h"
@@ -49,6 +50,47 @@ using namespace std;
 
 namespace httpd_catalog {
 
+namespace {
+
+/**
+ * Revalidate cached resources using the httpd_catalog module's curl code.
+ */
+class HttpdRevalidator: public BESHttpCacheRevalidator {
+private:
+    CURL *&d_curl;
+    char *d_error_buffer;
+    const vector<string> &d_request_headers;
+
+protected:
+    virtual long get(const vector<string> &request_headers, int fd, vector<string> &response_headers)
+    {
+        vector<string> req_hdrs(d_request_headers);
+        req_hdrs.insert(req_hdrs.end(), request_headers.begin(), request_headers.end());
+        try {
+            return read_url(d_curl, get_url(), fd, &response_headers, &req_hdrs, d_error_buffer);
+        }
+        catch (libdap::Error &e) {
+            throw BESInternalError(e.get_error_message(), __FILE__, __LINE__);
+        }
+    }
+
+    virtual void reset_connection()
+    {
+        d_curl = init(d_error_buffer);
+        configureProxy(d_curl, get_url());
+    }
+
+public:
+    HttpdRevalidator(RemoteHttpResourceCache *cache, const string &cache_file, const string &url, CURL *&curl,
+        char *error_buffer, const vector<string> &request_headers) :
+        BESHttpCacheRevalidator(cache, cache_file, url, "HttpResourceCache"), d_curl(curl),
+            d_error_buffer(error_buffer), d_request_headers(request_headers)
+    {
+    }
+};
+
+} // namespace
+
 /**
  * Builds a RemoteHttpResource object associated with the passed \c url parameter.
  *
@@ -174,25 +216,12 @@ void RemoteHttpResource::retrieveResource()
         if (cache->get_read_lock(d_resourceCacheFileName, d_fd)) {
             BESDEBUG(MODULE, prolog << "Remote resource is already in cache. cache_file_name: " << d_resourceCacheFileName << endl);
 
-            // #########################################################################################################
-            // I think in this if() is where we need to load the headers from the cache if we have them.
-            string hdr_filename = cache->get_cache_file_name(d_remoteResourceUrl) + ".hdrs";
-            ifstream hdr_ifs(hdr_filename.c_str());
-            try {
-                BESDEBUG(MODULE, prolog << "Reading response headers from: " << hdr_filename << endl);
-                for (string line; getline(hdr_ifs, line);) {
-                    (*d_response_headers).push_back(line);
-                    BESDEBUG(MODULE, prolog << "header:   " << line << endl);
-                }
-            }
-            catch (...) {
-                hdr_ifs.close();
-                throw;
-            }
+            read_cached_headers();
+            HttpdRevalidator(cache, d_resourceCacheFileName, d_remoteResourceUrl, d_curl, d_error_buffer,
+                *d_request_headers).revalidate(d_fd, *d_response_headers);
             ingest_http_headers_and_type();
             d_initialized = true;
             return;
-            // #########################################################################################################
         }
 
         // Now we actually need to reach out across the interwebs and retrieve the remote resource and put it's
@@ -210,26 +239,16 @@ void RemoteHttpResource::retrieveResource()
                 throw;
             }
 
-            // #########################################################################################################
-            // I think right here is where I would be able to cache the data type/response headers. While I have
-            // the exclusive lock I could open another cache file for metadata and write to it.
-            {
-                string hdr_filename = cache->get_cache_file_name(d_remoteResourceUrl) + ".hdrs";
-                ofstream hdr_out(hdr_filename.c_str());
-                try {
-                    for (size_t i = 0; i < this->d_response_headers->size(); i++) {
-                        hdr_out << (*d_response_headers)[i] << endl;
-                    }
-                }
-                catch (...) {
-                    // If this fails for any reason we:
-                    hdr_out.close(); // Close the stream
-                    unlink(hdr_filename.c_str()); // unlink the file
-                    unlink(d_resourceCacheFileName.c_str()); // unlink the primary cache file.
-                    throw;
-                }
+            // Save the response headers so later requests can determine the
+            // resource's type and revalidate it.
+            try {
+                BESHttpCacheRevalidator::save_headers(d_resourceCacheFileName, *d_response_headers);
+            }
+            catch (...) {
+                unlink(BESHttpCacheRevalidator::headers_file_name(d_resourceCacheFileName).c_str());
+                unlink(d_resourceCacheFileName.c_str());
+                throw;
             }
-            // #########################################################################################################
 
             // Change the exclusive lock on the new file to a shared lock. This keeps
             // other processes from purging the new file and ensures that the reading
@@ -254,6 +273,8 @@ void RemoteHttpResource::retrieveResource()
         else {
             if (cache->get_read_lock(d_resourceCacheFileName, d_fd)) {
                 BESDEBUG(MODULE, prolog << "Remote resource is in cache. cache_file_name: " << d_resourceCacheFileName << endl);
+                read_cached_headers();
+                ingest_http_headers_and_type();
                 d_initialized = true;
                 return;
             }
@@ -331,6 +352,16 @@ catch (libdap::Error &e) {
     BESDEBUG(MODULE, prolog << "END" << endl);
 }
 
+/**
+ * Read the cached response headers of the resource into d_response_headers.
+ * Call ingest_http_headers_and_type() to use them.
+ */
+void RemoteHttpResource::read_cached_headers()
+{
+    d_http_response_headers->clear();
+    BESHttpCacheRevalidator::read_headers(d_resourceCacheFileName, *d_response_headers);
+}
+
 void RemoteHttpResource::ingest_http_headers_and_type()
 {
     BESDEBUG(MODULE, prolog << "BEGIN" << endl);
@@ -40,6 +40,9 @@ namespace httpd_catalog {
  * retrieve the content of the resource and place it in a local disk cache
  * for rapid (subsequent) access. It can be configure to use a proxy server
  * for the outgoing requests.
+ *
+ * When HttpResourceCache.MaxAge is set, stale resources are revalidated by
+ * BESHttpCacheRevalidator.
  */
 class RemoteHttpResource {
 private:
@@ -85,6 +88,8 @@ private:
      */
     void ingest_http_headers_and_type();
 
+    void read_cached_headers();
+
 protected:
     RemoteHttpResource() :
         d_fd(0), d_initialized(false), d_curl(0), d_resourceCacheFileName(""), d_request_headers(0), d_response_headers(
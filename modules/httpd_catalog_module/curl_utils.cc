@@ -34,6 +34,7 @@
 #include "BESSyntaxUserError.h"
 #include "BESInternalError.h"
 #include "BESInternalFatalError.h"
+#include "BESDeadline.h"
 #include "WhiteList.h"
 
 #include "curl_utils.h"
@@ -508,10 +509,16 @@ long read_url(CURL *curl, const string &url, int fd, vector<string> *resp_hdrs,
     curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &urlp);
     BESDEBUG(MODULE, prolog << "url in curl object: " << urlp << endl);
 
+    // Limit the transfer to the time left before the request's deadline (0 is no limit)
+    BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+    long timeout_ms = BESDeadline::TheDeadline()->remaining_ms();
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms < 0 ? 0L : std::max(timeout_ms, 1L));
+
     // This call is the one that makes curl go get the thing.
     CURLcode res = curl_easy_perform(curl);
 
     if (res != CURLE_OK) {
+        BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
         BESDEBUG(MODULE, prolog << "OUCH! CURL returned an error! curl msg:  " << curl_easy_strerror(res) << endl);
         throw BESInternalError(string("CURL returned an error! curl msg: ").append(curl_easy_strerror(res)), __FILE__, __LINE__);
     }
@@ -270,6 +270,77 @@ public:
     }
 
 
+    // A directory page that uses a pre-formatted listing instead of a table
+    void get_preformatted_file_node_test() {
+        if(debug) cerr << endl;
+
+        string url = get_data_file_url("pre.data.http_catalog/");
+
+        HttpdDirScraper hds;
+        bes::CatalogNode *node = 0;
+        try {
+            if(debug) cerr << prolog << "Scraping '" << url << "'" << endl;
+            node = hds.get_node(url,"/data/httpd_catalog/");
+            if(debug) cerr << prolog << "Found " <<  node->get_leaf_count() << " leaves and " << node->get_node_count() << " nodes." << endl;
+
+            CPPUNIT_ASSERT(node->get_node_count() == 2);
+            bes::CatalogNode::item_iter it = node->nodes_begin();
+            CPPUNIT_ASSERT((*it++)->get_name() == "subdir1");
+            CPPUNIT_ASSERT((*it)->get_name() == "subdir2");
+
+            CPPUNIT_ASSERT(node->get_leaf_count() == 2);
+            it = node->leaves_begin();
+            bes::CatalogItem *first_leaf = *it++;
+            CPPUNIT_ASSERT(first_leaf->get_name() == "READTHIS");
+            CPPUNIT_ASSERT(first_leaf->get_size() == 72);
+
+            bes::CatalogItem *second_leaf = *it;
+            CPPUNIT_ASSERT(second_leaf->get_name() == "fnoc1.nc");
+            CPPUNIT_ASSERT(second_leaf->get_size() == 23000);
+        }
+        catch (BESError &besE){
+            cerr << "Caught BESError! message: " << besE.get_verbose_message() << " type: " << besE.get_bes_error_type() << endl;
+            CPPUNIT_FAIL("Caught BESError");
+        }
+        delete node;
+    }
+
+
+    // Links are named relative to their directory page; links that lead out
+    // of the directory are not items.
+    void get_relative_href_test() {
+        string url = "http://test.opendap.org/data/nc/";
+        string name;
+
+        CPPUNIT_ASSERT(HttpdDirScraper::get_relative_href(url, "fnoc1.nc", name));
+        CPPUNIT_ASSERT_EQUAL(string("fnoc1.nc"), name);
+
+        CPPUNIT_ASSERT(HttpdDirScraper::get_relative_href(url, "/data/nc/fnoc1.nc", name));
+        CPPUNIT_ASSERT_EQUAL(string("fnoc1.nc"), name);
+
+        CPPUNIT_ASSERT(HttpdDirScraper::get_relative_href(url, "/data/nc/subdir/", name));
+        CPPUNIT_ASSERT_EQUAL(string("subdir/"), name);
+
+        CPPUNIT_ASSERT(HttpdDirScraper::get_relative_href(url, "http://test.opendap.org/data/nc/fnoc1.nc", name));
+        CPPUNIT_ASSERT_EQUAL(string("fnoc1.nc"), name);
+
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "", name));
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "/data/", name));
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "/data/nc/", name));
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "/data/hdf5/file.h5", name));
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "http://test.opendap.org/data/", name));
+        CPPUNIT_ASSERT(!HttpdDirScraper::get_relative_href(url, "http://other.host.org/data/nc/fnoc1.nc", name));
+    }
+
+    // A listing with no time gets an empty last modified time, not the current time
+    void no_time_test() {
+        HttpdDirScraper hds;
+        CPPUNIT_ASSERT_EQUAL(string(""), hds.httpd_time_to_iso_8601(""));
+        CPPUNIT_ASSERT_EQUAL(string(""), hds.httpd_time_to_iso_8601("-"));
+        CPPUNIT_ASSERT(!hds.httpd_time_to_iso_8601("19-Oct-2018 19:32").empty());
+    }
+
+
 /* TESTS END */
 /*##################################################################################################*/
 
@@ -278,6 +349,9 @@ public:
 
     CPPUNIT_TEST(get_remote_node_test);
     CPPUNIT_TEST(get_file_node_test);
+    CPPUNIT_TEST(get_preformatted_file_node_test);
+    CPPUNIT_TEST(get_relative_href_test);
+    CPPUNIT_TEST(no_time_test);
 
     CPPUNIT_TEST_SUITE_END();
 };
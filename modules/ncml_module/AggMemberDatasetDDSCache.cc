@@ -0,0 +1,326 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of the "NcML Module" project, a BES module designed
+// to allow NcML files to be used to be used as a wrapper to add
+// AIS to existing datasets of any format.
+//
+// Copyright (c) 2020 OPeNDAP, Inc.
+//
+// For more information, please also see the main website: http://opendap.org/
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// Please see the files COPYING and COPYRIGHT for more information on the GLPL.
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+/////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include <DDS.h>
+#include <BaseType.h>
+#include <Constructor.h>
+#include <Array.h>
+#include <AttrTable.h>
+
+#include "BESDebug.h"
+#include "BESUtil.h"
+#include "TheBESKeys.h"
+
+#include "AggMemberDatasetDDSCache.h"
+
+using namespace std;
+using namespace libdap;
+
+static const string BES_DATA_ROOT("BES.Data.RootDirectory");
+static const string BES_CATALOG_ROOT("BES.Catalog.catalog.RootDirectory");
+
+// Rough per-object overheads used by estimate_size(). These only need to be
+// in the right ballpark; the cache size is a budget, not an exact limit.
+static const unsigned long long BASETYPE_OVERHEAD = 256;
+static const unsigned long long ATTRIBUTE_OVERHEAD = 64;
+static const unsigned long long DIMENSION_OVERHEAD = 64;
+
+namespace agg_util {
+
+AggMemberDatasetDDSCache *AggMemberDatasetDDSCache::d_instance = 0;
+bool AggMemberDatasetDDSCache::d_enabled = true;
+
+const string AggMemberDatasetDDSCache::SIZE_KEY = "NCML.MemberDDSCache.size";
+
+/**
+ * Checks TheBESKeys for AggMemberDatasetDDSCache::SIZE_KEY, a size in
+ * megabytes. Returns the size in bytes or zero if the key is not set.
+ */
+unsigned long long AggMemberDatasetDDSCache::getCacheSizeFromConfig()
+{
+    bool found;
+    string size;
+    unsigned long long size_in_megabytes = 0;
+    TheBESKeys::TheKeys()->get_value(SIZE_KEY, size, found);
+    if (found) {
+        std::istringstream iss(size);
+        iss >> size_in_megabytes;
+    }
+
+    return size_in_megabytes * 1024 * 1024;
+}
+
+/**
+ * Checks TheBESKeys for BES_CATALOG_ROOT, and failing that for
+ * BES_DATA_ROOT. Returns the empty string if neither is set, in which
+ * case member locations are stat'd as given.
+ */
+string AggMemberDatasetDDSCache::getBesDataRootDirFromConfig()
+{
+    bool found;
+    string rootDir = "";
+    TheBESKeys::TheKeys()->get_value(BES_CATALOG_ROOT, rootDir, found);
+    if (!found) {
+        TheBESKeys::TheKeys()->get_value(BES_DATA_ROOT, rootDir, found);
+    }
+
+    return rootDir;
+}
+
+AggMemberDatasetDDSCache::AggMemberDatasetDDSCache(const string &data_root_dir, unsigned long long max_size) :
+    d_dataRootDir(data_root_dir), d_maxCacheSize(max_size), d_currentSize(0), d_age(0)
+{
+    BESDEBUG("cache", "AggMemberDatasetDDSCache() - data root: " << d_dataRootDir << ", size: " << d_maxCacheSize << endl);
+}
+
+/**
+ * Get an instance of this singleton class, if one has not already been built a new one will be built using the passed parameters.
+ * NB: This method is meant for unit tests and is not expected to be utilized during the normal use pattern in the server.
+ */
+AggMemberDatasetDDSCache *
+AggMemberDatasetDDSCache::get_instance(const string &data_root_dir, unsigned long long max_size)
+{
+    if (d_enabled && d_instance == 0) {
+        if (max_size > 0) {
+            d_instance = new AggMemberDatasetDDSCache(data_root_dir, max_size);
+#ifdef HAVE_ATEXIT
+            atexit(delete_instance);
+#endif
+            BESDEBUG("cache", "AggMemberDatasetDDSCache::"<<__func__ << "() - Cache is ENABLED" << endl);
+        }
+        else {
+            d_enabled = false;
+            BESDEBUG("cache", "AggMemberDatasetDDSCache::"<<__func__ << "() - Cache is DISABLED" << endl);
+        }
+    }
+
+    return d_instance;
+}
+
+/**
+ * Get the instance of the singleton AggMemberDatasetDDSCache object. If one
+ * has not yet been built a new one will be by interrogating "TheBESKeys".
+ * Returns null when the cache is disabled.
+ */
+AggMemberDatasetDDSCache *
+AggMemberDatasetDDSCache::get_instance()
+{
+    if (d_enabled && d_instance == 0) {
+        return get_instance(getBesDataRootDirFromConfig(), getCacheSizeFromConfig());
+    }
+
+    return d_instance;
+}
+
+/**
+ * Deletes the instance of this singleton, Called on exit by atexit()
+ */
+void AggMemberDatasetDDSCache::delete_instance()
+{
+    BESDEBUG("cache", "AggMemberDatasetDDSCache::delete_instance() - Deleting singleton AggMemberDatasetDDSCache instance." << endl);
+    delete d_instance;
+    d_instance = 0;
+}
+
+AggMemberDatasetDDSCache::~AggMemberDatasetDDSCache()
+{
+    for (index_t::iterator i = d_index.begin(), e = d_index.end(); i != e; ++i) {
+        delete i->second.d_dds;
+    }
+}
+
+static unsigned long long estimate_attr_table_size(AttrTable &at)
+{
+    unsigned long long size = 0;
+    for (AttrTable::Attr_iter i = at.attr_begin(), e = at.attr_end(); i != e; ++i) {
+        size += ATTRIBUTE_OVERHEAD + at.get_name(i).size();
+        if (at.get_attr_type(i) == Attr_container) {
+            size += estimate_attr_table_size(*at.get_attr_table(i));
+        }
+        else {
+            vector<string> *values = at.get_attr_vector(i);
+            for (vector<string>::iterator v = values->begin(), ve = values->end(); v != ve; ++v)
+                size += v->size();
+        }
+    }
+
+    return size;
+}
+
+static unsigned long long estimate_variable_size(BaseType *btp)
+{
+    unsigned long long size = BASETYPE_OVERHEAD + btp->name().size() + btp->dataset().size();
+    size += estimate_attr_table_size(btp->get_attr_table());
+
+    if (btp->type() == dods_array_c) {
+        Array *a = static_cast<Array*>(btp);
+        for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d)
+            size += DIMENSION_OVERHEAD + a->dimension_name(d).size();
+        size += estimate_variable_size(a->var());
+    }
+    else if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter v = c->var_begin(), ve = c->var_end(); v != ve; ++v)
+            size += estimate_variable_size(*v);
+    }
+
+    return size;
+}
+
+/**
+ * @brief Estimate the bytes held by a DDS
+ *
+ * This walks the variables and attributes of the DDS adding up names,
+ * attribute values and a fixed overhead for each object. Only metadata
+ * is counted; the DDS objects cached here never hold data.
+ *
+ * @param dds The DDS to measure
+ * @return The estimated size in bytes
+ */
+unsigned long long AggMemberDatasetDDSCache::estimate_size(DDS &dds)
+{
+    unsigned long long size = sizeof(DDS) + dds.get_dataset_name().size() + dds.filename().size();
+    size += estimate_attr_table_size(dds.get_attr_table());
+    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i)
+        size += estimate_variable_size(*i);
+
+    return size;
+}
+
+/**
+ * Get the modification time of the member dataset, or zero if it
+ * cannot be found as a local file.
+ */
+time_t AggMemberDatasetDDSCache::get_mtime(const string &location) const
+{
+    string datasetFileName = d_dataRootDir.empty() ? location : BESUtil::assemblePath(d_dataRootDir, location, true);
+
+    struct stat buf;
+    if (stat(datasetFileName.c_str(), &buf) == 0)
+        return buf.st_mtime;
+
+    return 0;
+}
+
+void AggMemberDatasetDDSCache::remove(index_t::iterator i)
+{
+    d_currentSize -= i->second.d_size;
+    d_lru.erase(i->second.d_age);
+    delete i->second.d_dds;
+    d_index.erase(i);
+}
+
+/**
+ * Remove least recently used entries until there is room for
+ * 'needed' more bytes.
+ */
+void AggMemberDatasetDDSCache::purge(unsigned long long needed)
+{
+    while (!d_lru.empty() && d_currentSize + needed > d_maxCacheSize) {
+        lru_t::iterator oldest = d_lru.begin();
+        BESDEBUG("cache", "AggMemberDatasetDDSCache::purge() - Removing " << oldest->second << endl);
+        index_t::iterator i = d_index.find(oldest->second);
+        remove(i);
+    }
+}
+
+/**
+ * @brief Get a copy of the cached DDS for a member location
+ *
+ * If the member's file has been modified since the entry was added,
+ * the entry is removed and null is returned.
+ *
+ * @param location The member location, relative to the BES data root
+ * @return A new DDS the caller must delete, or null if the location is
+ * not cached.
+ */
+DDS *AggMemberDatasetDDSCache::get(const string &location)
+{
+    index_t::iterator i = d_index.find(location);
+    if (i == d_index.end()) return 0;
+
+    if (i->second.d_mtime != get_mtime(location)) {
+        BESDEBUG("cache", "AggMemberDatasetDDSCache::get() - Stale entry for " << location << endl);
+        remove(i);
+        return 0;
+    }
+
+    // Move the entry to the young end of the LRU list
+    d_lru.erase(i->second.d_age);
+    i->second.d_age = ++d_age;
+    d_lru.insert(make_pair(i->second.d_age, location));
+
+    BESDEBUG("cache", "AggMemberDatasetDDSCache::get() - Hit for " << location << endl);
+    return new DDS(*i->second.d_dds);
+}
+
+/**
+ * @brief Cache a copy of a member's DDS
+ *
+ * Entries larger than the whole cache are not added. Entries for
+ * locations that are not local files (their mtime cannot be found)
+ * are not added either, since they could never be validated.
+ *
+ * @param location The member location, relative to the BES data root
+ * @param dds The DDS to copy into the cache
+ */
+void AggMemberDatasetDDSCache::add(const string &location, const DDS &dds)
+{
+    time_t mtime = get_mtime(location);
+    if (mtime == 0) return;
+
+    index_t::iterator i = d_index.find(location);
+    if (i != d_index.end()) remove(i);
+
+    DDS *cached = new DDS(dds);
+    unsigned long long size = estimate_size(*cached);
+    if (size > d_maxCacheSize) {
+        BESDEBUG("cache", "AggMemberDatasetDDSCache::add() - " << location << " is too large to cache" << endl);
+        delete cached;
+        return;
+    }
+
+    purge(size);
+
+    d_index.insert(make_pair(location, Entry(cached, mtime, size, ++d_age)));
+    d_lru.insert(make_pair(d_age, location));
+    d_currentSize += size;
+
+    BESDEBUG("cache", "AggMemberDatasetDDSCache::add() - Added " << location << " (" << size << " bytes, total "
+        << d_currentSize << ")" << endl);
+}
+
+} // namespace agg_util
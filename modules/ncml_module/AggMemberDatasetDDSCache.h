@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of the "NcML Module" project, a BES module designed
+// to allow NcML files to be used to be used as a wrapper to add
+// AIS to existing datasets of any format.
+//
+// Copyright (c) 2020 OPeNDAP, Inc.
+//
+// For more information, please also see the main website: http://opendap.org/
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// Please see the files COPYING and COPYRIGHT for more information on the GLPL.
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef MODULES_NCML_MODULE_AGGMEMBERDATASETDDSCACHE_H_
+#define MODULES_NCML_MODULE_AGGMEMBERDATASETDDSCACHE_H_
+
+#include <ctime>
+#include <map>
+#include <string>
+
+namespace libdap {
+class DDS;
+}
+
+namespace agg_util {
+
+/**
+ * An in-memory, process-wide cache of the DataDDS objects built for
+ * aggregation member datasets. AggMemberDatasetUsingLocationRef asks the
+ * handler for a member's DataDDS on every request; with this cache enabled
+ * the first request pays for that and later requests get a copy of the
+ * cached DDS, skipping the member handler's metadata build.
+ *
+ * Entries are keyed by the member's location and are only used when the
+ * modification time of the member file matches the one recorded when the
+ * entry was added. The cache tracks an estimate of the bytes held by each
+ * DDS and evicts the least recently used entries when the total exceeds
+ * the configured size (NCML.MemberDDSCache.size, in megabytes). A size of
+ * zero (the default) disables the cache.
+ *
+ * Like ObjMemCache, this cache is per-process; each beslistener builds
+ * its own. It makes no attempt at thread safety.
+ */
+class AggMemberDatasetDDSCache {
+private:
+    struct Entry {
+        libdap::DDS *d_dds;             // Owned by the cache
+        time_t d_mtime;                 // mtime of the member when cached
+        unsigned long long d_size;      // estimated bytes held by d_dds
+        unsigned long long d_age;       // key into the LRU map
+
+        Entry(libdap::DDS *dds, time_t mtime, unsigned long long size, unsigned long long age) :
+            d_dds(dds), d_mtime(mtime), d_size(size), d_age(age)
+        {
+        }
+    };
+
+    static bool d_enabled;
+    static AggMemberDatasetDDSCache *d_instance;
+    static void delete_instance();
+
+    std::string d_dataRootDir;
+    unsigned long long d_maxCacheSize;      // bytes
+    unsigned long long d_currentSize;       // bytes
+    unsigned long long d_age;
+
+    typedef std::map<std::string, Entry> index_t;
+    index_t d_index;
+
+    typedef std::map<unsigned long long, std::string> lru_t;
+    lru_t d_lru;
+
+    AggMemberDatasetDDSCache(const std::string &data_root_dir, unsigned long long max_size);
+    AggMemberDatasetDDSCache(const AggMemberDatasetDDSCache &src);
+    AggMemberDatasetDDSCache &operator=(const AggMemberDatasetDDSCache &rhs);
+
+    time_t get_mtime(const std::string &location) const;
+    void remove(index_t::iterator i);
+    void purge(unsigned long long needed);
+
+    static std::string getBesDataRootDirFromConfig();
+    static unsigned long long getCacheSizeFromConfig();
+
+    friend class AggMemberDatasetDDSCacheTest;
+
+public:
+    static const std::string SIZE_KEY;
+
+    static AggMemberDatasetDDSCache *get_instance();
+    static AggMemberDatasetDDSCache *get_instance(const std::string &data_root_dir, unsigned long long max_size);
+
+    static unsigned long long estimate_size(libdap::DDS &dds);
+
+    virtual ~AggMemberDatasetDDSCache();
+
+    libdap::DDS *get(const std::string &location);
+    void add(const std::string &location, const libdap::DDS &dds);
+
+    /** @return The number of cached member DDS objects */
+    unsigned int size() const
+    {
+        return d_index.size();
+    }
+
+    /** @return The estimated number of bytes held by the cache */
+    unsigned long long bytes() const
+    {
+        return d_currentSize;
+    }
+};
+
+} // namespace agg_util
+
+#endif /* MODULES_NCML_MODULE_AGGMEMBERDATASETDDSCACHE_H_ */
@@ -27,6 +27,7 @@
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 /////////////////////////////////////////////////////////////////////////////
 #include "AggMemberDatasetUsingLocationRef.h"
+#include "AggMemberDatasetDDSCache.h"
 
 #include "BESDataDDSResponse.h" // bes
 #include "DDS.h" // libdap
@@ -105,8 +106,25 @@ void AggMemberDatasetUsingLocationRef::loadDDS()
     // this as a leak, but the _loader.loadInto() method takes ownership. jhrg 2/7/17
     newResponse.release();
 
+    // If the member DDS cache is enabled and holds a current DDS for this
+    // location, use a copy of it and skip the member handler's metadata build.
+    AggMemberDatasetDDSCache *ddsCache = AggMemberDatasetDDSCache::get_instance();
+    if (ddsCache) {
+        DDS *cachedDDS = ddsCache->get(getLocation());
+        if (cachedDDS) {
+            BESDEBUG("ncml", "Using cached DDS for aggregation member location = " << getLocation() << endl);
+            delete _pDataResponse->get_dds();
+            _pDataResponse->set_dds(cachedDDS);
+            return;
+        }
+    }
+
     BESDEBUG("ncml", "Loading loadDDS for aggregation member location = " << getLocation() << endl);
     _loader.loadInto(getLocation(), DDSLoader::eRT_RequestDataDDS, _pDataResponse);
+
+    if (ddsCache && _pDataResponse->get_dds()) {
+        ddsCache->add(getLocation(), *(_pDataResponse->get_dds()));
+    }
 }
 
 void AggMemberDatasetUsingLocationRef::cleanup() throw ()
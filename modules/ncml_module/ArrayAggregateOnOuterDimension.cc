@@ -38,6 +38,7 @@
 #include "NCMLUtil.h" // SAFE_DELETE, NCMLUtil::getVariableNoRecurse
 #include "BESDebug.h"
 #include "BESStopWatch.h"
+#include "BESDeadline.h"
 
 // BES debug channel we output to
 static const string DEBUG_CHANNEL("agg_util");
@@ -179,6 +180,9 @@ bool ArrayAggregateOnOuterDimension::serialize(libdap::ConstraintEvaluator &eval
 
         // Traverse the dataset array respecting hyperslab
         for (int i = outerDim.start; i <= outerDim.stop && i < outerDim.size; i += outerDim.stride) {
+            // Stop reading granules once the request has run out of time
+            BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
             AggMemberDataset& dataset = *((getDatasetList())[i]);
 
             try {
@@ -294,6 +298,9 @@ void ArrayAggregateOnOuterDimension::readConstrainedGranuleArraysAndAggregateDat
 
     // Traverse the dataset array respecting hyperslab
     for (int i = outerDim.start; i <= outerDim.stop && i < outerDim.size; i += outerDim.stride) {
+        // Stop reading granules once the request has run out of time
+        BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
         AggMemberDataset& dataset = *((getDatasetList())[i]);
 
         try {
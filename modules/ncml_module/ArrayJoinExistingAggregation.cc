@@ -33,6 +33,7 @@
 
 #include "BESDebug.h"
 #include "BESStopWatch.h"
+#include "BESDeadline.h"
 
 #include "ArrayJoinExistingAggregation.h"
 
@@ -185,6 +186,9 @@ bool ArrayJoinExistingAggregation::serialize(libdap::ConstraintEvaluator &eval,
             // be inside for the given values of the constraint.
             for (int outerDimIndex = outerDim.start; outerDimIndex <= outerDim.stop && outerDimIndex < outerDim.size;
                 outerDimIndex += outerDim.stride) {
+                // Stop reading granules once the request has run out of time
+                BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
                 // Figure out where the given outer index maps into in local granule space
                 int localGranuleIndex = outerDimIndex - outerDimIndexOfCurrDatasetHead;
 
@@ -355,6 +359,9 @@ void ArrayJoinExistingAggregation::readConstrainedGranuleArraysAndAggregateDataH
         // be inside for the given values of the constraint.
         for (int outerDimIndex = outerDim.start; outerDimIndex <= outerDim.stop && outerDimIndex < outerDim.size;
             outerDimIndex += outerDim.stride) {
+            // Stop reading granules once the request has run out of time
+            BESDeadline::TheDeadline()->check(__FILE__, __LINE__);
+
             // Figure out where the given outer index maps into in local granule space
             int localGranuleIndex = outerDimIndex - outerDimIndexOfCurrDatasetHead;
 
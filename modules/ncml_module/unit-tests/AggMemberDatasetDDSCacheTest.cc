@@ -0,0 +1,316 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of the BES, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <fstream>
+#include <string>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <DDS.h>
+#include <Byte.h>
+#include <BaseTypeFactory.h>
+#include <GetOpt.h>
+
+#include "BESDebug.h"
+#include "TheBESKeys.h"
+
+#include "AggMemberDatasetDDSCache.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+namespace agg_util {
+
+class AggMemberDatasetDDSCacheTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    DDS *d_dds;
+    string d_members;
+
+    // Make a member file and set its modification time
+    void make_member(const string &location, time_t mtime)
+    {
+        string path = d_members + "/" + location;
+        ofstream out(path.c_str());
+        out << location << endl;
+        out.close();
+
+        struct utimbuf times;
+        times.actime = mtime;
+        times.modtime = mtime;
+        CPPUNIT_ASSERT(utime(path.c_str(), &times) == 0);
+    }
+
+    void remove_member(const string &location)
+    {
+        unlink((d_members + "/" + location).c_str());
+    }
+
+public:
+    AggMemberDatasetDDSCacheTest() :
+        d_dds(0), d_members(string(TEST_BUILD_DIR).append("/members"))
+    {
+    }
+
+    ~AggMemberDatasetDDSCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+        mkdir(d_members.c_str(), 0755);
+        make_member("a.nc", 1000);
+        make_member("b.nc", 1000);
+        make_member("c.nc", 1000);
+
+        d_dds = new DDS(&d_factory, "member");
+        Byte b("b");
+        d_dds->add_var(&b);
+    }
+
+    void tearDown()
+    {
+        delete d_dds;
+        d_dds = 0;
+
+        // Each test builds its own singleton
+        AggMemberDatasetDDSCache::delete_instance();
+        AggMemberDatasetDDSCache::d_enabled = true;
+
+        remove_member("a.nc");
+        remove_member("b.nc");
+        remove_member("c.nc");
+        rmdir(d_members.c_str());
+    }
+
+    void hit_test()
+    {
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance(d_members, 1024 * 1024);
+        CPPUNIT_ASSERT(cache);
+
+        CPPUNIT_ASSERT(cache->get("a.nc") == 0);
+
+        cache->add("a.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 1);
+        CPPUNIT_ASSERT(cache->bytes() == AggMemberDatasetDDSCache::estimate_size(*d_dds));
+
+        DDS *dds = cache->get("a.nc");
+        CPPUNIT_ASSERT(dds);
+        CPPUNIT_ASSERT(dds != d_dds);
+        CPPUNIT_ASSERT(dds->get_dataset_name() == "member");
+        CPPUNIT_ASSERT(dds->num_var() == 1);
+        CPPUNIT_ASSERT(dds->var("b"));
+        delete dds;
+
+        // The copy returned is the caller's; the entry is still cached
+        CPPUNIT_ASSERT(cache->size() == 1);
+        dds = cache->get("a.nc");
+        CPPUNIT_ASSERT(dds);
+        delete dds;
+    }
+
+    // A location that is not a file is never cached since it could not be
+    // checked for changes
+    void not_a_file_test()
+    {
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance(d_members, 1024 * 1024);
+        CPPUNIT_ASSERT(cache);
+
+        cache->add("no_such_file.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 0);
+        CPPUNIT_ASSERT(cache->get("no_such_file.nc") == 0);
+    }
+
+    void eviction_test()
+    {
+        unsigned long long entry_size = AggMemberDatasetDDSCache::estimate_size(*d_dds);
+        DBG(cerr << "entry size: " << entry_size << endl);
+
+        // Room for two entries but not three
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance(d_members, 2 * entry_size + entry_size / 2);
+        CPPUNIT_ASSERT(cache);
+
+        cache->add("a.nc", *d_dds);
+        cache->add("b.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 2);
+
+        // Using 'a.nc' makes 'b.nc' the least recently used entry
+        DDS *dds = cache->get("a.nc");
+        CPPUNIT_ASSERT(dds);
+        delete dds;
+
+        cache->add("c.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 2);
+        CPPUNIT_ASSERT(cache->bytes() == 2 * entry_size);
+
+        CPPUNIT_ASSERT(cache->get("b.nc") == 0);
+
+        dds = cache->get("a.nc");
+        CPPUNIT_ASSERT(dds);
+        delete dds;
+
+        dds = cache->get("c.nc");
+        CPPUNIT_ASSERT(dds);
+        delete dds;
+    }
+
+    // An entry bigger than the whole cache is not added
+    void too_large_test()
+    {
+        unsigned long long entry_size = AggMemberDatasetDDSCache::estimate_size(*d_dds);
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance(d_members, entry_size - 1);
+        CPPUNIT_ASSERT(cache);
+
+        cache->add("a.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 0);
+        CPPUNIT_ASSERT(cache->bytes() == 0);
+    }
+
+    void size_zero_test()
+    {
+        CPPUNIT_ASSERT(AggMemberDatasetDDSCache::get_instance(d_members, 0) == 0);
+
+        // Once disabled, the cache stays disabled
+        CPPUNIT_ASSERT(AggMemberDatasetDDSCache::get_instance(d_members, 1024 * 1024) == 0);
+    }
+
+    void size_key_test()
+    {
+        TheBESKeys::ConfigFile = string(TEST_SRC_DIR).append("/test.keys");
+
+        TheBESKeys::TheKeys()->set_key(AggMemberDatasetDDSCache::SIZE_KEY, "0");
+        CPPUNIT_ASSERT(AggMemberDatasetDDSCache::get_instance() == 0);
+
+        AggMemberDatasetDDSCache::d_enabled = true;
+        TheBESKeys::TheKeys()->set_key(AggMemberDatasetDDSCache::SIZE_KEY, "1");
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance();
+        CPPUNIT_ASSERT(cache);
+        CPPUNIT_ASSERT(cache->d_maxCacheSize == 1024 * 1024);
+    }
+
+    void stale_entry_test()
+    {
+        AggMemberDatasetDDSCache *cache = AggMemberDatasetDDSCache::get_instance(d_members, 1024 * 1024);
+        CPPUNIT_ASSERT(cache);
+
+        cache->add("a.nc", *d_dds);
+        cache->add("b.nc", *d_dds);
+        CPPUNIT_ASSERT(cache->size() == 2);
+
+        make_member("a.nc", 2000);
+
+        CPPUNIT_ASSERT(cache->get("a.nc") == 0);
+        CPPUNIT_ASSERT(cache->size() == 1);
+        CPPUNIT_ASSERT(cache->bytes() == AggMemberDatasetDDSCache::estimate_size(*d_dds));
+
+        // The unchanged member is still cached
+        DDS *dds = cache->get("b.nc");
+        CPPUNIT_ASSERT(dds);
+        delete dds;
+
+        // A member that is removed is stale too
+        remove_member("b.nc");
+        CPPUNIT_ASSERT(cache->get("b.nc") == 0);
+        CPPUNIT_ASSERT(cache->size() == 0);
+        CPPUNIT_ASSERT(cache->bytes() == 0);
+    }
+
+    CPPUNIT_TEST_SUITE( AggMemberDatasetDDSCacheTest );
+
+    CPPUNIT_TEST(hit_test);
+    CPPUNIT_TEST(not_a_file_test);
+    CPPUNIT_TEST(eviction_test);
+    CPPUNIT_TEST(too_large_test);
+    CPPUNIT_TEST(size_zero_test);
+    CPPUNIT_TEST(size_key_test);
+    CPPUNIT_TEST(stale_entry_test);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AggMemberDatasetDDSCacheTest);
+
+} // namespace agg_util
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = true;  // debug is a static global
+            BESDebug::SetUp("cerr,cache");
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: AggMemberDatasetDDSCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = agg_util::AggMemberDatasetDDSCacheTest::suite()->getTests();
+            unsigned int prefix_len = agg_util::AggMemberDatasetDDSCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = agg_util::AggMemberDatasetDDSCacheTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+            ++i;
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
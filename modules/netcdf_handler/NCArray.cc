@@ -57,7 +57,7 @@
 #include "NCRequestHandler.h"
 #include "NCArray.h"
 #include "NCStructure.h"
-// #include "nc_util.h"
+#include "nc_util.h"
 
 BaseType *
 NCArray::ptr_duplicate()
@@ -169,6 +169,26 @@ void NCArray::do_cardinal_array_read(int ncid, int varid, nc_type datatype,
         case NC_UBYTE:
 #endif
         {
+            if (!has_values && var()->width() == size) {
+                // Not part of a compound, so read the values straight into
+                // the Vector's storage instead of copying them there.
+                reserve_value_capacity(nels);
+                if (has_stride)
+                    errstat = nc_get_vars(ncid, varid, cor, edg, step, get_buf());
+                else
+                    errstat = nc_get_vara(ncid, varid, cor, edg, get_buf());
+                if (errstat != NC_NOERR) {
+                    ostringstream oss;
+                    oss << "NCArray::do_cardinal_array_read() - Could not get the value for Array variable '" << name() << "'.";
+                    oss << " dimensions: " << dimensions(true);
+                    oss << " nc_get_vara() errstat: " << errstat;
+                    throw Error(errstat, oss.str());
+                }
+
+                set_read_p(true);
+                break;
+            }
+
             if (!has_values) {
                 values.resize(nels * size);
                 if (has_stride)
@@ -338,38 +358,33 @@ void NCArray::do_array_read(int ncid, int varid, nc_type datatype,
                     has_values = true;
                 }
 
+                // Get the compound's fields once and use them for every element
+                vector<nc_compound_field> fields;
+                errstat = nc_inq_compound_fields(ncid, datatype, fields);
+                if (errstat != NC_NOERR)
+                    throw InternalErr(__FILE__, __LINE__, "Could not get the fields of a compound type (" + long_to_string(errstat) + ").");
+
                 for (int element = 0; element < nels; ++element) {
                     NCStructure *ncs = dynamic_cast<NCStructure*> (var()->ptr_duplicate());
                     for (size_t i = 0; i < nfields; ++i) {
-                        char field_name[NC_MAX_NAME+1];
-                        nc_type field_typeid;
-                        size_t field_offset;
-                        // These are unused... should they be used?
-                        // int field_ndims;
-                        // int field_sizes[MAX_NC_DIMS];
-                        nc_inq_compound_field(ncid, datatype, i, field_name, &field_offset, &field_typeid, 0, 0); //&field_ndims, &field_sizes[0]);
-                        BaseType *field = ncs->var(field_name);
-                        if (field_typeid >= NC_FIRSTUSERTYPEID /*is_user_defined_type(ncid, field_typeid)*/) {
-                            // Interior user defined types have names, but not field_names
-                            // so use the type name as the field name (matches the
-                            // behavior of the ncdds.cc code).
-                            nc_inq_compound_name(ncid, field_typeid, field_name);
-                            field = ncs->var(field_name);
+                        const nc_compound_field &f = fields[i];
+                        BaseType *field = ncs->var(f.name);
+                        if (f.type >= NC_FIRSTUSERTYPEID /*is_user_defined_type(ncid, f.type)*/) {
                             NCStructure &child_ncs = dynamic_cast<NCStructure&> (*field);
-                            child_ncs.do_structure_read(ncid, varid, field_typeid,
-                                    values, has_values, field_offset + values_offset + size * element);
+                            child_ncs.do_structure_read(ncid, varid, f.type,
+                                    values, has_values, f.offset + values_offset + size * element);
                         }
                         else if (field->is_vector_type()) {
                             // Because the netcdf api reads data 'atomically' from
                             // compounds, this call works for both cardinal and
                             // array variables.
                             NCArray &child_array = dynamic_cast<NCArray&>(*field);
-                            child_array.do_array_read(ncid, varid, field_typeid,
-                                    values, has_values, field_offset + values_offset + size * element,
+                            child_array.do_array_read(ncid, varid, f.type,
+                                    values, has_values, f.offset + values_offset + size * element,
                                     nels, cor, edg, step, has_stride);
                         }
                         else if (field->is_simple_type()) {
-                            field->val2buf(&values[0] + (element * size) + field_offset);
+                            field->val2buf(&values[0] + (element * size) + f.offset);
                         }
                         else {
                             throw InternalErr(__FILE__, __LINE__, "Expecting a netcdf user defined type or an array or a scalar.");
@@ -467,12 +482,13 @@ bool NCArray::read()
         return true;
 
     int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    int errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR)
         throw Error(errstat, string("Could not open the dataset's file (") + dataset().c_str() + string(")"));
+    nc_cached_file ncfile(ncid);
 
     int varid;                  /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not get variable ID for: " + name() + ". (error: " + long_to_string(errstat) + ").");
 
@@ -500,7 +516,7 @@ bool NCArray::read()
             nels, cor, edg, step, has_stride);
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
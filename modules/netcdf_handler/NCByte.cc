@@ -45,6 +45,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <util.h>
 
 #include "NCByte.h"
+#include "nc_util.h"
 
 // This `helper function' creates a pointer to the a NCByte and returns
 // that pointer. It takes the same arguments as the class's ctor. If any of
@@ -98,14 +99,15 @@ bool NCByte::read() {
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__,
                 "Could not get variable ID for: " + name() + ". (error: " + long_to_string(errstat) + ").");
@@ -139,7 +141,7 @@ bool NCByte::read() {
 
     val2buf(&Dbyte);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
@@ -47,6 +47,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <InternalErr.h>
 
 #include "NCFloat32.h"
+#include "nc_util.h"
 
 
 NCFloat32::NCFloat32(const string &n, const string &d) : Float32(n, d)
@@ -93,13 +94,14 @@ bool NCFloat32::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not get variable ID for '" + name() + "'.");
 
@@ -122,7 +124,7 @@ bool NCFloat32::read()
         flt32 = (dods_float32) flt;
         val2buf(&flt32);
 
-        if (nc_close(ncid) != NC_NOERR)
+        if (ncfile.close() != NC_NOERR)
             throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
     }
     else
@@ -44,6 +44,7 @@ static char rcsid[] not_used ={"$Id$"};
 #include <InternalErr.h>
 
 #include "NCFloat64.h"
+#include "nc_util.h"
 
 
 NCFloat64::NCFloat64(const string &n, const string &d) : Float64(n, d)
@@ -92,15 +93,16 @@ NCFloat64::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
 
     if (errstat != NC_NOERR)
     {
 	string err = "Could not open the dataset's file (" + dataset() + ")" ;
 	throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
       throw Error(errstat, "Could not get variable ID.");
 
@@ -128,7 +130,7 @@ NCFloat64::read()
 	flt64 = (dods_float64) dbl;
 	val2buf((void *) &flt64 );
 
-	if (nc_close(ncid) != NC_NOERR)
+	if (ncfile.close() != NC_NOERR)
 	  throw InternalErr(__FILE__, __LINE__, 
 			    "Could not close the dataset!");
     }
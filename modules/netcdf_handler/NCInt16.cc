@@ -45,6 +45,7 @@ static char rcsid[] not_used ={"$Id$"};
 
 #include "NCRequestHandler.h"
 #include "NCInt16.h"
+#include "nc_util.h"
 
 
 NCInt16::NCInt16(const string &n, const string &d) : Int16(n, d)
@@ -83,14 +84,15 @@ bool NCInt16::read() {
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not get variable ID for '" + name() + "'.");
 
@@ -131,7 +133,7 @@ bool NCInt16::read() {
     dods_int16 intg16 = (dods_int16) sht;
     val2buf(&intg16);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
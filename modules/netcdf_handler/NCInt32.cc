@@ -43,6 +43,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <InternalErr.h>
 
 #include "NCInt32.h"
+#include "nc_util.h"
 
 NCInt32::NCInt32(const string &n, const string &d) :
     Int32(n, d)
@@ -82,14 +83,15 @@ bool NCInt32::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not get variable ID.");
 
@@ -127,7 +129,7 @@ bool NCInt32::read()
     dods_int32 intg32 = (dods_int32) lht;
     val2buf(&intg32);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
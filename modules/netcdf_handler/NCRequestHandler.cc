@@ -60,6 +60,7 @@
 #include <Ancillary.h>
 
 #include "NCRequestHandler.h"
+#include "nc_util.h"
 #include "GlobalMetadataStore.h"
 
 #define NC_NAME "nc"
@@ -230,6 +231,9 @@ NCRequestHandler::NCRequestHandler(const string &name) :
         dmr_cache = new ObjMemCache(get_cache_entries(), get_cache_purge_level());
     }
 
+    // Open netCDF files are cached separately; see nc_util.cc
+    nc_set_file_cache_entries(get_uint_key("NC.FileCacheEntries", 0));
+
     BESDEBUG(NC_NAME, "Exiting NCRequestHandler::NCRequestHandler" << endl);
 }
 
@@ -239,6 +243,8 @@ NCRequestHandler::~NCRequestHandler()
     delete dds_cache;
     delete datadds_cache;
     delete dmr_cache;
+
+    nc_clear_file_cache();
 }
 
 bool NCRequestHandler::nc_build_das(BESDataHandlerInterface & dhi)
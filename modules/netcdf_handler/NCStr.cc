@@ -44,6 +44,7 @@ static char rcsid[] not_used = { "$Id$" };
 
 #include <InternalErr.h>
 #include "NCStr.h"
+#include "nc_util.h"
 
 #include <debug.h>
 
@@ -87,15 +88,16 @@ bool NCStr::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
 
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not get variable ID.");
 
@@ -191,5 +193,8 @@ bool NCStr::read()
 
     }
 
+    if (ncfile.close() != NC_NOERR)
+        throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
+
     return true;
 }
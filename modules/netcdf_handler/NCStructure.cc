@@ -176,42 +176,42 @@ void NCStructure::do_structure_read(int ncid, int varid, nc_type datatype,
                     has_values = true;
                 }
 
+                // When this is an element of an array of compounds, the
+                // fields come from the file cache instead of the library.
+                vector<nc_compound_field> fields;
+                errstat = nc_inq_compound_fields(ncid, datatype, fields);
+                if (errstat != NC_NOERR)
+                    throw InternalErr(__FILE__, __LINE__, "Could not get the fields of a compound type (" + long_to_string(errstat) + ").");
+
                 for (size_t i = 0; i < nfields; ++i) {
-                    char field_name[NC_MAX_NAME+1];
-                    nc_type field_typeid;
-                    size_t field_offset;
-                    int field_ndims;
-                    nc_inq_compound_field(ncid, datatype, i, field_name, &field_offset, &field_typeid, &field_ndims, 0);
-                    if (is_user_defined_type(ncid, field_typeid)) {
-                        // Interior user defined types have names, but not field_names
-                        // so use the type name as the field name (matches the
-                        // behavior of the ncdds.cc code).
-                        nc_inq_compound_name(ncid, field_typeid, field_name);
-                        NCStructure &ncs = dynamic_cast<NCStructure&>(*var(field_name));
-                        ncs.do_structure_read(ncid, varid, field_typeid, values, has_values, field_offset + values_offset);
+                    const nc_compound_field &f = fields[i];
+                    BaseType *field = var(f.name);
+                    if (is_user_defined_type(ncid, f.type)) {
+                        NCStructure &ncs = dynamic_cast<NCStructure&>(*field);
+                        ncs.do_structure_read(ncid, varid, f.type, values, has_values, f.offset + values_offset);
                     }
-                    else if (var(field_name)->is_vector_type()) {
+                    else if (field->is_vector_type()) {
                         // Because the netcdf api reads data 'atomically' from
                         // compounds, this call works for both cardinal and
                         // array variables.
-                        NCArray &child_array = dynamic_cast<NCArray&>(*var(field_name));
-                        vector<size_t> cor(field_ndims);
-                        vector<size_t> edg(field_ndims);
-                        vector<ptrdiff_t> step(field_ndims);
+                        NCArray &child_array = dynamic_cast<NCArray&>(*field);
+                        vector<size_t> cor(f.ndims);
+                        vector<size_t> edg(f.ndims);
+                        vector<ptrdiff_t> step(f.ndims);
                         bool has_stride;
                         long nels = child_array.format_constraint(&cor[0], &step[0], &edg[0], &has_stride);
-                        child_array.do_array_read(ncid, varid, field_typeid,
-                                values, has_values, field_offset + values_offset,
+                        child_array.do_array_read(ncid, varid, f.type,
+                                values, has_values, f.offset + values_offset,
                                 nels, &cor[0], &edg[0], &step[0], has_stride);
                     }
-                    else if (var(field_name)->is_simple_type()) {
-                        var(field_name)->val2buf(&values[0]  + field_offset + values_offset);
+                    else if (field->is_simple_type()) {
+                        field->val2buf(&values[0]  + f.offset + values_offset);
                     }
                     else {
                         throw InternalErr(__FILE__, __LINE__, "Expecting a netcdf user defined type or an array or a scalar.");
                     }
 
-                    var(field_name)->set_read_p(true);
+                    field->set_read_p(true);
                 }
                 break;
             }
@@ -242,12 +242,13 @@ bool NCStructure::read()
         return true;
 
     int ncid;
-    int errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    int errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not open the dataset's file (" + dataset() + ")");
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not get variable ID for: " + name() + ". (error: " + long_to_string(errstat) + ").");
 
@@ -265,7 +266,7 @@ bool NCStructure::read()
 
     set_read_p(true);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
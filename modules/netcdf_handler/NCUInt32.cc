@@ -37,6 +37,7 @@ static char rcsid[] not_used = { "$Id$" };
 #include <InternalErr.h>
 
 #include "NCUInt32.h"
+#include "nc_util.h"
 
 NCUInt32::NCUInt32(const string &n, const string &d) :
     UInt32(n, d)
@@ -76,14 +77,15 @@ bool NCUInt32::read()
         return true;
 
     int ncid, errstat;
-    errstat = nc_open(dataset().c_str(), NC_NOWRITE, &ncid); /* netCDF id */
+    errstat = nc_open_cached(dataset(), &ncid); /* netCDF id */
     if (errstat != NC_NOERR) {
         string err = "Could not open the dataset's file (" + dataset() + ")";
         throw Error(errstat, err);
     }
+    nc_cached_file ncfile(ncid);
 
     int varid; /* variable Id */
-    errstat = nc_inq_varid(ncid, name().c_str(), &varid);
+    errstat = nc_inq_varid_cached(ncid, name(), &varid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not get variable ID during read.");
 
@@ -121,7 +123,7 @@ bool NCUInt32::read()
     dods_uint32 uintg32 = (dods_uint32) lng;
     val2buf(&uintg32);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "Could not close the dataset!");
 
     return true;
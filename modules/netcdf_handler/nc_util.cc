@@ -24,8 +24,21 @@
 
 #include "config.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
 #include <netcdf.h>
 
+#include <BESOpenFileCache.h>
+
+#include "nc_util.h"
+
+using namespace std;
+
 bool is_user_defined_type(int /*ncid*/, int type)
 {
 #if NETCDF_VERSION >= 4
@@ -54,3 +67,160 @@ bool is_user_defined_type(int /*ncid*/, int type)
 #endif
 }
 
+
+/**
+ * What the file cache keeps with each open netCDF file: the ids of the
+ * variables and the layouts of the compound types that have been looked up.
+ */
+struct nc_file_data {
+    map<string, int> varids;
+    map<nc_type, vector<nc_compound_field> > compounds;
+};
+
+static void close_nc_file(int ncid)
+{
+    nc_close(ncid);
+}
+
+typedef BESOpenFileCache<int, nc_file_data> nc_file_cache_t;
+static nc_file_cache_t nc_file_cache(close_nc_file, "nc");
+
+/**
+ * @brief Set the number of open files the file cache may hold
+ *
+ * If zero (the default) the cache is off and nc_open_cached() and the
+ * others just call the netCDF library.
+ */
+void nc_set_file_cache_entries(unsigned int entries)
+{
+    nc_file_cache.set_max_entries(entries);
+}
+
+/**
+ * @brief Close all of the cached files that are not in use
+ */
+void nc_clear_file_cache()
+{
+    nc_file_cache.clear();
+}
+
+/**
+ * @brief Open a netCDF file, reusing an open file if possible
+ *
+ * Each call must be matched by a call to nc_close_cached(); see
+ * nc_cached_file.
+ *
+ * @param path The pathname of the file
+ * @param ncidp Value-result parameter for the netCDF id
+ * @return The netCDF status
+ */
+int nc_open_cached(const string &path, int *ncidp)
+{
+    struct stat sb;
+    if (nc_file_cache.get_max_entries() == 0 || stat(path.c_str(), &sb) != 0)
+        return nc_open(path.c_str(), NC_NOWRITE, ncidp);
+
+    nc_file_cache_t::entry *file = nc_file_cache.get(path, sb);
+    if (file) {
+        *ncidp = file->handle;
+        return NC_NOERR;
+    }
+
+    int status = nc_open(path.c_str(), NC_NOWRITE, ncidp);
+    if (status == NC_NOERR) nc_file_cache.add(path, sb, *ncidp);
+
+    return status;
+}
+
+/**
+ * @brief Get a variable's id, using the file cache's copy if possible
+ *
+ * @param ncid A netCDF id returned by nc_open_cached()
+ * @param name The variable's name
+ * @param varidp Value-result parameter for the variable id
+ * @return The netCDF status
+ */
+int nc_inq_varid_cached(int ncid, const string &name, int *varidp)
+{
+    nc_file_cache_t::entry *file = nc_file_cache.find(ncid);
+    if (!file) return nc_inq_varid(ncid, name.c_str(), varidp);
+
+    map<string, int>::iterator v = file->data.varids.find(name);
+    if (v != file->data.varids.end()) {
+        *varidp = v->second;
+        return NC_NOERR;
+    }
+
+    int status = nc_inq_varid(ncid, name.c_str(), varidp);
+    if (status == NC_NOERR) file->data.varids[name] = *varidp;
+    return status;
+}
+
+/**
+ * @brief Release a file opened by nc_open_cached()
+ *
+ * The file stays open if it is in the cache.
+ *
+ * @param ncid The netCDF id
+ * @return The netCDF status
+ */
+int nc_close_cached(int ncid)
+{
+    if (nc_file_cache.release(ncid)) return NC_NOERR;
+
+    return nc_close(ncid);
+}
+
+/**
+ * @brief Get the fields of a compound type
+ *
+ * The fields are read once per type, not once per element or once per
+ * field, when the file was opened with nc_open_cached() and the file cache
+ * is on.
+ *
+ * @param ncid The netCDF id
+ * @param datatype A compound type
+ * @param fields Value-result parameter for the type's fields
+ * @return The netCDF status
+ */
+int nc_inq_compound_fields(int ncid, nc_type datatype, vector<nc_compound_field> &fields)
+{
+#if NETCDF_VERSION >= 4
+    nc_file_cache_t::entry *file = nc_file_cache.find(ncid);
+    if (file) {
+        map<nc_type, vector<nc_compound_field> >::iterator c = file->data.compounds.find(datatype);
+        if (c != file->data.compounds.end()) {
+            fields = c->second;
+            return NC_NOERR;
+        }
+    }
+
+    size_t nfields;
+    int status = nc_inq_compound_nfields(ncid, datatype, &nfields);
+    if (status != NC_NOERR) return status;
+
+    fields.resize(nfields);
+    for (size_t i = 0; i < nfields; ++i) {
+        char field_name[NC_MAX_NAME + 1];
+        status = nc_inq_compound_field(ncid, datatype, i, field_name, &fields[i].offset, &fields[i].type,
+            &fields[i].ndims, 0);
+        if (status != NC_NOERR) return status;
+
+        // Interior user defined types have names, but not field names, so
+        // use the type name as the field name (matches ncdds.cc).
+        if (is_user_defined_type(ncid, fields[i].type)) {
+            status = nc_inq_compound_name(ncid, fields[i].type, field_name);
+            if (status != NC_NOERR) return status;
+        }
+
+        fields[i].name = field_name;
+    }
+
+    if (file) file->data.compounds[datatype] = fields;
+
+    return NC_NOERR;
+#else
+    fields.clear();
+    return NC_EBADTYPE;
+#endif
+}
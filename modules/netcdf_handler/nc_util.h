@@ -22,4 +22,59 @@
 //
 // You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
 
+#ifndef _nc_util_h
+#define _nc_util_h 1
+
+#include <string>
+#include <vector>
+
+#include <netcdf.h>
+
 bool is_user_defined_type(int ncid, int type);
+
+// A per-process cache of open netCDF files and their variable ids (see
+// BESOpenFileCache). Use these in place of nc_open(), nc_inq_varid() and
+// nc_close(). Like the netCDF library, the cache is not thread-safe.
+void nc_set_file_cache_entries(unsigned int entries);
+void nc_clear_file_cache();
+
+int nc_open_cached(const std::string &path, int *ncidp);
+int nc_inq_varid_cached(int ncid, const std::string &name, int *varidp);
+int nc_close_cached(int ncid);
+
+/**
+ * Release a file opened with nc_open_cached() when this goes out of scope, so
+ * a file is not left in use when an exception is thrown. Use close() to
+ * release the file and get the status.
+ */
+class nc_cached_file {
+private:
+    int d_ncid;
+
+public:
+    nc_cached_file(int ncid) : d_ncid(ncid) { }
+    ~nc_cached_file()
+    {
+        if (d_ncid != -1) (void) nc_close_cached(d_ncid);
+    }
+
+    /// @return The status of nc_close_cached()
+    int close()
+    {
+        int ncid = d_ncid;
+        d_ncid = -1;
+        return nc_close_cached(ncid);
+    }
+};
+
+/// A field of a netCDF compound type
+struct nc_compound_field {
+    std::string name;   // for a user defined type, the name of the type
+    size_t offset;
+    nc_type type;
+    int ndims;
+};
+
+int nc_inq_compound_fields(int ncid, nc_type datatype, std::vector<nc_compound_field> &fields);
+
+#endif // _nc_util_h
@@ -549,8 +549,9 @@ void nc_read_dataset_attributes(DAS &das, const string &filename)
     BESDEBUG("nc", "In nc_read_dataset_attributes" << endl);
 
     int ncid, errstat;
-    errstat = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
+    errstat = nc_open_cached(filename, &ncid);
     if (errstat != NC_NOERR) throw Error(errstat, "NetCDF handler: Could not open " + filename + ".");
+    nc_cached_file ncfile(ncid);
 
     // how many variables? how many global attributes?
     int nvars, ngatts;
@@ -682,7 +683,7 @@ void nc_read_dataset_attributes(DAS &das, const string &filename)
         attr_table_ptr->append_attr("Unlimited_Dimension", print_type(datatype), print_rep);
     }
 
-    if (nc_close(ncid) != NC_NOERR) throw InternalErr(__FILE__, __LINE__, "NetCDF handler: Could not close the dataset!");
+    if (ncfile.close() != NC_NOERR) throw InternalErr(__FILE__, __LINE__, "NetCDF handler: Could not close the dataset!");
 
     BESDEBUG("nc", "Exiting nc_read_dataset_attributes" << endl);
 }
@@ -613,9 +613,10 @@ void nc_read_dataset_variables(DDS &dds_table, const string &filename)
     int ncid, errstat;
     int nvars;
 
-    errstat = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
+    errstat = nc_open_cached(filename, &ncid);
     if (errstat != NC_NOERR)
         throw Error(errstat, "Could not open " + filename + ".");
+    nc_cached_file ncfile(ncid);
 
     // how many variables?
     errstat = nc_inq_nvars(ncid, &nvars);
@@ -628,7 +629,7 @@ void nc_read_dataset_variables(DDS &dds_table, const string &filename)
     // read variables' classes
     read_variables(dds_table, filename, ncid, nvars);
 
-    if (nc_close(ncid) != NC_NOERR)
+    if (ncfile.close() != NC_NOERR)
         throw InternalErr(__FILE__, __LINE__, "ncdds: Could not close the dataset!");
 }
 
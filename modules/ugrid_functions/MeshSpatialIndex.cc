@@ -0,0 +1,312 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Authors: Nathan Potter <ndp@opendap.org>
+//          James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <DapObj.h>
+#include <ObjMemCache.h>
+#include <CacheKey.h>
+
+#include "BESDebug.h"
+
+#include "MeshSpatialIndex.h"
+
+#ifdef NDEBUG
+#undef BESDEBUG
+#define BESDEBUG( x, y )
+#endif
+
+using namespace std;
+
+namespace ugrid {
+
+// Faces per BVH leaf
+static const int BVH_LEAF_SIZE = 8;
+
+ObjMemCache *MeshSpatialIndex::d_cache = 0;
+
+/**
+ * Orders node or face numbers using a value from a vector indexed by
+ * those numbers (a coordinate or a face centroid).
+ */
+struct IndexedLess {
+    const vector<double> &d_values;
+    IndexedLess(const vector<double> &values) : d_values(values) { }
+    bool operator()(int a, int b) const { return d_values[a] < d_values[b]; }
+};
+
+static bool intersects(const MeshBox &a, const MeshBox &b)
+{
+    return a.min[0] <= b.max[0] && a.max[0] >= b.min[0] && a.min[1] <= b.max[1] && a.max[1] >= b.min[1];
+}
+
+static void empty_box(MeshBox &box)
+{
+    box.min[0] = box.min[1] = numeric_limits<double>::max();
+    box.max[0] = box.max[1] = -numeric_limits<double>::max();
+}
+
+static void extend_box(MeshBox &box, double x, double y)
+{
+    box.min[0] = min(box.min[0], x);
+    box.max[0] = max(box.max[0], x);
+    box.min[1] = min(box.min[1], y);
+    box.max[1] = max(box.max[1], y);
+}
+
+/**
+ * @brief Build the node KD-tree and face BVH for a mesh
+ *
+ * @param x The first node coordinate (e.g., longitude), one value per node
+ * @param y The second node coordinate (e.g., latitude)
+ * @param cells The zero-based face node connectivity, faceCount x
+ * nodesPerFace. Values that are not valid node numbers (e.g., the fill
+ * values of a flexible mesh) are ignored.
+ * @param faceCount Number of faces
+ * @param nodesPerFace Maximum number of nodes per face
+ */
+MeshSpatialIndex::MeshSpatialIndex(const vector<double> &x, const vector<double> &y, const GF::Node *cells,
+    int faceCount, int nodesPerFace) :
+    d_nodeCount(x.size()), d_faceCount(faceCount), d_nodesPerFace(nodesPerFace), d_x(x), d_y(y),
+        d_cells(cells, cells + (size_t) faceCount * nodesPerFace)
+{
+    BESDEBUG("ugrid", "MeshSpatialIndex() - Indexing " << d_nodeCount << " nodes and " << d_faceCount << " faces." << endl);
+
+    d_nodeOrder.resize(d_nodeCount);
+    for (int i = 0; i < d_nodeCount; ++i)
+        d_nodeOrder[i] = i;
+    buildKDTree(0, d_nodeCount, 0);
+
+    vector<MeshBox> faceBoxes(d_faceCount);
+    vector<double> cx(d_faceCount), cy(d_faceCount);
+    for (int f = 0; f < d_faceCount; ++f) {
+        empty_box(faceBoxes[f]);
+        const GF::Node *fn = getFaceNodes(f);
+        for (int k = 0; k < d_nodesPerFace; ++k) {
+            if (validNode(fn[k])) extend_box(faceBoxes[f], d_x[fn[k]], d_y[fn[k]]);
+        }
+        cx[f] = (faceBoxes[f].min[0] + faceBoxes[f].max[0]) / 2.0;
+        cy[f] = (faceBoxes[f].min[1] + faceBoxes[f].max[1]) / 2.0;
+    }
+
+    d_faceOrder.resize(d_faceCount);
+    for (int f = 0; f < d_faceCount; ++f)
+        d_faceOrder[f] = f;
+    d_bvh.reserve(2 * (d_faceCount / BVH_LEAF_SIZE + 1));
+    if (d_faceCount > 0) buildBVH(faceBoxes, cx, cy, 0, d_faceCount);
+
+    BESDEBUG("ugrid", "MeshSpatialIndex() - BVH has " << d_bvh.size() << " nodes." << endl);
+}
+
+void MeshSpatialIndex::buildKDTree(int begin, int end, int axis)
+{
+    if (end - begin <= 1) return;
+
+    int mid = begin + (end - begin) / 2;
+    nth_element(d_nodeOrder.begin() + begin, d_nodeOrder.begin() + mid, d_nodeOrder.begin() + end,
+        IndexedLess(axis == 0 ? d_x : d_y));
+
+    buildKDTree(begin, mid, 1 - axis);
+    buildKDTree(mid + 1, end, 1 - axis);
+}
+
+void MeshSpatialIndex::queryKDTree(const MeshBox &box, int begin, int end, int axis, vector<int> &nodes) const
+{
+    if (begin >= end) return;
+
+    int mid = begin + (end - begin) / 2;
+    int n = d_nodeOrder[mid];
+    double v = (axis == 0) ? d_x[n] : d_y[n];
+
+    if (d_x[n] >= box.min[0] && d_x[n] <= box.max[0] && d_y[n] >= box.min[1] && d_y[n] <= box.max[1])
+        nodes.push_back(n);
+
+    if (box.min[axis] <= v) queryKDTree(box, begin, mid, 1 - axis, nodes);
+    if (box.max[axis] >= v) queryKDTree(box, mid + 1, end, 1 - axis, nodes);
+}
+
+/**
+ * Build the BVH for the faces in d_faceOrder[begin, end). Faces are split
+ * at the median of their centroids (cx, cy) along the longer axis of the
+ * range's bounding box.
+ *
+ * @return The index of the new BVH node in d_bvh
+ */
+int MeshSpatialIndex::buildBVH(const vector<MeshBox> &faceBoxes, const vector<double> &cx, const vector<double> &cy,
+    int begin, int end)
+{
+    BVHNode node;
+    empty_box(node.d_box);
+    for (int i = begin; i < end; ++i) {
+        const MeshBox &fb = faceBoxes[d_faceOrder[i]];
+        if (fb.min[0] > fb.max[0]) continue;   // a face with no valid nodes
+        extend_box(node.d_box, fb.min[0], fb.min[1]);
+        extend_box(node.d_box, fb.max[0], fb.max[1]);
+    }
+    node.d_left = node.d_right = -1;
+    node.d_start = begin;
+    node.d_count = end - begin;
+
+    int index = d_bvh.size();
+    d_bvh.push_back(node);
+
+    if (end - begin <= BVH_LEAF_SIZE) return index;
+
+    int axis = (node.d_box.max[0] - node.d_box.min[0] >= node.d_box.max[1] - node.d_box.min[1]) ? 0 : 1;
+
+    int mid = begin + (end - begin) / 2;
+    nth_element(d_faceOrder.begin() + begin, d_faceOrder.begin() + mid, d_faceOrder.begin() + end,
+        IndexedLess(axis == 0 ? cx : cy));
+
+    // d_bvh may be reallocated by the recursive calls; use the index
+    int left = buildBVH(faceBoxes, cx, cy, begin, mid);
+    int right = buildBVH(faceBoxes, cx, cy, mid, end);
+    d_bvh[index].d_left = left;
+    d_bvh[index].d_right = right;
+
+    return index;
+}
+
+void MeshSpatialIndex::queryBVH(const MeshBox &box, int bvhNode, vector<int> &faces) const
+{
+    const BVHNode &node = d_bvh[bvhNode];
+    if (!intersects(box, node.d_box)) return;
+
+    if (node.d_left == -1) {
+        for (int i = node.d_start; i < node.d_start + node.d_count; ++i) {
+            int f = d_faceOrder[i];
+            MeshBox fb;
+            empty_box(fb);
+            const GF::Node *fn = getFaceNodes(f);
+            for (int k = 0; k < d_nodesPerFace; ++k) {
+                if (validNode(fn[k])) extend_box(fb, d_x[fn[k]], d_y[fn[k]]);
+            }
+            if (intersects(box, fb)) faces.push_back(f);
+        }
+        return;
+    }
+
+    queryBVH(box, node.d_left, faces);
+    queryBVH(box, node.d_right, faces);
+}
+
+/**
+ * @brief Find the nodes inside a box
+ * @param box The box
+ * @param nodes Value-result parameter; the node numbers are appended in
+ * ascending order.
+ */
+void MeshSpatialIndex::getNodesInBox(const MeshBox &box, vector<int> &nodes) const
+{
+    vector<int>::size_type first = nodes.size();
+    queryKDTree(box, 0, d_nodeCount, 0, nodes);
+    sort(nodes.begin() + first, nodes.end());
+}
+
+/**
+ * @brief Find the faces whose bounding boxes intersect a box
+ *
+ * This includes every face that has a node inside the box.
+ *
+ * @param box The box
+ * @param faces Value-result parameter; the face numbers are appended in
+ * ascending order.
+ */
+void MeshSpatialIndex::getFacesInBox(const MeshBox &box, vector<int> &faces) const
+{
+    if (d_bvh.empty()) return;
+
+    vector<int>::size_type first = faces.size();
+    queryBVH(box, 0, faces);
+    sort(faces.begin() + first, faces.end());
+}
+
+/**
+ * @brief Set the number of mesh indexes cached by each BES process
+ * @param entries Zero disables the cache (and use of the index)
+ */
+void MeshSpatialIndex::setCacheEntries(unsigned int entries)
+{
+    if (entries > 0 && !d_cache) {
+        d_cache = new ObjMemCache(entries, 0.2);
+        BESDEBUG("ugrid", "MeshSpatialIndex::setCacheEntries() - Caching up to " << entries << " mesh indexes." << endl);
+    }
+}
+
+/**
+ * @brief Get the key for the index of a mesh
+ *
+ * The key holds the dataset's modification time and size as well as its
+ * name, so an index is not used for a dataset that has been replaced.
+ *
+ * @param dataset The dataset's pathname
+ * @param meshVarName The mesh variable
+ * @return The key, or the empty string if the dataset is not a file; such
+ * a dataset's indexes are not cached.
+ */
+string MeshSpatialIndex::getCacheKey(const string &dataset, const string &meshVarName)
+{
+    string version = dataset_version(dataset);
+    if (version.empty()) return "";
+
+    return dataset + "#" + version + "#" + meshVarName;
+}
+
+/**
+ * @brief Get a cached index
+ * @param key See getCacheKey()
+ * @return The index, which is still owned by the cache, or null.
+ */
+MeshSpatialIndex *MeshSpatialIndex::getCached(const string &key)
+{
+    if (!d_cache) return 0;
+
+    return dynamic_cast<MeshSpatialIndex*>(d_cache->get(key));
+}
+
+/**
+ * @brief Add an index to the cache
+ *
+ * The cache takes ownership of the index; if the cache is disabled, the
+ * index is deleted. Call this once the index is no longer needed by the
+ * current request since adding may purge older entries.
+ *
+ * @param index The index
+ * @param key See getCacheKey()
+ */
+void MeshSpatialIndex::addCached(MeshSpatialIndex *index, const string &key)
+{
+    if (!d_cache) {
+        delete index;
+        return;
+    }
+
+    d_cache->add(index, key);
+}
+
+} // namespace ugrid
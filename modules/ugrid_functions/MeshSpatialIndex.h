@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Authors: Nathan Potter <ndp@opendap.org>
+//          James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _MeshSpatialIndex_h
+#define _MeshSpatialIndex_h 1
+
+#include <string>
+#include <vector>
+
+#include <gridfields/type.h>
+
+#include <DapObj.h>
+
+class ObjMemCache;
+
+namespace ugrid {
+
+/**
+ * A box in the plane of the first two node coordinates of a mesh. The box
+ * is closed; both the min and max values are inside it.
+ */
+struct MeshBox {
+    double min[2];
+    double max[2];
+};
+
+/**
+ * @brief A spatial index for a two dimensional mesh
+ *
+ * The index holds a KD-tree over the mesh's nodes and a bounding volume
+ * hierarchy (BVH) over its faces, both built using the first two node
+ * coordinate variables. It also holds a copy of the (zero-based) face
+ * node connectivity so that a restricted mesh can be built without
+ * reading the connectivity array again.
+ *
+ * Building the index is O(N log N) in the number of nodes and faces;
+ * the indexes are cached (by dataset, the dataset's modification time and
+ * size, and mesh variable) in a per-process ObjMemCache so that repeated
+ * requests for the same mesh only pay for that once. See getCacheKey(),
+ * getCached() and addCached().
+ */
+class MeshSpatialIndex: public libdap::DapObj {
+private:
+    struct BVHNode {
+        MeshBox d_box;
+        int d_left, d_right;    // child nodes, -1 for a leaf
+        int d_start, d_count;   // range in d_faceOrder, leaves only
+    };
+
+    int d_nodeCount;
+    int d_faceCount;
+    int d_nodesPerFace;
+
+    std::vector<double> d_x, d_y;
+    std::vector<GF::Node> d_cells;      // faceCount x nodesPerFace, zero-based
+
+    // KD-tree: an implicit, balanced tree stored in d_nodeOrder; the median
+    // of each range is the splitting node and the axis alternates by depth.
+    std::vector<int> d_nodeOrder;
+
+    std::vector<BVHNode> d_bvh;
+    std::vector<int> d_faceOrder;
+
+    static ObjMemCache *d_cache;
+
+    bool validNode(long long n) const
+    {
+        return n >= 0 && n < d_nodeCount;
+    }
+
+    void buildKDTree(int begin, int end, int axis);
+    void queryKDTree(const MeshBox &box, int begin, int end, int axis, std::vector<int> &nodes) const;
+
+    int buildBVH(const std::vector<MeshBox> &faceBoxes, const std::vector<double> &cx,
+        const std::vector<double> &cy, int begin, int end);
+    void queryBVH(const MeshBox &box, int bvhNode, std::vector<int> &faces) const;
+
+    MeshSpatialIndex(const MeshSpatialIndex &);
+    MeshSpatialIndex &operator=(const MeshSpatialIndex &);
+
+public:
+    MeshSpatialIndex(const std::vector<double> &x, const std::vector<double> &y, const GF::Node *cells,
+        int faceCount, int nodesPerFace);
+    virtual ~MeshSpatialIndex()
+    {
+    }
+
+    int getNodeCount() const
+    {
+        return d_nodeCount;
+    }
+    int getFaceCount() const
+    {
+        return d_faceCount;
+    }
+    int getNodesPerFace() const
+    {
+        return d_nodesPerFace;
+    }
+
+    /** @return The zero-based connectivity of the face 'f' */
+    const GF::Node *getFaceNodes(int f) const
+    {
+        return &d_cells[(size_t) f * d_nodesPerFace];
+    }
+
+    void getNodesInBox(const MeshBox &box, std::vector<int> &nodes) const;
+    void getFacesInBox(const MeshBox &box, std::vector<int> &faces) const;
+
+    static void setCacheEntries(unsigned int entries);
+    static bool cacheEnabled()
+    {
+        return d_cache != 0;
+    }
+    static std::string getCacheKey(const std::string &dataset, const std::string &meshVarName);
+    static MeshSpatialIndex *getCached(const std::string &key);
+    static void addCached(MeshSpatialIndex *index, const std::string &key);
+};
+
+} // namespace ugrid
+
+#endif // _MeshSpatialIndex_h
@@ -31,6 +31,10 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
 
 #include <gridfields/type.h>
 #include <gridfields/gridfield.h>
@@ -52,6 +56,7 @@
 //#include "NDimensionalArray.h"
 #include "MeshDataVariable.h"
 #include "TwoDMeshTopology.h"
+#include "MeshSpatialIndex.h"
 
 #include "BESDebug.h"
 #include "BESError.h"
@@ -70,7 +75,7 @@ namespace ugrid {
 /* not used. faceCoordinateNames(0), */
 TwoDMeshTopology::TwoDMeshTopology() :
     d_meshVar(0), nodeCoordinateArrays(0), nodeCount(0), faceNodeConnectivityArray(0), faceCount(0), faceCoordinateArrays(
-        0), gridTopology(0), d_inputGridField(0), resultGridField(0), fncCellArray(0), _initialized(false)
+        0), gridTopology(0), d_inputGridField(0), resultGridField(0), fncCellArray(0), d_subset(false), _initialized(false)
 {
     rangeDataArrays = new vector<MeshDataVariable *>();
     sharedIntArrays = new vector<int *>();
@@ -142,6 +147,8 @@ void TwoDMeshTopology::init(string meshVarName, DDS *dds)
 
     if (!d_meshVar) throw Error("Unable to locate variable: " + meshVarName);
 
+    d_datasetName = dds->filename();
+
     dimension = getAttributeValue(d_meshVar, UGRID_TOPOLOGY_DIMENSION);
     if (dimension.empty()) dimension = getAttributeValue(d_meshVar, UGRID_DIMENSION);
 
@@ -727,6 +734,235 @@ void TwoDMeshTopology::buildBasicGfTopology()
     }
 }
 
+static string trim(const string &s)
+{
+    string::size_type first = s.find_first_not_of(" \t");
+    if (first == string::npos) return "";
+    return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+}
+
+static bool getNumber(const string &s, double &value)
+{
+    if (s.empty()) return false;
+    char *end;
+    value = strtod(s.c_str(), &end);
+    return *end == '\0';
+}
+
+/**
+ * Parse a restrict filter expression that is a conjunction of comparisons
+ * between the coordinates named 'xName' and 'yName' and constants, e.g.,
+ * '28.0<lat & lat<29.0 & -89.0<lon & lon<-88.0', into a box. Sides of the
+ * box not bounded by the expression are infinite. The box is padded a
+ * little because gridfields compares the coordinates as floats.
+ *
+ * @return True if the whole expression has that form, false otherwise.
+ */
+static bool getFilterBox(const string &filterExpression, const string &xName, const string &yName, MeshBox &box)
+{
+    box.min[0] = box.min[1] = -numeric_limits<double>::infinity();
+    box.max[0] = box.max[1] = numeric_limits<double>::infinity();
+
+    vector<string> clauses = split(filterExpression, '&');
+    if (clauses.empty()) return false;
+
+    for (vector<string>::iterator i = clauses.begin(); i != clauses.end(); ++i) {
+        string::size_type pos = i->find_first_of("<>");
+        if (pos == string::npos) return false;
+
+        bool less = (*i)[pos] == '<';
+        string::size_type rhsPos = ((*i)[pos + 1] == '=') ? pos + 2 : pos + 1;
+        string lhs = trim(i->substr(0, pos));
+        string rhs = trim(i->substr(rhsPos));
+
+        // Put the comparison in the form 'name op value'
+        string name;
+        double value;
+        if (getNumber(rhs, value))
+            name = lhs;
+        else if (getNumber(lhs, value)) {
+            name = rhs;
+            less = !less;
+        }
+        else
+            return false;
+
+        int axis;
+        if (name == xName)
+            axis = 0;
+        else if (name == yName)
+            axis = 1;
+        else
+            return false;
+
+        if (less)
+            box.max[axis] = min(box.max[axis], value);
+        else
+            box.min[axis] = max(box.min[axis], value);
+    }
+
+    for (int axis = 0; axis < 2; ++axis) {
+        if (box.min[axis] != -numeric_limits<double>::infinity()) box.min[axis] -= (fabs(box.min[axis]) + 1) * 1e-6;
+        if (box.max[axis] != numeric_limits<double>::infinity()) box.max[axis] += (fabs(box.max[axis]) + 1) * 1e-6;
+    }
+
+    return true;
+}
+
+/**
+ * Build the spatial index for this mesh using the first two node
+ * coordinate arrays and the face node connectivity array.
+ */
+MeshSpatialIndex *TwoDMeshTopology::buildSpatialIndex()
+{
+    BESDEBUG("ugrid", "TwoDMeshTopology::buildSpatialIndex() - Building the spatial index for " << meshVarName() << endl);
+
+    double *x = extractArray<double>((*nodeCoordinateArrays)[0]);
+    vector<double> xValues(x, x + nodeCount);
+    delete[] x;
+    double *y = extractArray<double>((*nodeCoordinateArrays)[1]);
+    vector<double> yValues(y, y + nodeCount);
+    delete[] y;
+
+    faceNodeConnectivityArray->read();
+    int nodesPerFace = faceNodeConnectivityArray->dimension_size(fncNodesDim);
+    GF::Node *cells = getFncArrayAsGFCells(faceNodeConnectivityArray);
+    int startIndex = getStartIndex(faceNodeConnectivityArray);
+    if (startIndex != 0) {
+        for (int j = 0; j < nodesPerFace * faceCount; j++) {
+            cells[j] -= startIndex;
+        }
+    }
+
+    MeshSpatialIndex *index;
+    try {
+        index = new MeshSpatialIndex(xValues, yValues, cells, faceCount, nodesPerFace);
+    }
+    catch (...) {
+        delete[] cells;
+        throw;
+    }
+    delete[] cells;
+
+    return index;
+}
+
+/**
+ * Build the input GridField using only the nodes and faces in d_nodeSubset
+ * and d_faceSubset. The faces are renumbered to use the subset's nodes; the
+ * index variables (see addIndexVariable()) hold the numbers of the nodes
+ * and faces in the whole mesh.
+ */
+void TwoDMeshTopology::buildSubsetGfTopology(const MeshSpatialIndex &index)
+{
+    BESDEBUG("ugrid",
+        "TwoDMeshTopology::buildSubsetGfTopology() - Building GridFields objects for " << d_nodeSubset.size() << " nodes and " << d_faceSubset.size() << " faces of " << meshVarName() << endl);
+
+    gridTopology = new GF::Grid(meshVarName());
+    gridTopology->setKCells(new GF::Implicit0Cells(d_nodeSubset.size()), node);
+
+    int nodesPerFace = index.getNodesPerFace();
+    fncCellArray = new GF::Node[d_faceSubset.size() * nodesPerFace];
+    GF::Node *cell = fncCellArray;
+    for (vector<int>::iterator f = d_faceSubset.begin(); f != d_faceSubset.end(); ++f) {
+        const GF::Node *faceNodes = index.getFaceNodes(*f);
+        for (int k = 0; k < nodesPerFace; ++k) {
+            vector<int>::iterator n = lower_bound(d_nodeSubset.begin(), d_nodeSubset.end(), (int) faceNodes[k]);
+            // Values that are not nodes (fill values) are left as they are
+            if (n != d_nodeSubset.end() && *n == faceNodes[k])
+                *cell++ = n - d_nodeSubset.begin();
+            else
+                *cell++ = faceNodes[k];
+        }
+    }
+    gridTopology->setKCells(new GF::CellArray(fncCellArray, d_faceSubset.size(), nodesPerFace), face);
+
+    d_inputGridField = new GF::GridField(gridTopology);
+
+    vector<libdap::Array *>::iterator ncit;
+    for (ncit = nodeCoordinateArrays->begin(); ncit != nodeCoordinateArrays->end(); ++ncit) {
+        GF::Array *gfa = extractGridFieldArray(*ncit, sharedIntArrays, sharedFloatArrays, &d_nodeSubset);
+        gfArrays.push_back(gfa);
+        d_inputGridField->AddAttribute(node, gfa);
+    }
+
+    for (ncit = faceCoordinateArrays->begin(); ncit != faceCoordinateArrays->end(); ++ncit) {
+        GF::Array *gfa = extractGridFieldArray(*ncit, sharedIntArrays, sharedFloatArrays, &d_faceSubset);
+        gfArrays.push_back(gfa);
+        d_inputGridField->AddAttribute(face, gfa);
+    }
+
+    d_subset = true;
+}
+
+/**
+ * @brief Build the GridField for a restriction
+ *
+ * When the restriction is on the nodes and the filter expression only
+ * bounds the first two node coordinates (a box), use the mesh's spatial
+ * index to build a GridField that holds only the nodes in the box and the
+ * faces that touch it. The restrict operator then has far less work to do
+ * and the face node connectivity need not be read. The index is cached
+ * (see MeshSpatialIndex), so it is built only once per mesh. Otherwise
+ * this builds the GridField for the whole mesh.
+ *
+ * @param loc The location of the restriction
+ * @param filterExpression The restriction's filter expression
+ */
+void TwoDMeshTopology::buildBasicGfTopology(locationType loc, const string &filterExpression)
+{
+    MeshBox box;
+    if (loc != node || !MeshSpatialIndex::cacheEnabled() || nodeCoordinateArrays->size() < 2
+        || !getFilterBox(filterExpression, (*nodeCoordinateArrays)[0]->var()->name(),
+            (*nodeCoordinateArrays)[1]->var()->name(), box)) {
+        buildBasicGfTopology();
+        return;
+    }
+
+    string key = MeshSpatialIndex::getCacheKey(d_datasetName, meshVarName());
+    if (key.empty()) {
+        buildBasicGfTopology();
+        return;
+    }
+
+    MeshSpatialIndex *index = MeshSpatialIndex::getCached(key);
+    auto_ptr<MeshSpatialIndex> newIndex;
+    if (!index) {
+        newIndex.reset(buildSpatialIndex());
+        index = newIndex.get();
+    }
+
+    if (index->getNodeCount() != nodeCount || index->getFaceCount() != faceCount) {
+        BESDEBUG("ugrid", "TwoDMeshTopology::buildBasicGfTopology() - Cached spatial index does not match " << key << endl);
+        buildBasicGfTopology();
+        return;
+    }
+
+    d_nodeSubset.clear();
+    d_faceSubset.clear();
+    index->getFacesInBox(box, d_faceSubset);
+    index->getNodesInBox(box, d_nodeSubset);
+
+    // Every node of a face in the subset must be in the subset
+    int nodesPerFace = index->getNodesPerFace();
+    for (vector<int>::iterator f = d_faceSubset.begin(); f != d_faceSubset.end(); ++f) {
+        const GF::Node *faceNodes = index->getFaceNodes(*f);
+        for (int k = 0; k < nodesPerFace; ++k) {
+            if (faceNodes[k] >= 0 && faceNodes[k] < nodeCount) d_nodeSubset.push_back(faceNodes[k]);
+        }
+    }
+    sort(d_nodeSubset.begin(), d_nodeSubset.end());
+    d_nodeSubset.erase(unique(d_nodeSubset.begin(), d_nodeSubset.end()), d_nodeSubset.end());
+
+    // An empty subset makes an empty result; let the whole mesh build report that.
+    if (d_nodeSubset.empty() || d_faceSubset.empty())
+        buildBasicGfTopology();
+    else
+        buildSubsetGfTopology(*index);
+
+    if (newIndex.get()) MeshSpatialIndex::addCached(newIndex.release(), key);
+}
+
 int TwoDMeshTopology::getResultGridSize(locationType dim)
 {
     return resultGridField->Size(dim);
@@ -1286,7 +1522,11 @@ void TwoDMeshTopology::addIndexVariable(locationType location)
     BESDEBUG("ugrid",
         "TwoDMeshTopology::addIndexVariable() - Adding index variable '" << name << "'  size: " << libdap::long_to_string(size) << " at rank " << libdap::long_to_string(location) << endl);
 
-    GF::Array *indexArray = newGFIndexArray(name, size, sharedIntArrays);
+    GF::Array *indexArray;
+    if (d_subset)
+        indexArray = newGFIndexArray(name, (location == node) ? d_nodeSubset : d_faceSubset, sharedIntArrays);
+    else
+        indexArray = newGFIndexArray(name, size, sharedIntArrays);
     d_inputGridField->AddAttribute(location, indexArray);
     gfArrays.push_back(indexArray);
 }
@@ -44,6 +44,8 @@ class Grid;
 
 namespace ugrid {
 
+class MeshSpatialIndex;
+
 /**
  * Identifies the location/rank/dimension that various grid components are associated with.
  */
@@ -189,6 +191,16 @@ private:
 
     GF::Node *fncCellArray;
 
+    // Used to key the cached MeshSpatialIndex for this mesh
+    string d_datasetName;
+
+    // When the input GridField holds only part of the mesh (see
+    // buildBasicGfTopology(locationType, const string &)), these hold the
+    // (sorted) numbers of the nodes and faces it holds.
+    bool d_subset;
+    vector<int> d_nodeSubset;
+    vector<int> d_faceSubset;
+
     bool _initialized;
 
     void ingestFaceNodeConnectivityArray(libdap::BaseType *meshTopology, libdap::DDS *dds);
@@ -199,6 +211,9 @@ private:
     int getStartIndex(libdap::Array *array);
     GF::CellArray *getFaceNodeConnectivityCells();
 
+    MeshSpatialIndex *buildSpatialIndex();
+    void buildSubsetGfTopology(const MeshSpatialIndex &index);
+
     libdap::Array *getGFAttributeAsDapArray(libdap::Array *sourceArray, locationType rank,
         GF::GridField *resultGridField);
     libdap::Array *getGridFieldCellArrayAsDapArray(GF::GridField *resultGridField, libdap::Array *sourceFcnArray);
@@ -224,6 +239,7 @@ public:
     }
 
     void buildBasicGfTopology();
+    void buildBasicGfTopology(locationType loc, const string &filterExpression);
     void applyRestrictOperator(locationType loc, string filterExpression);
 
     int getInputGridSize(locationType location);
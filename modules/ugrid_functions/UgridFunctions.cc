@@ -29,7 +29,9 @@ using std::endl;
 #include "UgridFunctions.h"
 #include "ServerFunctionsList.h"
 #include "BESDebug.h"
+#include "TheBESKeys.h"
 #include "ugrid_restrict.h"
+#include "MeshSpatialIndex.h"
 
 static string getFunctionNames()
 {
@@ -66,6 +68,11 @@ void UgridFunctions::initialize(const string &/*modname*/)
 
     BESDEBUG("UgridFunctions", "initialize() - function names: " << getFunctionNames() << endl);
 
+    // Number of mesh spatial indexes each BES process caches; zero (the
+    // default) disables the index.
+    int entries = TheBESKeys::TheKeys()->read_int_key("UgridFunctions.SpatialIndexCacheEntries", 0);
+    if (entries > 0) ugrid::MeshSpatialIndex::setCacheEntries(entries);
+
     BESDEBUG("UgridFunctions", "initialize() - END" << endl);
 }
 
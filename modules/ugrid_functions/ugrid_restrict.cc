@@ -546,7 +546,7 @@ void ugrid_restrict(string func_name, locationType location, int argc, BaseType
             TwoDMeshTopology *tdmt = new TwoDMeshTopology();
             tdmt->init(meshVariableName, &dds);
 
-            tdmt->buildBasicGfTopology();
+            tdmt->buildBasicGfTopology(args.dimension, args.filterExpression);
             tdmt->addIndexVariable(node);
             tdmt->addIndexVariable(face);
             tdmt->applyRestrictOperator(args.dimension, args.filterExpression);
@@ -31,6 +31,7 @@
 
 #include <vector>
 #include <sstream>
+#include <algorithm>
 
 #include <gridfields/array.h>
 
@@ -117,6 +118,38 @@ GF::Array *newGFIndexArray(string name, long size, vector<int*> *sharedIntArrays
     return gfa;
 }
 
+/**
+ * Build a gridfields index array that holds the given values; used when
+ * the gridfield holds a subset of a mesh so that the index values are
+ * those of the whole mesh.
+ */
+GF::Array *newGFIndexArray(string name, const vector<int> &indexes, vector<int*> *sharedIntArrays)
+{
+    GF::Array *gfa = new GF::Array(name, GF::INT);
+    int *values = new int[indexes.size()];
+    copy(indexes.begin(), indexes.end(), values);
+    gfa->shareIntData(values, indexes.size());
+    sharedIntArrays->push_back(values);
+    return gfa;
+}
+
+/**
+ * If subset is not null, return a new array holding the elements of
+ * 'values' at the indexes in subset and delete 'values'. Otherwise
+ * return 'values'.
+ */
+template<typename T> static T *subset_values(T *values, const vector<int> *subset)
+{
+    if (!subset) return values;
+
+    T *dest = new T[subset->size()];
+    for (vector<int>::size_type i = 0; i < subset->size(); ++i)
+        dest[i] = values[(*subset)[i]];
+
+    delete[] values;
+    return dest;
+}
+
 /**
  * Extract data from a DAP array and return those values in a gridfields
  * array. This function sets the \e send_p property of the DAP Array and
@@ -125,9 +158,14 @@ GF::Array *newGFIndexArray(string name, long size, vector<int*> *sharedIntArrays
  * Array class has been specialized.
  *
  * @param a The DAP Array. Extract values from this array
+ * @param sharedIntArrays Holds the values of INT arrays; the caller deletes them
+ * @param sharedFloatArrays Holds the values of FLOAT arrays
+ * @param subset If not null, the GF::Array holds only the values at these
+ * indexes (in this order).
  * @return A GF::Array
  */
-GF::Array *extractGridFieldArray(libdap::Array *a, vector<int*> *sharedIntArrays, vector<float*> *sharedFloatArrays)
+GF::Array *extractGridFieldArray(libdap::Array *a, vector<int*> *sharedIntArrays, vector<float*> *sharedFloatArrays,
+    const vector<int> *subset)
 {
     if ((a->type() == dods_array_c && !a->var()->is_simple_type()) || a->var()->type() == dods_str_c
         || a->var()->type() == dods_url_c)
@@ -137,56 +175,58 @@ GF::Array *extractGridFieldArray(libdap::Array *a, vector<int*> *sharedIntArrays
     a->set_send_p(true);
     a->read();
 
+    long size = subset ? subset->size() : a->length();
+
     // Construct a GridField array from a DODS array
     GF::Array *gfa;
 
     switch (a->var()->type()) {
     case dods_byte_c: {
         gfa = new GF::Array(a->var()->name(), GF::INT);
-        int *values = extract_array_helper<dods_byte, int>(a);
-        gfa->shareIntData(values, a->length());
+        int *values = subset_values(extract_array_helper<dods_byte, int>(a), subset);
+        gfa->shareIntData(values, size);
         sharedIntArrays->push_back(values);
         break;
     }
     case dods_uint16_c: {
         gfa = new GF::Array(a->var()->name(), GF::INT);
-        int *values = extract_array_helper<dods_uint16, int>(a);
-        gfa->shareIntData(values, a->length());
+        int *values = subset_values(extract_array_helper<dods_uint16, int>(a), subset);
+        gfa->shareIntData(values, size);
         sharedIntArrays->push_back(values);
         break;
     }
     case dods_int16_c: {
         gfa = new GF::Array(a->var()->name(), GF::INT);
-        int *values = extract_array_helper<dods_int16, int>(a);
-        gfa->shareIntData(values, a->length());
+        int *values = subset_values(extract_array_helper<dods_int16, int>(a), subset);
+        gfa->shareIntData(values, size);
         sharedIntArrays->push_back(values);
         break;
     }
     case dods_uint32_c: {
         gfa = new GF::Array(a->var()->name(), GF::INT);
-        int *values = extract_array_helper<dods_uint32, int>(a);
-        gfa->shareIntData(values, a->length());
+        int *values = subset_values(extract_array_helper<dods_uint32, int>(a), subset);
+        gfa->shareIntData(values, size);
         sharedIntArrays->push_back(values);
         break;
     }
     case dods_int32_c: {
         gfa = new GF::Array(a->var()->name(), GF::INT);
-        int *values = extract_array_helper<dods_int32, int>(a);
-        gfa->shareIntData(values, a->length());
+        int *values = subset_values(extract_array_helper<dods_int32, int>(a), subset);
+        gfa->shareIntData(values, size);
         sharedIntArrays->push_back(values);
         break;
     }
     case dods_float32_c: {
         gfa = new GF::Array(a->var()->name(), GF::FLOAT);
-        float *values = extract_array_helper<dods_float32, float>(a);
-        gfa->shareFloatData(values, a->length());
+        float *values = subset_values(extract_array_helper<dods_float32, float>(a), subset);
+        gfa->shareFloatData(values, size);
         sharedFloatArrays->push_back(values);
         break;
     }
     case dods_float64_c: {
         gfa = new GF::Array(a->var()->name(), GF::FLOAT);
-        float *values = extract_array_helper<dods_float64, float>(a);
-        gfa->shareFloatData(values, a->length());
+        float *values = subset_values(extract_array_helper<dods_float64, float>(a), subset);
+        gfa->shareFloatData(values, size);
         sharedFloatArrays->push_back(values);
         break;
     }
@@ -67,8 +67,10 @@ namespace ugrid {
 #define UGRID_FACE_EDGE_CONNECTIVITY "face_edge_connectivity"
 #define UGRID_FACE_FACE_CONNECTIVITY "face_face_connectivity"
 
-GF::Array *extractGridFieldArray(libdap::Array *a, vector<int*> *sharedIntArrays, vector<float*> *sharedFloatArrays);
+GF::Array *extractGridFieldArray(libdap::Array *a, vector<int*> *sharedIntArrays, vector<float*> *sharedFloatArrays,
+    const vector<int> *subset = 0);
 GF::Array *newGFIndexArray(string name, long size, vector<int*> *sharedIntArrays);
+GF::Array *newGFIndexArray(string name, const vector<int> &indexes, vector<int*> *sharedIntArrays);
 
 string getAttributeValue(libdap::BaseType *bt, string aName);
 bool matchesCfRoleOrStandardName(libdap::BaseType *bt, string aValue);
@@ -0,0 +1,349 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <BESDebug.h>
+
+#include "GetOpt.h"
+
+#include "MeshSpatialIndex.h"
+
+#include "test_config.h"
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+using namespace std;
+
+namespace ugrid {
+
+/**
+ * Read the values of a variable from the data section of a CDL file, e.g.,
+ * 'X = -1.0, 0.0, 1.0 ;'.
+ */
+static vector<double> read_cdl_values(const string &cdl_file, const string &name)
+{
+    ifstream in(cdl_file.c_str());
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    string::size_type data = text.find("data:");
+    string::size_type pos = text.find("\n " + name + " =", data);
+    if (data == string::npos || pos == string::npos) return vector<double>();
+
+    pos = text.find('=', pos) + 1;
+    string values = text.substr(pos, text.find(';', pos) - pos);
+    replace(values.begin(), values.end(), ',', ' ');
+
+    vector<double> result;
+    istringstream iss(values);
+    double v;
+    while (iss >> v)
+        result.push_back(v);
+
+    return result;
+}
+
+class MeshSpatialIndexTest: public CppUnit::TestFixture {
+private:
+    vector<double> d_x, d_y;
+    vector<GF::Node> d_cells;   // zero-based, faces x nodes per face
+    int d_faceCount;
+    int d_nodesPerFace;
+
+    MeshSpatialIndex *index()
+    {
+        return new MeshSpatialIndex(d_x, d_y, &d_cells[0], d_faceCount, d_nodesPerFace);
+    }
+
+    static MeshBox box(double xmin, double ymin, double xmax, double ymax)
+    {
+        MeshBox b;
+        b.min[0] = xmin;
+        b.min[1] = ymin;
+        b.max[0] = xmax;
+        b.max[1] = ymax;
+        return b;
+    }
+
+public:
+    MeshSpatialIndexTest() :
+        d_faceCount(0), d_nodesPerFace(0)
+    {
+    }
+
+    ~MeshSpatialIndexTest()
+    {
+    }
+
+    // The mesh in ugrid_test_01: eight triangles around the node (0, 0).
+    // Its face node connectivity is stored (three, faces), with a start
+    // index of one.
+    void setUp()
+    {
+        string cdl = string(TEST_SRC_DIR) + "/../data/ugrid_test_01.cdl";
+        d_x = read_cdl_values(cdl, "X");
+        d_y = read_cdl_values(cdl, "Y");
+        vector<double> fnca = read_cdl_values(cdl, "fnca");
+
+        CPPUNIT_ASSERT(d_x.size() == 9 && d_y.size() == 9 && fnca.size() == 24);
+
+        d_nodesPerFace = 3;
+        d_faceCount = fnca.size() / d_nodesPerFace;
+        d_cells.resize(fnca.size());
+        for (int f = 0; f < d_faceCount; ++f)
+            for (int k = 0; k < d_nodesPerFace; ++k)
+                d_cells[f * d_nodesPerFace + k] = (GF::Node) fnca[k * d_faceCount + f] - 1;
+    }
+
+    void tearDown()
+    {
+    }
+
+    CPPUNIT_TEST_SUITE( MeshSpatialIndexTest );
+
+    CPPUNIT_TEST(build_test);
+    CPPUNIT_TEST(nodes_in_box_test);
+    CPPUNIT_TEST(faces_in_box_test);
+    CPPUNIT_TEST(empty_box_test);
+    CPPUNIT_TEST(fill_value_test);
+    CPPUNIT_TEST(brute_force_test);
+    CPPUNIT_TEST(cache_key_test);
+    CPPUNIT_TEST(cache_test);
+
+    CPPUNIT_TEST_SUITE_END();
+
+    void build_test()
+    {
+        auto_ptr<MeshSpatialIndex> idx(index());
+        CPPUNIT_ASSERT(idx->getNodeCount() == 9);
+        CPPUNIT_ASSERT(idx->getFaceCount() == 8);
+        CPPUNIT_ASSERT(idx->getNodesPerFace() == 3);
+
+        // The second face is nodes 2, 3 and 9 (one-based)
+        const GF::Node *fn = idx->getFaceNodes(1);
+        CPPUNIT_ASSERT(fn[0] == 1 && fn[1] == 2 && fn[2] == 8);
+    }
+
+    void nodes_in_box_test()
+    {
+        auto_ptr<MeshSpatialIndex> idx(index());
+
+        vector<int> nodes;
+        idx->getNodesInBox(box(-0.5, -0.5, 0.5, 0.5), nodes);
+        CPPUNIT_ASSERT(nodes.size() == 1 && nodes[0] == 8);
+
+        // The box is closed; (1, 1), (1.5, 0) and (1, -1) are in it
+        nodes.clear();
+        idx->getNodesInBox(box(1.0, -1.0, 2.0, 1.0), nodes);
+        CPPUNIT_ASSERT(nodes.size() == 3);
+        CPPUNIT_ASSERT(nodes[0] == 2 && nodes[1] == 3 && nodes[2] == 4);
+
+        // Values are appended, sorted
+        idx->getNodesInBox(box(-2.0, -2.0, 2.0, 2.0), nodes);
+        CPPUNIT_ASSERT(nodes.size() == 12);
+        for (int i = 0; i < 9; ++i)
+            CPPUNIT_ASSERT(nodes[3 + i] == i);
+    }
+
+    void faces_in_box_test()
+    {
+        auto_ptr<MeshSpatialIndex> idx(index());
+
+        // Every face has the center node
+        vector<int> faces;
+        idx->getFacesInBox(box(-0.1, -0.1, 0.1, 0.1), faces);
+        CPPUNIT_ASSERT(faces.size() == 8);
+
+        // Only the faces with the node (1.5, 0) reach x = 1.4
+        faces.clear();
+        idx->getFacesInBox(box(1.3, -0.1, 1.6, 0.1), faces);
+        CPPUNIT_ASSERT(faces.size() == 2);
+        CPPUNIT_ASSERT(faces[0] == 2 && faces[1] == 3);
+    }
+
+    void empty_box_test()
+    {
+        auto_ptr<MeshSpatialIndex> idx(index());
+
+        vector<int> nodes, faces;
+        idx->getNodesInBox(box(10.0, 10.0, 11.0, 11.0), nodes);
+        idx->getFacesInBox(box(10.0, 10.0, 11.0, 11.0), faces);
+        CPPUNIT_ASSERT(nodes.empty());
+        CPPUNIT_ASSERT(faces.empty());
+    }
+
+    // Node numbers that are not nodes (e.g., fill values) are ignored
+    void fill_value_test()
+    {
+        d_cells[2] = -1;        // the first face's center node
+        auto_ptr<MeshSpatialIndex> idx(index());
+
+        vector<int> faces;
+        idx->getFacesInBox(box(-0.1, -0.1, 0.1, 0.1), faces);
+        CPPUNIT_ASSERT(faces.size() == 7);
+        CPPUNIT_ASSERT(faces[0] == 1);
+    }
+
+    // Compare the KD-tree with a linear scan for a larger set of nodes
+    void brute_force_test()
+    {
+        const int n = 2000;
+        srand(31);
+        d_x.resize(n);
+        d_y.resize(n);
+        for (int i = 0; i < n; ++i) {
+            d_x[i] = rand() / (double) RAND_MAX * 360.0 - 180.0;
+            d_y[i] = rand() / (double) RAND_MAX * 180.0 - 90.0;
+        }
+        d_faceCount = 0;
+        d_cells.assign(1, 0);
+
+        auto_ptr<MeshSpatialIndex> idx(index());
+
+        MeshBox b = box(-20.0, 10.0, 35.0, 40.0);
+        vector<int> nodes;
+        idx->getNodesInBox(b, nodes);
+
+        vector<int> expected;
+        for (int i = 0; i < n; ++i)
+            if (d_x[i] >= b.min[0] && d_x[i] <= b.max[0] && d_y[i] >= b.min[1] && d_y[i] <= b.max[1])
+                expected.push_back(i);
+
+        DBG(cerr << "brute_force_test() - " << nodes.size() << " nodes in the box" << endl);
+        CPPUNIT_ASSERT(!expected.empty());
+        CPPUNIT_ASSERT(nodes == expected);
+    }
+
+    void cache_key_test()
+    {
+        string dataset = string(TEST_SRC_DIR) + "/../data/ugrid_test_01.nc";
+        string key = MeshSpatialIndex::getCacheKey(dataset, "fvcom_mesh");
+        CPPUNIT_ASSERT(!key.empty());
+        CPPUNIT_ASSERT(key.find(dataset) == 0);
+        CPPUNIT_ASSERT(key != MeshSpatialIndex::getCacheKey(dataset, "other_mesh"));
+
+        // A dataset that is not a file has no key
+        CPPUNIT_ASSERT(MeshSpatialIndex::getCacheKey("http://localhost/ugrid_test_01.nc", "fvcom_mesh").empty());
+
+        // A dataset with the same name, but that has been modified, has a
+        // different key.
+        string copy = string(TEST_BUILD_DIR) + "/mesh_index_test.nc";
+        {
+            ifstream src(dataset.c_str(), ios::binary);
+            ofstream dst(copy.c_str(), ios::binary);
+            dst << src.rdbuf();
+        }
+        struct utimbuf times;
+        times.actime = times.modtime = 1000000000;
+        utime(copy.c_str(), &times);
+        string old_key = MeshSpatialIndex::getCacheKey(copy, "fvcom_mesh");
+        times.actime = times.modtime = 1000000001;
+        utime(copy.c_str(), &times);
+        string new_key = MeshSpatialIndex::getCacheKey(copy, "fvcom_mesh");
+        unlink(copy.c_str());
+
+        CPPUNIT_ASSERT(!old_key.empty());
+        CPPUNIT_ASSERT(old_key != new_key);
+    }
+
+    void cache_test()
+    {
+        MeshSpatialIndex::setCacheEntries(2);
+        CPPUNIT_ASSERT(MeshSpatialIndex::cacheEnabled());
+
+        string key = MeshSpatialIndex::getCacheKey(string(TEST_SRC_DIR) + "/../data/ugrid_test_01.nc", "fvcom_mesh");
+        CPPUNIT_ASSERT(!MeshSpatialIndex::getCached(key));
+
+        MeshSpatialIndex *idx = index();
+        MeshSpatialIndex::addCached(idx, key);
+        CPPUNIT_ASSERT(MeshSpatialIndex::getCached(key) == idx);
+        CPPUNIT_ASSERT(!MeshSpatialIndex::getCached(key + "x"));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MeshSpatialIndexTest);
+
+} // namespace ugrid
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            BESDebug::SetUp("cerr,ugrid");
+            break;
+        case 'h': {     // help - show test names
+            std::cerr << "Usage: MeshSpatialIndexTest has the following tests:" << std::endl;
+            const std::vector<CppUnit::Test*> &tests = ugrid::MeshSpatialIndexTest::suite()->getTests();
+            unsigned int prefix_len = ugrid::MeshSpatialIndexTest::suite()->getName().append("::").length();
+            for (std::vector<CppUnit::Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                std::cerr << (*i)->getName().replace(0, prefix_len, "") << std::endl;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        while (i < argc) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ugrid::MeshSpatialIndexTest::suite()->getName().append("::").append(argv[i++]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
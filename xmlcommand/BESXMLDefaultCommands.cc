@@ -51,6 +51,7 @@
 #include "BESXMLDeleteDefinitionsCommand.h"
 
 #include "ShowPathInfoCommand.h"
+#include "ShowStoredResultCommand.h"
 #include "ShowBesKeyCommand.h"
 #include "ShowBesKeyResponseHandler.h"
 
@@ -114,6 +115,9 @@ int BESXMLDefaultCommands::initialize(int, char**)
     BESDEBUG( "besxml", "    adding " << SHOW_PATH_INFO_RESPONSE_STR << " command" << endl ) ;
     BESXMLCommand::add_command( SHOW_PATH_INFO_RESPONSE_STR, ShowPathInfoCommand::CommandBuilder ) ;
 
+    BESDEBUG( "besxml", "    adding " << SHOW_STORED_RESULT_RESPONSE_STR << " command" << endl ) ;
+    BESXMLCommand::add_command( SHOW_STORED_RESULT_RESPONSE_STR, ShowStoredResultCommand::CommandBuilder ) ;
+
     BESXMLCommand::add_command( SHOW_BES_KEY_RESPONSE_STR, ShowBesKeyCommand::CommandBuilder ) ;
 
     BESDEBUG("besxml", "    adding " << SHOW_BES_KEY_RESPONSE << " response handler" << endl ) ;
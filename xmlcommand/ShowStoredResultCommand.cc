@@ -0,0 +1,92 @@
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+#include "ShowStoredResultCommand.h"
+#include "BESDebug.h"
+#include "BESXMLUtils.h"
+#include "BESSyntaxUserError.h"
+
+using std::endl;
+using std::ostream;
+using std::string;
+using std::map;
+
+#define SHOW_STORED_RESULT_RESPONSE "show.storedResult"
+
+ShowStoredResultCommand::ShowStoredResultCommand(const BESDataHandlerInterface &base_dhi) :
+    BESXMLCommand(base_dhi)
+{
+}
+
+/** @brief parse a showStoredResult command.
+ *
+ &lt;showStoredResult id="stored result id" /&gt;
+ *
+ * @param node xml2 element node pointer
+ */
+void ShowStoredResultCommand::parse_request(xmlNode *node)
+{
+    string name;
+    string value;
+    map<string, string> props;
+    BESXMLUtils::GetNodeInfo(node, name, value, props);
+    if (name != SHOW_STORED_RESULT_RESPONSE_STR) {
+        string err = "The specified command " + name + " is not a " + SHOW_STORED_RESULT_RESPONSE_STR + " command";
+        throw BESSyntaxUserError(err, __FILE__, __LINE__);
+    }
+
+    string id = props["id"];
+    if (id.empty()) {
+        string err = (string) SHOW_STORED_RESULT_RESPONSE_STR + " command: Must specify the stored result id";
+        throw BESSyntaxUserError(err, __FILE__, __LINE__);
+    }
+
+    d_xmlcmd_dhi.action = SHOW_STORED_RESULT_RESPONSE;
+    d_xmlcmd_dhi.data[STORED_RESULT_ID] = id;
+    d_cmd_log_info = "show storedResult for " + id + ";";
+
+    BESDEBUG("besxml", "Built BES Command: '" << d_cmd_log_info << "'"<< endl );
+
+    // now that we've set the action, go get the response handler for the
+    // action by calling set_response() in our parent class
+    BESXMLCommand::set_response();
+}
+
+/** @brief dumps information about this object
+ *
+ * Displays the pointer value of this instance
+ *
+ * @param strm C++ i/o stream to dump the information to
+ */
+void ShowStoredResultCommand::dump(ostream &strm) const
+{
+    strm << BESIndent::LMarg << "ShowStoredResultCommand::dump - (" << (void *) this << ")" << endl;
+    BESIndent::Indent();
+    BESXMLCommand::dump(strm);
+    BESIndent::UnIndent();
+}
+
+BESXMLCommand *
+ShowStoredResultCommand::CommandBuilder(const BESDataHandlerInterface &base_dhi)
+{
+    return new ShowStoredResultCommand(base_dhi);
+}
@@ -0,0 +1,60 @@
+
+// This file is part of bes, A C++ back-end server implementation framework
+// for the OPeNDAP Data Access Protocol.
+
+// Copyright (c) 2020 OPeNDAP, Inc
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+#ifndef A_ShowStoredResultCommand_h
+#define A_ShowStoredResultCommand_h 1
+
+#include "BESXMLCommand.h"
+#include "BESDataHandlerInterface.h"
+
+#define SHOW_STORED_RESULT_RESPONSE_STR "showStoredResult"
+
+#define STORED_RESULT_ID "storedResultId"
+
+/**
+ * @brief Return the status of a stored result
+ *
+ * &lt;showStoredResult id="stored result id" /&gt;
+ *
+ * The id is the one returned (as part of a URL) in the AsyncAccepted
+ * response to a store_result request.
+ */
+class ShowStoredResultCommand: public BESXMLCommand {
+public:
+    ShowStoredResultCommand(const BESDataHandlerInterface &base_dhi);
+    virtual ~ShowStoredResultCommand()
+    {
+    }
+
+    virtual void parse_request(xmlNode *node);
+
+    virtual bool has_response()
+    {
+        return true;
+    }
+
+    virtual void dump(std::ostream &strm) const;
+
+    static BESXMLCommand * CommandBuilder(const BESDataHandlerInterface &base_dhi);
+};
+
+#endif // A_ShowStoredResultCommand_h